@@ -3,7 +3,6 @@
 #include "animation/animation.h"
 #include "animation/controller.h"
 #include "animation/events.h"
-#include "engine/base_proxy_allocator.h"
 #include "engine/blob.h"
 #include "engine/crc32.h"
 #include "engine/engine.h"
@@ -14,6 +13,8 @@
 #include "engine/property_register.h"
 #include "engine/resource_manager.h"
 #include "engine/serializer.h"
+#include "engine/sparse_set.h"
+#include "engine/tag_allocator.h"
 #include "engine/universe/universe.h"
 #include "renderer/model.h"
 #include "renderer/pose.h"
@@ -63,7 +64,7 @@ struct AnimationSystemImpl LUMIX_FINAL : public IPlugin
 	void destroyScene(IScene* scene) override;
 	const char* getName() const override { return "animation"; }
 
-	Lumix::IAllocator& m_allocator;
+	TagAllocator m_allocator;
 	Engine& m_engine;
 	AnimationManager m_animation_manager;
 	Anim::ControllerManager m_controller_manager;
@@ -202,6 +203,8 @@ struct AnimationSceneImpl LUMIX_FINAL : public AnimationScene
 			LUMIX_DELETE(m_anim_system.m_allocator, controller.root);
 		}
 		m_controllers.clear();
+		m_shared_controllers.clear();
+		m_event_stream.clear();
 	}
 
 
@@ -726,7 +729,7 @@ struct AnimationSceneImpl LUMIX_FINAL : public AnimationScene
 	void processEventStream()
 	{
 		InputBlob blob(m_event_stream);
-		u32 set_input_type = crc32("set_input");
+		constexpr u32 set_input_type = constCrc32("set_input");
 		while (blob.getPosition() < blob.getSize())
 		{
 			u32 type;
@@ -815,9 +818,9 @@ struct AnimationSceneImpl LUMIX_FINAL : public AnimationScene
 	Universe& m_universe;
 	AnimationSystemImpl& m_anim_system;
 	Engine& m_engine;
-	AssociativeArray<Entity, Animable> m_animables;
-	AssociativeArray<Entity, Controller> m_controllers;
-	AssociativeArray<Entity, SharedController> m_shared_controllers;
+	SparseSet<Entity, Animable> m_animables;
+	SparseSet<Entity, Controller> m_controllers;
+	SparseSet<Entity, SharedController> m_shared_controllers;
 	RenderScene* m_render_scene;
 	bool m_is_game_running;
 	OutputBlob m_event_stream;
@@ -825,7 +828,7 @@ struct AnimationSceneImpl LUMIX_FINAL : public AnimationScene
 
 
 AnimationSystemImpl::AnimationSystemImpl(Engine& engine)
-	: m_allocator(engine.getAllocator())
+	: m_allocator(engine.getAllocator(), "animation")
 	, m_engine(engine)
 	, m_animation_manager(m_allocator)
 	, m_controller_manager(m_allocator)
@@ -834,27 +837,27 @@ AnimationSystemImpl::AnimationSystemImpl(Engine& engine)
 	m_controller_manager.create(CONTROLLER_RESOURCE_TYPE, m_engine.getResourceManager());
 
 	PropertyRegister::add("anim_controller",
-		LUMIX_NEW(m_allocator, ResourcePropertyDescriptor<AnimationSceneImpl>)("Source",
+		LUMIX_NEW(engine.getAllocator(), ResourcePropertyDescriptor<AnimationSceneImpl>)("Source",
 			&AnimationSceneImpl::getControllerSource,
 			&AnimationSceneImpl::setControllerSource,
 			"Animation controller (*.act)",
 			CONTROLLER_RESOURCE_TYPE));
 
 	PropertyRegister::add("animable",
-		LUMIX_NEW(m_allocator, ResourcePropertyDescriptor<AnimationSceneImpl>)("Animation",
+		LUMIX_NEW(engine.getAllocator(), ResourcePropertyDescriptor<AnimationSceneImpl>)("Animation",
 			&AnimationSceneImpl::getAnimation,
 			&AnimationSceneImpl::setAnimation,
 			"Animation (*.ani)",
 			ANIMATION_TYPE));
 	PropertyRegister::add("animable",
-		LUMIX_NEW(m_allocator, DecimalPropertyDescriptor<AnimationSceneImpl>)(
+		LUMIX_NEW(engine.getAllocator(), DecimalPropertyDescriptor<AnimationSceneImpl>)(
 			"Start time", &AnimationSceneImpl::getStartTime, &AnimationSceneImpl::setStartTime, 0, FLT_MAX, 0.1f));
 	PropertyRegister::add("animable",
-		LUMIX_NEW(m_allocator, DecimalPropertyDescriptor<AnimationSceneImpl>)(
+		LUMIX_NEW(engine.getAllocator(), DecimalPropertyDescriptor<AnimationSceneImpl>)(
 			"Time scale", &AnimationSceneImpl::getTimeScale, &AnimationSceneImpl::setTimeScale, 0, FLT_MAX, 0.1f));
 
 	PropertyRegister::add("shared_anim_controller",
-		LUMIX_NEW(m_allocator, EntityPropertyDescriptor<AnimationSceneImpl>)(
+		LUMIX_NEW(engine.getAllocator(), EntityPropertyDescriptor<AnimationSceneImpl>)(
 			"Parent", &AnimationSceneImpl::getSharedControllerParent, &AnimationSceneImpl::setSharedControllerParent));
 
 
@@ -162,7 +162,7 @@ void Node::removeEvent(int index)
 void Node::onGUI()
 {
 	
-	u32 set_input_type = crc32("set_input");
+	constexpr u32 set_input_type = constCrc32("set_input");
 	ImGui::InputText("Name", name.data, lengthOf(name.data));
 	if (engine_cmp && ImGui::CollapsingHeader("Events"))
 	{
@@ -4,16 +4,21 @@
 #include "engine/debug/debug.h"
 #include "engine/engine.h"
 #include "engine/fs/disk_file_device.h"
+#include "engine/fs/file_events_device.h"
 #include "engine/fs/file_system.h"
 #include "engine/fs/file_system.h"
 #include "engine/fs/memory_file_device.h"
+#include "engine/fs/os_file.h"
+#include "engine/fs/pack_builder.h"
 #include "engine/fs/pack_file_device.h"
 #include "engine/input_system.h"
 #include "engine/log.h"
 #include "engine/lua_wrapper.h"
+#include "engine/mt/sync.h"
 #include "engine/mt/thread.h"
 #include "engine/path_utils.h"
 #include "engine/plugin_manager.h"
+#include "engine/pool_allocator.h"
 #include "engine/profiler.h"
 #include "engine/resource_manager.h"
 #include "engine/resource_manager_base.h"
@@ -63,12 +68,21 @@ class App
 {
 public:
 	App()
-		: m_allocator(m_main_allocator)
+		: m_pool_allocator(m_main_allocator)
+		, m_allocator(isPoolAllocatorEnabled() ? (Lumix::IAllocator&)m_pool_allocator : m_main_allocator)
 		, m_window_mode(false)
 		, m_universe(nullptr)
 		, m_exit_code(0)
 		, m_pipeline(nullptr)
+		, m_profile_capture_frames(0)
+		, m_exit_after_capture(false)
+		, m_is_profile_capture_requested(false)
+		, m_file_events_device(nullptr)
+		, m_load_order_mutex(false)
+		, m_is_recording_load_order(false)
 	{
+		m_profile_capture_path[0] = '\0';
+		m_alloc_report_path[0] = '\0';
 		m_frame_timer = Lumix::Timer::create(m_allocator);
 		ASSERT(!s_instance);
 		s_instance = this;
@@ -214,6 +228,51 @@ public:
 
 				parser.getCurrent(m_startup_script_path, Lumix::lengthOf(m_startup_script_path));
 			}
+			else if (parser.currentEquals("-profile_capture"))
+			{
+				// the app still creates its window and renderer, there is no headless capture
+				m_is_profile_capture_requested = true;
+				if (!parser.next()) break;
+
+				char tmp[16];
+				parser.getCurrent(tmp, Lumix::lengthOf(tmp));
+				Lumix::fromCString(tmp, Lumix::stringLength(tmp), &m_profile_capture_frames);
+				if (!parser.next()) break;
+
+				parser.getCurrent(m_profile_capture_path, Lumix::lengthOf(m_profile_capture_path));
+			}
+			else if (parser.currentEquals("-profile_exit"))
+			{
+				m_exit_after_capture = true;
+			}
+			else if (parser.currentEquals("-record_load_order"))
+			{
+				if (!parser.next()) break;
+
+				char tmp[Lumix::MAX_PATH_LENGTH];
+				parser.getCurrent(tmp, Lumix::lengthOf(tmp));
+				if (!m_load_order_file.open(tmp, Lumix::FS::Mode::CREATE_AND_WRITE, m_allocator))
+				{
+					Lumix::g_log_error.log("App") << "Could not create " << tmp;
+				}
+				else
+				{
+					m_is_recording_load_order = true;
+				}
+			}
+			else if (parser.currentEquals("-alloc_sampling"))
+			{
+				if (!parser.next()) break;
+
+				char tmp[16];
+				parser.getCurrent(tmp, Lumix::lengthOf(tmp));
+				int interval = 0;
+				Lumix::fromCString(tmp, Lumix::stringLength(tmp), &interval);
+				m_allocator.getSampler().setInterval(interval);
+				if (!parser.next()) break;
+
+				parser.getCurrent(m_alloc_report_path, Lumix::lengthOf(m_alloc_report_path));
+			}
 		}
 
 		createWindow();
@@ -240,7 +299,17 @@ public:
 		m_file_system->mount(m_disk_file_device);
 		m_file_system->mount(m_pack_file_device);
 		m_pack_file_device->mount("data.pak");
-		m_file_system->setDefaultDevice("memory:disk:pack");
+		if (m_is_recording_load_order)
+		{
+			m_file_events_device = LUMIX_NEW(m_allocator, Lumix::FS::FileEventsDevice)(m_allocator);
+			m_file_events_device->OnEvent.bind<App, &App::onFileEvent>(this);
+			m_file_system->mount(m_file_events_device);
+			m_file_system->setDefaultDevice("memory:events:disk:pack");
+		}
+		else
+		{
+			m_file_system->setDefaultDevice("memory:disk:pack");
+		}
 		m_file_system->setSaveGameDevice("memory:disk");
 
 		m_engine = Lumix::Engine::create(current_dir, "", m_file_system, m_allocator);
@@ -379,6 +448,95 @@ public:
 	}
 
 
+	// called from IO threads
+	void onFileEvent(const Lumix::FS::Event& event)
+	{
+		if (event.type != Lumix::FS::EventType::OPEN_FINISHED || event.ret != 1) return;
+		if ((event.param & Lumix::FS::Mode::READ) == 0) return;
+
+		Lumix::MT::SpinLock lock(m_load_order_mutex);
+		m_load_order_file.write(event.path, Lumix::stringLength(event.path));
+		m_load_order_file.write("\n", 1);
+	}
+
+
+	// -pool_allocator makes the engine use PoolAllocator instead of DefaultAllocator
+	static bool isPoolAllocatorEnabled()
+	{
+		char cmd_line[1024];
+		Lumix::getCommandLine(cmd_line, Lumix::lengthOf(cmd_line));
+		Lumix::CommandLineParser parser(cmd_line);
+		while (parser.next())
+		{
+			if (parser.currentEquals("-pool_allocator")) return true;
+		}
+		return false;
+	}
+
+
+	// -pack <dest> <file list> [-pack_load_order <file>] [-pack_no_compression] [-pack_alignment <n>]
+	// builds the pack without starting the engine, returns false if there is no -pack on the command line
+	bool buildPack()
+	{
+		char dest[Lumix::MAX_PATH_LENGTH] = {};
+		char list[Lumix::MAX_PATH_LENGTH] = {};
+		char load_order[Lumix::MAX_PATH_LENGTH] = {};
+		bool compress = true;
+		int alignment = 16;
+		char cmd_line[1024];
+		Lumix::getCommandLine(cmd_line, Lumix::lengthOf(cmd_line));
+		Lumix::CommandLineParser parser(cmd_line);
+		while (parser.next())
+		{
+			if (parser.currentEquals("-pack"))
+			{
+				if (!parser.next()) break;
+				parser.getCurrent(dest, Lumix::lengthOf(dest));
+				if (!parser.next()) break;
+				parser.getCurrent(list, Lumix::lengthOf(list));
+			}
+			else if (parser.currentEquals("-pack_load_order"))
+			{
+				if (!parser.next()) break;
+				parser.getCurrent(load_order, Lumix::lengthOf(load_order));
+			}
+			else if (parser.currentEquals("-pack_no_compression"))
+			{
+				compress = false;
+			}
+			else if (parser.currentEquals("-pack_alignment"))
+			{
+				if (!parser.next()) break;
+
+				char tmp[16];
+				parser.getCurrent(tmp, Lumix::lengthOf(tmp));
+				Lumix::fromCString(tmp, Lumix::stringLength(tmp), &alignment);
+			}
+		}
+		if (!dest[0]) return false;
+
+		Lumix::g_log_info.getCallback().bind<outputToConsole>();
+		Lumix::g_log_warning.getCallback().bind<outputToConsole>();
+		Lumix::g_log_error.getCallback().bind<outputToConsole>();
+
+		m_exit_code = 1;
+		Lumix::FS::PackBuilder builder(m_allocator);
+		if (!builder.addFiles(list))
+		{
+			Lumix::g_log_error.log("App") << "Could not read " << list;
+			return true;
+		}
+		if (load_order[0] && !builder.setLoadOrder(load_order))
+		{
+			Lumix::g_log_error.log("App") << "Could not read " << load_order;
+			return true;
+		}
+		alignment = Lumix::Math::nextPow2(Lumix::Math::maximum(alignment, 1));
+		if (builder.build(dest, alignment, compress)) m_exit_code = 0;
+		return true;
+	}
+
+
 	void shutdown()
 	{
 		auto* gui_system = static_cast<Lumix::GUISystem*>(m_engine->getPluginManager().getPlugin("gui"));
@@ -390,11 +548,18 @@ public:
 		LUMIX_DELETE(m_allocator, m_disk_file_device);
 		LUMIX_DELETE(m_allocator, m_mem_file_device);
 		LUMIX_DELETE(m_allocator, m_pack_file_device);
+		LUMIX_DELETE(m_allocator, m_file_events_device);
+		if (m_is_recording_load_order) m_load_order_file.close();
 		Lumix::Pipeline::destroy(m_pipeline);
 		Lumix::Engine::destroy(m_engine, m_allocator);
 		m_engine = nullptr;
 		m_pipeline = nullptr;
 		m_universe = nullptr;
+
+		if (m_alloc_report_path[0] && !m_allocator.getSampler().saveReport(m_alloc_report_path))
+		{
+			Lumix::g_log_error.log("App") << "Could not save allocation report " << m_alloc_report_path;
+		}
 	}
 
 
@@ -480,12 +645,54 @@ public:
 			Lumix::MT::sleep(Lumix::u32(1000 / 60.0f - frame_time * 1000));
 		}
 		handleEvents();
+		Lumix::Profiler::frame();
+		checkProfileCapture();
+	}
+
+
+	// writes the binary capture and its chrome://tracing conversion next to it
+	void checkProfileCapture()
+	{
+		if (m_profile_capture_frames <= 0 || Lumix::Profiler::isCapturing()) return;
+
+		m_profile_capture_frames = 0;
+		Lumix::StaticString<Lumix::MAX_PATH_LENGTH + 5> json_path(m_profile_capture_path, ".json");
+		if (!Lumix::Profiler::saveCapture(m_profile_capture_path))
+		{
+			Lumix::g_log_error.log("App") << "Could not save profiler capture to " << m_profile_capture_path;
+		}
+		if (!Lumix::Profiler::saveCaptureAsChromeTrace(json_path))
+		{
+			Lumix::g_log_error.log("App") << "Could not save profiler capture to " << json_path;
+		}
+		// leave the main loop, shutdown() destroys the engine and plugins as usual
+		if (m_exit_after_capture) m_finished = true;
+	}
+
+
+	void startProfileCapture()
+	{
+		if (!m_is_profile_capture_requested) return;
+
+		if (m_profile_capture_frames <= 0 || m_profile_capture_path[0] == '\0')
+		{
+			Lumix::g_log_error.log("App") << "-profile_capture expects <frames> <path> with frames > 0";
+			m_profile_capture_frames = 0;
+			if (m_exit_after_capture)
+			{
+				m_exit_code = 1;
+				m_finished = true;
+			}
+			return;
+		}
+		Lumix::Profiler::startCapture(m_profile_capture_frames);
 	}
 
 
 	void run()
 	{
 		m_finished = false;
+		startProfileCapture();
 		while (!m_finished)
 		{
 			frame();
@@ -495,6 +702,7 @@ public:
 
 private:
 	Lumix::DefaultAllocator m_main_allocator;
+	Lumix::PoolAllocator m_pool_allocator;
 	Lumix::Debug::Allocator m_allocator;
 	Lumix::Engine* m_engine;
 	char m_universe_path[Lumix::MAX_PATH_LENGTH];
@@ -504,6 +712,10 @@ private:
 	Lumix::FS::MemoryFileDevice* m_mem_file_device;
 	Lumix::FS::DiskFileDevice* m_disk_file_device;
 	Lumix::FS::PackFileDevice* m_pack_file_device;
+	Lumix::FS::FileEventsDevice* m_file_events_device;
+	Lumix::FS::OsFile m_load_order_file;
+	Lumix::MT::SpinMutex m_load_order_mutex;
+	bool m_is_recording_load_order;
 	Lumix::Timer* m_frame_timer;
 	GUIInterface* m_gui_interface;
 	bool m_finished;
@@ -511,6 +723,11 @@ private:
 	int m_exit_code;
 	char m_startup_script_path[Lumix::MAX_PATH_LENGTH];
 	char m_pipeline_path[Lumix::MAX_PATH_LENGTH];
+	int m_profile_capture_frames;
+	char m_profile_capture_path[Lumix::MAX_PATH_LENGTH];
+	bool m_exit_after_capture;
+	bool m_is_profile_capture_requested;
+	char m_alloc_report_path[Lumix::MAX_PATH_LENGTH];
 	HWND m_hwnd;
 
 	static App* s_instance;
@@ -523,6 +740,7 @@ App* App::s_instance = nullptr;
 INT WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, INT)
 {
 	App app;
+	if (app.buildPack()) return app.getExitCode();
 	app.init();
 	app.run();
 	app.shutdown();
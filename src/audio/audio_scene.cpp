@@ -13,6 +13,7 @@
 #include "engine/resource_manager.h"
 #include "engine/resource_manager_base.h"
 #include "engine/serializer.h"
+#include "engine/sparse_set.h"
 #include "engine/universe/universe.h"
 #include "lua_script/lua_script_system.h"
 
@@ -178,6 +179,7 @@ struct AudioSceneImpl LUMIX_FINAL : public AudioScene
 	{
 		for (auto* clip : m_clips)
 		{
+			if (!clip) continue;
 			clip->clip->getResourceManager().unload(*clip->clip);
 			LUMIX_DELETE(m_allocator, clip);
 		}
@@ -200,7 +202,7 @@ struct AudioSceneImpl LUMIX_FINAL : public AudioScene
 		if (!m_animation_scene) return;
 		
 		InputBlob blob(m_animation_scene->getEventStream());
-		u32 sound_type = crc32("sound");
+		constexpr u32 sound_type = constCrc32("sound");
 		while (blob.getPosition() < blob.getSize())
 		{
 			u32 type;
@@ -712,8 +714,8 @@ struct AudioSceneImpl LUMIX_FINAL : public AudioScene
 	Universe& getUniverse() override { return m_universe; }
 	IPlugin& getPlugin() const override { return m_system; }
 
-	AssociativeArray<Entity, AmbientSound> m_ambient_sounds;
-	AssociativeArray<Entity, EchoZone> m_echo_zones;
+	SparseSet<Entity, AmbientSound> m_ambient_sounds;
+	SparseSet<Entity, EchoZone> m_echo_zones;
 	AudioDevice& m_device;
 	Listener m_listener;
 	IAllocator& m_allocator;
@@ -15,6 +15,7 @@
 #include "engine/property_descriptor.h"
 #include "engine/property_register.h"
 #include "engine/resource_manager.h"
+#include "engine/tag_allocator.h"
 #include "renderer/render_scene.h"
 
 
@@ -58,8 +59,9 @@ static void registerProperties(Lumix::IAllocator& allocator)
 struct AudioSystemImpl LUMIX_FINAL : public AudioSystem
 {
 	explicit AudioSystemImpl(Engine& engine)
-		: m_engine(engine)
-		, m_manager(engine.getAllocator())
+		: m_allocator(engine.getAllocator(), "audio")
+		, m_engine(engine)
+		, m_manager(m_allocator)
 		, m_device(nullptr)
 	{
 		registerProperties(engine.getAllocator());
@@ -86,7 +88,7 @@ struct AudioSystemImpl LUMIX_FINAL : public AudioSystem
 
 	void createScenes(Universe& ctx) override
 	{
-		auto* scene = AudioScene::createInstance(*this, ctx, m_engine.getAllocator());
+		auto* scene = AudioScene::createInstance(*this, ctx, m_allocator);
 		ctx.addScene(scene);
 	}
 
@@ -94,6 +96,7 @@ struct AudioSystemImpl LUMIX_FINAL : public AudioSystem
 	void destroyScene(IScene* scene) override { AudioScene::destroyInstance(static_cast<AudioScene*>(scene)); }
 
 
+	TagAllocator m_allocator;
 	ClipManager m_manager;
 	Engine& m_engine;
 	AudioDevice* m_device;
@@ -10,6 +10,7 @@
 #include "engine/resource.h"
 #include "engine/resource_manager.h"
 #include "engine/resource_manager_base.h"
+#include "engine/tag_allocator.h"
 #include "engine/timer.h"
 #include "engine/debug/debug.h"
 #include "engine/engine.h"
@@ -320,6 +321,8 @@ struct ProfilerUIImpl LUMIX_FINAL : public ProfilerUI
 		{
 			onGUICPUProfiler();
 			onGUIMemoryProfiler();
+			onGUIMemoryTags();
+			onGUIAllocationSampling();
 			onGUIResources();
 			onGUIFileSystem();
 		}
@@ -417,6 +420,8 @@ struct ProfilerUIImpl LUMIX_FINAL : public ProfilerUI
 
 	void onGUICPUProfiler();
 	void onGUIMemoryProfiler();
+	void onGUIMemoryTags();
+	void onGUIAllocationSampling();
 	void onGUIResources();
 	void onFrame();
 	void showProfileBlock(Block* block, int column);
@@ -785,6 +790,101 @@ void ProfilerUIImpl::saveResourceList()
 }
 
 
+void ProfilerUIImpl::onGUIMemoryTags()
+{
+	if (!ImGui::CollapsingHeader("Memory by subsystem")) return;
+
+	Lumix::TagAllocator::Stats stats[64];
+	int count = Lumix::Math::minimum(Lumix::TagAllocator::getStats(stats, Lumix::lengthOf(stats)), Lumix::lengthOf(stats));
+
+	ImGui::Columns(6, "memory_tags");
+	ImGui::Text("Subsystem");
+	ImGui::NextColumn();
+	ImGui::Text("Size (KB)");
+	ImGui::NextColumn();
+	ImGui::Text("Peak (KB)");
+	ImGui::NextColumn();
+	ImGui::Text("Allocations");
+	ImGui::NextColumn();
+	ImGui::Text("Allocs / frame");
+	ImGui::NextColumn();
+	ImGui::Text("KB / frame");
+	ImGui::NextColumn();
+	ImGui::Separator();
+	for (int i = 0; i < count; ++i)
+	{
+		const auto& tag = stats[i];
+		ImGui::Text("%s", tag.tag);
+		ImGui::NextColumn();
+		ImGui::Text("%.3f", tag.size / 1024.0f);
+		ImGui::NextColumn();
+		ImGui::Text("%.3f", tag.peak / 1024.0f);
+		ImGui::NextColumn();
+		ImGui::Text("%d", tag.allocation_count);
+		ImGui::NextColumn();
+		ImGui::Text("%d", tag.frame_allocation_count);
+		ImGui::NextColumn();
+		ImGui::Text("%.3f", tag.frame_allocated_size / 1024.0f);
+		ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+}
+
+
+void ProfilerUIImpl::onGUIAllocationSampling()
+{
+	if (!ImGui::CollapsingHeader("Allocation sampling")) return;
+
+	auto& sampler = m_main_allocator.getSampler();
+	int interval = (int)sampler.getInterval();
+	if (ImGui::InputInt("Interval (B)", &interval, 1024, 64 * 1024))
+	{
+		sampler.setInterval(Lumix::Math::maximum(interval, 0));
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Clear")) sampler.clear();
+	ImGui::SameLine();
+	if (ImGui::Button("Save report"))
+	{
+		if (!sampler.saveReport("allocation_samples.txt"))
+		{
+			Lumix::g_log_error.log("Profiler") << "Could not save allocation_samples.txt";
+		}
+	}
+
+	Lumix::Debug::AllocationSampler::Site sites[32];
+	int count = Lumix::Math::minimum(sampler.getSites(sites, Lumix::lengthOf(sites)), Lumix::lengthOf(sites));
+	for (int i = 0; i < count; ++i)
+	{
+		const auto& site = sites[i];
+		ImGui::PushID(i);
+		bool is_open = ImGui::TreeNode("site",
+			"%.3fKB in %u samples, live %.3fKB",
+			site.size / 1024.0f,
+			site.count,
+			site.live_size / 1024.0f);
+		if (is_open)
+		{
+			for (auto* node = site.stack_leaf; node; node = Lumix::Debug::StackTree::getParent(node))
+			{
+				char fn_name[256];
+				int line;
+				if (Lumix::Debug::StackTree::getFunction(node, fn_name, Lumix::lengthOf(fn_name), &line))
+				{
+					ImGui::Text("%s (%d)", fn_name, line);
+				}
+				else
+				{
+					ImGui::Text("N/A");
+				}
+			}
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
+	}
+}
+
+
 void ProfilerUIImpl::onGUIResources()
 {
 	if (!ImGui::CollapsingHeader("Resources")) return;
@@ -814,6 +914,19 @@ void ProfilerUIImpl::onGUIResources()
 		auto* resource_manager = m_resource_manager.get(resource_types[i]);
 		auto& resources = resource_manager->getResourceTable();
 
+		auto stats = resource_manager->getMemoryStats();
+		ImGui::Text("Used: %.3fKB, cached: %.3fKB, evicted: %u",
+			stats.used / 1024.0f,
+			stats.cached / 1024.0f,
+			stats.evicted_count);
+		int budget_mb = int(stats.budget >> 20);
+		ImGui::PushID(manager_names[i]);
+		if (ImGui::InputInt("Budget (MB)", &budget_mb))
+		{
+			resource_manager->setMemoryBudget(size_t(Lumix::Math::maximum(budget_mb, 0)) << 20);
+		}
+		ImGui::PopID();
+
 		ImGui::Columns(4, "resc");
 		ImGui::Text("Path");
 		ImGui::NextColumn();
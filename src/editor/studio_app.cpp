@@ -16,11 +16,13 @@
 #include "engine/fs/disk_file_device.h"
 #include "engine/fs/file_system.h"
 #include "engine/fs/os_file.h"
+#include "engine/fs/pack_builder.h"
 #include "engine/input_system.h"
 #include "engine/log.h"
 #include "engine/lua_wrapper.h"
 #include "engine/mt/thread.h"
 #include "engine/path_utils.h"
+#include "engine/pool_allocator.h"
 #include "engine/plugin_manager.h"
 #include "engine/profiler.h"
 #include "engine/property_register.h"
@@ -139,13 +141,18 @@ public:
 		, m_confirm_new(false)
 		, m_confirm_exit(false)
 		, m_exit_code(0)
-		, m_allocator(m_main_allocator)
+		, m_pool_allocator(m_main_allocator)
+		, m_allocator(isPoolAllocatorEnabled() ? (IAllocator&)m_pool_allocator : m_main_allocator)
 		, m_universes(m_allocator)
 	{
 		m_add_cmp_root.label[0] = '\0';
 		m_drag_data = {DragData::NONE, nullptr, 0};
 		m_template_name[0] = '\0';
 		m_open_filter[0] = '\0';
+		m_pack.mode = PackConfig::Mode::ALL_FILES;
+		m_pack.compress = true;
+		m_pack.alignment = 16;
+		m_alloc_report_path[0] = '\0';
 		init();
 		registerComponent("hierarchy", "Hierarchy");
 	}
@@ -195,6 +202,9 @@ public:
 
 		SDL_DestroyWindow(m_window);
 		SDL_Quit();
+
+		// live samples are leaks, except allocations of this object
+		if (m_alloc_report_path[0]) m_allocator.getSampler().saveReport(m_alloc_report_path);
 	}
 
 
@@ -1468,6 +1478,21 @@ public:
 		}
 	}
 
+	// -pool_allocator makes the engine use PoolAllocator instead of DefaultAllocator
+	static bool isPoolAllocatorEnabled()
+	{
+		char cmd_line[2048];
+		getCommandLine(cmd_line, lengthOf(cmd_line));
+
+		CommandLineParser parser(cmd_line);
+		while (parser.next())
+		{
+			if (parser.currentEquals("-pool_allocator")) return true;
+		}
+		return false;
+	}
+
+
 	bool shouldSleepWhenInactive()
 	{
 		char cmd_line[2048];
@@ -1631,6 +1656,30 @@ public:
 	}
 
 
+	// -alloc_sampling <interval in bytes> <report path>
+	void checkAllocSamplingCommandLine()
+	{
+		char command_line[1024];
+		getCommandLine(command_line, lengthOf(command_line));
+		CommandLineParser parser(command_line);
+		while (parser.next())
+		{
+			if (!parser.currentEquals("-alloc_sampling")) continue;
+			if (!parser.next()) break;
+
+			char tmp[16];
+			parser.getCurrent(tmp, lengthOf(tmp));
+			int interval = 0;
+			fromCString(tmp, stringLength(tmp), &interval);
+			m_allocator.getSampler().setInterval(interval);
+			if (!parser.next()) break;
+
+			parser.getCurrent(m_alloc_report_path, lengthOf(m_alloc_report_path));
+			break;
+		}
+	}
+
+
 	void checkScriptCommandLine()
 	{
 		char command_line[1024];
@@ -1795,6 +1844,18 @@ public:
 			}
 
 			ImGui::Combo("Mode", (int*)&m_pack.mode, "All files\0Loaded universe\0");
+			ImGui::Checkbox("Compress", &m_pack.compress);
+			if (ImGui::InputInt("Alignment", &m_pack.alignment))
+			{
+				m_pack.alignment = Math::nextPow2(Math::maximum(m_pack.alignment, 1));
+			}
+			ImGui::LabelText("Load order", "%s", m_pack.load_order.data);
+			ImGui::SameLine();
+			if (ImGui::Button("Choose file"))
+			{
+				PlatformInterface::getOpenFilename(
+					m_pack.load_order.data, lengthOf(m_pack.load_order.data), "Text files\0*.txt\0", nullptr);
+			}
 
 			if (ImGui::Button("Pack")) packData();
 		}
@@ -1827,56 +1888,21 @@ public:
 			return;
 		}
 
-		FS::OsFile file;
-		if (!file.open(dest, FS::Mode::CREATE_AND_WRITE, m_allocator))
-		{
-			g_log_error.log("Editor") << "Could not create " << dest;
-			return;
-		}
-
-		int count = infos.size();
-		file.write(&count, sizeof(count));
-		u64 offset = sizeof(count) + (sizeof(u32) + sizeof(u64) * 2) * count;
+		FS::PackBuilder builder(m_allocator);
 		for (auto& info : infos)
 		{
-			info.offset = offset;
-			offset += info.size;
+			builder.addFile(info.path);
 		}
-
-		for (auto& info : infos)
+		if (!m_pack.load_order.empty() && !builder.setLoadOrder(m_pack.load_order))
 		{
-			file.write(&info.hash, sizeof(info.hash));
-			file.write(&info.offset, sizeof(info.offset));
-			file.write(&info.size, sizeof(info.size));
+			g_log_warning.log("Editor") << "Could not read load order " << m_pack.load_order;
 		}
-
-		for (auto& info : infos)
+		if (!builder.build(dest, m_pack.alignment, m_pack.compress))
 		{
-			FS::OsFile src;
-			size_t src_size = PlatformInterface::getFileSize(info.path);
-			if (!src.open(info.path, FS::Mode::OPEN_AND_READ, m_allocator))
-			{
-				file.close();
-				g_log_error.log("Editor") << "Could not open " << info.path;
-				return;
-			}
-			u8 buf[4096];
-			for (; src_size > 0; src_size -= Math::minimum(sizeof(buf), src_size))
-			{
-				size_t batch_size = Math::minimum(sizeof(buf), src_size);
-				if (!src.read(buf, batch_size))
-				{
-					file.close();
-					g_log_error.log("Editor") << "Could not read " << info.path;
-					return;
-				}
-				file.write(buf, batch_size);
-			}
-			src.close();
+			g_log_error.log("Editor") << "Could not create " << dest;
+			return;
 		}
 
-		file.close();
-
 		const char* bin_files[] = {
 			"app.exe",
 			"assimp.dll",
@@ -1912,14 +1938,14 @@ public:
 		if (file.open(path, FS::Mode::OPEN_AND_READ, m_allocator))
 		{
 			auto size = file.size();
-			auto* src = (char*)m_engine->getLIFOAllocator().allocate(size + 1);
+			auto* src = (char*)m_engine->getFrameAllocator().allocate(size + 1);
 			file.read(src, size);
 			src[size] = 0;
 			
 			LuaPlugin* plugin = LUMIX_NEW(m_editor->getAllocator(), LuaPlugin)(*this, src, filename);
 			addPlugin(*plugin);
 
-			m_engine->getLIFOAllocator().deallocate(src);
+			m_engine->getFrameAllocator().deallocate(src);
 			file.close();
 		}
 		else
@@ -2136,6 +2162,7 @@ public:
 
 	void init()
 	{
+		checkAllocSamplingCommandLine();
 		SDL_SetMainReady();
 		SDL_Init(SDL_INIT_VIDEO);
 
@@ -2262,6 +2289,7 @@ public:
 
 
 	DefaultAllocator m_main_allocator;
+	PoolAllocator m_pool_allocator;
 	Debug::Allocator m_allocator;
 	Engine* m_engine;
 	SDL_Window* m_window;
@@ -2286,6 +2314,7 @@ public:
 	Settings m_settings;
 	Metadata m_metadata;
 	char m_template_name[100];
+	char m_alloc_report_path[MAX_PATH_LENGTH];
 	char m_open_filter[64];
 	char m_component_filter[32];
 
@@ -2298,7 +2327,11 @@ public:
 		};
 
 		Mode mode;
+		bool compress;
+		int alignment;
 		StaticString<MAX_PATH_LENGTH> dest_dir;
+		// recorded by the app with -record_load_order
+		StaticString<MAX_PATH_LENGTH> load_order;
 	};
 
 	PackConfig m_pack;
@@ -2340,15 +2340,40 @@ public:
 		else
 		{
 			m_selected_entity_on_game_mode = m_selected_entities.empty() ? INVALID_ENTITY : m_selected_entities[0];
-			auto& fs = m_engine->getFileSystem();
-			m_game_mode_file = fs.open(fs.getMemoryDevice(), Path(""), FS::Mode::WRITE);
-			save(*m_game_mode_file);
+			saveGameModeSnapshot();
 			m_is_game_mode = true;
 			m_engine->startGame(*m_universe);
 		}
 	}
 
 
+	// same data as save(), but without the header, hashes and checks, since it's restored
+	// in the same process with the same plugins
+	void saveGameModeSnapshot()
+	{
+		PROFILE_FUNCTION();
+		while (m_engine->getFileSystem().hasWork()) m_engine->getFileSystem().updateAsyncTransactions();
+
+		m_game_mode_snapshot.clear();
+		m_engine->serializeSnapshot(*m_universe, m_game_mode_snapshot);
+		m_entity_groups.serialize(m_game_mode_snapshot);
+		m_prefab_system->serialize(m_game_mode_snapshot);
+	}
+
+
+	void loadGameModeSnapshot()
+	{
+		PROFILE_FUNCTION();
+		m_is_loading = true;
+		InputBlob blob(m_game_mode_snapshot);
+		m_engine->deserializeSnapshot(*m_universe, blob);
+		m_entity_groups.deserialize(blob);
+		m_prefab_system->deserialize(blob);
+		m_camera = m_render_interface->getCameraEntity(m_render_interface->getCameraInSlot("editor"));
+		m_is_loading = false;
+	}
+
+
 	void stopGameMode(bool reload)
 	{
 		ASSERT(m_universe);
@@ -2361,22 +2386,16 @@ public:
 		if (reload)
 		{
 			m_universe_destroyed.invoke();
-			m_game_mode_file->seek(FS::SeekMode::BEGIN, 0);
 			m_entity_groups.setUniverse(nullptr);
-			StaticString<64> name(m_universe->getName());
-			m_engine->destroyUniverse(*m_universe);
-			
-			m_universe = &m_engine->createUniverse(true);
+			// the universe and its scenes are reused, only their content is replaced
+			m_universe->clear();
 			m_universe_created.invoke();
-			m_universe->setName(name);
-			m_universe->entityDestroyed().bind<WorldEditorImpl, &WorldEditorImpl::onEntityDestroyed>(this);
 			m_selected_entities.clear();
 			m_entity_groups.setUniverse(m_universe);
 			m_camera = INVALID_ENTITY;
-			load(*m_game_mode_file);
+			loadGameModeSnapshot();
 		}
-		m_engine->getFileSystem().close(*m_game_mode_file);
-		m_game_mode_file = nullptr;
+		m_game_mode_snapshot.clear();
 		if(isValid(m_selected_entity_on_game_mode)) selectEntities(&m_selected_entity_on_game_mode, 1);
 		m_engine->getResourceManager().enableUnload(true);
 	}
@@ -2676,6 +2695,7 @@ public:
 		, m_plugins(m_allocator)
 		, m_undo_stack(m_allocator)
 		, m_copy_buffer(m_allocator)
+		, m_game_mode_snapshot(m_allocator)
 		, m_camera(INVALID_ENTITY)
 		, m_editor_command_creators(m_allocator)
 		, m_is_loading(false)
@@ -3389,7 +3409,7 @@ private:
 	bool m_is_orbit;
 	bool m_is_additive_selection;
 	bool m_is_snap_mode;
-	FS::IFile* m_game_mode_file;
+	OutputBlob m_game_mode_snapshot;
 	Engine* m_engine;
 	Entity m_camera;
 	Entity m_selected_entity_on_game_mode;
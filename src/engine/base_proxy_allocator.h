@@ -70,6 +70,7 @@ public:
 
 
 	IAllocator& getSourceAllocator() { return m_source; }
+	int getAllocationCount() const { return m_allocation_count; }
 
 private:
 	IAllocator& m_source;
@@ -13,4 +13,27 @@ LUMIX_ENGINE_API u32 crc32(const char* str);
 LUMIX_ENGINE_API u32 continueCrc32(u32 original_crc, const char* str);
 
 
+namespace Detail
+{
+	constexpr u32 crc32Bits(u32 crc, int bits)
+	{
+		return bits == 0 ? crc : crc32Bits((crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1))), bits - 1);
+	}
+
+
+	constexpr u32 constCrc32(u32 crc, const char* str)
+	{
+		return *str ? constCrc32(crc32Bits(crc ^ (u8)*str, 8), str + 1) : ~crc;
+	}
+}
+
+
+// same value as crc32(str), but can be evaluated at compile time, e.g.
+// constexpr u32 TYPE_HASH = constCrc32("set_input");
+constexpr u32 constCrc32(const char* str)
+{
+	return Detail::constCrc32(0xffffFFFF, str);
+}
+
+
 } // namespace Lumix
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "engine/debug/debug.h"
+#include "engine/array.h"
+#include "engine/fs/os_file.h"
+#include "engine/hash_map.h"
+#include "engine/math_utils.h"
+#include "engine/mt/atomic.h"
+#include "engine/string.h"
+#include <cstdlib>
+
+
+namespace Lumix
+{
+
+
+namespace Debug
+{
+
+
+// bytes left until the next sample, shared by all samplers
+static thread_local i64 s_bytes_until_sample = 0;
+static thread_local bool s_is_countdown_started = false;
+static thread_local u32 s_random_state = 0;
+
+
+struct Sample
+{
+	StackNode* stack_leaf;
+	size_t size;
+};
+
+
+struct AllocationSampler::Impl
+{
+	explicit Impl(IAllocator& _allocator)
+		: allocator(_allocator)
+		, mutex(false)
+		, samples(_allocator)
+		, sites(_allocator)
+	{
+	}
+
+	IAllocator& allocator;
+	MT::SpinMutex mutex;
+	StackTree stack_tree;
+	HashMap<void*, Sample> samples;
+	HashMap<void*, Site> sites;
+};
+
+
+static int getBucket(void* ptr)
+{
+	return HashFunc<void*>::get(ptr) & 4095;
+}
+
+
+// uniformly distributed in [1, 2 * interval], so the mean distance between samples is the interval
+// and regular allocation patterns do not always hit or always miss the same call site
+static i64 getNextSampleDistance(size_t interval)
+{
+	if (s_random_state == 0) s_random_state = (u32)(uintptr)&s_random_state | 1;
+	s_random_state ^= s_random_state << 13;
+	s_random_state ^= s_random_state >> 17;
+	s_random_state ^= s_random_state << 5;
+	return 1 + i64(s_random_state % (2 * interval));
+}
+
+
+AllocationSampler::AllocationSampler(IAllocator& allocator)
+	: m_interval(0)
+	, m_live_count(0)
+{
+	static_assert(BUCKETS_COUNT == 4096, "getBucket uses the mask");
+	m_impl = LUMIX_NEW(allocator, Impl)(allocator);
+	for (volatile i32& bucket : m_buckets) bucket = 0;
+}
+
+
+AllocationSampler::~AllocationSampler()
+{
+	LUMIX_DELETE(m_impl->allocator, m_impl);
+}
+
+
+void AllocationSampler::sample(void* ptr, size_t size)
+{
+	size_t interval = m_interval;
+	if (interval == 0) return;
+
+	// starting at zero would sample the first allocation of every thread
+	if (!s_is_countdown_started)
+	{
+		s_bytes_until_sample = getNextSampleDistance(interval);
+		s_is_countdown_started = true;
+	}
+	s_bytes_until_sample -= size;
+	if (s_bytes_until_sample > 0) return;
+	s_bytes_until_sample = getNextSampleDistance(interval);
+
+	Sample sample;
+	sample.size = Math::maximum(size, interval);
+	MT::SpinLock lock(m_impl->mutex);
+	sample.stack_leaf = m_impl->stack_tree.record();
+	m_impl->samples.insert(ptr, sample);
+
+	auto iter = m_impl->sites.find(sample.stack_leaf);
+	Site* site;
+	if (iter.isValid())
+	{
+		site = &iter.value();
+	}
+	else
+	{
+		Site new_site = {sample.stack_leaf, 0, 0, 0, 0};
+		m_impl->sites.insert(sample.stack_leaf, new_site);
+		site = &m_impl->sites[sample.stack_leaf];
+	}
+	++site->count;
+	++site->live_count;
+	site->size += sample.size;
+	site->live_size += sample.size;
+
+	MT::atomicIncrement(&m_buckets[getBucket(ptr)]);
+	MT::atomicIncrement(&m_live_count);
+}
+
+
+void AllocationSampler::removeSample(void* ptr)
+{
+	int bucket = getBucket(ptr);
+	if (m_buckets[bucket] == 0) return;
+
+	MT::SpinLock lock(m_impl->mutex);
+	auto iter = m_impl->samples.find(ptr);
+	if (!iter.isValid()) return;
+
+	Sample sample = iter.value();
+	m_impl->samples.erase(iter);
+	Site& site = m_impl->sites[sample.stack_leaf];
+	--site.live_count;
+	site.live_size -= sample.size;
+
+	MT::atomicDecrement(&m_buckets[bucket]);
+	MT::atomicDecrement(&m_live_count);
+}
+
+
+void AllocationSampler::clear()
+{
+	MT::SpinLock lock(m_impl->mutex);
+	m_impl->samples.clear();
+	m_impl->sites.clear();
+	for (volatile i32& bucket : m_buckets) bucket = 0;
+	m_live_count = 0;
+}
+
+
+int AllocationSampler::getSites(Site* sites, int max_count)
+{
+	Array<Site> tmp(m_impl->allocator);
+	{
+		MT::SpinLock lock(m_impl->mutex);
+		tmp.reserve(m_impl->sites.size());
+		for (auto iter = m_impl->sites.begin(), end = m_impl->sites.end(); iter != end; ++iter)
+		{
+			tmp.push(iter.value());
+		}
+	}
+	if (tmp.empty()) return 0;
+
+	qsort(&tmp[0], tmp.size(), sizeof(tmp[0]), [](const void* a, const void* b) {
+		size_t size_a = ((const Site*)a)->size;
+		size_t size_b = ((const Site*)b)->size;
+		return size_a < size_b ? 1 : (size_a > size_b ? -1 : 0);
+	});
+	int count = Math::minimum(tmp.size(), max_count);
+	for (int i = 0; i < count; ++i) sites[i] = tmp[i];
+	return tmp.size();
+}
+
+
+static void writeCallstack(FS::OsFile& file, StackNode* node)
+{
+	if (!node)
+	{
+		file << "\t\tunknown call stack\n";
+		return;
+	}
+	for (; node; node = StackTree::getParent(node))
+	{
+		char fn_name[256];
+		int line;
+		if (!StackTree::getFunction(node, fn_name, lengthOf(fn_name), &line)) copyString(fn_name, "?");
+		file << "\t\t" << fn_name;
+		if (line >= 0) file << " (" << line << ")";
+		file << "\n";
+	}
+}
+
+
+static void writeSite(FS::OsFile& file, const AllocationSampler::Site& site, bool live)
+{
+	file << "\t" << u64(live ? site.live_size : site.size) << " B in " << (live ? site.live_count : site.count)
+		 << " samples\n";
+	writeCallstack(file, site.stack_leaf);
+}
+
+
+bool AllocationSampler::saveReport(const char* path)
+{
+	Array<Site> sites(m_impl->allocator);
+	sites.resize(getSites(nullptr, 0));
+	if (!sites.empty()) sites.resize(getSites(&sites[0], sites.size()));
+
+	FS::OsFile file;
+	if (!file.open(path, FS::Mode::CREATE_AND_WRITE, m_impl->allocator)) return false;
+
+	u64 total_size = 0;
+	u64 live_size = 0;
+	for (const Site& site : sites)
+	{
+		total_size += site.size;
+		live_size += site.live_size;
+	}
+	file << "Sampling interval: " << u64(m_interval) << " B\n";
+	file << "Estimated allocated: " << total_size << " B, still alive: " << live_size << " B\n\n";
+
+	// sites are sorted by allocated size
+	file << "Hot allocation sites:\n";
+	for (const Site& site : sites) writeSite(file, site, false);
+
+	file << "\nLive allocations (leaks if written at shutdown):\n";
+	for (const Site& site : sites)
+	{
+		if (site.live_count > 0) writeSite(file, site, true);
+	}
+
+	file.close();
+	return true;
+}
+
+
+} // namespace Debug
+
+
+} // namespace Lumix
@@ -41,6 +41,54 @@ private:
 };
 
 
+// Captures call stacks of a statistically representative subset of allocations, on average one
+// per interval allocated bytes, and aggregates them by call site. Sizes of sites are estimated,
+// every sample stands for max(size, interval) bytes. It is much cheaper than the full tracking
+// Allocator does in _DEBUG, so it can be enabled in production-like runs.
+class LUMIX_ENGINE_API AllocationSampler
+{
+public:
+	struct Site
+	{
+		StackNode* stack_leaf;
+		u32 count;
+		u32 live_count;
+		size_t size;
+		size_t live_size;
+	};
+
+public:
+	// allocator is used for bookkeeping, it must not be the sampled one
+	explicit AllocationSampler(IAllocator& allocator);
+	~AllocationSampler();
+
+	// 0 disables sampling, already sampled allocations are tracked until they are freed
+	void setInterval(size_t interval) { m_interval = interval; }
+	size_t getInterval() const { return m_interval; }
+	void onAllocated(void* ptr, size_t size) { if (m_interval != 0 && ptr) sample(ptr, size); }
+	void onDeallocated(void* ptr) { if (m_live_count != 0 && ptr) removeSample(ptr); }
+	// sorted by estimated size, returns number of all sites
+	int getSites(Site* sites, int max_count);
+	// hot allocation sites and sites of allocations which are still alive, with call stacks
+	bool saveReport(const char* path);
+	void clear();
+
+private:
+	struct Impl;
+	static const int BUCKETS_COUNT = 4096;
+
+	void sample(void* ptr, size_t size);
+	void removeSample(void* ptr);
+
+private:
+	Impl* m_impl;
+	volatile size_t m_interval;
+	volatile i32 m_live_count;
+	// number of live samples per pointer hash, most frees are not sampled and skip the lock
+	volatile i32 m_buckets[BUCKETS_COUNT];
+};
+
+
 class LUMIX_ENGINE_API Allocator LUMIX_FINAL : public IAllocator
 {
 public:
@@ -50,7 +98,7 @@ public:
 		AllocationInfo* next;
 		size_t size;
 		StackNode* stack_leaf;
-		u16 align;
+		u32 align;
 	};
 
 public:
@@ -67,6 +115,7 @@ public:
 	void checkGuards();
 
 	IAllocator& getSourceAllocator() { return m_source; }
+	AllocationSampler& getSampler() { return m_sampler; }
 	AllocationInfo* getFirstAllocationInfo() const { return m_root; }
 	void lock();
 	void unlock();
@@ -83,6 +132,7 @@ private:
 
 private:
 	IAllocator& m_source;
+	AllocationSampler m_sampler;
 	StackTree m_stack_tree;
 	MT::SpinMutex m_mutex;
 	AllocationInfo* m_root;
@@ -4,6 +4,7 @@
 #include "engine/system.h"
 #include <cstdlib>
 #include <cstdio>
+#include <execinfo.h>
 
 
 static bool g_is_crash_reporting_enabled = false;
@@ -50,11 +51,13 @@ public:
 
 StackTree::StackTree()
 {
+	m_root = nullptr;
 }
 
 
 StackTree::~StackTree()
 {
+	delete m_root;
 }
 
 
@@ -65,36 +68,118 @@ void StackTree::refreshModuleList()
 
 int StackTree::getPath(StackNode* node, StackNode** output, int max_size)
 {
-	return 0;
+	int i = 0;
+	while (i < max_size && node)
+	{
+		output[i] = node;
+		i++;
+		node = node->m_parent;
+	}
+	return i;
 }
 
 
 StackNode* StackTree::getParent(StackNode* node)
 {
-	return nullptr;
+	return node ? node->m_parent : nullptr;
 }
 
 
 bool StackTree::getFunction(StackNode* node, char* out, int max_size, int* line)
 {
-	return false;
+	// there are no line numbers without debug info parsing, symbols are "module(function+offset) [address]"
+	*line = -1;
+	char** symbols = backtrace_symbols(&node->m_instruction, 1);
+	if (!symbols) return false;
+	copyString(out, max_size, symbols[0]);
+	free(symbols);
+	return true;
 }
 
 
 void StackTree::printCallstack(StackNode* node)
 {
+	while (node)
+	{
+		backtrace_symbols_fd(&node->m_instruction, 1, fileno(stdout));
+		node = node->m_parent;
+	}
 }
 
 
 StackNode* StackTree::insertChildren(StackNode* root_node, void** instruction, void** stack)
 {
-	return nullptr;
+	StackNode* node = root_node;
+	while (instruction >= stack)
+	{
+		StackNode* new_node = new StackNode();
+		node->m_first_child = new_node;
+		new_node->m_parent = node;
+		new_node->m_next = nullptr;
+		new_node->m_first_child = nullptr;
+		new_node->m_instruction = *instruction;
+		node = new_node;
+		--instruction;
+	}
+	return node;
 }
 
 
 StackNode* StackTree::record()
 {
-	return nullptr;
+	static const int frames_to_capture = 256;
+	void* stack[frames_to_capture];
+	int captured_frames_count = backtrace(stack, frames_to_capture);
+	// skip this function and the caller, the same as on Windows
+	if (captured_frames_count <= 2) return nullptr;
+	void** first = stack + 2;
+
+	void** ptr = stack + captured_frames_count - 1;
+	if (!m_root)
+	{
+		m_root = new StackNode();
+		m_root->m_instruction = *ptr;
+		m_root->m_first_child = nullptr;
+		m_root->m_next = nullptr;
+		m_root->m_parent = nullptr;
+		--ptr;
+		return insertChildren(m_root, ptr, first);
+	}
+
+	StackNode* node = m_root;
+	while (ptr >= first)
+	{
+		while (node->m_instruction != *ptr && node->m_next)
+		{
+			node = node->m_next;
+		}
+		if (node->m_instruction != *ptr)
+		{
+			node->m_next = new StackNode;
+			node->m_next->m_parent = node->m_parent;
+			node->m_next->m_instruction = *ptr;
+			node->m_next->m_next = nullptr;
+			node->m_next->m_first_child = nullptr;
+			--ptr;
+			return insertChildren(node->m_next, ptr, first);
+		}
+		else if (ptr == first)
+		{
+			return node;
+		}
+		else if (node->m_first_child)
+		{
+			--ptr;
+			node = node->m_first_child;
+		}
+		else
+		{
+			--ptr;
+			return insertChildren(node, ptr, first);
+		}
+	}
+
+	return node;
 }
 
 
@@ -106,6 +191,7 @@ static const u32 ALLOCATION_GUARD = 0xFDFDFDFD;
 
 Allocator::Allocator(IAllocator& source)
 	: m_source(source)
+	, m_sampler(source)
 	, m_root(nullptr)
 	, m_mutex(false)
 	, m_total_size(0)
@@ -236,7 +322,10 @@ u8* Allocator::getSystemFromUser(void* user_ptr)
 void* Allocator::reallocate(void* user_ptr, size_t size)
 {
 #ifndef _DEBUG
-	return m_source.reallocate(user_ptr, size);
+	m_sampler.onDeallocated(user_ptr);
+	void* new_data = m_source.reallocate(user_ptr, size);
+	m_sampler.onAllocated(new_data, size);
+	return new_data;
 #else
 	if (user_ptr == nullptr) return allocate(size);
 	if (size == 0) return nullptr;
@@ -257,7 +346,9 @@ void* Allocator::reallocate(void* user_ptr, size_t size)
 void* Allocator::allocate_aligned(size_t size, size_t align)
 {
 #ifndef _DEBUG
-	return m_source.allocate_aligned(size, align);
+	void* ptr = m_source.allocate_aligned(size, align);
+	m_sampler.onAllocated(ptr, size);
+	return ptr;
 #else
 	void* system_ptr;
 	AllocationInfo* info;
@@ -281,7 +372,7 @@ void* Allocator::allocate_aligned(size_t size, size_t align)
 		m_total_size += size;
 	} // because of the SpinLock
 
-	info->align = u16(align);
+	info->align = u32(align);
 	info->stack_leaf = m_stack_tree.record();
 	info->size = size;
 	if (m_is_fill_enabled)
@@ -295,6 +386,7 @@ void* Allocator::allocate_aligned(size_t size, size_t align)
 		*(u32*)((u8*)system_ptr + system_size - sizeof(ALLOCATION_GUARD)) = ALLOCATION_GUARD;
 	}
 
+	m_sampler.onAllocated(user_ptr, size);
 	return user_ptr;
 #endif
 }
@@ -303,10 +395,12 @@ void* Allocator::allocate_aligned(size_t size, size_t align)
 void Allocator::deallocate_aligned(void* user_ptr)
 {
 #ifndef _DEBUG
+	m_sampler.onDeallocated(user_ptr);
 	m_source.deallocate_aligned(user_ptr);
 #else
 	if (user_ptr)
 	{
+		m_sampler.onDeallocated(user_ptr);
 		AllocationInfo* info = getAllocationInfoFromUser(user_ptr);
 		void* system_ptr = getSystemFromUser(user_ptr);
 		if (m_is_fill_enabled)
@@ -344,7 +438,10 @@ void Allocator::deallocate_aligned(void* user_ptr)
 void* Allocator::reallocate_aligned(void* user_ptr, size_t size, size_t align)
 {
 #ifndef _DEBUG
-	return m_source.reallocate_aligned(user_ptr, size, align);
+	m_sampler.onDeallocated(user_ptr);
+	void* new_data = m_source.reallocate_aligned(user_ptr, size, align);
+	m_sampler.onAllocated(new_data, size);
+	return new_data;
 #else
 	if (user_ptr == nullptr) return allocate_aligned(size, align);
 	if (size == 0) return nullptr;
@@ -365,7 +462,9 @@ void* Allocator::reallocate_aligned(void* user_ptr, size_t size, size_t align)
 void* Allocator::allocate(size_t size)
 {
 #ifndef _DEBUG
-	return m_source.allocate(size);
+	void* ptr = m_source.allocate(size);
+	m_sampler.onAllocated(ptr, size);
+	return ptr;
 #else
 	void* system_ptr;
 	AllocationInfo* info;
@@ -401,6 +500,7 @@ void* Allocator::allocate(size_t size)
 		*(u32*)((u8*)system_ptr + system_size - sizeof(ALLOCATION_GUARD)) = ALLOCATION_GUARD;
 	}
 
+	m_sampler.onAllocated(user_ptr, size);
 	return user_ptr;
 #endif
 }
@@ -408,10 +508,12 @@ void* Allocator::allocate(size_t size)
 void Allocator::deallocate(void* user_ptr)
 {
 #ifndef _DEBUG
+	m_sampler.onDeallocated(user_ptr);
 	m_source.deallocate(user_ptr);
 #else
 	if (user_ptr)
 	{
+		m_sampler.onDeallocated(user_ptr);
 		AllocationInfo* info = getAllocationInfoFromUser(user_ptr);
 		void* system_ptr = getSystemFromUser(user_ptr);
 		if (m_is_fill_enabled)
@@ -245,6 +245,7 @@ static const u32 ALLOCATION_GUARD = 0xFDFDFDFD;
 
 Allocator::Allocator(IAllocator& source)
 	: m_source(source)
+	, m_sampler(source)
 	, m_root(nullptr)
 	, m_mutex(false)
 	, m_total_size(0)
@@ -375,7 +376,10 @@ u8* Allocator::getSystemFromUser(void* user_ptr)
 void* Allocator::reallocate(void* user_ptr, size_t size)
 {
 #ifndef _DEBUG
-	return m_source.reallocate(user_ptr, size);
+	m_sampler.onDeallocated(user_ptr);
+	void* new_data = m_source.reallocate(user_ptr, size);
+	m_sampler.onAllocated(new_data, size);
+	return new_data;
 #else
 	if (user_ptr == nullptr) return allocate(size);
 	if (size == 0) return nullptr;
@@ -396,7 +400,9 @@ void* Allocator::reallocate(void* user_ptr, size_t size)
 void* Allocator::allocate_aligned(size_t size, size_t align)
 {
 #ifndef _DEBUG
-	return m_source.allocate_aligned(size, align);
+	void* ptr = m_source.allocate_aligned(size, align);
+	m_sampler.onAllocated(ptr, size);
+	return ptr;
 #else
 	void* system_ptr;
 	AllocationInfo* info;
@@ -420,7 +426,7 @@ void* Allocator::allocate_aligned(size_t size, size_t align)
 		m_total_size += size;
 	} // because of the SpinLock
 
-	info->align = u16(align);
+	info->align = u32(align);
 	info->stack_leaf = m_stack_tree.record();
 	info->size = size;
 	if (m_is_fill_enabled)
@@ -434,6 +440,7 @@ void* Allocator::allocate_aligned(size_t size, size_t align)
 		*(u32*)((u8*)system_ptr + system_size - sizeof(ALLOCATION_GUARD)) = ALLOCATION_GUARD;
 	}
 
+	m_sampler.onAllocated(user_ptr, size);
 	return user_ptr;
 #endif
 }
@@ -442,10 +449,12 @@ void* Allocator::allocate_aligned(size_t size, size_t align)
 void Allocator::deallocate_aligned(void* user_ptr)
 {
 #ifndef _DEBUG
+	m_sampler.onDeallocated(user_ptr);
 	m_source.deallocate_aligned(user_ptr);
 #else
 	if (user_ptr)
 	{
+		m_sampler.onDeallocated(user_ptr);
 		AllocationInfo* info = getAllocationInfoFromUser(user_ptr);
 		void* system_ptr = getSystemFromUser(user_ptr);
 		if (m_is_fill_enabled)
@@ -483,7 +492,10 @@ void Allocator::deallocate_aligned(void* user_ptr)
 void* Allocator::reallocate_aligned(void* user_ptr, size_t size, size_t align)
 {
 #ifndef _DEBUG
-	return m_source.reallocate_aligned(user_ptr, size, align);
+	m_sampler.onDeallocated(user_ptr);
+	void* new_data = m_source.reallocate_aligned(user_ptr, size, align);
+	m_sampler.onAllocated(new_data, size);
+	return new_data;
 #else
 	if (user_ptr == nullptr) return allocate_aligned(size, align);
 	if (size == 0) return nullptr;
@@ -504,7 +516,9 @@ void* Allocator::reallocate_aligned(void* user_ptr, size_t size, size_t align)
 void* Allocator::allocate(size_t size)
 {
 #ifndef _DEBUG
-	return m_source.allocate(size);
+	void* ptr = m_source.allocate(size);
+	m_sampler.onAllocated(ptr, size);
+	return ptr;
 #else
 	void* system_ptr;
 	AllocationInfo* info;
@@ -540,6 +554,7 @@ void* Allocator::allocate(size_t size)
 		*(u32*)((u8*)system_ptr + system_size - sizeof(ALLOCATION_GUARD)) = ALLOCATION_GUARD;
 	}
 
+	m_sampler.onAllocated(user_ptr, size);
 	return user_ptr;
 #endif
 }
@@ -547,10 +562,12 @@ void* Allocator::allocate(size_t size)
 void Allocator::deallocate(void* user_ptr)
 {
 #ifndef _DEBUG
+	m_sampler.onDeallocated(user_ptr);
 	m_source.deallocate(user_ptr);
 #else
 	if (user_ptr)
 	{
+		m_sampler.onDeallocated(user_ptr);
 		AllocationInfo* info = getAllocationInfoFromUser(user_ptr);
 		void* system_ptr = getSystemFromUser(user_ptr);
 		if (m_is_fill_enabled)
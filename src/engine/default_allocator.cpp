@@ -67,7 +67,8 @@ namespace Lumix
 		if (newptr == nullptr) {
 			return nullptr;
 		}
-		memcpy(newptr, ptr, malloc_usable_size(ptr));
+		size_t old_size = malloc_usable_size(ptr);
+		memcpy(newptr, ptr, old_size < size ? old_size : size);
 		free(ptr);
 		return newptr;
 	}
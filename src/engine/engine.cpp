@@ -7,9 +7,9 @@
 #include "engine/fs/memory_file_device.h"
 #include "engine/fs/os_file.h"
 #include "engine/fs/resource_file_device.h"
+#include "engine/frame_allocator.h"
 #include "engine/input_system.h"
 #include "engine/iplugin.h"
-#include "engine/lifo_allocator.h"
 #include "engine/log.h"
 #include "engine/lua_wrapper.h"
 #include "engine/lua_wrapper.h"
@@ -22,6 +22,7 @@
 #include "engine/property_descriptor.h"
 #include "engine/property_register.h"
 #include "engine/resource_manager.h"
+#include "engine/tag_allocator.h"
 #include "engine/timer.h"
 #include "engine/universe/hierarchy.h"
 #include "engine/universe/universe.h"
@@ -393,6 +394,7 @@ class EngineImpl LUMIX_FINAL : public Engine
 public:
 	EngineImpl(const char* base_path0, const char* base_path1, FS::FileSystem* fs, IAllocator& allocator)
 		: m_allocator(allocator)
+		, m_lua_allocator(allocator, "lua")
 		, m_prefab_resource_manager(m_allocator)
 		, m_resource_manager(m_allocator)
 		, m_lua_resources(m_allocator)
@@ -406,7 +408,6 @@ public:
 		, m_time_multiplier(1.0f)
 		, m_paused(false)
 		, m_next_frame(false)
-		, m_lifo_allocator(m_allocator, 10 * 1024 * 1024)
 	{
 		g_log_info.log("Core") << "Creating engine...";
 		Profiler::setThreadName("Main");
@@ -420,7 +421,7 @@ public:
 		g_log_error.getCallback().bind<showLogInVS>();
 
 		m_platform_data = {};
-		m_state = lua_newstate(luaAllocator, &m_allocator);
+		m_state = lua_newstate(luaAllocator, &m_lua_allocator);
 		luaL_openlibs(m_state);
 		registerLuaAPI();
 
@@ -1282,8 +1283,11 @@ public:
 			}
 		}
 		m_plugin_manager->update(dt, m_paused);
+		context.flushTransforms();
 		m_input_system->update(dt);
 		getFileSystem().updateAsyncTransactions();
+		FrameAllocator::frame();
+		TagAllocator::frame();
 
 		if (m_next_frame)
 		{
@@ -1417,6 +1421,26 @@ public:
 	}
 
 
+	void serializeSnapshot(Universe& ctx, OutputBlob& serializer) override
+	{
+		PROFILE_FUNCTION();
+		m_path_manager.serialize(serializer);
+		m_plugin_manager->serialize(serializer);
+		ctx.serializeSnapshot(serializer);
+	}
+
+
+	void deserializeSnapshot(Universe& ctx, InputBlob& serializer) override
+	{
+		PROFILE_FUNCTION();
+		m_path_manager.deserialize(serializer);
+		m_plugin_manager->deserialize(serializer);
+		// scenes are created in the same order by the same plugins
+		ctx.deserializeSnapshot(serializer);
+		m_path_manager.clear();
+	}
+
+
 	ComponentUID createComponent(Universe& universe, Entity entity, ComponentType type)
 	{
 		ComponentUID cmp;
@@ -1440,7 +1464,7 @@ public:
 			g_log_error.log("Editor") << "Prefab " << prefab->getPath().c_str() << " is not ready, preload it.";
 			return 0;
 		}
-		Array<Entity> entities(engine->m_lifo_allocator);
+		Array<Entity> entities(FrameAllocator::get());
 		universe->instantiatePrefab(*prefab, position, { 0, 0, 0, 1 }, 1, entities);
 
 		lua_createtable(L, entities.size(), 0);
@@ -1481,9 +1505,9 @@ public:
 	}
 
 
-	IAllocator& getLIFOAllocator() override
+	IAllocator& getFrameAllocator() override
 	{
-		return m_lifo_allocator;
+		return FrameAllocator::get();
 	}
 
 
@@ -1511,7 +1535,7 @@ public:
 
 private:
 	IAllocator& m_allocator;
-	LIFOAllocator m_lifo_allocator;
+	TagAllocator m_lua_allocator;
 
 	FS::FileSystem* m_file_system;
 	FS::MemoryFileDevice* m_mem_file_device;
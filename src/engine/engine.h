@@ -75,6 +75,10 @@ public:
 	virtual void update(Universe& context) = 0;
 	virtual u32 serialize(Universe& ctx, OutputBlob& serializer) = 0;
 	virtual bool deserialize(Universe& ctx, InputBlob& serializer) = 0;
+	// snapshot can be restored only by the same engine instance, e.g. when game mode is stopped;
+	// it's restored into the same universe after Universe::clear, the universe is not recreated
+	virtual void serializeSnapshot(Universe& ctx, OutputBlob& serializer) = 0;
+	virtual void deserializeSnapshot(Universe& ctx, InputBlob& serializer) = 0;
 	virtual float getFPS() const = 0;
 	virtual double getTime() const = 0;
 	virtual float getLastTimeDelta() const = 0;
@@ -85,7 +89,8 @@ public:
 	virtual lua_State* getState() = 0;
 	virtual void runScript(const char* src, int src_length, const char* path) = 0;
 	virtual ComponentUID createComponent(Universe& universe, Entity entity, ComponentType type) = 0;
-	virtual IAllocator& getLIFOAllocator() = 0;
+	// temporary allocations of the calling thread which do not outlive the frame
+	virtual IAllocator& getFrameAllocator() = 0;
 	virtual class Resource* getLuaResource(int idx) const = 0;
 	virtual int addLuaResource(const Path& path, struct ResourceType type) = 0;
 	virtual void unloadLuaResource(int resource_idx) = 0;
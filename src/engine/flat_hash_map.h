@@ -0,0 +1,406 @@
+#pragma once
+
+
+#include "engine/hash_map.h"
+
+
+namespace Lumix
+{
+
+
+// Open addressing hash map with robin hood linear probing. Keys and values are stored
+// inline in one allocation, so lookups do not chase pointers and inserts do not allocate
+// unless the table grows. Like Array, it relocates keys and values with copyMemory.
+// The table is kept at most half full, longer probe sequences cost more than the memory.
+// Inserting an existing key replaces its value. Iterators are invalidated by insert,
+// erase(iterator) returns an iterator to the next element, so elements can be erased while iterating.
+template <class K, class V, class Hasher = HashFunc<K>>
+class FlatHashMap
+{
+public:
+	typedef K key_type;
+	typedef V value_type;
+	typedef u32 size_type;
+	typedef FlatHashMap<K, V, Hasher> my_type;
+
+	static const size_type s_default_ids_count = 8;
+
+private:
+	struct Slot
+	{
+		K key;
+		V value;
+		// distance from the home slot + 1, 0 means empty slot
+		u8 distance;
+	};
+
+	static const u32 MAX_DISTANCE = 0xff;
+
+public:
+	class iterator
+	{
+	public:
+		iterator()
+			: m_map(nullptr)
+			, m_index(0)
+			, m_end(0)
+		{
+		}
+
+		iterator(my_type* map, size_type index)
+			: m_map(map)
+			, m_index(index)
+			, m_end(map->m_capacity)
+		{
+		}
+
+		bool isValid() const { return m_map && m_index < m_map->m_capacity; }
+		key_type& key() { return m_map->m_slots[m_index].key; }
+		value_type& value() { return m_map->m_slots[m_index].value; }
+		value_type& operator*() { return value(); }
+
+		iterator& operator++()
+		{
+			m_index = m_map->next(m_index, m_end);
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			iterator tmp = *this;
+			m_index = m_map->next(m_index, m_end);
+			return tmp;
+		}
+
+		bool operator==(const iterator& rhs) const { return m_index == rhs.m_index; }
+		bool operator!=(const iterator& rhs) const { return m_index != rhs.m_index; }
+
+	private:
+		friend class FlatHashMap;
+
+		my_type* m_map;
+		size_type m_index;
+		// erase can move already visited elements from the start of the table to its end,
+		// slots from m_end are either empty or contain such elements
+		size_type m_end;
+	};
+
+	class constIterator
+	{
+	public:
+		constIterator()
+			: m_map(nullptr)
+			, m_index(0)
+		{
+		}
+
+		constIterator(const my_type* map, size_type index)
+			: m_map(map)
+			, m_index(index)
+		{
+		}
+
+		bool isValid() const { return m_map && m_index < m_map->m_capacity; }
+		const key_type& key() const { return m_map->m_slots[m_index].key; }
+		const value_type& value() const { return m_map->m_slots[m_index].value; }
+		const value_type& operator*() const { return value(); }
+
+		constIterator& operator++()
+		{
+			m_index = m_map->next(m_index, m_map->m_capacity);
+			return *this;
+		}
+
+		constIterator operator++(int)
+		{
+			constIterator tmp = *this;
+			m_index = m_map->next(m_index, m_map->m_capacity);
+			return tmp;
+		}
+
+		bool operator==(const constIterator& rhs) const { return m_index == rhs.m_index; }
+		bool operator!=(const constIterator& rhs) const { return m_index != rhs.m_index; }
+
+	private:
+		const my_type* m_map;
+		size_type m_index;
+	};
+
+public:
+	explicit FlatHashMap(IAllocator& allocator)
+		: m_allocator(allocator)
+	{
+		init(s_default_ids_count);
+	}
+
+	FlatHashMap(size_type ids_count, IAllocator& allocator)
+		: m_allocator(allocator)
+	{
+		init(Math::nextPow2(ids_count));
+	}
+
+	explicit FlatHashMap(const my_type& src)
+		: m_allocator(src.m_allocator)
+	{
+		init(src.m_capacity);
+		copyFrom(src);
+	}
+
+	~FlatHashMap()
+	{
+		destructAll();
+		m_allocator.deallocate(m_slots);
+	}
+
+	my_type& operator=(const my_type& src)
+	{
+		if (this != &src)
+		{
+			destructAll();
+			m_allocator.deallocate(m_slots);
+			init(src.m_capacity);
+			copyFrom(src);
+		}
+		return *this;
+	}
+
+	size_type size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	size_type capacity() const { return m_capacity; }
+
+	value_type& operator[](const key_type& key) const
+	{
+		size_type index = findIndex(key);
+		ASSERT(index < m_capacity);
+		return m_slots[index].value;
+	}
+
+	value_type& at(const key_type& key) { return (*this)[key]; }
+
+	void insert(const key_type& key, const value_type& value)
+	{
+		for (;;)
+		{
+			size_type index = m_mask & Hasher::get(key);
+			u32 distance = 1;
+			while (m_slots[index].distance >= distance)
+			{
+				if (m_slots[index].distance == distance && m_slots[index].key == key)
+				{
+					m_slots[index].value = value;
+					return;
+				}
+				index = (index + 1) & m_mask;
+				++distance;
+			}
+
+			if ((m_size + 1) * 2 > m_capacity || distance > MAX_DISTANCE || !shiftForward(index))
+			{
+				grow(m_capacity * 2);
+				continue;
+			}
+
+			new (NewPlaceholder(), &m_slots[index].key) key_type(key);
+			new (NewPlaceholder(), &m_slots[index].value) value_type(value);
+			m_slots[index].distance = (u8)distance;
+			++m_size;
+			return;
+		}
+	}
+
+	iterator erase(iterator it)
+	{
+		ASSERT(it.isValid());
+		iterator result(it);
+		eraseAt(it.m_index, &result.m_end);
+		// the next element was shifted into the erased slot
+		bool is_shifted = it.m_index < result.m_end && m_slots[it.m_index].distance != 0;
+		if (!is_shifted) result.m_index = next(it.m_index, result.m_end);
+		return result;
+	}
+
+	size_type erase(const key_type& key)
+	{
+		size_type index = findIndex(key);
+		if (index == m_capacity) return 0;
+		size_type end = m_capacity;
+		eraseAt(index, &end);
+		return 1;
+	}
+
+	void clear()
+	{
+		destructAll();
+		m_allocator.deallocate(m_slots);
+		init(s_default_ids_count);
+	}
+
+	void rehash(size_type ids_count)
+	{
+		if (m_capacity < ids_count) grow(Math::nextPow2(ids_count));
+	}
+
+	iterator begin() { return iterator(this, first()); }
+	iterator end() { return iterator(this, m_capacity); }
+	constIterator begin() const { return constIterator(this, first()); }
+	constIterator end() const { return constIterator(this, m_capacity); }
+
+	iterator find(const key_type& key) { return iterator(this, findIndex(key)); }
+	constIterator find(const key_type& key) const { return constIterator(this, findIndex(key)); }
+
+private:
+	void init(size_type ids_count)
+	{
+		ASSERT(Math::isPowOfTwo(ids_count));
+		m_slots = (Slot*)m_allocator.allocate(ids_count * sizeof(Slot));
+		for (size_type i = 0; i < ids_count; ++i)
+		{
+			m_slots[i].distance = 0;
+		}
+		m_capacity = ids_count;
+		m_mask = ids_count - 1;
+		m_size = 0;
+	}
+
+	void copyFrom(const my_type& src)
+	{
+		// same capacity, so every element keeps its slot
+		for (size_type i = 0; i < m_capacity; ++i)
+		{
+			if (src.m_slots[i].distance == 0) continue;
+			new (NewPlaceholder(), &m_slots[i].key) key_type(src.m_slots[i].key);
+			new (NewPlaceholder(), &m_slots[i].value) value_type(src.m_slots[i].value);
+			m_slots[i].distance = src.m_slots[i].distance;
+		}
+		m_size = src.m_size;
+	}
+
+	void destructAll()
+	{
+		for (size_type i = 0; i < m_capacity; ++i)
+		{
+			if (m_slots[i].distance == 0) continue;
+			m_slots[i].key.~key_type();
+			m_slots[i].value.~value_type();
+		}
+	}
+
+	size_type findIndex(const key_type& key) const
+	{
+		size_type index = m_mask & Hasher::get(key);
+		u32 distance = 1;
+		// elements are ordered by distance, we can stop at the first one closer to its home
+		while (m_slots[index].distance >= distance)
+		{
+			if (m_slots[index].distance == distance && m_slots[index].key == key) return index;
+			index = (index + 1) & m_mask;
+			++distance;
+		}
+		return m_capacity;
+	}
+
+	size_type first() const
+	{
+		for (size_type i = 0; i < m_capacity; ++i)
+		{
+			if (m_slots[i].distance != 0) return i;
+		}
+		return m_capacity;
+	}
+
+	// returns m_capacity, i.e. end(), if there is no element before the end slot
+	size_type next(size_type index, size_type end) const
+	{
+		for (size_type i = index + 1; i < end; ++i)
+		{
+			if (m_slots[i].distance != 0) return i;
+		}
+		return m_capacity;
+	}
+
+	// moves the run of elements starting at index one slot forward to make room,
+	// which is equivalent to the robin hood swapping
+	bool shiftForward(size_type index)
+	{
+		size_type empty = index;
+		while (m_slots[empty].distance != 0)
+		{
+			if (m_slots[empty].distance == MAX_DISTANCE) return false;
+			empty = (empty + 1) & m_mask;
+		}
+
+		while (empty != index)
+		{
+			size_type prev = (empty - 1) & m_mask;
+			copyMemory(&m_slots[empty], &m_slots[prev], sizeof(Slot));
+			m_slots[empty].distance = m_slots[prev].distance + 1;
+			empty = prev;
+		}
+		m_slots[index].distance = 0;
+		return true;
+	}
+
+	// backward shift deletion, no tombstones; an element shifted from the iteration end slot
+	// (slot 0 after wrapping around) to the slot before it decrements the end, see iterator::m_end
+	void eraseAt(size_type index, size_type* end)
+	{
+		m_slots[index].key.~key_type();
+		m_slots[index].value.~value_type();
+		size_type next_index = (index + 1) & m_mask;
+		while (m_slots[next_index].distance > 1)
+		{
+			if (next_index == (*end & m_mask)) --*end;
+			copyMemory(&m_slots[index], &m_slots[next_index], sizeof(Slot));
+			m_slots[index].distance = m_slots[next_index].distance - 1;
+			index = next_index;
+			next_index = (next_index + 1) & m_mask;
+		}
+		m_slots[index].distance = 0;
+		--m_size;
+	}
+
+	void grow(size_type ids_count)
+	{
+		Slot* old_slots = m_slots;
+		size_type old_capacity = m_capacity;
+		init(ids_count);
+
+		for (size_type i = 0; i < old_capacity; ++i)
+		{
+			if (old_slots[i].distance == 0) continue;
+
+			// keys are unique, just find the robin hood position and relocate
+			const Slot& slot = old_slots[i];
+			size_type index = m_mask & Hasher::get(slot.key);
+			u32 distance = 1;
+			while (m_slots[index].distance >= distance)
+			{
+				index = (index + 1) & m_mask;
+				++distance;
+			}
+			if (distance > MAX_DISTANCE || !shiftForward(index))
+			{
+				// too many collisions, old table is still intact so start over with a bigger one
+				m_allocator.deallocate(m_slots);
+				init(m_capacity * 2);
+				i = (size_type)-1;
+				continue;
+			}
+			copyMemory(&m_slots[index], &slot, sizeof(Slot));
+			m_slots[index].distance = (u8)distance;
+			++m_size;
+		}
+
+		m_allocator.deallocate(old_slots);
+	}
+
+private:
+	IAllocator& m_allocator;
+	Slot* m_slots;
+	size_type m_size;
+	size_type m_capacity;
+	size_type m_mask;
+};
+
+
+} // namespace Lumix
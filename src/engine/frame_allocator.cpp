@@ -0,0 +1,330 @@
+#include "engine/frame_allocator.h"
+#include "engine/array.h"
+#include "engine/default_allocator.h"
+#include "engine/log.h"
+#include "engine/math_utils.h"
+#include "engine/mt/atomic.h"
+#include "engine/mt/sync.h"
+#include "engine/profiler.h"
+#include "engine/string.h"
+
+
+namespace Lumix
+{
+
+
+static const size_t PAGE_SIZE = 1024 * 1024;
+static const size_t MIN_ALIGN = sizeof(void*);
+
+
+struct FrameAllocatorRegistry
+{
+	FrameAllocatorRegistry()
+		: allocators(allocator)
+		, mutex(false)
+		, frame(0)
+	{
+	}
+
+
+	~FrameAllocatorRegistry()
+	{
+		for (FrameAllocator* frame_allocator : allocators)
+		{
+			LUMIX_DELETE(allocator, frame_allocator);
+		}
+	}
+
+
+	DefaultAllocator allocator;
+	Array<FrameAllocator*> allocators;
+	MT::SpinMutex mutex;
+	volatile i32 frame;
+};
+
+
+static FrameAllocatorRegistry g_registry;
+static thread_local FrameAllocator* s_frame_allocator = nullptr;
+
+
+static u8* alignPointer(u8* ptr, size_t align)
+{
+	return (u8*)(((uintptr)ptr + align - 1) & ~(uintptr)(align - 1));
+}
+
+
+FrameAllocator::FrameAllocator(IAllocator& source, size_t page_size)
+	: m_source(source)
+	, m_min_page_size(page_size)
+	, m_page_size(page_size)
+	, m_page(nullptr)
+	, m_retired(nullptr)
+	, m_generation(0)
+	, m_pages_count(0)
+	, m_current(nullptr)
+	, m_end(nullptr)
+	, m_last(nullptr)
+	, m_allocations_count(0)
+	, m_used(0)
+	, m_peak(0)
+	, m_last_frame_peak(0)
+	, m_frame(g_registry.frame)
+{
+}
+
+
+FrameAllocator::~FrameAllocator()
+{
+	ASSERT(m_allocations_count == 0);
+	ASSERT(!m_retired);
+	freePages(m_page);
+	while (m_retired)
+	{
+		RetiredPages* next = m_retired->next;
+		freePages(m_retired->page);
+		m_source.deallocate(m_retired);
+		m_retired = next;
+	}
+}
+
+
+FrameAllocator& FrameAllocator::get()
+{
+	if (s_frame_allocator) return *s_frame_allocator;
+
+	MT::SpinLock lock(g_registry.mutex);
+	s_frame_allocator = LUMIX_NEW(g_registry.allocator, FrameAllocator)(g_registry.allocator, PAGE_SIZE);
+	g_registry.allocators.push(s_frame_allocator);
+	return *s_frame_allocator;
+}
+
+
+void FrameAllocator::frame()
+{
+	MT::atomicIncrement(&g_registry.frame);
+
+	// peaks are written by the owning threads, reading a stale value is fine for statistics
+	size_t sum = 0;
+	{
+		MT::SpinLock lock(g_registry.mutex);
+		for (FrameAllocator* frame_allocator : g_registry.allocators)
+		{
+			sum += frame_allocator->m_last_frame_peak;
+		}
+	}
+	PROFILE_INT("frame allocators KB", int(sum >> 10));
+}
+
+
+// frame() can not touch allocators of other threads, so each one ends its frame on its first use in the next one
+void FrameAllocator::checkFrame()
+{
+	if (m_frame == g_registry.frame) return;
+
+	m_frame = g_registry.frame;
+	m_last_frame_peak = m_peak;
+	if (m_allocations_count > 0) retirePages();
+	rewind();
+	shrink();
+	m_peak = 0;
+}
+
+
+void FrameAllocator::retirePages()
+{
+	g_log_warning.log("Engine") << m_allocations_count << " frame allocation(s) outlived their frame";
+
+	RetiredPages* retired = (RetiredPages*)m_source.allocate(sizeof(RetiredPages));
+	retired->next = m_retired;
+	retired->page = m_page;
+	retired->allocations_count = m_allocations_count;
+	retired->generation = m_generation;
+	m_retired = retired;
+
+	++m_generation;
+	m_page = nullptr;
+	m_pages_count = 0;
+	m_current = m_end = nullptr;
+	m_allocations_count = 0;
+}
+
+
+void FrameAllocator::deallocateRetired(u32 generation)
+{
+	RetiredPages** iter = &m_retired;
+	while ((*iter)->generation != generation) iter = &(*iter)->next;
+
+	RetiredPages* retired = *iter;
+	ASSERT(retired->allocations_count > 0);
+	--retired->allocations_count;
+	if (retired->allocations_count > 0) return;
+
+	*iter = retired->next;
+	freePages(retired->page);
+	m_source.deallocate(retired);
+}
+
+
+void FrameAllocator::addPage(size_t min_size)
+{
+	size_t size = Math::maximum(m_page_size, min_size);
+	Page* page = (Page*)m_source.allocate(sizeof(Page) + size);
+	page->prev = m_page;
+	page->size = size;
+	m_page = page;
+	++m_pages_count;
+	m_current = (u8*)(page + 1);
+	m_end = m_current + size;
+}
+
+
+void FrameAllocator::freePages(Page* page)
+{
+	while (page)
+	{
+		Page* prev = page->prev;
+		m_source.deallocate(page);
+		page = prev;
+	}
+}
+
+
+void FrameAllocator::rewind()
+{
+	ASSERT(m_allocations_count == 0);
+	m_last = nullptr;
+	m_used = 0;
+	if (m_pages_count > 1)
+	{
+		// the next frame probably needs as much memory, so allocate one page big enough
+		size_t total_size = 0;
+		for (Page* page = m_page; page; page = page->prev) total_size += page->size;
+		freePages(m_page);
+		m_page = nullptr;
+		m_pages_count = 0;
+		m_page_size = total_size;
+		addPage(total_size);
+		return;
+	}
+	if (m_page) m_current = (u8*)(m_page + 1);
+}
+
+
+// a single spike should not keep its memory for the rest of the process, so the page is halved
+// at the end of every frame which used less than half of it
+void FrameAllocator::shrink()
+{
+	if (!m_page || m_page->size <= m_min_page_size || m_last_frame_peak * 2 > m_page->size) return;
+
+	m_page_size = Math::maximum(m_page->size / 2, m_min_page_size);
+	freePages(m_page);
+	m_page = nullptr;
+	m_pages_count = 0;
+	addPage(m_page_size);
+}
+
+
+void* FrameAllocator::allocate_aligned(size_t size, size_t align)
+{
+	checkFrame();
+	align = Math::maximum(align, MIN_ALIGN);
+
+	u8* begin = m_current;
+	u8* mem = alignPointer(begin + sizeof(Header), align);
+	if (!m_page || mem + size > m_end)
+	{
+		addPage(size + sizeof(Header) + align);
+		begin = m_current;
+		mem = alignPointer(begin + sizeof(Header), align);
+	}
+
+	Header* header = (Header*)mem - 1;
+	header->begin = begin;
+	header->size = size;
+	header->generation = m_generation;
+	m_current = mem + size;
+	m_last = mem;
+	++m_allocations_count;
+	m_used += m_current - begin;
+	m_peak = Math::maximum(m_peak, m_used);
+	return mem;
+}
+
+
+void FrameAllocator::deallocate_aligned(void* ptr)
+{
+	if (!ptr) return;
+
+	u32 generation = ((Header*)ptr - 1)->generation;
+	if (generation != m_generation)
+	{
+		deallocateRetired(generation);
+		return;
+	}
+
+	ASSERT(m_allocations_count > 0);
+	--m_allocations_count;
+	if (m_allocations_count == 0)
+	{
+		rewind();
+		return;
+	}
+	if (ptr == m_last)
+	{
+		u8* begin = ((Header*)ptr - 1)->begin;
+		m_used -= m_current - begin;
+		m_current = begin;
+		m_last = nullptr;
+	}
+}
+
+
+void* FrameAllocator::reallocate_aligned(void* ptr, size_t size, size_t align)
+{
+	if (!ptr) return allocate_aligned(size, align);
+	if (size == 0)
+	{
+		deallocate_aligned(ptr);
+		return nullptr;
+	}
+
+	// before the m_last check, a new frame retires the page ptr is in
+	checkFrame();
+	Header* header = (Header*)ptr - 1;
+	if (ptr == m_last && (u8*)ptr + size <= m_end)
+	{
+		u8* end = (u8*)ptr + size;
+		m_used = m_used - (m_current - header->begin) + (end - header->begin);
+		m_peak = Math::maximum(m_peak, m_used);
+		m_current = end;
+		header->size = size;
+		return ptr;
+	}
+
+	size_t old_size = header->size;
+	void* new_mem = allocate_aligned(size, align);
+	copyMemory(new_mem, ptr, Math::minimum(old_size, size));
+	deallocate_aligned(ptr);
+	return new_mem;
+}
+
+
+void* FrameAllocator::allocate(size_t size)
+{
+	return allocate_aligned(size, MIN_ALIGN);
+}
+
+
+void FrameAllocator::deallocate(void* ptr)
+{
+	deallocate_aligned(ptr);
+}
+
+
+void* FrameAllocator::reallocate(void* ptr, size_t size)
+{
+	return reallocate_aligned(ptr, size, MIN_ALIGN);
+}
+
+
+} // namespace Lumix
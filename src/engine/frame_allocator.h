@@ -0,0 +1,92 @@
+#pragma once
+
+
+#include "engine/iallocator.h"
+
+
+namespace Lumix
+{
+
+
+// Linear allocator for temporary allocations which do not outlive the frame. Every thread has its
+// own instance (see get()), so it can be used from MTJD jobs without locking. Memory is taken from
+// a chain of pages, deallocate only gives back memory of the last allocation, but the whole
+// allocator is rewound as soon as there are no allocations and at the end of every frame.
+// Pages chained during a frame are merged into one on rewind, so after the first frames temporaries
+// do not hit the source allocator at all; the page shrinks again when frames need less memory.
+// Allocations still alive at the end of a frame are reported and keep only their own pages alive.
+class LUMIX_ENGINE_API FrameAllocator LUMIX_FINAL : public IAllocator
+{
+public:
+	FrameAllocator(IAllocator& source, size_t page_size);
+	~FrameAllocator();
+
+	void* allocate(size_t size) override;
+	void deallocate(void* ptr) override;
+	void* reallocate(void* ptr, size_t size) override;
+	void* allocate_aligned(size_t size, size_t align) override;
+	void deallocate_aligned(void* ptr) override;
+	void* reallocate_aligned(void* ptr, size_t size, size_t align) override;
+
+	int getPagesCount() const { return m_pages_count; }
+	// size of new pages, grows when a frame needs more pages and shrinks when frames use less
+	size_t getPageSize() const { return m_page_size; }
+	// the most memory used at once in the current frame
+	size_t getPeak() const { return m_peak; }
+
+	// allocator of the calling thread
+	static FrameAllocator& get();
+	// called once per frame from the main thread, reports peaks of all threads to the profiler
+	static void frame();
+
+private:
+	struct Page
+	{
+		Page* prev;
+		size_t size;
+	};
+
+	struct Header
+	{
+		u8* begin;
+		size_t size;
+		u32 generation;
+	};
+
+	// pages with allocations which outlived their frame, freed with the last of them
+	struct RetiredPages
+	{
+		RetiredPages* next;
+		Page* page;
+		int allocations_count;
+		u32 generation;
+	};
+
+	void addPage(size_t min_size);
+	void freePages(Page* page);
+	void rewind();
+	void shrink();
+	void retirePages();
+	void deallocateRetired(u32 generation);
+	void checkFrame();
+
+private:
+	IAllocator& m_source;
+	size_t m_min_page_size;
+	size_t m_page_size;
+	Page* m_page;
+	RetiredPages* m_retired;
+	u32 m_generation;
+	int m_pages_count;
+	u8* m_current;
+	u8* m_end;
+	void* m_last;
+	int m_allocations_count;
+	size_t m_used;
+	size_t m_peak;
+	size_t m_last_frame_peak;
+	i32 m_frame;
+};
+
+
+} // namespace Lumix
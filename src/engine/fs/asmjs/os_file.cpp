@@ -167,5 +167,65 @@ OsFile& OsFile::operator <<(float value)
 }
 
 
+// no mmap, the whole file is read into memory
+struct OsMappedFileImpl
+{
+	explicit OsMappedFileImpl(IAllocator& allocator)
+		: m_allocator(allocator)
+	{
+	}
+
+	IAllocator& m_allocator;
+	void* m_buffer;
+};
+
+
+OsMappedFile::OsMappedFile()
+	: m_impl(nullptr)
+	, m_data(nullptr)
+	, m_size(0)
+{
+}
+
+OsMappedFile::~OsMappedFile()
+{
+	ASSERT(!m_impl);
+}
+
+bool OsMappedFile::open(const char* path, IAllocator& allocator)
+{
+	ASSERT(!m_impl);
+	OsFile file;
+	if (!file.open(path, Mode::OPEN_AND_READ, allocator)) return false;
+
+	size_t size = file.size();
+	void* buffer = size > 0 ? allocator.allocate(size) : nullptr;
+	if (size > 0 && !file.read(buffer, size))
+	{
+		allocator.deallocate(buffer);
+		file.close();
+		return false;
+	}
+	file.close();
+
+	m_impl = LUMIX_NEW(allocator, OsMappedFileImpl)(allocator);
+	m_impl->m_buffer = buffer;
+	m_data = (const u8*)buffer;
+	m_size = size;
+	return true;
+}
+
+void OsMappedFile::close()
+{
+	if (!m_impl) return;
+
+	m_impl->m_allocator.deallocate(m_impl->m_buffer);
+	LUMIX_DELETE(m_impl->m_allocator, m_impl);
+	m_impl = nullptr;
+	m_data = nullptr;
+	m_size = 0;
+}
+
+
 } // namespace FS
 } // namespace Lumix
@@ -1,17 +1,19 @@
 #include "engine/fs/file_system.h"
 
 #include "engine/array.h"
-#include "engine/base_proxy_allocator.h"
 #include "engine/blob.h"
+#include "engine/crc32.h"
 #include "engine/fs/disk_file_device.h"
 #include "engine/fs/file_system.h"
-#include "engine/mt/lock_free_fixed_queue.h"
+#include "engine/fs/memory_file_device.h"
+#include "engine/math_utils.h"
+#include "engine/mt/sync.h"
 #include "engine/mt/task.h"
-#include "engine/mt/transaction.h"
+#include "engine/mt/thread.h"
 #include "engine/path.h"
 #include "engine/profiler.h"
-#include "engine/queue.h"
 #include "engine/string.h"
+#include "engine/tag_allocator.h"
 
 
 namespace Lumix
@@ -35,19 +37,149 @@ struct AsyncItem
 	ReadCallback m_cb;
 	Mode m_mode;
 	u32 m_id;
+	int m_priority;
 	char m_path[MAX_PATH_LENGTH];
+	// 0 for items not bound to a path, e.g. closeAsync of a file without a known path
+	u32 m_path_hash;
 	u8 m_flags;
 };
 
-static const i32 C_MAX_TRANS = 16;
+static const int C_MAX_IO_THREADS = 4;
 
-typedef MT::Transaction<AsyncItem> AsynTrans;
-typedef MT::LockFreeFixedQueue<AsynTrans, C_MAX_TRANS> TransQueue;
-typedef Queue<AsynTrans*, C_MAX_TRANS> InProgressQueue;
-typedef Array<AsyncItem> ItemsTable;
+typedef Array<AsyncItem*> ItemsTable;
 typedef Array<IFileDevice*> DevicesTable;
 
 
+// Items waiting for an IO thread and items finished by IO threads. m_flags of queued items
+// are accessed only under the mutex, since both the main thread and IO threads write them.
+// Items with the same path are processed one at a time, in the order they were pushed.
+struct AsyncQueue
+{
+	explicit AsyncQueue(IAllocator& allocator)
+		: waiting(allocator)
+		, finished(allocator)
+		, processing(allocator)
+		, mutex(false)
+		, semaphore(0, 0x7fffFFFF)
+		, aborted(false)
+	{
+	}
+
+
+	void push(AsyncItem* item)
+	{
+		{
+			MT::SpinLock lock(mutex);
+			waiting.push(item);
+		}
+		semaphore.signal();
+	}
+
+
+	// the item's path is not being processed and no earlier item waits for the same path
+	bool canStart(int index) const
+	{
+		u32 hash = waiting[index]->m_path_hash;
+		if (hash == 0) return true;
+		if (processing.indexOf(hash) >= 0) return false;
+		for (int i = 0; i < index; ++i)
+		{
+			if (waiting[i]->m_path_hash == hash) return false;
+		}
+		return true;
+	}
+
+
+	// highest priority first, items with the same priority in the order they were pushed;
+	// flags are the item's flags read under the lock
+	AsyncItem* tryPop(u8* flags)
+	{
+		MT::SpinLock lock(mutex);
+		int best = -1;
+		for (int i = 0, c = waiting.size(); i < c; ++i)
+		{
+			if (best >= 0 && waiting[i]->m_priority <= waiting[best]->m_priority) continue;
+			if (canStart(i)) best = i;
+		}
+		if (best < 0) return nullptr;
+
+		AsyncItem* item = waiting[best];
+		waiting.erase(best);
+		if (item->m_path_hash != 0) processing.push(item->m_path_hash);
+		*flags = item->m_flags;
+		return item;
+	}
+
+
+	// blocks until there is an item, returns nullptr when aborted
+	AsyncItem* pop(u8* flags)
+	{
+		for (;;)
+		{
+			semaphore.wait();
+			if (aborted) return nullptr;
+			// canceled items are removed without waiting on the semaphore, so it can be empty,
+			// or all waiting items can wait for their path
+			AsyncItem* item = tryPop(flags);
+			if (item) return item;
+		}
+	}
+
+
+	void finish(AsyncItem* item, u8 flags)
+	{
+		bool wake = false;
+		{
+			MT::SpinLock lock(mutex);
+			item->m_flags |= flags;
+			finished.push(item);
+			if (item->m_path_hash != 0)
+			{
+				processing.eraseItemFast(item->m_path_hash);
+				wake = !waiting.empty();
+			}
+		}
+		// an item waiting for this path might have been skipped by another IO thread
+		if (wake) semaphore.signal();
+	}
+
+
+	void abort(int threads_count)
+	{
+		aborted = true;
+		for (int i = 0; i < threads_count; ++i) semaphore.signal();
+	}
+
+
+	ItemsTable waiting;
+	ItemsTable finished;
+	// path hashes of items being processed by IO threads
+	Array<u32> processing;
+	MT::SpinMutex mutex;
+	MT::Semaphore semaphore;
+	volatile bool aborted;
+};
+
+
+// opens (and reads the whole file if there is a memory device) or closes the file
+static void processItem(AsyncQueue& queue, AsyncItem* item, u8 flags)
+{
+	PROFILE_BLOCK("transaction");
+	if ((flags & E_IS_OPEN) == E_IS_OPEN)
+	{
+		bool success = item->m_file->open(Path(item->m_path), item->m_mode);
+		queue.finish(item, success ? E_SUCCESS : E_FAIL);
+	}
+	else
+	{
+		item->m_file->close();
+		item->m_file->release();
+		item->m_file = nullptr;
+		queue.finish(item, 0);
+	}
+}
+
+
 void IFile::release()
 {
 	getDevice().destroyFile(this);
@@ -75,9 +207,9 @@ void IFile::getContents(OutputBlob& blob)
 class FSTask LUMIX_FINAL : public MT::Task
 {
 public:
-	FSTask(TransQueue* queue, IAllocator& allocator)
+	FSTask(AsyncQueue& queue, IAllocator& allocator)
 		: MT::Task(allocator)
-		, m_trans_queue(queue)
+		, m_queue(queue)
 	{
 	}
 
@@ -87,32 +219,16 @@ public:
 
 	int task()
 	{
-		while (!m_trans_queue->isAborted())
+		u8 flags;
+		while (AsyncItem* item = m_queue.pop(&flags))
 		{
-			PROFILE_BLOCK("transaction");
-			AsynTrans* tr = m_trans_queue->pop(true);
-			if (!tr) break;
-
-			if ((tr->data.m_flags & E_IS_OPEN) == E_IS_OPEN)
-			{
-				tr->data.m_flags |=
-					tr->data.m_file->open(Path(tr->data.m_path), tr->data.m_mode) ? E_SUCCESS : E_FAIL;
-			}
-			else if ((tr->data.m_flags & E_CLOSE) == E_CLOSE)
-			{
-				tr->data.m_file->close();
-				tr->data.m_file->release();
-				tr->data.m_file = nullptr;
-			}
-			tr->setCompleted();
+			processItem(m_queue, item, flags);
 		}
 		return 0;
 	}
 
-	void stop() { m_trans_queue->abort(); }
-
 private:
-	TransQueue* m_trans_queue;
+	AsyncQueue& m_queue;
 };
 
 
@@ -123,45 +239,66 @@ class FileSystemImpl LUMIX_FINAL : public FileSystem
 {
 public:
 	explicit FileSystemImpl(IAllocator& allocator)
-		: m_allocator(allocator)
-		, m_pending(m_allocator)
+		: m_allocator(allocator, "file system")
 		, m_devices(m_allocator)
+		, m_queue(m_allocator)
 		, m_in_progress(m_allocator)
+		, m_finished(m_allocator)
+		, m_buffer_device(m_allocator)
 		, m_last_id(0)
+		#if !LUMIX_SINGLE_THREAD()
+			, m_tasks(m_allocator)
+		#endif
 	{
 		m_disk_device.m_devices[0] = nullptr;
 		m_memory_device.m_devices[0] = nullptr;
 		m_default_device.m_devices[0] = nullptr;
 		m_save_game_device.m_devices[0] = nullptr;
 		#if !LUMIX_SINGLE_THREAD()
-			m_task = LUMIX_NEW(m_allocator, FSTask)(&m_transaction_queue, m_allocator);
-			m_task->create("FSTask");
+			int threads_count = Math::clamp((int)MT::getCPUsCount() - 1, 1, C_MAX_IO_THREADS);
+			for (int i = 0; i < threads_count; ++i)
+			{
+				FSTask* task = LUMIX_NEW(m_allocator, FSTask)(m_queue, m_allocator);
+				task->create("FSTask");
+				m_tasks.push(task);
+			}
 		#endif
 	}
 
 	~FileSystemImpl()
 	{
 		#if !LUMIX_SINGLE_THREAD()
-			m_task->stop();
-			m_task->destroy();
-			LUMIX_DELETE(m_allocator, m_task);
+			m_queue.abort(m_tasks.size());
+			for (FSTask* task : m_tasks)
+			{
+				task->destroy();
+				LUMIX_DELETE(m_allocator, task);
+			}
 		#endif
-		while (!m_in_progress.empty())
+		for (AsyncItem* item : m_in_progress)
 		{
-			auto* trans = m_in_progress.front();
-			m_in_progress.pop();
-			if (trans->data.m_file) close(*trans->data.m_file);
-		}
-		for (auto& i : m_pending)
-		{
-			close(*i.m_file);
+			// close items processed by an IO thread do not have a file anymore
+			if (item->m_file)
+			{
+				bool is_opened = (item->m_flags & (E_SUCCESS | E_FAIL)) != 0;
+				bool is_open_item = (item->m_flags & E_IS_OPEN) == E_IS_OPEN;
+				if (is_open_item && !is_opened)
+				{
+					item->m_file->release();
+				}
+				else
+				{
+					close(*item->m_file);
+				}
+			}
+			LUMIX_DELETE(m_allocator, item);
 		}
 	}
 
-	BaseProxyAllocator& getAllocator() { return m_allocator; }
+	TagAllocator& getAllocator() { return m_allocator; }
 
 
-	bool hasWork() const override { return !m_in_progress.empty() || !m_pending.empty(); }
+	bool hasWork() const override { return !m_in_progress.empty(); }
 
 
 	bool mount(IFileDevice* device) override
@@ -242,23 +379,33 @@ public:
 	u32 openAsync(const DeviceList& device_list,
 		const Path& file,
 		int mode,
-		const ReadCallback& call_back) override
+		const ReadCallback& call_back,
+		int priority) override
 	{
 		IFile* prev = createFile(device_list);
 
 		if (prev)
 		{
-			AsyncItem& item = m_pending.emplace();
-
-			item.m_file = prev;
-			item.m_cb = call_back;
-			item.m_mode = mode;
-			copyString(item.m_path, file.c_str());
-			item.m_flags = E_IS_OPEN;
-			item.m_id = m_last_id;
+			// read the whole file on the IO thread, so callbacks do not touch the disk
+			bool is_buffered = equalStrings(device_list.m_devices[0]->name(), "memory");
+			if (!is_buffered && (mode & Mode::READ) && !(mode & Mode::WRITE))
+			{
+				prev = m_buffer_device.createFile(prev);
+			}
+
+			AsyncItem* item = LUMIX_NEW(m_allocator, AsyncItem);
+			item->m_file = prev;
+			item->m_cb = call_back;
+			item->m_mode = mode;
+			item->m_priority = priority;
+			copyString(item->m_path, file.c_str());
+			item->m_path_hash = crc32(item->m_path);
+			item->m_flags = E_IS_OPEN;
+			item->m_id = m_last_id;
 			++m_last_id;
 			if (m_last_id == INVALID_ASYNC) m_last_id = 0;
-			return item.m_id;
+			push(item);
+			return item->m_id;
 		}
 
 		return INVALID_ASYNC;
@@ -269,24 +416,28 @@ public:
 	{
 		if (id == INVALID_ASYNC) return;
 
-		for (int i = 0, c = m_pending.size(); i < c; ++i)
+		MT::SpinLock lock(m_queue.mutex);
+		for (int i = 0, c = m_queue.waiting.size(); i < c; ++i)
 		{
-			if (m_pending[i].m_id == id)
+			AsyncItem* item = m_queue.waiting[i];
+			if (item->m_id == id && (item->m_flags & E_IS_OPEN))
 			{
-				m_pending[i].m_flags |= E_CANCELED;
+				// not opened yet, the file is released in updateAsyncTransactions
+				item->m_flags |= E_CANCELED;
+				m_queue.waiting.erase(i);
+				m_queue.finished.push(item);
 				return;
 			}
 		}
 
-		for (auto iter = m_in_progress.begin(), end = m_in_progress.end(); iter != end; ++iter)
+		for (AsyncItem* item : m_in_progress)
 		{
-			if (iter.value()->data.m_id == id)
+			if (item->m_id == id && (item->m_flags & E_IS_OPEN))
 			{
-				iter.value()->data.m_flags |= E_CANCELED;
+				item->m_flags |= E_CANCELED;
 				return;
 			}
 		}
-
 	}
 
 
@@ -333,79 +484,73 @@ public:
 	}
 
 
-	void closeAsync(IFile& file) override
+	void closeAsync(IFile& file) override { pushClose(file, ""); }
+
+
+	// closes of files opened by openAsync keep their path, so later items with the path wait for them
+	void pushClose(IFile& file, const char* path)
 	{
-		AsyncItem& item = m_pending.emplace();
+		AsyncItem* item = LUMIX_NEW(m_allocator, AsyncItem);
+		item->m_file = &file;
+		item->m_cb.bind<closeAsync>();
+		item->m_mode = 0;
+		item->m_priority = 0;
+		copyString(item->m_path, path);
+		item->m_path_hash = path[0] ? crc32(path) : 0;
+		item->m_flags = E_CLOSE;
+		item->m_id = INVALID_ASYNC;
+		push(item);
+	}
 
-		item.m_file = &file;
-		item.m_cb.bind<closeAsync>();
-		item.m_mode = 0;
-		item.m_flags = E_CLOSE;
+
+	void push(AsyncItem* item)
+	{
+		m_in_progress.push(item);
+		m_queue.push(item);
 	}
 
 
 	void updateAsyncTransactions() override
 	{
 		PROFILE_FUNCTION();
-		while (!m_in_progress.empty())
-		{
-			AsynTrans* tr = m_in_progress.front();
-			if (!tr->isCompleted()) break;
-
-			PROFILE_BLOCK("processAsyncTransaction");
-			m_in_progress.pop();
 
-			if ((tr->data.m_flags & E_CANCELED) == 0)
-			{
-				tr->data.m_cb.invoke(*tr->data.m_file, !!(tr->data.m_flags & E_SUCCESS));
-			}
-			if ((tr->data.m_flags & (E_SUCCESS | E_FAIL)) != 0)
+		#if LUMIX_SINGLE_THREAD()
+			u8 flags;
+			while (AsyncItem* item = m_queue.tryPop(&flags))
 			{
-				closeAsync(*tr->data.m_file);
+				processItem(m_queue, item, flags);
 			}
-			m_transaction_queue.dealoc(tr);
-		}
+		#endif
 
-		i32 can_add = C_MAX_TRANS - m_in_progress.size();
-		while (can_add && !m_pending.empty())
 		{
-			AsynTrans* tr = m_transaction_queue.alloc(false);
-			if (tr)
-			{
-				AsyncItem& item = m_pending[0];
-				tr->data.m_file = item.m_file;
-				tr->data.m_cb = item.m_cb;
-				tr->data.m_id = item.m_id;
-				tr->data.m_mode = item.m_mode;
-				copyString(tr->data.m_path, sizeof(tr->data.m_path), item.m_path);
-				tr->data.m_flags = item.m_flags;
-				tr->reset();
-
-				m_transaction_queue.push(tr, true);
-				m_in_progress.push(tr);
-				m_pending.erase(0);
-			}
-			can_add--;
+			MT::SpinLock lock(m_queue.mutex);
+			m_finished.swap(m_queue.finished);
 		}
 
-		#if LUMIX_SINGLE_THREAD()
-			while (AsynTrans* tr = m_transaction_queue.pop(false))
+		// callbacks can open new files, they are processed in the next update
+		for (AsyncItem* item : m_finished)
+		{
+			PROFILE_BLOCK("processAsyncTransaction");
+			m_in_progress.eraseItemFast(item);
+
+			if ((item->m_flags & E_IS_OPEN) == E_IS_OPEN)
 			{
-				PROFILE_BLOCK("transaction");
-				if ((tr->data.m_flags & E_IS_OPEN) == E_IS_OPEN)
+				if ((item->m_flags & E_CANCELED) == 0)
+				{
+					item->m_cb.invoke(*item->m_file, !!(item->m_flags & E_SUCCESS));
+				}
+				if ((item->m_flags & (E_SUCCESS | E_FAIL)) != 0)
 				{
-					tr->data.m_flags |=
-						tr->data.m_file->open(Path(tr->data.m_path), tr->data.m_mode) ? E_SUCCESS : E_FAIL;
+					pushClose(*item->m_file, item->m_path);
 				}
-				else if ((tr->data.m_flags & E_CLOSE) == E_CLOSE)
+				else
 				{
-					tr->data.m_file->close();
-					tr->data.m_file->release();
-					tr->data.m_file = nullptr;
+					item->m_file->release();
 				}
-				tr->setCompleted();
 			}
-		#endif
+			LUMIX_DELETE(m_allocator, item);
+		}
+		m_finished.clear();
 	}
 
 	const DeviceList& getDefaultDevice() const override { return m_default_device; }
@@ -425,21 +570,23 @@ public:
 	static void closeAsync(IFile&, bool) {}
 
 private:
-	BaseProxyAllocator m_allocator;
-	#if !LUMIX_SINGLE_THREAD()
-		FSTask* m_task;
-	#endif
+	TagAllocator m_allocator;
 	DevicesTable m_devices;
 
-	ItemsTable m_pending;
-	TransQueue m_transaction_queue;
-	InProgressQueue m_in_progress;
+	AsyncQueue m_queue;
+	// items pushed to m_queue and not yet processed by updateAsyncTransactions
+	ItemsTable m_in_progress;
+	ItemsTable m_finished;
+	MemoryFileDevice m_buffer_device;
 
 	DeviceList m_disk_device;
 	DeviceList m_memory_device;
 	DeviceList m_default_device;
 	DeviceList m_save_game_device;
 	u32 m_last_id;
+	#if !LUMIX_SINGLE_THREAD()
+		Array<FSTask*> m_tasks;
+	#endif
 };
 
 FileSystem* FileSystem::create(IAllocator& allocator)
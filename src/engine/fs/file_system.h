@@ -107,10 +107,17 @@ public:
 	virtual bool unMount(IFileDevice* device) = 0;
 
 	virtual IFile* open(const DeviceList& device_list, const Path& file, Mode mode) = 0;
+	// Files are opened on IO threads, files opened for reading are read whole into memory there,
+	// so call_back gets a file with a valid getBuffer(). Higher priority files are opened first.
+	// call_back is called from updateAsyncTransactions, unless the request is canceled.
+	// Several IO threads process requests, so requests for different paths can complete in any
+	// order. Requests for the same path, including the close of a file opened by openAsync,
+	// are processed one at a time in the order they were made.
 	virtual u32 openAsync(const DeviceList& device_list,
 						   const Path& file,
 						   int mode,
-						   const ReadCallback& call_back) = 0;
+						   const ReadCallback& call_back,
+						   int priority = 0) = 0;
 	virtual void cancelAsync(u32 id) = 0;
 
 	virtual void close(IFile& file) = 0;
@@ -3,6 +3,9 @@
 #include "engine/string.h"
 #include "engine/lumix.h"
 #include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 
@@ -167,5 +170,68 @@ OsFile& OsFile::operator <<(float value)
 }
 
 
+struct OsMappedFileImpl
+{
+	explicit OsMappedFileImpl(IAllocator& allocator)
+		: m_allocator(allocator)
+	{
+	}
+
+	IAllocator& m_allocator;
+};
+
+
+OsMappedFile::OsMappedFile()
+	: m_impl(nullptr)
+	, m_data(nullptr)
+	, m_size(0)
+{
+}
+
+OsMappedFile::~OsMappedFile()
+{
+	ASSERT(!m_impl);
+}
+
+bool OsMappedFile::open(const char* path, IAllocator& allocator)
+{
+	ASSERT(!m_impl);
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* data = nullptr;
+	if (info.st_size > 0)
+	{
+		data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	// the mapping keeps the file open
+	::close(fd);
+	if (data == MAP_FAILED) return false;
+
+	m_impl = LUMIX_NEW(allocator, OsMappedFileImpl)(allocator);
+	m_data = (const u8*)data;
+	m_size = (size_t)info.st_size;
+	return true;
+}
+
+void OsMappedFile::close()
+{
+	if (!m_impl) return;
+
+	if (m_data) munmap((void*)m_data, m_size);
+	LUMIX_DELETE(m_impl->m_allocator, m_impl);
+	m_impl = nullptr;
+	m_data = nullptr;
+	m_size = 0;
+}
+
+
 } // namespace FS
 } // namespace Lumix
@@ -20,6 +20,7 @@ namespace Lumix
 				, m_pos(0)
 				, m_file(file) 
 				, m_write(false)
+				, m_owns_buffer(true)
 				, m_allocator(allocator)
 			{
 			}
@@ -30,7 +31,7 @@ namespace Lumix
 				{
 					m_file->release();
 				}
-				m_allocator.deallocate(m_buffer);
+				if (m_owns_buffer) m_allocator.deallocate(m_buffer);
 			}
 
 
@@ -51,9 +52,19 @@ namespace Lumix
 						if(mode & Mode::READ)
 						{
 							m_capacity = m_size = m_file->size();
-							m_buffer = (u8*)m_allocator.allocate(sizeof(u8) * m_size);
-							m_file->read(m_buffer, m_size);
 							m_pos = 0;
+							// zero copy if the data are already in memory, e.g. in a mapped pack file
+							const void* child_buffer = m_file->getBuffer();
+							m_owns_buffer = !child_buffer || m_write;
+							if (m_owns_buffer)
+							{
+								m_buffer = (u8*)m_allocator.allocate(sizeof(u8) * m_size);
+								m_file->read(m_buffer, m_size);
+							}
+							else
+							{
+								m_buffer = (u8*)child_buffer;
+							}
 						}
 
 						return true;
@@ -82,8 +93,9 @@ namespace Lumix
 					m_file->close();
 				}
 
-				m_allocator.deallocate(m_buffer);
+				if (m_owns_buffer) m_allocator.deallocate(m_buffer);
 				m_buffer = nullptr;
+				m_owns_buffer = true;
 			}
 
 			bool read(void* buffer, size_t size) override
@@ -99,12 +111,14 @@ namespace Lumix
 				size_t pos = m_pos;
 				size_t cap = m_capacity;
 				size_t sz = m_size;
-				if(pos + size > cap)
+				// borrowed buffer is read only, copy it on first write
+				if(pos + size > cap || !m_owns_buffer)
 				{
 					size_t new_cap = Math::maximum(cap * 2, pos + size);
 					u8* new_data = (u8*)m_allocator.allocate(sizeof(u8) * new_cap);
 					copyMemory(new_data, m_buffer, (int)sz);
-					m_allocator.deallocate(m_buffer);
+					if (m_owns_buffer) m_allocator.deallocate(m_buffer);
+					m_owns_buffer = true;
 					m_buffer = new_data;
 					m_capacity = new_cap;
 				}
@@ -166,6 +180,7 @@ namespace Lumix
 			size_t m_pos;
 			IFile* m_file;
 			bool m_write;
+			bool m_owns_buffer;
 		};
 
 		void MemoryFileDevice::destroyFile(IFile* file)
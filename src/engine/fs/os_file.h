@@ -40,5 +40,26 @@ namespace Lumix
 		private:
 			struct OsFileImpl* m_impl;
 		};
+
+
+		// Read only view of a whole file, can be read from any number of threads.
+		// Memory mapped where the platform supports it.
+		class LUMIX_ENGINE_API OsMappedFile
+		{
+		public:
+			OsMappedFile();
+			~OsMappedFile();
+
+			bool open(const char* path, IAllocator& allocator);
+			void close();
+
+			const u8* getData() const { return m_data; }
+			size_t size() const { return m_size; }
+
+		private:
+			struct OsMappedFileImpl* m_impl;
+			const u8* m_data;
+			size_t m_size;
+		};
 	} // ~namespace FS
 } // ~namespace Lumix
@@ -0,0 +1,276 @@
+#include "engine/fs/pack_builder.h"
+#include "engine/crc32.h"
+#include "engine/fs/os_file.h"
+#include "engine/fs/pack_file_device.h"
+#include "engine/log.h"
+#include "engine/lz4.h"
+#include "engine/math_utils.h"
+#include "engine/path_utils.h"
+#include "engine/string.h"
+#include <cstdlib>
+
+
+namespace Lumix
+{
+namespace FS
+{
+
+
+static const int UNORDERED = 0x40000000;
+static const size_t ENTRY_SIZE = sizeof(u32) + sizeof(u64) * 3;
+
+
+PackBuilder::PackBuilder(IAllocator& allocator)
+	: m_allocator(allocator)
+	, m_entries(allocator)
+	, m_contents(allocator)
+{
+}
+
+
+void PackBuilder::addFile(const char* path)
+{
+	Entry& entry = m_entries.emplace();
+	PathUtils::normalize(path, entry.path, lengthOf(entry.path));
+	entry.hash = crc32(entry.path);
+	entry.order = -1;
+	entry.offset = 0;
+	entry.size = 0;
+	entry.compressed_size = 0;
+	entry.content_hash = 0;
+	entry.duplicate_of = -1;
+}
+
+
+// lines are separated by '\0', text ends with an empty line
+bool PackBuilder::readLines(const char* path, Array<char>& text)
+{
+	OsFile file;
+	if (!file.open(path, Mode::OPEN_AND_READ, m_allocator)) return false;
+	text.resize((int)file.size() + 2);
+	bool success = file.read(&text[0], text.size() - 2);
+	file.close();
+	if (!success) return false;
+
+	text[text.size() - 2] = '\0';
+	text.back() = '\0';
+	for (char& c : text)
+	{
+		if (c == '\n' || c == '\r') c = '\0';
+	}
+	return true;
+}
+
+
+bool PackBuilder::addFiles(const char* list_path)
+{
+	Array<char> text(m_allocator);
+	if (!readLines(list_path, text)) return false;
+
+	for (const char* line = &text[0]; line < &text.back(); line += stringLength(line) + 1)
+	{
+		if (line[0]) addFile(line);
+	}
+	return true;
+}
+
+
+bool PackBuilder::setLoadOrder(const char* load_order_path)
+{
+	Array<char> text(m_allocator);
+	if (!readLines(load_order_path, text)) return false;
+
+	FlatHashMap<u32, int> entries(m_allocator);
+	for (int i = 0, c = m_entries.size(); i < c; ++i)
+	{
+		entries.insert(m_entries[i].hash, i);
+	}
+
+	int order = 0;
+	for (const char* line = &text[0]; line < &text.back(); line += stringLength(line) + 1)
+	{
+		char normalized[MAX_PATH_LENGTH];
+		PathUtils::normalize(line, normalized, lengthOf(normalized));
+		auto iter = entries.find(crc32(normalized));
+		if (iter.isValid() && m_entries[iter.value()].order < 0)
+		{
+			m_entries[iter.value()].order = order;
+			++order;
+		}
+	}
+	return true;
+}
+
+
+int PackBuilder::findDuplicate(const Entry& entry, const Array<u8>& data)
+{
+	auto iter = m_contents.find(entry.content_hash);
+	if (!iter.isValid()) return -1;
+
+	const Entry& candidate = m_entries[iter.value()];
+	if (candidate.size != entry.size) return -1;
+
+	// same hash, check the content
+	OsFile file;
+	if (!file.open(candidate.path, Mode::OPEN_AND_READ, m_allocator)) return -1;
+	Array<u8> candidate_data(m_allocator);
+	candidate_data.resize((int)candidate.size);
+	bool success = candidate.size == 0 || file.read(&candidate_data[0], (size_t)candidate.size);
+	file.close();
+	if (!success) return -1;
+	if (entry.size > 0 && compareMemory(&data[0], &candidate_data[0], (size_t)entry.size) != 0) return -1;
+	return iter.value();
+}
+
+
+bool PackBuilder::writeEntry(OsFile& file, Entry& entry, u64& offset, u32 alignment, bool compress)
+{
+	OsFile src;
+	if (!src.open(entry.path, Mode::OPEN_AND_READ, m_allocator))
+	{
+		g_log_error.log("Engine") << "Could not open " << entry.path;
+		return false;
+	}
+	Array<u8> data(m_allocator);
+	entry.size = src.size();
+	data.resize((int)entry.size);
+	bool success = entry.size == 0 || src.read(&data[0], (size_t)entry.size);
+	src.close();
+	if (!success)
+	{
+		g_log_error.log("Engine") << "Could not read " << entry.path;
+		return false;
+	}
+
+	entry.content_hash = entry.size == 0 ? 0 : crc32(&data[0], (int)entry.size);
+	int duplicate = findDuplicate(entry, data);
+	if (duplicate >= 0)
+	{
+		entry.duplicate_of = duplicate;
+		entry.offset = m_entries[duplicate].offset;
+		entry.compressed_size = m_entries[duplicate].compressed_size;
+		return true;
+	}
+
+	const u8* out_data = entry.size == 0 ? nullptr : &data[0];
+	u64 out_size = entry.size;
+	Array<u8> compressed(m_allocator);
+	if (compress && entry.size > 0)
+	{
+		compressed.resize(LZ4::compressBound((int)entry.size));
+		int compressed_size = LZ4::compress(&data[0], (int)entry.size, &compressed[0], compressed.size());
+		// not worth decompressing if it saves less than 1/8
+		if (compressed_size > 0 && (u64)compressed_size < entry.size - entry.size / 8)
+		{
+			out_data = &compressed[0];
+			out_size = compressed_size;
+			entry.compressed_size = compressed_size;
+		}
+	}
+
+	static const u8 zeros[64] = {};
+	u64 aligned_offset = (offset + alignment - 1) & ~u64(alignment - 1);
+	for (u64 padding = aligned_offset - offset; padding > 0;)
+	{
+		size_t size = (size_t)Math::minimum(padding, (u64)sizeof(zeros));
+		if (!file.write(zeros, size))
+		{
+			g_log_error.log("Engine") << "Could not write padding before " << entry.path;
+			return false;
+		}
+		padding -= size;
+	}
+
+	entry.offset = aligned_offset;
+	offset = aligned_offset + out_size;
+	m_contents.insert(entry.content_hash, int(&entry - &m_entries[0]));
+	if (out_size > 0 && !file.write(out_data, (size_t)out_size))
+	{
+		g_log_error.log("Engine") << "Could not write " << entry.path;
+		return false;
+	}
+	return true;
+}
+
+
+bool PackBuilder::build(const char* dest_path, u32 alignment, bool compress)
+{
+	ASSERT(alignment > 0 && Math::isPowOfTwo(alignment));
+	m_contents.clear();
+
+	// recorded files first, the rest in the order they were added
+	for (int i = 0, c = m_entries.size(); i < c; ++i)
+	{
+		if (m_entries[i].order < 0) m_entries[i].order = UNORDERED + i;
+	}
+	if (!m_entries.empty())
+	{
+		qsort(&m_entries[0], m_entries.size(), sizeof(m_entries[0]), [](const void* a, const void* b) {
+			return ((const Entry*)a)->order - ((const Entry*)b)->order;
+		});
+	}
+
+	OsFile file;
+	if (!file.open(dest_path, Mode::CREATE_AND_WRITE, m_allocator))
+	{
+		g_log_error.log("Engine") << "Could not create " << dest_path;
+		return false;
+	}
+
+	// the header is written at the end, when offsets are known
+	i32 count = m_entries.size();
+	u64 offset = sizeof(PackFileDevice::MAGIC) + sizeof(PackFileDevice::VERSION) + sizeof(count) + ENTRY_SIZE * count;
+	static const u8 zeros[64] = {};
+	bool success = true;
+	for (u64 i = 0; i < offset; i += sizeof(zeros))
+	{
+		success = success && file.write(zeros, (size_t)Math::minimum(offset - i, (u64)sizeof(zeros)));
+	}
+	if (!success)
+	{
+		g_log_error.log("Engine") << "Could not write " << dest_path;
+		file.close();
+		return false;
+	}
+
+	u64 compressed_count = 0;
+	u64 duplicates_count = 0;
+	for (Entry& entry : m_entries)
+	{
+		if (!writeEntry(file, entry, offset, alignment, compress))
+		{
+			file.close();
+			return false;
+		}
+		if (entry.duplicate_of >= 0) ++duplicates_count;
+		else if (entry.compressed_size > 0) ++compressed_count;
+	}
+
+	u32 magic = PackFileDevice::MAGIC;
+	u32 version = PackFileDevice::VERSION;
+	success = file.seek(SeekMode::BEGIN, 0);
+	success = success && file.write(&magic, sizeof(magic));
+	success = success && file.write(&version, sizeof(version));
+	success = success && file.write(&count, sizeof(count));
+	for (const Entry& entry : m_entries)
+	{
+		success = success && file.write(&entry.hash, sizeof(entry.hash));
+		success = success && file.write(&entry.offset, sizeof(entry.offset));
+		success = success && file.write(&entry.size, sizeof(entry.size));
+		success = success && file.write(&entry.compressed_size, sizeof(entry.compressed_size));
+	}
+	file.close();
+	if (!success)
+	{
+		g_log_error.log("Engine") << "Could not write " << dest_path;
+		return false;
+	}
+
+	g_log_info.log("Engine") << "Packed " << count << " files into " << dest_path << " (" << offset << " bytes, "
+							 << compressed_count << " compressed, " << duplicates_count << " duplicates)";
+	return true;
+}
+
+
+} // namespace FS
+} // namespace Lumix
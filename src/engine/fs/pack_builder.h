@@ -0,0 +1,62 @@
+#pragma once
+
+
+#include "engine/array.h"
+#include "engine/flat_hash_map.h"
+#include "engine/lumix.h"
+
+
+namespace Lumix
+{
+class IAllocator;
+
+namespace FS
+{
+
+
+class OsFile;
+
+
+// Writes packs for PackFileDevice. Files are written in the recorded load order (see
+// setLoadOrder), files with the same content are stored only once and files which compress
+// well are LZ4 compressed.
+class LUMIX_ENGINE_API PackBuilder
+{
+public:
+	explicit PackBuilder(IAllocator& allocator);
+
+	// path is used to read the file and its hash is the key in the pack
+	void addFile(const char* path);
+	// text file with one path per line
+	bool addFiles(const char* list_path);
+	// text file with one path per line, files in the list are written first and in that order
+	bool setLoadOrder(const char* load_order_path);
+	// alignment of each file in the pack, power of two
+	bool build(const char* dest_path, u32 alignment, bool compress);
+
+private:
+	struct Entry
+	{
+		char path[MAX_PATH_LENGTH];
+		u32 hash;
+		int order;
+		u64 offset;
+		u64 size;
+		u64 compressed_size;
+		u32 content_hash;
+		int duplicate_of;
+	};
+
+	bool readLines(const char* path, Array<char>& text);
+	bool writeEntry(OsFile& file, Entry& entry, u64& offset, u32 alignment, bool compress);
+	int findDuplicate(const Entry& entry, const Array<u8>& data);
+
+	IAllocator& m_allocator;
+	Array<Entry> m_entries;
+	// content hash -> index of the first written entry with such content
+	FlatHashMap<u32, int> m_contents;
+};
+
+
+} // namespace FS
+} // namespace Lumix
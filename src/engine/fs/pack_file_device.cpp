@@ -1,5 +1,6 @@
 #include "engine/fs/file_system.h"
 #include "engine/iallocator.h"
+#include "engine/lz4.h"
 #include "engine/path.h"
 #include "engine/string.h"
 #include "pack_file_device.h"
@@ -11,6 +12,8 @@ namespace FS
 {
 
 
+// Reads directly from the mapped pack, there is no shared file position. Compressed files
+// are decompressed in open, which runs on an IO thread for async requests.
 class PackFile LUMIX_FINAL : public IFile
 {
 public:
@@ -18,55 +21,86 @@ public:
 		: m_device(device)
 		, m_allocator(allocator)
 		, m_local_offset(0)
+		, m_data(nullptr)
+		, m_decompressed(nullptr)
 	{
+		m_file.offset = 0;
+		m_file.size = 0;
+		m_file.compressed_size = 0;
 	}
 
 
 	bool open(const Path& path, Mode mode) override
 	{
+		ASSERT(!m_decompressed);
 		auto iter = m_device.m_files.find(path.getHash());
 		if (iter == m_device.m_files.end()) return false;
 		m_file = iter.value();
 		m_local_offset = 0;
-		return m_device.m_file.seek(SeekMode::BEGIN, (size_t)m_file.offset);
+		const u8* packed = m_device.m_file.getData() + m_file.offset;
+		if (m_file.compressed_size == 0)
+		{
+			m_data = packed;
+			return true;
+		}
+
+		m_decompressed = (u8*)m_allocator.allocate((size_t)m_file.size);
+		m_data = m_decompressed;
+		return LZ4::decompress(packed, (int)m_file.compressed_size, m_decompressed, (int)m_file.size);
 	}
 
 
 	bool read(void* buffer, size_t size) override
 	{
-		if (m_device.m_offset != m_file.offset + m_local_offset)
-		{
-			if (!m_device.m_file.seek(FS::SeekMode::BEGIN, size_t(m_file.offset + m_local_offset)))
-			{
-				return false;
-			}
-		}
+		if (m_local_offset + size > m_file.size) return false;
+		copyMemory(buffer, m_data + m_local_offset, size);
 		m_local_offset += size;
-		return m_device.m_file.read(buffer, size);
+		return true;
 	}
 
 
 	bool seek(SeekMode base, size_t pos) override
 	{
+		switch (base)
+		{
+			case SeekMode::BEGIN: break;
+			case SeekMode::CURRENT: pos += m_local_offset; break;
+			case SeekMode::END: pos = (size_t)m_file.size - pos; break;
+			default: ASSERT(false); return false;
+		}
+		if (pos > m_file.size) return false;
 		m_local_offset = pos;
-		return m_device.m_file.seek(SeekMode::BEGIN, size_t(m_file.offset + pos));
+		return true;
 	}
 
 
+	// valid while the pack is mounted and the file is open
+	const void* getBuffer() const override { return m_data; }
+
 	IFileDevice& getDevice() override { return m_device; }
-	void close() override { m_local_offset = 0; }
+
+
+	void close() override
+	{
+		m_local_offset = 0;
+		m_allocator.deallocate(m_decompressed);
+		m_decompressed = nullptr;
+		m_data = nullptr;
+	}
+
 	bool write(const void* buffer, size_t size) override { ASSERT(false); return false; }
-	const void* getBuffer() const override { return nullptr; }
 	size_t size() override { return (size_t)m_file.size; }
 	size_t pos() override { return m_local_offset; }
 
 private:
-	virtual ~PackFile() {}
+	virtual ~PackFile() { m_allocator.deallocate(m_decompressed); }
 
 	PackFileDevice::PackFileInfo m_file;
 	PackFileDevice& m_device;
 	size_t m_local_offset;
 	IAllocator& m_allocator;
+	const u8* m_data;
+	u8* m_decompressed;
 }; // class PackFile
 
 
@@ -85,20 +119,55 @@ PackFileDevice::~PackFileDevice()
 
 bool PackFileDevice::mount(const char* path)
 {
+	m_files.clear();
 	m_file.close();
-	if(!m_file.open(path, Mode::OPEN_AND_READ, m_allocator)) return false;
+	if (!m_file.open(path, m_allocator)) return false;
+	if (readHeader()) return true;
+
+	m_files.clear();
+	m_file.close();
+	return false;
+}
+
+
+bool PackFileDevice::readHeader()
+{
+	const u8* data = m_file.getData();
+	size_t size = m_file.size();
+	size_t pos = 0;
+	u32 magic;
+	if (size < sizeof(magic)) return false;
+	copyMemory(&magic, data, sizeof(magic));
+	bool is_legacy = magic != MAGIC;
+	if (!is_legacy)
+	{
+		u32 version;
+		if (size < sizeof(magic) + sizeof(version)) return false;
+		copyMemory(&version, data + sizeof(magic), sizeof(version));
+		if (version > VERSION) return false;
+		pos = sizeof(magic) + sizeof(version);
+	}
 
 	i32 count;
-	m_file.read(&count, sizeof(count));
-	for(int i = 0; i < count; ++i)
+	if (size - pos < sizeof(count)) return false;
+	copyMemory(&count, data + pos, sizeof(count));
+	pos += sizeof(count);
+
+	size_t info_size = is_legacy ? sizeof(u64) * 2 : sizeof(PackFileInfo);
+	size_t entry_size = sizeof(u32) + info_size;
+	if (count < 0 || (size - pos) / entry_size < (size_t)count) return false;
+	for (int i = 0; i < count; ++i)
 	{
 		u32 hash;
-		m_file.read(&hash, sizeof(hash));
 		PackFileInfo info;
-		m_file.read(&info, sizeof(info));
+		info.compressed_size = 0;
+		copyMemory(&hash, data + pos, sizeof(hash));
+		copyMemory(&info, data + pos + sizeof(hash), info_size);
+		pos += entry_size;
+		u64 stored_size = info.compressed_size == 0 ? info.size : info.compressed_size;
+		if (info.offset > size || stored_size > size - info.offset) return false;
 		m_files.insert(hash, info);
 	}
-	m_offset = m_file.pos();
 	return true;
 }
 
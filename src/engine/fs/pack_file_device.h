@@ -2,7 +2,7 @@
 
 #include "engine/fs/ifile_device.h"
 #include "engine/fs/os_file.h"
-#include "engine/hash_map.h"
+#include "engine/flat_hash_map.h"
 #include "engine/lumix.h"
 
 
@@ -15,10 +15,17 @@ namespace FS
 class IFile;
 
 
+// Pack layout: u32 MAGIC, u32 VERSION, i32 count, count times {u32 path hash, u64 offset,
+// u64 size, u64 compressed size} and the data. Compressed size is 0 for stored files,
+// other files are LZ4 compressed. Old packs start directly with the count and their entries
+// do not have the compressed size, they are still supported.
 class LUMIX_ENGINE_API PackFileDevice LUMIX_FINAL : public IFileDevice
 {
 	friend class PackFile;
 public:
+	static const u32 MAGIC = 0x4b50584c; // 'LXPK'
+	static const u32 VERSION = 1;
+
 	PackFileDevice(IAllocator& allocator);
 	~PackFileDevice();
 
@@ -32,11 +39,14 @@ private:
 	{
 		u64 offset;
 		u64 size;
+		u64 compressed_size;
 	};
 
-	HashMap<u32, PackFileInfo> m_files;
-	size_t m_offset;
-	OsFile m_file;
+	bool readHeader();
+
+	// files are never modified after mount, so any number of threads can read them
+	FlatHashMap<u32, PackFileInfo> m_files;
+	OsMappedFile m_file;
 	IAllocator& m_allocator;
 };
 
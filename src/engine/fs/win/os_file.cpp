@@ -176,5 +176,78 @@ OsFile& OsFile::operator <<(float value)
 }
 
 
+struct OsMappedFileImpl
+{
+	explicit OsMappedFileImpl(IAllocator& allocator)
+		: m_allocator(allocator)
+	{
+	}
+
+	IAllocator& m_allocator;
+	HANDLE m_file;
+	HANDLE m_mapping;
+};
+
+
+OsMappedFile::OsMappedFile()
+	: m_impl(nullptr)
+	, m_data(nullptr)
+	, m_size(0)
+{
+}
+
+OsMappedFile::~OsMappedFile()
+{
+	ASSERT(!m_impl);
+}
+
+bool OsMappedFile::open(const char* path, IAllocator& allocator)
+{
+	ASSERT(!m_impl);
+	HANDLE file = ::CreateFile(
+		path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	DWORD size_high = 0;
+	DWORD size_low = ::GetFileSize(file, &size_high);
+	u64 size = ((u64)size_high << 32) | size_low;
+	HANDLE mapping = nullptr;
+	const void* data = nullptr;
+	// empty files can not be mapped
+	if (size > 0)
+	{
+		mapping = ::CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data)
+		{
+			if (mapping) ::CloseHandle(mapping);
+			::CloseHandle(file);
+			return false;
+		}
+	}
+
+	OsMappedFileImpl* impl = LUMIX_NEW(allocator, OsMappedFileImpl)(allocator);
+	impl->m_file = file;
+	impl->m_mapping = mapping;
+	m_impl = impl;
+	m_data = (const u8*)data;
+	m_size = (size_t)size;
+	return true;
+}
+
+void OsMappedFile::close()
+{
+	if (!m_impl) return;
+
+	if (m_data) ::UnmapViewOfFile(m_data);
+	if (m_impl->m_mapping) ::CloseHandle(m_impl->m_mapping);
+	::CloseHandle(m_impl->m_file);
+	LUMIX_DELETE(m_impl->m_allocator, m_impl);
+	m_impl = nullptr;
+	m_data = nullptr;
+	m_size = 0;
+}
+
+
 } // namespace FS
 } // namespace Lumix
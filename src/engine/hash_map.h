@@ -58,7 +58,8 @@ namespace Lumix
 	{
 		static u32 get(const i32& key)
 		{
-			u32 x = ((key >> 16) ^ key) * 0x45d9f3b;
+			// multiply unsigned, signed overflow is undefined and the optimizer takes advantage of it
+			u32 x = (u32)((key >> 16) ^ key) * 0x45d9f3b;
 			x = ((x >> 16) ^ x) * 0x45d9f3b;
 			x = ((x >> 16) ^ x);
 			return x;
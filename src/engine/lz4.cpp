@@ -0,0 +1,196 @@
+#include "engine/lz4.h"
+#include "engine/string.h"
+
+
+namespace Lumix
+{
+namespace LZ4
+{
+
+
+static const int MIN_MATCH = 4;
+// the last match must start at least 12 bytes before the end of the block
+static const int MF_LIMIT = 12;
+// the last 5 bytes are always literals
+static const int LAST_LITERALS = 5;
+static const int MAX_OFFSET = 0xffff;
+static const int HASH_LOG = 12;
+static const int RUN_MASK = 0xf;
+
+
+static u32 read32(const u8* ptr)
+{
+	u32 value;
+	copyMemory(&value, ptr, sizeof(value));
+	return value;
+}
+
+
+static u32 hash(u32 sequence)
+{
+	return (sequence * 2654435761U) >> (32 - HASH_LOG);
+}
+
+
+static u8* writeLength(u8* out, int length)
+{
+	while (length >= 255)
+	{
+		*out = 255;
+		++out;
+		length -= 255;
+	}
+	*out = (u8)length;
+	return out + 1;
+}
+
+
+static u8* writeSequence(u8* out, const u8* literals, int literals_count, int offset, int match_length)
+{
+	u8* token = out;
+	++out;
+	if (literals_count >= RUN_MASK)
+	{
+		*token = RUN_MASK << 4;
+		out = writeLength(out, literals_count - RUN_MASK);
+	}
+	else
+	{
+		*token = u8(literals_count << 4);
+	}
+	copyMemory(out, literals, literals_count);
+	out += literals_count;
+
+	// the last sequence has only literals
+	if (match_length == 0) return out;
+
+	out[0] = u8(offset);
+	out[1] = u8(offset >> 8);
+	out += 2;
+	int length = match_length - MIN_MATCH;
+	if (length >= RUN_MASK)
+	{
+		*token |= RUN_MASK;
+		out = writeLength(out, length - RUN_MASK);
+	}
+	else
+	{
+		*token |= u8(length);
+	}
+	return out;
+}
+
+
+static int sequenceBound(int literals_count, int match_length)
+{
+	return 1 + literals_count / 255 + 1 + literals_count + 2 + match_length / 255 + 1;
+}
+
+
+int compressBound(int size)
+{
+	return size + size / 255 + 16;
+}
+
+
+int compress(const void* src, int src_size, void* dst, int dst_capacity)
+{
+	const u8* in = (const u8*)src;
+	u8* out = (u8*)dst;
+	u8* out_end = out + dst_capacity;
+
+	int table[1 << HASH_LOG];
+	for (int& i : table) i = -1;
+
+	int anchor = 0;
+	int pos = 0;
+	while (pos < src_size - MF_LIMIT)
+	{
+		u32 sequence = read32(in + pos);
+		u32 h = hash(sequence);
+		int candidate = table[h];
+		table[h] = pos;
+		if (candidate < 0 || pos - candidate > MAX_OFFSET || read32(in + candidate) != sequence)
+		{
+			++pos;
+			continue;
+		}
+
+		int length = MIN_MATCH;
+		int max_length = src_size - LAST_LITERALS - pos;
+		while (length < max_length && in[candidate + length] == in[pos + length]) ++length;
+
+		int literals_count = pos - anchor;
+		if (out + sequenceBound(literals_count, length) > out_end) return 0;
+		out = writeSequence(out, in + anchor, literals_count, pos - candidate, length);
+		pos += length;
+		anchor = pos;
+	}
+
+	int literals_count = src_size - anchor;
+	if (out + sequenceBound(literals_count, 0) > out_end) return 0;
+	out = writeSequence(out, in + anchor, literals_count, 0, 0);
+	return int(out - (u8*)dst);
+}
+
+
+static bool readLength(const u8*& in, const u8* in_end, int& length)
+{
+	u32 value;
+	do
+	{
+		if (in >= in_end) return false;
+		value = *in;
+		++in;
+		length += value;
+		if (length < 0) return false;
+	} while (value == 255);
+	return true;
+}
+
+
+bool decompress(const void* src, int src_size, void* dst, int dst_size)
+{
+	const u8* in = (const u8*)src;
+	const u8* in_end = in + src_size;
+	u8* out = (u8*)dst;
+	u8* out_end = out + dst_size;
+
+	for (;;)
+	{
+		if (in >= in_end) return false;
+		u32 token = *in;
+		++in;
+
+		int literals_count = token >> 4;
+		if (literals_count == RUN_MASK && !readLength(in, in_end, literals_count)) return false;
+		if (literals_count > in_end - in || literals_count > out_end - out) return false;
+		copyMemory(out, in, literals_count);
+		in += literals_count;
+		out += literals_count;
+
+		if (in == in_end) return out == out_end;
+
+		if (in_end - in < 2) return false;
+		int offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > out - (u8*)dst) return false;
+
+		int length = token & RUN_MASK;
+		if (length == RUN_MASK && !readLength(in, in_end, length)) return false;
+		length += MIN_MATCH;
+		if (length > out_end - out) return false;
+
+		// source and destination can overlap, copy byte by byte
+		const u8* match = out - offset;
+		for (int i = 0; i < length; ++i)
+		{
+			out[i] = match[i];
+		}
+		out += length;
+	}
+}
+
+
+} // namespace LZ4
+} // namespace Lumix
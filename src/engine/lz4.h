@@ -0,0 +1,23 @@
+#pragma once
+
+
+#include "engine/lumix.h"
+
+
+namespace Lumix
+{
+namespace LZ4
+{
+
+
+// Compressor and decompressor of the LZ4 block format, data are compatible with the reference
+// implementation. The compressor is the simple greedy one, fast enough for offline packing.
+LUMIX_ENGINE_API int compressBound(int size);
+// returns compressed size or 0 if dst is too small
+LUMIX_ENGINE_API int compress(const void* src, int src_size, void* dst, int dst_capacity);
+// returns false on malformed data or if the data do not decompress to exactly dst_size bytes
+LUMIX_ENGINE_API bool decompress(const void* src, int src_size, void* dst, int dst_size);
+
+
+} // namespace LZ4
+} // namespace Lumix
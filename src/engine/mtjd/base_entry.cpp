@@ -2,6 +2,7 @@
 #include "engine/mtjd/base_entry.h"
 
 #include "engine/mtjd/manager.h"
+#include "engine/mt/sync.h"
 
 namespace Lumix
 {
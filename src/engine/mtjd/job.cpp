@@ -2,6 +2,7 @@
 #include "engine/mtjd/job.h"
 
 #include "engine/mtjd/manager.h"
+#include "engine/mt/atomic.h"
 
 namespace Lumix
 {
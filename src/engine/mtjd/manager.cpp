@@ -1,11 +1,14 @@
 #include "engine/lumix.h"
 #include "engine/mtjd/manager.h"
 
+#include "engine/array.h"
 #include "engine/mtjd/job.h"
-#include "engine/mtjd/scheduler.h"
 #include "engine/mtjd/worker_thread.h"
 
+#include "engine/mt/atomic.h"
+#include "engine/mt/sync.h"
 #include "engine/mt/thread.h"
+#include "engine/profiler.h"
 
 namespace Lumix
 {
@@ -13,31 +16,165 @@ namespace MTJD
 {
 
 
-struct ManagerImpl LUMIX_FINAL : public Manager
+struct ManagerImpl;
+
+
+#if !LUMIX_SINGLE_THREAD()
+
+
+static const int SPIN_COUNT = 64;
+
+
+// set on worker threads so jobs scheduled from a running job end up in the worker's own deque
+static thread_local ManagerImpl* s_worker_manager = nullptr;
+static thread_local u32 s_worker_idx = 0;
+
+
+struct JobEntry
+{
+	JobDecl decl;
+	volatile i32* counter;
+};
+
+
+// Per-worker job deque. The owner pushes and pops at the back (LIFO, data is still in cache),
+// thieves and helping threads take from the front (FIFO, oldest jobs). One ring per priority, grows on demand.
+class JobDeque
 {
-	typedef MT::LockFreeFixedQueue<Job*, 512>	JobsTable;
-	typedef Array<JobTrans*>					TransTable;
+public:
+	explicit JobDeque(IAllocator& allocator)
+		: m_allocator(allocator)
+		, m_mutex(false)
+		, m_count(0)
+	{
+		for (Ring& ring : m_rings)
+		{
+			ring.jobs = nullptr;
+			ring.capacity = 0;
+			ring.head = 0;
+			ring.tail = 0;
+		}
+	}
+
+	~JobDeque()
+	{
+		for (Ring& ring : m_rings)
+		{
+			m_allocator.deallocate(ring.jobs);
+		}
+	}
+
+	bool isEmpty() const { return m_count == 0; }
+
+	void pushBack(const JobEntry& job, Priority priority)
+	{
+		ASSERT(priority > Priority::None && priority < Priority::Count);
+
+		MT::SpinLock lock(m_mutex);
+		Ring& ring = m_rings[(int)priority];
+		if (ring.tail - ring.head == ring.capacity) grow(ring);
+		ring.jobs[ring.tail & (ring.capacity - 1)] = job;
+		++ring.tail;
+		MT::atomicIncrement(&m_count);
+	}
+
+	bool popBack(JobEntry* job)
+	{
+		if (isEmpty()) return false;
+
+		MT::SpinLock lock(m_mutex);
+		for (Ring& ring : m_rings)
+		{
+			if (ring.head == ring.tail) continue;
+
+			--ring.tail;
+			MT::atomicDecrement(&m_count);
+			*job = ring.jobs[ring.tail & (ring.capacity - 1)];
+			return true;
+		}
+		return false;
+	}
+
+	// can fail spuriously when the deque is locked by another thread, check isEmpty before sleeping
+	bool popFront(JobEntry* job)
+	{
+		if (isEmpty()) return false;
+		if (!m_mutex.poll()) return false;
+
+		bool found = false;
+		for (Ring& ring : m_rings)
+		{
+			if (ring.head == ring.tail) continue;
+
+			*job = ring.jobs[ring.head & (ring.capacity - 1)];
+			++ring.head;
+			MT::atomicDecrement(&m_count);
+			found = true;
+			break;
+		}
+		m_mutex.unlock();
+		return found;
+	}
+
+private:
+	struct Ring
+	{
+		JobEntry* jobs;
+		u32 capacity;
+		u32 head;
+		u32 tail;
+	};
+
+	void grow(Ring& ring)
+	{
+		u32 new_capacity = ring.capacity == 0 ? 64 : ring.capacity << 1;
+		JobEntry* new_jobs = (JobEntry*)m_allocator.allocate(sizeof(JobEntry) * new_capacity);
+		for (u32 i = ring.head; i != ring.tail; ++i)
+		{
+			new_jobs[i & (new_capacity - 1)] = ring.jobs[i & (ring.capacity - 1)];
+		}
+		m_allocator.deallocate(ring.jobs);
+		ring.jobs = new_jobs;
+		ring.capacity = new_capacity;
+	}
 
+	IAllocator& m_allocator;
+	MT::SpinMutex m_mutex;
+	volatile i32 m_count;
+	Ring m_rings[(int)Priority::Count];
+};
 
+
+#endif
+
+
+struct ManagerImpl LUMIX_FINAL : public Manager
+{
 	ManagerImpl(IAllocator& allocator)
-		: m_scheduling_counter(0)
+		: m_allocator(allocator)
 		#if !LUMIX_SINGLE_THREAD()
-			, m_scheduler(*this, allocator)
+			, m_queues(allocator)
+			, m_worker_tasks(allocator)
+			, m_work_signal(0, 0x7fffFFFF)
+			, m_sleeping_workers(0)
+			, m_next_queue(0)
+			, m_is_exiting(false)
 		#endif
-		, m_worker_tasks(allocator)
-		, m_allocator(allocator)
-		, m_pending_trans(allocator)
 	{
 #if !LUMIX_SINGLE_THREAD()
 		u32 threads_num = getCpuThreadsCount();
 
-		m_scheduler.create("MTJD::Scheduler");
+		m_queues.reserve(threads_num);
+		for (u32 i = 0; i < threads_num; ++i)
+		{
+			m_queues.emplace(m_allocator);
+		}
 
 		m_worker_tasks.reserve(threads_num);
 		for (u32 i = 0; i < threads_num; ++i)
 		{
-			auto& task = m_worker_tasks.emplace(m_allocator);
-			task.create("MTJD::WorkerTask", this, &m_trans_queue);
+			auto& task = m_worker_tasks.emplace(*this, i, m_allocator);
+			task.create("MTJD::WorkerTask");
 			task.setAffinityMask(getAffinityMask(i));
 		}
 
@@ -48,10 +185,11 @@ struct ManagerImpl LUMIX_FINAL : public Manager
 	{
 #if !LUMIX_SINGLE_THREAD()
 
-		u32 threads_num = getCpuThreadsCount();
-		for (u32 i = 0; i < threads_num; ++i)
+		m_is_exiting = true;
+		MT::memoryBarrier();
+		for (int i = 0; i < m_worker_tasks.size(); ++i)
 		{
-			m_trans_queue.abort();
+			m_work_signal.signal();
 		}
 
 		for (auto& task : m_worker_tasks)
@@ -59,10 +197,6 @@ struct ManagerImpl LUMIX_FINAL : public Manager
 			task.destroy();
 		}
 
-		m_scheduler.forceExit(false);
-		m_scheduler.dataSignal();
-		m_scheduler.destroy();
-
 #endif
 	}
 
@@ -92,9 +226,8 @@ struct ManagerImpl LUMIX_FINAL : public Manager
 		{
 			job->m_scheduled = true;
 
-			pushReadyJob(job);
-
-			m_scheduler.dataSignal();
+			JobEntry entry = {{&ManagerImpl::executeJob, job}, nullptr};
+			pushReadyJob(entry, job->getPriority());
 		}
 
 #else
@@ -105,114 +238,171 @@ struct ManagerImpl LUMIX_FINAL : public Manager
 #endif
 	}
 
-	void scheduleCpu(Job* job)
+
+	void runJobs(const JobDecl* jobs, int count, volatile i32* counter) override
 	{
-		JobTrans* tr = m_trans_queue.alloc(false);
-		if (tr)
+		ASSERT(count >= 0);
+
+#if !LUMIX_SINGLE_THREAD()
+
+		MT::atomicAdd(counter, count);
+		for (int i = 0; i < count; ++i)
 		{
-			tr->data = job;
-			if (!m_trans_queue.push(tr, false))
-			{
-				m_trans_queue.dealoc(tr);
-				pushReadyJob(job);
-			}
-			else
-			{
-				m_pending_trans.push(tr);
-			}
+			JobEntry entry = {jobs[i], counter};
+			pushReadyJob(entry, Priority::Default);
+		}
+
+#else
+
+		for (int i = 0; i < count; ++i)
+		{
+			jobs[i].task(jobs[i].data);
 		}
+
+#endif
 	}
 
-	void doScheduling() override
+
+	void wait(volatile i32* counter) override
 	{
 #if !LUMIX_SINGLE_THREAD()
 
-		u32 count = MT::atomicIncrement(&m_scheduling_counter);
-		if (1 == count)
+		PROFILE_FUNCTION();
+		int worker_idx = s_worker_manager == this ? (int)s_worker_idx : -1;
+		while (*counter > 0)
 		{
-			do
+			JobEntry job;
+			if (popJob(worker_idx, &job))
 			{
-				for (int i = 0; i < m_pending_trans.size();)
-				{
-					JobTrans* tr = m_pending_trans[i];
-					if (tr->isCompleted())
-					{
-						tr->data->onExecuted();
-						m_trans_queue.dealoc(tr);
-						m_pending_trans.eraseFast(i);
-					}
-					else
-					{
-						++i;
-					}
-				}
-
-				Job* job = getNextReadyJob();
-				if (job)
-				{
-					scheduleCpu(job);
-				}
-
-				count = MT::atomicDecrement(&m_scheduling_counter);
-			} while (0 < count);
+				execute(job);
+			}
+			else
+			{
+				MT::yield();
+			}
 		}
 
 #endif
 	}
 
-	Job* getNextReadyJob()
+
+	static void executeJob(void* data)
 	{
+		Job* job = (Job*)data;
+		Profiler::beginBlock(job->getJobName());
+		job->execute();
+		Profiler::endBlock();
+
+		job->onExecuted();
+	}
+
+
 #if !LUMIX_SINGLE_THREAD()
 
-		for (i32 i = 0; i < (i32)Priority::Count; ++i)
-		{
-			if (!m_ready_to_execute[i].isEmpty())
-			{
-				Job** entry = m_ready_to_execute[i].pop(true);
-				Job* ret = *entry;
-				m_ready_to_execute[i].dealoc(entry);
+	static void execute(const JobEntry& job)
+	{
+		job.decl.task(job.decl.data);
+		if (job.counter) MT::atomicDecrement(job.counter);
+	}
 
-				return ret;
-			}
+
+	void pushReadyJob(const JobEntry& job, Priority priority)
+	{
+		u32 queue_idx = s_worker_manager == this
+			? s_worker_idx
+			: u32(MT::atomicIncrement(&m_next_queue)) % m_queues.size();
+		m_queues[queue_idx].pushBack(job, priority);
+
+		MT::memoryBarrier();
+		if (m_sleeping_workers > 0) m_work_signal.signal();
+	}
+
+
+	// worker_idx < 0 for threads which do not own a queue
+	bool popJob(int worker_idx, JobEntry* job)
+	{
+		if (worker_idx >= 0 && m_queues[worker_idx].popBack(job)) return true;
+
+		int start = worker_idx < 0 ? 0 : worker_idx + 1;
+		int count = worker_idx < 0 ? m_queues.size() : m_queues.size() - 1;
+		for (int i = 0; i < count; ++i)
+		{
+			if (m_queues[(start + i) % m_queues.size()].popFront(job)) return true;
 		}
+		return false;
+	}
 
-#endif
 
-		return nullptr;
+	bool hasQueuedJobs() const
+	{
+		for (const JobDeque& queue : m_queues)
+		{
+			if (!queue.isEmpty()) return true;
+		}
+		return false;
 	}
 
-	void pushReadyJob(Job* job)
+
+	void initWorkerThread(u32 worker_idx) override
 	{
-		ASSERT(job);
+		s_worker_manager = this;
+		s_worker_idx = worker_idx;
+	}
 
-#if !LUMIX_SINGLE_THREAD()
 
-		Job** jobEntry = m_ready_to_execute[(i32)job->getPriority()].alloc(true);
-		if (jobEntry)
+	bool runNextJob(u32 worker_idx) override
+	{
+		JobEntry job;
+		bool found = false;
+		while (!found)
 		{
-			*jobEntry = job;
-			m_ready_to_execute[(i32)job->getPriority()].push(jobEntry, true);
+			for (int i = 0; i < SPIN_COUNT && !found; ++i)
+			{
+				if (m_is_exiting) return false;
+
+				found = popJob(worker_idx, &job);
+				if (!found) MT::yield();
+			}
+			if (found) break;
+
+			// pushReadyJob checks m_sleeping_workers after the push, so a job pushed
+			// before the increment is seen by the checks below, anything later signals;
+			// popFront fails when a deque is locked, so do not sleep while any deque has a job
+			MT::atomicIncrement(&m_sleeping_workers);
+			found = popJob(worker_idx, &job);
+			if (!found && !m_is_exiting && !hasQueuedJobs()) m_work_signal.wait();
+			MT::atomicDecrement(&m_sleeping_workers);
 		}
 
-#endif
+		Profiler::beginBlock("WorkerTask");
+		execute(job);
+		Profiler::endBlock();
+		return true;
 	}
 
+#else
+
+	void initWorkerThread(u32) override {}
+	bool runNextJob(u32) override { return false; }
+
+#endif
+
+
 	u32 getAffinityMask(u32) const
 	{
 		return MT::getThreadAffinityMask();
 	}
 
 	IAllocator&			m_allocator;
-	JobsTable			m_ready_to_execute[(size_t)Priority::Count];
-	JobTransQueue		m_trans_queue;
-	TransTable			m_pending_trans;
-	Array<WorkerTask>	m_worker_tasks;
 	#if !LUMIX_SINGLE_THREAD()
-		Scheduler			m_scheduler;
+		Array<JobDeque>		m_queues;
+		Array<WorkerTask>	m_worker_tasks;
+		MT::Semaphore		m_work_signal;
+		volatile i32		m_sleeping_workers;
+		volatile i32		m_next_queue;
+		volatile bool		m_is_exiting;
 	#endif
 
-	volatile i32 m_scheduling_counter;
-
 
 }; // struct ManagerImpl
 
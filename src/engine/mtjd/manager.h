@@ -1,12 +1,18 @@
 #pragma once
 
 
-#include "engine/mt/lock_free_fixed_queue.h"
-#include "engine/mt/transaction.h"
+#include "engine/lumix.h"
+#include "engine/math_utils.h"
+#include "engine/mt/atomic.h"
 
 
 namespace Lumix
 {
+
+
+class IAllocator;
+
+
 namespace MTJD
 {
 
@@ -15,23 +21,77 @@ class Job;
 class WorkerTask;
 
 
+struct JobDecl
+{
+	void (*task)(void* data);
+	void* data;
+};
+
+
 class LUMIX_ENGINE_API Manager
 {
-	friend class Scheduler;
 	friend class WorkerTask;
 
 public:
-	typedef MT::Transaction<Job*> JobTrans;
-	typedef MT::LockFreeFixedQueue<JobTrans, 32> JobTransQueue;
-
 	virtual ~Manager() {}
 
 	virtual u32 getCpuThreadsCount() const = 0;
 	virtual void schedule(Job* job) = 0;
-	virtual void doScheduling() = 0;
+
+	// counter is incremented by count and decremented as each job finishes
+	virtual void runJobs(const JobDecl* jobs, int count, volatile i32* counter) = 0;
+	// executes pending jobs on the calling thread until counter drops to zero
+	virtual void wait(volatile i32* counter) = 0;
+
+	// calls fn(from, to) for consecutive subranges of [0, count) of at most grain elements,
+	// the calling thread takes part and the call returns when the whole range is processed
+	template <typename F> void parallelFor(int count, int grain, const F& fn)
+	{
+		ASSERT(grain > 0);
+		if (count <= grain)
+		{
+			if (count > 0) fn(0, count);
+			return;
+		}
+
+		struct Context
+		{
+			const F* fn;
+			volatile i32 offset;
+			i32 count;
+			i32 grain;
+		};
+		Context ctx = {&fn, 0, count, grain};
+
+		JobDecl jobs[64];
+		int chunks = (count + grain - 1) / grain;
+		int jobs_count = Math::minimum(chunks, (int)getCpuThreadsCount() + 1, lengthOf(jobs));
+		for (int i = 0; i < jobs_count; ++i)
+		{
+			jobs[i].data = &ctx;
+			jobs[i].task = [](void* data) {
+				Context* ctx = (Context*)data;
+				for (;;)
+				{
+					i32 from = MT::atomicAdd(&ctx->offset, ctx->grain) - ctx->grain;
+					if (from >= ctx->count) return;
+					(*ctx->fn)(from, Math::minimum(from + ctx->grain, ctx->count));
+				}
+			};
+		}
+
+		volatile i32 counter = 0;
+		runJobs(jobs, jobs_count, &counter);
+		wait(&counter);
+	}
 
 	static Manager* create(IAllocator& allocator);
 	static void destroy(Manager& manager);
+
+protected:
+	virtual void initWorkerThread(u32 worker_idx) = 0;
+	// blocks until a job is executed, returns false when the manager is being destroyed
+	virtual bool runNextJob(u32 worker_idx) = 0;
 };
 
 
@@ -1,8 +1,6 @@
 #include "engine/lumix.h"
 #include "engine/mtjd/worker_thread.h"
 #include "engine/mtjd/manager.h"
-#include "engine/mtjd/job.h"
-#include "engine/profiler.h"
 
 namespace Lumix
 {
@@ -10,8 +8,10 @@ namespace Lumix
 	{
 #if !LUMIX_SINGLE_THREAD()
 
-		WorkerTask::WorkerTask(IAllocator& allocator)
+		WorkerTask::WorkerTask(Manager& manager, u32 worker_idx, IAllocator& allocator)
 			: Task(allocator)
+			, m_manager(manager)
+			, m_worker_idx(worker_idx)
 		{
 		}
 
@@ -19,35 +19,12 @@ namespace Lumix
 		{
 		}
 
-		bool WorkerTask::create(const char* name, Manager* manager, Manager::JobTransQueue* trans_queue)
-		{
-			ASSERT(manager);
-			ASSERT(trans_queue);
-
-			m_manager = manager;
-			m_trans_queue = trans_queue;
-
-			return Task::create(name);
-		}
-
 		int WorkerTask::task()
 		{
-			ASSERT(m_trans_queue);
+			m_manager.initWorkerThread(m_worker_idx);
 
-			while (!m_trans_queue->isAborted())
+			while (m_manager.runNextJob(m_worker_idx))
 			{
-				Manager::JobTrans* tr = m_trans_queue->pop(true);
-				if (!tr)
-					break;
-
-				Profiler::beginBlock("WorkerTask");
-				Profiler::beginBlock(tr->data->getJobName());
-				tr->data->execute();
-				tr->setCompleted();
-				Profiler::endBlock();
-				Profiler::endBlock();
-
-				m_manager->doScheduling();
 			}
 
 			return 0;
@@ -2,9 +2,6 @@
 
 
 #include "engine/mt/task.h"
-#include "engine/mt/lock_free_fixed_queue.h"
-
-#include "engine/mtjd/manager.h"
 
 
 #if !LUMIX_SINGLE_THREAD()
@@ -20,19 +17,20 @@ namespace MTJD
 {
 
 
+class Manager;
+
+
 class WorkerTask LUMIX_FINAL : public MT::Task
 {
 public:
-	WorkerTask(IAllocator& allocator);
+	WorkerTask(Manager& manager, u32 worker_idx, IAllocator& allocator);
 	~WorkerTask();
 
-	bool create(const char* name, Manager* manager, Manager::JobTransQueue* trans_queue);
-
-	virtual int task();
+	int task() override;
 
 private:
-	Manager::JobTransQueue* m_trans_queue;
-	Manager* m_manager;
+	Manager& m_manager;
+	u32 m_worker_idx;
 };
 
 
@@ -40,4 +38,4 @@ private:
 } // namepsace Lumix
 
 
-#endif
\ No newline at end of file
+#endif
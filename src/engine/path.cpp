@@ -3,6 +3,7 @@
 
 #include "engine/blob.h"
 #include "engine/crc32.h"
+#include "engine/mt/atomic.h"
 #include "engine/mt/sync.h"
 #include "engine/path_utils.h"
 #include "engine/string.h"
@@ -15,10 +16,12 @@ namespace Lumix
 
 
 	PathManager::PathManager(Lumix::IAllocator& allocator)
-		: m_paths(allocator)
-		, m_mutex(false)
-		, m_allocator(allocator)
+		: m_allocator(allocator)
 	{
+		for (Shard*& shard : m_shards)
+		{
+			shard = LUMIX_NEW(m_allocator, Shard)(m_allocator);
+		}
 		g_path_manager = this;
 		m_empty_path = getPath(0, "");
 	}
@@ -28,26 +31,41 @@ namespace Lumix
 	{
 		decrementRefCount(m_empty_path);
 		m_empty_path = nullptr;
-		ASSERT(m_paths.size() == 0);
+		clear();
+		for (Shard* shard : m_shards)
+		{
+			ASSERT(shard->paths.size() == 0);
+			LUMIX_DELETE(m_allocator, shard);
+		}
 		g_path_manager = nullptr;
 	}
 
 
 	void PathManager::serialize(OutputBlob& serializer)
 	{
-		MT::SpinLock lock(m_mutex);
-		clear();
-		serializer.write((i32)m_paths.size());
-		for (int i = 0; i < m_paths.size(); ++i)
+		for (Shard* shard : m_shards) shard->mutex.lock();
+
+		i32 count = 0;
+		for (Shard* shard : m_shards)
 		{
-			serializer.writeString(m_paths.at(i)->m_path);
+			clearMultithreadUnsafe(*shard);
+			count += shard->paths.size();
+		}
+		serializer.write(count);
+		for (Shard* shard : m_shards)
+		{
+			for (int i = 0; i < shard->paths.size(); ++i)
+			{
+				serializer.writeString(shard->paths.at(i)->m_path);
+			}
 		}
+
+		for (Shard* shard : m_shards) shard->mutex.unlock();
 	}
 
 
 	void PathManager::deserialize(InputBlob& serializer)
 	{
-		MT::SpinLock lock(m_mutex);
 		i32 size;
 		serializer.read(size);
 		for (int i = 0; i < size; ++i)
@@ -55,15 +73,18 @@ namespace Lumix
 			char path[MAX_PATH_LENGTH];
 			serializer.readString(path, sizeof(path));
 			u32 hash = crc32(path);
-			PathInternal* internal = getPathMultithreadUnsafe(hash, path);
-			--internal->m_ref_count;
+			Shard& shard = getShard(hash);
+			MT::SpinLock lock(shard.mutex);
+			PathInternal* internal = getPathMultithreadUnsafe(shard, hash, path);
+			MT::atomicDecrement(&internal->m_ref_count);
 		}
 	}
 
 
 	Path::Path()
 	{
-		m_data = g_path_manager->getPath(0, "");
+		m_data = g_path_manager->m_empty_path;
+		g_path_manager->incrementRefCount(m_data);
 	}
 
 
@@ -76,72 +97,91 @@ namespace Lumix
 
 	PathInternal* PathManager::getPath(u32 hash)
 	{
-		MT::SpinLock lock(m_mutex);
-		int index = m_paths.find(hash);
+		Shard& shard = getShard(hash);
+		MT::SpinLock lock(shard.mutex);
+		int index = shard.paths.find(hash);
 		if (index < 0)
 		{
 			return nullptr;
 		}
-		++m_paths.at(index)->m_ref_count;
-		return m_paths.at(index);
+		PathInternal* internal = shard.paths.at(index);
+		MT::atomicIncrement(&internal->m_ref_count);
+		return internal;
 	}
 
 
 	PathInternal* PathManager::getPath(u32 hash, const char* path)
 	{
-		MT::SpinLock lock(m_mutex);
-		return getPathMultithreadUnsafe(hash, path);
+		Shard& shard = getShard(hash);
+		MT::SpinLock lock(shard.mutex);
+		return getPathMultithreadUnsafe(shard, hash, path);
 	}
 
 
 	void PathManager::clear()
 	{
-		for (int i = m_paths.size() - 1; i >= 0; --i)
+		for (Shard* shard : m_shards)
+		{
+			MT::SpinLock lock(shard->mutex);
+			clearMultithreadUnsafe(*shard);
+		}
+	}
+
+
+	void PathManager::clearMultithreadUnsafe(Shard& shard)
+	{
+		for (int i = shard.paths.size() - 1; i >= 0; --i)
 		{
-			if (m_paths.at(i)->m_ref_count == 0)
+			if (shard.paths.at(i)->m_ref_count == 0)
 			{
-				LUMIX_DELETE(m_allocator, m_paths.at(i));
-				m_paths.eraseAt(i);
+				LUMIX_DELETE(m_allocator, shard.paths.at(i));
+				shard.paths.eraseAt(i);
 			}
 		}
 	}
 
 
-	PathInternal* PathManager::getPathMultithreadUnsafe(u32 hash, const char* path)
+	PathInternal* PathManager::getPathMultithreadUnsafe(Shard& shard, u32 hash, const char* path)
 	{
-		int index = m_paths.find(hash);
+		int index = shard.paths.find(hash);
 		if (index < 0)
 		{
 			PathInternal* internal = LUMIX_NEW(m_allocator, PathInternal);
 			internal->m_ref_count = 1;
 			internal->m_id = hash;
 			copyString(internal->m_path, path);
-			m_paths.insert(hash, internal);
+			shard.paths.insert(hash, internal);
 			return internal;
 		}
 		else
 		{
-			++m_paths.at(index)->m_ref_count;
-			return m_paths.at(index);
+			PathInternal* internal = shard.paths.at(index);
+			MT::atomicIncrement(&internal->m_ref_count);
+			return internal;
 		}
 	}
 
 
 	void PathManager::incrementRefCount(PathInternal* path)
 	{
-		MT::SpinLock lock(m_mutex);
-		++path->m_ref_count;
+		MT::atomicIncrement(&path->m_ref_count);
 	}
 
 
 	void PathManager::decrementRefCount(PathInternal* path)
 	{
-		MT::SpinLock lock(m_mutex);
-		--path->m_ref_count;
-		if (path->m_ref_count == 0)
+		u32 hash = path->m_id;
+		if (MT::atomicDecrement(&path->m_ref_count) != 0) return;
+
+		// path can be revived or even freed by another thread before we get the lock,
+		// so look it up again, any entry without references can be freed
+		Shard& shard = getShard(hash);
+		MT::SpinLock lock(shard.mutex);
+		int index = shard.paths.find(hash);
+		if (index >= 0 && shard.paths.at(index)->m_ref_count == 0)
 		{
-			m_paths.erase(path->m_id);
-			LUMIX_DELETE(m_allocator, path);
+			LUMIX_DELETE(m_allocator, shard.paths.at(index));
+			shard.paths.eraseAt(index);
 		}
 	}
 
@@ -22,6 +22,9 @@ public:
 };
 
 
+// Paths are interned in shards selected by the hash, each shard has its own lock.
+// Copying and destroying a path only touches its atomic ref count, the shard is locked
+// only to create a path or to free the last reference.
 class LUMIX_ENGINE_API PathManager
 {
 	friend class Path;
@@ -36,16 +39,32 @@ public:
 	void clear();
 
 private:
+	static const int SHARDS_COUNT = 16;
+
+	struct Shard
+	{
+		explicit Shard(IAllocator& allocator)
+			: paths(allocator)
+			, mutex(false)
+		{
+		}
+
+		AssociativeArray<u32, PathInternal*> paths;
+		MT::SpinMutex mutex;
+	};
+
+private:
+	Shard& getShard(u32 hash) { return *m_shards[hash & (SHARDS_COUNT - 1)]; }
 	PathInternal* getPath(u32 hash, const char* path);
 	PathInternal* getPath(u32 hash);
-	PathInternal* getPathMultithreadUnsafe(u32 hash, const char* path);
+	PathInternal* getPathMultithreadUnsafe(Shard& shard, u32 hash, const char* path);
 	void incrementRefCount(PathInternal* path);
 	void decrementRefCount(PathInternal* path);
+	void clearMultithreadUnsafe(Shard& shard);
 
 private:
 	IAllocator& m_allocator;
-	AssociativeArray<u32, PathInternal*> m_paths;
-	MT::SpinMutex m_mutex;
+	Shard* m_shards[SHARDS_COUNT];
 	PathInternal* m_empty_path;
 };
 
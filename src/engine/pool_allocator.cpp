@@ -0,0 +1,507 @@
+#include "engine/pool_allocator.h"
+#include "engine/default_allocator.h"
+#include "engine/math_utils.h"
+#include "engine/mt/atomic.h"
+#include "engine/string.h"
+
+
+namespace Lumix
+{
+
+
+static const u32 SIZES[PoolAllocator::SIZE_CLASSES_COUNT] = {16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+	320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048};
+static const size_t MIN_ALIGN = 16;
+static const int SLAB_BITS = 16;
+static const size_t SLAB_SIZE = size_t(1) << SLAB_BITS;
+static const int MAX_THREAD_CACHES = 16;
+
+
+// at the beginning of every slab, slabs are SLAB_SIZE aligned
+struct SlabHeader
+{
+	PoolAllocator* owner;
+	SlabHeader* next;
+	u32 size_class;
+	u8 padding[MIN_ALIGN - (2 * sizeof(void*) + sizeof(u32)) % MIN_ALIGN];
+};
+
+
+struct SizeClassTable
+{
+	SizeClassTable()
+	{
+		int size_class = 0;
+		for (int i = 0; i < lengthOf(classes); ++i)
+		{
+			while (SIZES[size_class] < u32(i * MIN_ALIGN)) ++size_class;
+			classes[i] = (u8)size_class;
+		}
+	}
+
+	u8 classes[PoolAllocator::MAX_SMALL_SIZE / MIN_ALIGN + 1];
+};
+
+
+// Marks addresses which belong to slabs, so deallocate can tell small and large allocations apart.
+// Two levels indexed by bits 32-47 and 16-31 of the address, leaves are never freed.
+struct PageMap
+{
+	// leaves are zero initialized, it is a static
+	PageMap()
+		: mutex(false)
+	{
+	}
+
+
+	bool isSlab(const void* ptr) const
+	{
+		u64 address = (u64)(uintptr)ptr;
+		const u8* leaf = leaves[(address >> 32) & 0xffff];
+		return leaf && leaf[(address >> SLAB_BITS) & 0xffff];
+	}
+
+
+	void mark(const void* slab, bool is_slab)
+	{
+		u64 address = (u64)(uintptr)slab;
+		ASSERT((address >> 48) == 0);
+		MT::SpinLock lock(mutex);
+		u8*& leaf = leaves[(address >> 32) & 0xffff];
+		if (!leaf)
+		{
+			leaf = (u8*)allocator.allocate(0x10000);
+			setMemory(leaf, 0, 0x10000);
+		}
+		leaf[(address >> SLAB_BITS) & 0xffff] = is_slab ? 1 : 0;
+	}
+
+
+	DefaultAllocator allocator;
+	MT::SpinMutex mutex;
+	u8* leaves[0x10000];
+};
+
+
+struct PoolAllocatorList
+{
+	PoolAllocatorList()
+		: mutex(false)
+		, first(nullptr)
+	{
+	}
+
+
+	MT::SpinMutex mutex;
+	PoolAllocator* first;
+};
+
+
+static const SizeClassTable s_size_class_table;
+static PageMap s_page_map;
+static PoolAllocatorList s_allocators;
+static volatile i32 s_last_allocator_id = 0;
+
+
+struct PoolAllocator::ThreadCache
+{
+	ThreadCache* next;
+	FreeObject* lists[SIZE_CLASSES_COUNT];
+	int counts[SIZE_CLASSES_COUNT];
+};
+
+
+// Caches of the calling thread by allocator id. Entries are not evicted, a thread using more
+// allocators than MAX_THREAD_CACHES at once uses the shared pool of the others directly.
+// Ids are never reused, so entries of destroyed allocators just never match.
+struct PoolAllocator::ThreadCacheTable
+{
+	ThreadCacheTable()
+		: count(0)
+	{
+	}
+
+
+	// the thread exits, cached objects go back to the shared pools of allocators which still exist
+	~ThreadCacheTable()
+	{
+		MT::SpinLock lock(s_allocators.mutex);
+		for (int i = 0; i < count; ++i)
+		{
+			PoolAllocator* allocator = find(ids[i]);
+			if (allocator) allocator->releaseThreadCache(caches[i]);
+		}
+	}
+
+
+	// s_allocators.mutex must be locked
+	static PoolAllocator* find(i32 id)
+	{
+		for (PoolAllocator* allocator = s_allocators.first; allocator; allocator = allocator->m_next_allocator)
+		{
+			if (allocator->m_id == id) return allocator;
+		}
+		return nullptr;
+	}
+
+
+	void removeDestroyed()
+	{
+		MT::SpinLock lock(s_allocators.mutex);
+		for (int i = count - 1; i >= 0; --i)
+		{
+			if (find(ids[i])) continue;
+
+			--count;
+			ids[i] = ids[count];
+			caches[i] = caches[count];
+		}
+	}
+
+
+	i32 ids[MAX_THREAD_CACHES];
+	ThreadCache* caches[MAX_THREAD_CACHES];
+	int count;
+};
+
+
+static int sizeToClass(size_t size)
+{
+	ASSERT(size <= PoolAllocator::MAX_SMALL_SIZE);
+	return s_size_class_table.classes[(size + MIN_ALIGN - 1) / MIN_ALIGN];
+}
+
+
+// number of objects moved between a thread cache and the shared pool at once
+static int getBatchSize(int size_class)
+{
+	return Math::clamp(int(16 * 1024 / SIZES[size_class]), 4, 64);
+}
+
+
+PoolAllocator::PoolAllocator(IAllocator& source)
+	: m_source(source)
+	, m_mutex(false)
+	, m_slabs(nullptr)
+	, m_thread_caches(nullptr)
+	, m_large_allocations_count(0)
+{
+	m_id = MT::atomicIncrement(&s_last_allocator_id);
+	{
+		MT::SpinLock lock(s_allocators.mutex);
+		m_next_allocator = s_allocators.first;
+		s_allocators.first = this;
+	}
+	for (SizeClass& size_class : m_size_classes)
+	{
+		size_class.free_list = nullptr;
+		size_class.bump = nullptr;
+		size_class.bump_end = nullptr;
+		size_class.slabs_count = 0;
+		size_class.free_count = 0;
+		size_class.taken_count = 0;
+	}
+}
+
+
+PoolAllocator::~PoolAllocator()
+{
+	ASSERT(m_large_allocations_count == 0);
+	{
+		// after this, exiting threads do not give their caches back to this allocator
+		MT::SpinLock lock(s_allocators.mutex);
+		PoolAllocator** iter = &s_allocators.first;
+		while (*iter != this) iter = &(*iter)->m_next_allocator;
+		*iter = m_next_allocator;
+	}
+	while (m_thread_caches)
+	{
+		ThreadCache* next = m_thread_caches->next;
+		m_source.deallocate(m_thread_caches);
+		m_thread_caches = next;
+	}
+	SlabHeader* slab = (SlabHeader*)m_slabs;
+	while (slab)
+	{
+		SlabHeader* next = slab->next;
+		s_page_map.mark(slab, false);
+		m_source.deallocate_aligned(slab);
+		slab = next;
+	}
+}
+
+
+PoolAllocator::ThreadCacheTable& PoolAllocator::getThreadCacheTable()
+{
+	static thread_local ThreadCacheTable table;
+	return table;
+}
+
+
+// returns nullptr if the thread already has MAX_THREAD_CACHES caches of other allocators
+PoolAllocator::ThreadCache* PoolAllocator::getThreadCache()
+{
+	ThreadCacheTable& table = getThreadCacheTable();
+	for (int i = 0; i < table.count; ++i)
+	{
+		if (table.ids[i] == m_id) return table.caches[i];
+	}
+	if (table.count == MAX_THREAD_CACHES) table.removeDestroyed();
+	if (table.count == MAX_THREAD_CACHES) return nullptr;
+
+	ThreadCache* cache = (ThreadCache*)m_source.allocate(sizeof(ThreadCache));
+	setMemory(cache, 0, sizeof(*cache));
+	{
+		MT::SpinLock lock(m_mutex);
+		cache->next = m_thread_caches;
+		m_thread_caches = cache;
+	}
+	table.ids[table.count] = m_id;
+	table.caches[table.count] = cache;
+	++table.count;
+	return cache;
+}
+
+
+void PoolAllocator::releaseThreadCache(ThreadCache* cache)
+{
+	for (int i = 0; i < SIZE_CLASSES_COUNT; ++i)
+	{
+		if (cache->counts[i] > 0) flush(*cache, i, cache->counts[i]);
+	}
+	{
+		MT::SpinLock lock(m_mutex);
+		ThreadCache** iter = &m_thread_caches;
+		while (*iter != cache) iter = &(*iter)->next;
+		*iter = cache->next;
+	}
+	m_source.deallocate(cache);
+}
+
+
+int PoolAllocator::getSizeClass(const void* ptr) const
+{
+	if (!s_page_map.isSlab(ptr)) return -1;
+
+	const SlabHeader* slab = (const SlabHeader*)((uintptr)ptr & ~(uintptr)(SLAB_SIZE - 1));
+	ASSERT(slab->owner == this);
+	return slab->size_class;
+}
+
+
+// pool.mutex must be locked
+PoolAllocator::FreeObject* PoolAllocator::popObject(SizeClass& pool, int size_class)
+{
+	FreeObject* obj = pool.free_list;
+	if (obj)
+	{
+		pool.free_list = obj->next;
+		--pool.free_count;
+	}
+	else
+	{
+		u32 size = SIZES[size_class];
+		if (!pool.bump || pool.bump + size > pool.bump_end)
+		{
+			SlabHeader* slab = (SlabHeader*)m_source.allocate_aligned(SLAB_SIZE, SLAB_SIZE);
+			slab->owner = this;
+			slab->size_class = size_class;
+			s_page_map.mark(slab, true);
+			{
+				MT::SpinLock slabs_lock(m_mutex);
+				slab->next = (SlabHeader*)m_slabs;
+				m_slabs = slab;
+			}
+			++pool.slabs_count;
+			pool.bump = (u8*)(slab + 1);
+			pool.bump_end = (u8*)slab + SLAB_SIZE;
+		}
+		obj = (FreeObject*)pool.bump;
+		pool.bump += size;
+	}
+	++pool.taken_count;
+	return obj;
+}
+
+
+void PoolAllocator::refill(ThreadCache& cache, int size_class)
+{
+	SizeClass& pool = m_size_classes[size_class];
+	int batch_size = getBatchSize(size_class);
+
+	MT::SpinLock lock(pool.mutex);
+	for (int i = 0; i < batch_size; ++i)
+	{
+		FreeObject* obj = popObject(pool, size_class);
+		obj->next = cache.lists[size_class];
+		cache.lists[size_class] = obj;
+	}
+	cache.counts[size_class] += batch_size;
+}
+
+
+void PoolAllocator::flush(ThreadCache& cache, int size_class, int count)
+{
+	FreeObject* first = cache.lists[size_class];
+	FreeObject* last = first;
+	for (int i = 1; i < count; ++i) last = last->next;
+	cache.lists[size_class] = last->next;
+	cache.counts[size_class] -= count;
+
+	SizeClass& pool = m_size_classes[size_class];
+	MT::SpinLock lock(pool.mutex);
+	last->next = pool.free_list;
+	pool.free_list = first;
+	pool.free_count += count;
+	pool.taken_count -= count;
+}
+
+
+void* PoolAllocator::allocateSmall(int size_class)
+{
+	ThreadCache* cache = getThreadCache();
+	if (!cache)
+	{
+		SizeClass& pool = m_size_classes[size_class];
+		MT::SpinLock lock(pool.mutex);
+		return popObject(pool, size_class);
+	}
+	if (!cache->lists[size_class]) refill(*cache, size_class);
+
+	FreeObject* obj = cache->lists[size_class];
+	cache->lists[size_class] = obj->next;
+	--cache->counts[size_class];
+	return obj;
+}
+
+
+void PoolAllocator::deallocateSmall(void* ptr, int size_class)
+{
+	FreeObject* obj = (FreeObject*)ptr;
+	ThreadCache* cache = getThreadCache();
+	if (!cache)
+	{
+		SizeClass& pool = m_size_classes[size_class];
+		MT::SpinLock lock(pool.mutex);
+		obj->next = pool.free_list;
+		pool.free_list = obj;
+		++pool.free_count;
+		--pool.taken_count;
+		return;
+	}
+
+	obj->next = cache->lists[size_class];
+	cache->lists[size_class] = obj;
+	++cache->counts[size_class];
+
+	int batch_size = getBatchSize(size_class);
+	if (cache->counts[size_class] > 2 * batch_size) flush(*cache, size_class, batch_size);
+}
+
+
+void* PoolAllocator::allocate(size_t size)
+{
+	if (size <= MAX_SMALL_SIZE) return allocateSmall(sizeToClass(size));
+
+	MT::atomicIncrement(&m_large_allocations_count);
+	return m_source.allocate(size);
+}
+
+
+void PoolAllocator::deallocate(void* ptr)
+{
+	if (!ptr) return;
+
+	int size_class = getSizeClass(ptr);
+	if (size_class >= 0)
+	{
+		deallocateSmall(ptr, size_class);
+		return;
+	}
+	MT::atomicDecrement(&m_large_allocations_count);
+	m_source.deallocate(ptr);
+}
+
+
+void* PoolAllocator::reallocate(void* ptr, size_t size)
+{
+	if (!ptr) return allocate(size);
+	if (size == 0)
+	{
+		deallocate(ptr);
+		return nullptr;
+	}
+
+	int size_class = getSizeClass(ptr);
+	if (size_class < 0 && size > MAX_SMALL_SIZE) return m_source.reallocate(ptr, size);
+	if (size_class >= 0 && size <= SIZES[size_class]) return ptr;
+
+	// large allocations are bigger than any small one, so the copy is always in bounds
+	size_t old_size = size_class >= 0 ? SIZES[size_class] : size;
+	void* new_ptr = allocate(size);
+	copyMemory(new_ptr, ptr, Math::minimum(old_size, size));
+	deallocate(ptr);
+	return new_ptr;
+}
+
+
+void* PoolAllocator::allocate_aligned(size_t size, size_t align)
+{
+	if (size <= MAX_SMALL_SIZE && align <= MIN_ALIGN) return allocateSmall(sizeToClass(size));
+
+	MT::atomicIncrement(&m_large_allocations_count);
+	return m_source.allocate_aligned(size, align);
+}
+
+
+void PoolAllocator::deallocate_aligned(void* ptr)
+{
+	if (!ptr) return;
+
+	int size_class = getSizeClass(ptr);
+	if (size_class >= 0)
+	{
+		deallocateSmall(ptr, size_class);
+		return;
+	}
+	MT::atomicDecrement(&m_large_allocations_count);
+	m_source.deallocate_aligned(ptr);
+}
+
+
+void* PoolAllocator::reallocate_aligned(void* ptr, size_t size, size_t align)
+{
+	if (!ptr) return allocate_aligned(size, align);
+	if (size == 0)
+	{
+		deallocate_aligned(ptr);
+		return nullptr;
+	}
+
+	// the block can be large because of its alignment and not its size, only the source knows the size
+	int size_class = getSizeClass(ptr);
+	if (size_class < 0) return m_source.reallocate_aligned(ptr, size, align);
+	if (size <= SIZES[size_class] && align <= MIN_ALIGN) return ptr;
+
+	void* new_ptr = allocate_aligned(size, align);
+	copyMemory(new_ptr, ptr, Math::minimum((size_t)SIZES[size_class], size));
+	deallocate_aligned(ptr);
+	return new_ptr;
+}
+
+
+void PoolAllocator::getStats(SizeClassStats* stats)
+{
+	for (int i = 0; i < SIZE_CLASSES_COUNT; ++i)
+	{
+		SizeClass& size_class = m_size_classes[i];
+		MT::SpinLock lock(size_class.mutex);
+		stats[i].size = SIZES[i];
+		stats[i].slabs_count = size_class.slabs_count;
+		stats[i].free_count = size_class.free_count;
+		stats[i].taken_count = size_class.taken_count;
+	}
+}
+
+
+} // namespace Lumix
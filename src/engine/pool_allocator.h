@@ -0,0 +1,93 @@
+#pragma once
+
+
+#include "engine/iallocator.h"
+#include "engine/mt/sync.h"
+
+
+namespace Lumix
+{
+
+
+// General purpose allocator. Small allocations are served from size class slabs, every thread has
+// a cache of free objects per size class which is refilled from and returned to the shared pool
+// in batches, so most allocations do not take any lock. Thread caches are returned to the pool
+// when their thread exits. Allocations bigger than the largest size class or with alignment bigger
+// than 16 are passed to the source allocator and stay there when reallocated.
+class LUMIX_ENGINE_API PoolAllocator LUMIX_FINAL : public IAllocator
+{
+public:
+	static const int SIZE_CLASSES_COUNT = 24;
+	static const size_t MAX_SMALL_SIZE = 2048;
+
+	struct SizeClassStats
+	{
+		u32 size;
+		u32 slabs_count;
+		// objects in the shared pool
+		u32 free_count;
+		// objects taken by threads, either used or in thread caches
+		u32 taken_count;
+	};
+
+public:
+	explicit PoolAllocator(IAllocator& source);
+	~PoolAllocator();
+
+	void* allocate(size_t size) override;
+	void deallocate(void* ptr) override;
+	void* reallocate(void* ptr, size_t size) override;
+	void* allocate_aligned(size_t size, size_t align) override;
+	void deallocate_aligned(void* ptr) override;
+	void* reallocate_aligned(void* ptr, size_t size, size_t align) override;
+
+	// fills SIZE_CLASSES_COUNT items
+	void getStats(SizeClassStats* stats);
+	int getLargeAllocationsCount() const { return m_large_allocations_count; }
+
+private:
+	struct FreeObject
+	{
+		FreeObject* next;
+	};
+
+	struct SizeClass
+	{
+		SizeClass() : mutex(false) {}
+
+		MT::SpinMutex mutex;
+		FreeObject* free_list;
+		u8* bump;
+		u8* bump_end;
+		u32 slabs_count;
+		u32 free_count;
+		u32 taken_count;
+	};
+
+	struct ThreadCache;
+	struct ThreadCacheTable;
+
+	void* allocateSmall(int size_class);
+	void deallocateSmall(void* ptr, int size_class);
+	FreeObject* popObject(SizeClass& pool, int size_class);
+	void refill(ThreadCache& cache, int size_class);
+	void flush(ThreadCache& cache, int size_class, int count);
+	void releaseThreadCache(ThreadCache* cache);
+	ThreadCache* getThreadCache();
+	static ThreadCacheTable& getThreadCacheTable();
+	int getSizeClass(const void* ptr) const;
+
+private:
+	IAllocator& m_source;
+	SizeClass m_size_classes[SIZE_CLASSES_COUNT];
+	MT::SpinMutex m_mutex;
+	void* m_slabs;
+	ThreadCache* m_thread_caches;
+	i32 m_id;
+	volatile i32 m_large_allocations_count;
+	// list of all pool allocators, so exiting threads do not touch destroyed ones
+	PoolAllocator* m_next_allocator;
+};
+
+
+} // namespace Lumix
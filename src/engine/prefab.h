@@ -16,21 +16,37 @@ struct PrefabResource LUMIX_FINAL : public Resource
 	PrefabResource(const Path& path, ResourceManagerBase& resource_manager, IAllocator& allocator)
 		: Resource(path, resource_manager, allocator)
 		, blob(allocator)
+		, image(allocator)
+		, entities_count(0)
+		, is_compiled(false)
 	{
 	}
 
 
-	void unload(void) override { blob.clear(); }
+	void unload(void) override
+	{
+		blob.clear();
+		image.clear();
+		entities_count = 0;
+		is_compiled = false;
+	}
 
 
 	bool load(FS::IFile& file) override
 	{
 		file.getContents(blob);
+		image.clear();
+		entities_count = 0;
+		is_compiled = false;
 		return true;
 	}
 
 
 	Lumix::OutputBlob blob;
+	// binary copy of blob with resolved component types, built by the first Universe::instantiatePrefab
+	Lumix::OutputBlob image;
+	int entities_count;
+	bool is_compiled;
 };
 
 
@@ -1,7 +1,10 @@
 #include "profiler.h"
-#include "engine/hash_map.h"
+#include "engine/fs/os_file.h"
+#include "engine/flat_hash_map.h"
 #include "engine/log.h"
+#include "engine/math_utils.h"
 #include "engine/timer.h"
+#include "engine/mt/atomic.h"
 #include "engine/mt/sync.h"
 #include "engine/mt/thread.h"
 
@@ -120,17 +123,123 @@ int getBlockHitCount(Block* block)
 }
 
 
+static const u32 EVENTS_PER_THREAD = 1 << 14;
+
+
+struct Event
+{
+	enum Type : u8
+	{
+		BEGIN,
+		END,
+		INT,
+		FRAME
+	};
+
+	Type type;
+	int value;
+	const char* name;
+	u64 time;
+};
+
+
+static const u32 CAPTURE_MAGIC = 0x4652504C; // 'LPRF'
+static const u32 CAPTURE_VERSION = 0;
+static const u32 NO_NAME = 0xffffFFFF;
+
+
+// on-disk layout of one event, see saveCapture
+struct CaptureEvent
+{
+	u8 type;
+	u8 thread;
+	u16 reserved;
+	u32 name;
+	i32 value;
+	u32 reserved2;
+	u64 time;
+};
+
+
+struct CaptureHeader
+{
+	u32 magic;
+	u32 version;
+	u64 frequency;
+	u32 thread_count;
+	u32 string_count;
+	u32 string_data_size;
+	u32 event_count;
+};
+
+
+struct Capture
+{
+	explicit Capture(IAllocator& allocator)
+		: events(allocator)
+		, string_offsets(allocator)
+		, string_data(allocator)
+		, thread_names(allocator)
+	{
+	}
+
+
+	void clear()
+	{
+		events.clear();
+		string_offsets.clear();
+		string_data.clear();
+		thread_names.clear();
+	}
+
+
+	u32 addString(const char* str)
+	{
+		string_offsets.push(string_data.size());
+		for (const char* c = str; *c; ++c) string_data.push(*c);
+		string_data.push('\0');
+		return string_offsets.size() - 1;
+	}
+
+
+	const char* getString(u32 idx) const
+	{
+		if (idx >= (u32)string_offsets.size()) return "";
+		return &string_data[string_offsets[idx]];
+	}
+
+
+	u64 frequency;
+	Array<CaptureEvent> events;
+	Array<u32> string_offsets;
+	Array<char> string_data;
+	Array<u32> thread_names;
+};
+
+
+// Events are written only by the owning thread and consumed in frame(), which builds the block tree.
 struct ThreadData
 {
 	ThreadData() 
 	{
 		root_block = current_block = nullptr;
 		name[0] = '\0';
+		events = nullptr;
+		write = read = 0;
+		open_depth = dropped_depth = 0;
+		capture_thread = -1;
 	}
 
 	Block* root_block;
 	Block* current_block;
 	char name[30];
+
+	Event* events;
+	volatile u32 write;
+	volatile u32 read;
+	u32 open_depth;
+	u32 dropped_depth;
+	int capture_thread;
 };
 
 
@@ -139,8 +248,13 @@ struct Instance
 	Instance()
 		: threads(allocator)
 		, frame_listeners(allocator)
+		, capture(allocator)
+		, capture_strings(allocator)
+		, capture_threads(allocator)
+		, capture_frames_left(0)
 		, m_mutex(false)
 	{
+		main_thread.events = (Event*)allocator.allocate(sizeof(Event) * EVENTS_PER_THREAD);
 		threads.insert(MT::getCurrentThreadID(), &main_thread);
 		timer = Timer::create(allocator);
 	}
@@ -151,6 +265,7 @@ struct Instance
 		Timer::destroy(timer);
 		for (auto* i : threads)
 		{
+			allocator.deallocate(i->events);
 			if (i != &main_thread) LUMIX_DELETE(allocator, i);
 		}
 	}
@@ -158,14 +273,19 @@ struct Instance
 
 	DefaultAllocator allocator;
 	DelegateList<void()> frame_listeners;
-	HashMap<MT::ThreadID, ThreadData*> threads;
+	FlatHashMap<MT::ThreadID, ThreadData*> threads;
 	ThreadData main_thread;
 	Timer* timer;
+	Capture capture;
+	FlatHashMap<void*, u32> capture_strings;
+	Array<ThreadData*> capture_threads;
+	int capture_frames_left;
 	MT::SpinMutex m_mutex;
 };
 
 
 Instance g_instance;
+static thread_local ThreadData* s_thread_data = nullptr;
 
 
 float getBlockLength(Block* block)
@@ -179,94 +299,184 @@ float getBlockLength(Block* block)
 }
 
 
-struct BlockInfo
+static ThreadData* registerThread()
 {
-	Block* block;
-	ThreadData* thread_data;
-};
+	MT::SpinLock lock(g_instance.m_mutex);
+	MT::ThreadID thread_id = MT::getCurrentThreadID();
+	auto iter = g_instance.threads.find(thread_id);
+	if (iter.isValid())
+	{
+		s_thread_data = iter.value();
+		return s_thread_data;
+	}
+
+	s_thread_data = LUMIX_NEW(g_instance.allocator, ThreadData);
+	s_thread_data->events = (Event*)g_instance.allocator.allocate(sizeof(Event) * EVENTS_PER_THREAD);
+	g_instance.threads.insert(thread_id, s_thread_data);
+	return s_thread_data;
+}
 
-static BlockInfo getBlock(const char* name)
+
+static LUMIX_FORCE_INLINE ThreadData* getThreadData()
 {
-	auto thread_id = MT::getCurrentThreadID();
+	return s_thread_data ? s_thread_data : registerThread();
+}
 
-	ThreadData* thread_data = nullptr;
-	{
-		MT::SpinLock lock(g_instance.m_mutex);
-		auto iter = g_instance.threads.find(thread_id);
-		if (iter == g_instance.threads.end())
-		{
-			g_instance.threads.insert(thread_id, LUMIX_NEW(g_instance.allocator, ThreadData));
-			iter = g_instance.threads.find(thread_id);
-		}
 
-		thread_data = iter.value();
+// keeps one free slot for the end event of every open block, so begin/end pairs are never broken
+static LUMIX_FORCE_INLINE bool hasFreeSlot(const ThreadData& thread_data)
+{
+	return EVENTS_PER_THREAD - (thread_data.write - thread_data.read) > thread_data.open_depth + 1;
+}
+
+
+static LUMIX_FORCE_INLINE void pushEvent(ThreadData& thread_data, const Event& event)
+{
+	thread_data.events[thread_data.write & (EVENTS_PER_THREAD - 1)] = event;
+	MT::memoryBarrier();
+	++thread_data.write;
+}
+
+
+static Block* getChildBlock(ThreadData& thread_data, const char* name)
+{
+	Block* parent = thread_data.current_block;
+	Block* LUMIX_RESTRICT block = parent ? parent->m_first_child : thread_data.root_block;
+	while (block && block->m_name != name)
+	{
+		block = block->m_next;
 	}
+	if (block) return block;
 
-	if (!thread_data->current_block)
+	block = LUMIX_NEW(g_instance.allocator, Block)(g_instance.allocator);
+	block->m_parent = parent;
+	block->m_first_child = nullptr;
+	block->m_name = name;
+	if (parent)
 	{
-		Block* LUMIX_RESTRICT root = thread_data->root_block;
-		while (root && root->m_name != name)
-		{
-			root = root->m_next;
-		}
-		if (root)
-		{
-			thread_data->current_block = root;
-		}
-		else
-		{
-			Block* root = LUMIX_NEW(g_instance.allocator, Block)(g_instance.allocator);
-			root->m_parent = nullptr;
-			root->m_next = thread_data->root_block;
-			root->m_first_child = nullptr;
-			root->m_name = name;
-			thread_data->root_block = thread_data->current_block = root;
-		}
+		block->m_next = parent->m_first_child;
+		parent->m_first_child = block;
 	}
 	else
 	{
-		Block* LUMIX_RESTRICT child = thread_data->current_block->m_first_child;
-		while (child && child->m_name != name)
-		{
-			child = child->m_next;
-		}
-		if (!child)
-		{
-			child = LUMIX_NEW(g_instance.allocator, Block)(g_instance.allocator);
-			child->m_parent = thread_data->current_block;
-			child->m_first_child = nullptr;
-			child->m_name = name;
-			child->m_next = thread_data->current_block->m_first_child;
-			thread_data->current_block->m_first_child = child;
-		}
+		block->m_next = thread_data.root_block;
+		thread_data.root_block = block;
+	}
+	return block;
+}
+
+
+static u32 getCaptureString(const char* str)
+{
+	if (!str) return NO_NAME;
 
-		thread_data->current_block = child;
+	auto iter = g_instance.capture_strings.find((void*)str);
+	if (iter.isValid()) return iter.value();
+
+	u32 idx = g_instance.capture.addString(str);
+	g_instance.capture_strings.insert((void*)str, idx);
+	return idx;
+}
+
+
+static void captureEvent(ThreadData& thread_data, const Event& event)
+{
+	if (thread_data.capture_thread < 0)
+	{
+		if (g_instance.capture_threads.size() > 0xff) return;
+		thread_data.capture_thread = g_instance.capture_threads.size();
+		g_instance.capture_threads.push(&thread_data);
+		g_instance.capture.thread_names.push(NO_NAME);
 	}
 
-	return { thread_data->current_block, thread_data };
+	CaptureEvent& out = g_instance.capture.events.emplace();
+	out.type = event.type;
+	out.thread = (u8)thread_data.capture_thread;
+	out.reserved = 0;
+	out.name = getCaptureString(event.name);
+	out.value = event.value;
+	out.reserved2 = 0;
+	out.time = event.time;
 }
 
 
-void record(const char* name, int value)
+static void processEvents(ThreadData& thread_data)
 {
-	auto data = getBlock(name);
-	if (data.block->m_type != BlockType::INT)
+	u32 end = thread_data.write;
+	MT::memoryBarrier();
+	bool is_capturing = g_instance.capture_frames_left > 0;
+	for (u32 i = thread_data.read; i != end; ++i)
 	{
-		data.block->m_values.int_value = 0;
-		data.block->m_type = BlockType::INT;
+		const Event& event = thread_data.events[i & (EVENTS_PER_THREAD - 1)];
+		if (is_capturing) captureEvent(thread_data, event);
+		switch (event.type)
+		{
+			case Event::BEGIN:
+			{
+				Block* block = getChildBlock(thread_data, event.name);
+				auto& hit = block->m_hits.emplace();
+				hit.m_start = event.time;
+				hit.m_length = 0;
+				thread_data.current_block = block;
+				break;
+			}
+			case Event::END:
+			{
+				Block* block = thread_data.current_block;
+				ASSERT(block);
+				block->m_hits.back().m_length = event.time - block->m_hits.back().m_start;
+				thread_data.current_block = block->m_parent;
+				break;
+			}
+			case Event::INT:
+			{
+				Block* block = getChildBlock(thread_data, event.name);
+				if (block->m_type != BlockType::INT)
+				{
+					block->m_values.int_value = 0;
+					block->m_type = BlockType::INT;
+				}
+				block->m_values.int_value += event.value;
+				break;
+			}
+			case Event::FRAME: break;
+		}
 	}
-	data.block->m_values.int_value += value;
-	data.thread_data->current_block = data.block->m_parent;
+	MT::memoryBarrier();
+	thread_data.read = end;
+}
+
+
+void record(const char* name, int value)
+{
+	ThreadData* thread_data = getThreadData();
+	if (thread_data->dropped_depth > 0 || !hasFreeSlot(*thread_data)) return;
+
+	Event event;
+	event.type = Event::INT;
+	event.name = name;
+	event.value = value;
+	event.time = g_instance.timer->getRawTimeSinceStart();
+	pushEvent(*thread_data, event);
 }
 
 
 void beginBlock(const char* name)
 {
-	auto data = getBlock(name);
+	ThreadData* thread_data = getThreadData();
+	if (thread_data->dropped_depth > 0 || !hasFreeSlot(*thread_data))
+	{
+		++thread_data->dropped_depth;
+		return;
+	}
 
-	auto& hit = data.block->m_hits.emplace();
-	hit.m_start = g_instance.timer->getRawTimeSinceStart();
-	hit.m_length = 0;
+	Event event;
+	event.type = Event::BEGIN;
+	event.value = 0;
+	event.name = name;
+	event.time = g_instance.timer->getRawTimeSinceStart();
+	pushEvent(*thread_data, event);
+	++thread_data->open_depth;
 }
 
 
@@ -280,15 +490,9 @@ const char* getThreadName(MT::ThreadID thread_id)
 
 void setThreadName(const char* name)
 {
+	ThreadData* thread_data = getThreadData();
 	MT::SpinLock lock(g_instance.m_mutex);
-	MT::ThreadID thread_id = MT::getCurrentThreadID();
-	auto iter = g_instance.threads.find(thread_id);
-	if (iter == g_instance.threads.end())
-	{
-		g_instance.threads.insert(thread_id, LUMIX_NEW(g_instance.allocator, ThreadData));
-		iter = g_instance.threads.find(thread_id);
-	}
-	Lumix::copyString(iter.value()->name, name);
+	Lumix::copyString(thread_data->name, name);
 }
 
 
@@ -343,20 +547,261 @@ Block* getRootBlock(MT::ThreadID thread_id)
 
 void endBlock()
 {
-	auto thread_id = MT::getCurrentThreadID();
+	ThreadData* thread_data = getThreadData();
+	if (thread_data->dropped_depth > 0)
+	{
+		--thread_data->dropped_depth;
+		return;
+	}
+
+	ASSERT(thread_data->open_depth > 0);
+	Event event;
+	event.type = Event::END;
+	event.value = 0;
+	event.name = nullptr;
+	event.time = g_instance.timer->getRawTimeSinceStart();
+	pushEvent(*thread_data, event);
+	--thread_data->open_depth;
+}
 
-	ThreadData* thread_data = nullptr;
+
+static void captureFrame()
+{
+	Event event;
+	event.type = Event::FRAME;
+	event.value = 0;
+	event.name = "Frame";
+	event.time = g_instance.timer->getRawTimeSinceStart();
+	captureEvent(*getThreadData(), event);
+
+	--g_instance.capture_frames_left;
+	if (g_instance.capture_frames_left > 0) return;
+
+	// names are resolved at the end, threads usually name themselves after the first event
+	Capture& capture = g_instance.capture;
+	for (int i = 0; i < g_instance.capture_threads.size(); ++i)
 	{
-		MT::SpinLock lock(g_instance.m_mutex);
-		auto iter = g_instance.threads.find(thread_id);
-		ASSERT(iter.isValid());
-		thread_data = iter.value();
+		capture.thread_names[i] = capture.addString(g_instance.capture_threads[i]->name);
 	}
+}
 
-	ASSERT(thread_data->current_block);
-	u64 now = g_instance.timer->getRawTimeSinceStart();
-	thread_data->current_block->m_hits.back().m_length = now - thread_data->current_block->m_hits.back().m_start;
-	thread_data->current_block = thread_data->current_block->m_parent;
+
+void startCapture(int frame_count)
+{
+	ASSERT(frame_count > 0);
+	MT::SpinLock lock(g_instance.m_mutex);
+	g_instance.capture.clear();
+	g_instance.capture.frequency = g_instance.timer->getFrequency();
+	g_instance.capture_strings.clear();
+	g_instance.capture_threads.clear();
+	for (auto* i : g_instance.threads)
+	{
+		i->capture_thread = -1;
+	}
+	g_instance.capture_frames_left = frame_count;
+}
+
+
+bool isCapturing()
+{
+	return g_instance.capture_frames_left > 0;
+}
+
+
+bool saveCapture(const char* path)
+{
+	MT::SpinLock lock(g_instance.m_mutex);
+	if (g_instance.capture_frames_left > 0) return false;
+	const Capture& capture = g_instance.capture;
+
+	FS::OsFile file;
+	if (!file.open(path, FS::Mode::CREATE_AND_WRITE, g_instance.allocator))
+	{
+		g_log_error.log("Engine") << "Could not create " << path;
+		return false;
+	}
+
+	CaptureHeader header;
+	header.magic = CAPTURE_MAGIC;
+	header.version = CAPTURE_VERSION;
+	header.frequency = capture.frequency;
+	header.thread_count = capture.thread_names.size();
+	header.string_count = capture.string_offsets.size();
+	header.string_data_size = capture.string_data.size();
+	header.event_count = capture.events.size();
+	bool success = file.write(&header, sizeof(header));
+	success = success && file.write(capture.thread_names.begin(), sizeof(u32) * header.thread_count);
+	success = success && file.write(capture.string_offsets.begin(), sizeof(u32) * header.string_count);
+	success = success && file.write(capture.string_data.begin(), header.string_data_size);
+	success = success && file.write(capture.events.begin(), sizeof(CaptureEvent) * header.event_count);
+	file.close();
+
+	if (!success) g_log_error.log("Engine") << "Could not write " << path;
+	return success;
+}
+
+
+static bool loadCapture(const char* path, Capture& capture)
+{
+	FS::OsFile file;
+	if (!file.open(path, FS::Mode::OPEN_AND_READ, g_instance.allocator))
+	{
+		g_log_error.log("Engine") << "Could not open " << path;
+		return false;
+	}
+
+	CaptureHeader header;
+	bool success = file.read(&header, sizeof(header));
+	if (!success || header.magic != CAPTURE_MAGIC || header.version != CAPTURE_VERSION)
+	{
+		g_log_error.log("Engine") << path << " is not a profiler capture";
+		file.close();
+		return false;
+	}
+
+	capture.clear();
+	capture.frequency = header.frequency;
+	capture.thread_names.resize(header.thread_count);
+	capture.string_offsets.resize(header.string_count);
+	capture.string_data.resize(header.string_data_size);
+	capture.events.resize(header.event_count);
+	success = success && file.read(capture.thread_names.begin(), sizeof(u32) * header.thread_count);
+	success = success && file.read(capture.string_offsets.begin(), sizeof(u32) * header.string_count);
+	success = success && file.read(capture.string_data.begin(), header.string_data_size);
+	success = success && file.read(capture.events.begin(), sizeof(CaptureEvent) * header.event_count);
+	file.close();
+
+	for (u32 offset : capture.string_offsets)
+	{
+		if (offset >= header.string_data_size) success = false;
+	}
+	if (header.string_data_size > 0 && capture.string_data.back() != '\0') success = false;
+
+	if (!success) g_log_error.log("Engine") << "Corrupted profiler capture " << path;
+	return success;
+}
+
+
+static void writeJSONString(FS::OsFile& file, const char* str)
+{
+	file << '"';
+	for (const char* c = str; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\') file << '\\';
+		if ((u8)*c < 0x20) continue;
+		file << *c;
+	}
+	file << '"';
+}
+
+
+// chrome://tracing expects microseconds
+static void writeJSONTime(FS::OsFile& file, u64 time, double to_us)
+{
+	double us = time * to_us;
+	u64 integral = (u64)us;
+	u32 fraction = u32((us - integral) * 1000);
+	char tmp[] = {'.', char('0' + fraction / 100), char('0' + fraction / 10 % 10), char('0' + fraction % 10), 0};
+	file << integral << tmp;
+}
+
+
+static bool writeChromeTrace(const Capture& capture, const char* path)
+{
+	FS::OsFile file;
+	if (!file.open(path, FS::Mode::CREATE_AND_WRITE, g_instance.allocator))
+	{
+		g_log_error.log("Engine") << "Could not create " << path;
+		return false;
+	}
+
+	file << "{\"traceEvents\":[";
+	bool first = true;
+	auto separator = [&file, &first]() {
+		file << (first ? "\n" : ",\n");
+		first = false;
+	};
+
+	for (int i = 0; i < capture.thread_names.size(); ++i)
+	{
+		const char* thread_name = capture.getString(capture.thread_names[i]);
+		if (!thread_name[0]) continue;
+
+		separator();
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":";
+		writeJSONString(file, thread_name);
+		file << "}}";
+	}
+
+	// blocks open when the capture started or ended would break the B/E nesting, skip or close them
+	Array<u32> depths(g_instance.allocator);
+	depths.resize(capture.thread_names.size());
+	for (u32& depth : depths) depth = 0;
+
+	u64 start_time = capture.events.empty() ? 0 : capture.events[0].time;
+	for (const CaptureEvent& event : capture.events)
+	{
+		if (event.time < start_time) start_time = event.time;
+	}
+	double to_us = capture.frequency ? 1e6 / capture.frequency : 0;
+	u64 last_time = start_time;
+
+	for (const CaptureEvent& event : capture.events)
+	{
+		if (event.thread >= depths.size()) continue;
+		if (event.type == Event::END && depths[event.thread] == 0) continue;
+		last_time = Math::maximum(last_time, event.time);
+
+		separator();
+		file << "{";
+		if (event.name != NO_NAME)
+		{
+			file << "\"name\":";
+			writeJSONString(file, capture.getString(event.name));
+			file << ",";
+		}
+		switch (event.type)
+		{
+			case Event::BEGIN: file << "\"ph\":\"B\","; ++depths[event.thread]; break;
+			case Event::END: file << "\"ph\":\"E\","; --depths[event.thread]; break;
+			case Event::INT: file << "\"ph\":\"C\",\"args\":{\"value\":" << event.value << "},"; break;
+			case Event::FRAME: file << "\"ph\":\"i\",\"s\":\"g\","; break;
+		}
+		file << "\"pid\":0,\"tid\":" << (u32)event.thread << ",\"ts\":";
+		writeJSONTime(file, event.time - start_time, to_us);
+		file << "}";
+	}
+
+	for (int i = 0; i < depths.size(); ++i)
+	{
+		for (u32 j = 0; j < depths[i]; ++j)
+		{
+			separator();
+			file << "{\"ph\":\"E\",\"pid\":0,\"tid\":" << i << ",\"ts\":";
+			writeJSONTime(file, last_time - start_time, to_us);
+			file << "}";
+		}
+	}
+
+	file << "\n]}\n";
+	file.close();
+	return true;
+}
+
+
+bool saveCaptureAsChromeTrace(const char* path)
+{
+	MT::SpinLock lock(g_instance.m_mutex);
+	if (g_instance.capture_frames_left > 0) return false;
+	return writeChromeTrace(g_instance.capture, path);
+}
+
+
+bool convertCaptureToChromeTrace(const char* capture_path, const char* json_path)
+{
+	Capture capture(g_instance.allocator);
+	if (!loadCapture(capture_path, capture)) return false;
+	return writeChromeTrace(capture, json_path);
 }
 
 
@@ -365,6 +810,12 @@ void frame()
 	PROFILE_FUNCTION();
 
 	MT::SpinLock lock(g_instance.m_mutex);
+	for (auto* i : g_instance.threads)
+	{
+		processEvents(*i);
+	}
+	if (g_instance.capture_frames_left > 0) captureFrame();
+
 	g_instance.frame_listeners.invoke();
 	u64 now = g_instance.timer->getRawTimeSinceStart();
 
@@ -48,6 +48,15 @@ LUMIX_ENGINE_API void endBlock();
 LUMIX_ENGINE_API void frame();
 LUMIX_ENGINE_API DelegateList<void ()>& getFrameListeners();
 
+// records all events of the next frame_count frames, see saveCapture
+LUMIX_ENGINE_API void startCapture(int frame_count);
+LUMIX_ENGINE_API bool isCapturing();
+// compact binary dump of the last finished capture
+LUMIX_ENGINE_API bool saveCapture(const char* path);
+// JSON loadable in chrome://tracing
+LUMIX_ENGINE_API bool saveCaptureAsChromeTrace(const char* path);
+LUMIX_ENGINE_API bool convertCaptureToChromeTrace(const char* capture_path, const char* json_path);
+
 
 struct Scope
 {
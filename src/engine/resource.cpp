@@ -31,6 +31,8 @@ Resource::Resource(const Path& path, ResourceManagerBase& resource_manager, IAll
 	, m_cb(allocator)
 	, m_resource_manager(resource_manager)
 	, m_async_op(FS::FileSystem::INVALID_ASYNC)
+	, m_prev_unused(nullptr)
+	, m_next_unused(nullptr)
 {
 }
 
@@ -90,10 +92,14 @@ void Resource::fileLoaded(FS::IFile& file, bool success)
 	{
 		++m_failed_dep_count;
 	}
+	// resources which do not know their memory size are accounted by their file size
+	if (m_size == 0) m_size = file.size();
+	m_resource_manager.m_used_memory += m_size;
 
 	--m_empty_dep_count;
 	checkState();
 	m_async_op = FS::FileSystem::INVALID_ASYNC;
+	m_resource_manager.evict();
 }
 
 
@@ -110,6 +116,8 @@ void Resource::doUnload()
 	unload();
 	ASSERT(m_empty_dep_count <= 1);
 
+	ASSERT(m_resource_manager.m_used_memory >= m_size);
+	m_resource_manager.m_used_memory -= m_size;
 	m_size = 0;
 	m_empty_dep_count = 1;
 	m_failed_dep_count = 0;
@@ -101,6 +101,9 @@ private:
 	u16 m_failed_dep_count;
 	State m_current_state;
 	u32 m_async_op;
+	// links in ResourceManagerBase's list of unused resources
+	Resource* m_prev_unused;
+	Resource* m_next_unused;
 }; // class Resource
 
 
@@ -4,6 +4,7 @@
 #include "engine/lumix.h"
 #include "engine/path.h"
 #include "engine/path_utils.h"
+#include "engine/profiler.h"
 #include "engine/resource.h"
 #include "engine/resource_manager.h"
 
@@ -28,6 +29,7 @@ namespace Lumix
 			destroyResource(*resource);
 		}
 		m_resources.clear();
+		m_first_unused = m_last_unused = nullptr;
 	}
 
 	Resource* ResourceManagerBase::get(const Path& path)
@@ -51,6 +53,10 @@ namespace Lumix
 			resource = createResource(path);
 			m_resources.insert(path.getHash(), resource);
 		}
+		else if (isUnused(*resource))
+		{
+			removeUnused(*resource);
+		}
 		
 		if(resource->isEmpty())
 		{
@@ -68,7 +74,8 @@ namespace Lumix
 		Array<Resource*> to_remove(m_allocator);
 		for (auto* i : m_resources)
 		{
-			if (i->getRefCount() == 0) to_remove.push(i);
+			// cached resources are kept until evicted
+			if (i->getRefCount() == 0 && !isUnused(*i)) to_remove.push(i);
 		}
 
 		for (auto* i : to_remove)
@@ -80,6 +87,7 @@ namespace Lumix
 
 	void ResourceManagerBase::load(Resource& resource)
 	{
+		if (isUnused(resource)) removeUnused(resource);
 		if(resource.isEmpty())
 		{
 			resource.doLoad();
@@ -100,7 +108,15 @@ namespace Lumix
 		ASSERT(new_ref_count >= 0);
 		if(new_ref_count == 0 && m_is_unload_enabled)
 		{
-			resource.doUnload();
+			if (m_budget > 0)
+			{
+				pushUnused(resource);
+				evict();
+			}
+			else
+			{
+				resource.doUnload();
+			}
 		}
 	}
 
@@ -123,11 +139,110 @@ namespace Lumix
 
 		for (auto* resource : m_resources)
 		{
-			if (resource->getRefCount() == 0)
+			if (resource->getRefCount() == 0 && !isUnused(*resource))
 			{
-				resource->doUnload();
+				if (m_budget > 0 && !resource->isEmpty())
+				{
+					pushUnused(*resource);
+				}
+				else
+				{
+					resource->doUnload();
+				}
 			}
 		}
+		evict();
+	}
+
+	void ResourceManagerBase::setMemoryBudget(size_t budget)
+	{
+		m_budget = budget;
+		if (budget > 0)
+		{
+			evict();
+			return;
+		}
+
+		while (m_first_unused)
+		{
+			Resource* resource = m_first_unused;
+			removeUnused(*resource);
+			resource->doUnload();
+		}
+	}
+
+	ResourceManagerBase::MemoryStats ResourceManagerBase::getMemoryStats() const
+	{
+		MemoryStats stats;
+		stats.budget = m_budget;
+		stats.used = m_used_memory;
+		stats.cached = 0;
+		stats.evicted_count = m_evicted_count;
+		for (Resource* resource = m_first_unused; resource; resource = resource->m_next_unused)
+		{
+			stats.cached += resource->size();
+		}
+		return stats;
+	}
+
+	bool ResourceManagerBase::isUnused(const Resource& resource) const
+	{
+		return resource.m_prev_unused || m_first_unused == &resource;
+	}
+
+	void ResourceManagerBase::pushUnused(Resource& resource)
+	{
+		ASSERT(!isUnused(resource));
+		resource.m_prev_unused = m_last_unused;
+		resource.m_next_unused = nullptr;
+		if (m_last_unused)
+		{
+			m_last_unused->m_next_unused = &resource;
+		}
+		else
+		{
+			m_first_unused = &resource;
+		}
+		m_last_unused = &resource;
+	}
+
+	void ResourceManagerBase::removeUnused(Resource& resource)
+	{
+		ASSERT(isUnused(resource));
+		if (resource.m_prev_unused)
+		{
+			resource.m_prev_unused->m_next_unused = resource.m_next_unused;
+		}
+		else
+		{
+			m_first_unused = resource.m_next_unused;
+		}
+		if (resource.m_next_unused)
+		{
+			resource.m_next_unused->m_prev_unused = resource.m_prev_unused;
+		}
+		else
+		{
+			m_last_unused = resource.m_prev_unused;
+		}
+		resource.m_prev_unused = resource.m_next_unused = nullptr;
+	}
+
+	void ResourceManagerBase::evict()
+	{
+		if (m_used_memory <= m_budget || !m_first_unused) return;
+
+		PROFILE_FUNCTION();
+		int count = 0;
+		while (m_used_memory > m_budget && m_first_unused)
+		{
+			Resource* resource = m_first_unused;
+			removeUnused(*resource);
+			resource->doUnload();
+			++count;
+		}
+		m_evicted_count += count;
+		PROFILE_INT("evicted resources", count);
 	}
 
 	ResourceManagerBase::ResourceManagerBase(IAllocator& allocator)
@@ -136,6 +251,11 @@ namespace Lumix
 		, m_allocator(allocator)
 		, m_owner(nullptr)
 		, m_is_unload_enabled(true)
+		, m_first_unused(nullptr)
+		, m_last_unused(nullptr)
+		, m_budget(0)
+		, m_used_memory(0)
+		, m_evicted_count(0)
 	{ }
 
 	ResourceManagerBase::~ResourceManagerBase()
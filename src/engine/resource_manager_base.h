@@ -1,7 +1,7 @@
 #pragma once
 
 
-#include "engine/hash_map.h"
+#include "engine/flat_hash_map.h"
 
 
 namespace Lumix
@@ -24,7 +24,17 @@ class LUMIX_ENGINE_API ResourceManagerBase
 {
 	friend class Resource;
 public:
-	typedef HashMap<u32, Resource*> ResourceTable;
+	typedef FlatHashMap<u32, Resource*> ResourceTable;
+
+	struct MemoryStats
+	{
+		size_t budget;
+		// all loaded resources, including cached ones
+		size_t used;
+		// loaded but unreferenced resources, evicted when used memory is over budget
+		size_t cached;
+		u32 evicted_count;
+	};
 
 public:
 	void create(ResourceType type, ResourceManager& owner);
@@ -43,6 +53,11 @@ public:
 	void reload(Resource& resource);
 	ResourceTable& getResourceTable() { return m_resources; }
 
+	// unreferenced resources are kept loaded while the used memory fits in the budget and are
+	// evicted in least recently used order, 0 unloads them as soon as they are not referenced
+	void setMemoryBudget(size_t budget);
+	MemoryStats getMemoryStats() const;
+
 	ResourceManagerBase(IAllocator& allocator);
 	virtual ~ResourceManagerBase();
 	ResourceManager& getOwner() const { return *m_owner; }
@@ -52,12 +67,24 @@ protected:
 	virtual void destroyResource(Resource& resource) = 0;
 	Resource* get(const Path& path);
 
+private:
+	bool isUnused(const Resource& resource) const;
+	void pushUnused(Resource& resource);
+	void removeUnused(Resource& resource);
+	void evict();
+
 private:
 	IAllocator& m_allocator;
 	u32 m_size;
 	ResourceTable m_resources;
 	ResourceManager* m_owner;
 	bool m_is_unload_enabled;
+	// unreferenced loaded resources, the first one is the least recently used
+	Resource* m_first_unused;
+	Resource* m_last_unused;
+	size_t m_budget;
+	size_t m_used_memory;
+	u32 m_evicted_count;
 };
 
 
@@ -0,0 +1,241 @@
+#pragma once
+
+
+#include "engine/array.h"
+#include "engine/iallocator.h"
+#include "engine/string.h"
+
+
+namespace Lumix
+{
+	// Same interface as AssociativeArray, for keys with a small non-negative index such as Entity.
+	// Values are packed in a dense array, a sparse array maps key.index to the dense index,
+	// so insert, erase and find are O(1). Erasing moves the last value into the hole,
+	// so the order of values is not sorted by key and indices change on erase.
+	template <typename Key, typename Value>
+	class SparseSet
+	{
+		public:
+			explicit SparseSet(IAllocator& allocator)
+				: m_allocator(allocator)
+				, m_keys(nullptr)
+				, m_values(nullptr)
+				, m_size(0)
+				, m_capacity(0)
+				, m_sparse(allocator)
+			{}
+
+
+			~SparseSet()
+			{
+				callDestructors(m_keys, m_size);
+				callDestructors(m_values, m_size);
+				m_allocator.deallocate(m_keys);
+			}
+
+
+			Value& insert(const Key& key)
+			{
+				ASSERT(find(key) < 0);
+				int i = add(key);
+				new (NewPlaceholder(), &m_values[i]) Value();
+				return m_values[i];
+			}
+
+
+			template <typename... Params> Value& emplace(const Key& key, Params&&... params)
+			{
+				ASSERT(find(key) < 0);
+				int i = add(key);
+				new (NewPlaceholder(), &m_values[i]) Value(static_cast<Params&&>(params)...);
+				return m_values[i];
+			}
+
+
+			int insert(const Key& key, const Value& value)
+			{
+				if (find(key) >= 0) return -1;
+
+				int i = add(key);
+				new (NewPlaceholder(), &m_values[i]) Value(value);
+				return i;
+			}
+
+
+			bool find(const Key& key, Value& value) const
+			{
+				int i = find(key);
+				if (i < 0)
+				{
+					return false;
+				}
+				value = m_values[i];
+				return true;
+			}
+
+
+			int find(const Key& key) const
+			{
+				if (key.index < 0 || key.index >= m_sparse.size()) return -1;
+				return m_sparse[key.index];
+			}
+
+
+			const Value& operator [](const Key& key) const
+			{
+				int index = find(key);
+				if (index >= 0)
+				{
+					return m_values[index];
+				}
+				else
+				{
+					ASSERT(false);
+					return m_values[0];
+				}
+			}
+
+
+			Value& operator [](const Key& key)
+			{
+				int index = find(key);
+				if (index >= 0)
+				{
+					return m_values[index];
+				}
+				else
+				{
+					return m_values[insert(key, Value())];
+				}
+			}
+
+
+			int size() const
+			{
+				return m_size;
+			}
+
+
+			Value& get(const Key& key)
+			{
+				int index = find(key);
+				ASSERT(index >= 0);
+				return m_values[index];
+			}
+
+
+			Value* begin() { return m_values; }
+			Value* end() { return m_values + m_size; }
+			const Value* begin() const { return m_values; }
+			const Value* end() const { return m_values + m_size; }
+
+
+			Value& at(int index)
+			{
+				return m_values[index];
+			}
+
+
+			const Value& at(int index) const
+			{
+				return m_values[index];
+			}
+
+
+			void clear()
+			{
+				for (int i = 0; i < m_size; ++i)
+				{
+					m_sparse[m_keys[i].index] = -1;
+				}
+				callDestructors(m_keys, m_size);
+				callDestructors(m_values, m_size);
+				m_size = 0;
+			}
+
+
+			void reserve(int new_capacity)
+			{
+				if (m_capacity >= new_capacity) return;
+
+				u8* new_data = (u8*)m_allocator.allocate(new_capacity * (sizeof(Key) + sizeof(Value)));
+
+				copyMemory(new_data, m_keys, sizeof(Key) * m_size);
+				copyMemory(new_data + sizeof(Key) * new_capacity, m_values, sizeof(Value) * m_size);
+
+				m_allocator.deallocate(m_keys);
+				m_keys = (Key*)new_data;
+				m_values = (Value*)(new_data + sizeof(Key) * new_capacity);
+
+				m_capacity = new_capacity;
+			}
+
+
+			const Key& getKey(int index) const
+			{
+				return m_keys[index];
+			}
+
+
+			void eraseAt(int index)
+			{
+				if (index >= 0 && index < m_size)
+				{
+					m_sparse[m_keys[index].index] = -1;
+					m_values[index].~Value();
+					m_keys[index].~Key();
+					int last = m_size - 1;
+					if (index < last)
+					{
+						copyMemory(m_keys + index, m_keys + last, sizeof(Key));
+						copyMemory(m_values + index, m_values + last, sizeof(Value));
+						m_sparse[m_keys[index].index] = index;
+					}
+					--m_size;
+				}
+			}
+
+
+			void erase(const Key& key)
+			{
+				int i = find(key);
+				if (i >= 0)
+				{
+					eraseAt(i);
+				}
+			}
+
+		private:
+			template <typename T> void callDestructors(T* ptr, int count)
+			{
+				for (int i = 0; i < count; ++i)
+				{
+					ptr[i].~T();
+				}
+			}
+
+
+			int add(const Key& key)
+			{
+				ASSERT(key.index >= 0);
+				if (m_capacity == m_size) reserve(m_capacity < 4 ? 4 : m_capacity * 2);
+				while (key.index >= m_sparse.size()) m_sparse.push(-1);
+
+				int i = m_size;
+				new (NewPlaceholder(), &m_keys[i]) Key(key);
+				m_sparse[key.index] = i;
+				++m_size;
+				return i;
+			}
+
+		private:
+			IAllocator& m_allocator;
+			Key* m_keys;
+			Value* m_values;
+			int m_size;
+			int m_capacity;
+			Array<int> m_sparse;
+	};
+
+
+} // namespace Lumix
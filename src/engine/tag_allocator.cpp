@@ -0,0 +1,228 @@
+#include "engine/tag_allocator.h"
+#include "engine/math_utils.h"
+#include "engine/profiler.h"
+#include "engine/string.h"
+
+
+namespace Lumix
+{
+
+
+static const size_t MIN_ALIGN = 16;
+
+
+struct TagAllocatorRegistry
+{
+	TagAllocatorRegistry()
+		: mutex(false)
+		, first(nullptr)
+	{
+	}
+
+	MT::SpinMutex mutex;
+	TagAllocator* first;
+};
+
+
+static TagAllocatorRegistry g_registry;
+
+
+// header must keep the user pointer aligned, so it takes at least align bytes
+static size_t getHeaderSize(size_t align)
+{
+	return Math::maximum(align, MIN_ALIGN);
+}
+
+
+TagAllocator::TagAllocator(IAllocator& source, const char* tag)
+	: BaseProxyAllocator(source)
+	, m_tag(tag)
+	, m_mutex(false)
+	, m_size(0)
+	, m_peak(0)
+	, m_frame_allocation_count(0)
+	, m_frame_allocated_size(0)
+	, m_last_frame_allocation_count(0)
+	, m_last_frame_allocated_size(0)
+	, m_prev(nullptr)
+{
+	static_assert(sizeof(Header) <= MIN_ALIGN, "Header does not fit");
+	MT::SpinLock lock(g_registry.mutex);
+	m_next = g_registry.first;
+	if (m_next) m_next->m_prev = this;
+	g_registry.first = this;
+}
+
+
+TagAllocator::~TagAllocator()
+{
+	ASSERT(m_size == 0);
+	MT::SpinLock lock(g_registry.mutex);
+	if (m_prev) m_prev->m_next = m_next;
+	else g_registry.first = m_next;
+	if (m_next) m_next->m_prev = m_prev;
+}
+
+
+void TagAllocator::onAllocated(size_t size)
+{
+	MT::SpinLock lock(m_mutex);
+	m_size += size;
+	m_peak = Math::maximum(m_peak, m_size);
+	++m_frame_allocation_count;
+	m_frame_allocated_size += size;
+}
+
+
+void TagAllocator::onDeallocated(size_t size)
+{
+	MT::SpinLock lock(m_mutex);
+	ASSERT(m_size >= size);
+	m_size -= size;
+}
+
+
+void* TagAllocator::setHeader(void* mem, size_t offset, size_t size)
+{
+	void* ptr = (u8*)mem + offset;
+	Header* header = getHeader(ptr);
+	header->size = size;
+	header->offset = offset;
+	return ptr;
+}
+
+
+void* TagAllocator::allocate(size_t size)
+{
+	void* mem = BaseProxyAllocator::allocate(size + MIN_ALIGN);
+	if (!mem) return nullptr;
+	onAllocated(size);
+	return setHeader(mem, MIN_ALIGN, size);
+}
+
+
+void TagAllocator::deallocate(void* ptr)
+{
+	if (!ptr) return;
+
+	Header* header = getHeader(ptr);
+	ASSERT(header->offset == MIN_ALIGN);
+	onDeallocated(header->size);
+	BaseProxyAllocator::deallocate((u8*)ptr - MIN_ALIGN);
+}
+
+
+void* TagAllocator::reallocate(void* ptr, size_t size)
+{
+	if (!ptr) return allocate(size);
+	if (size == 0)
+	{
+		deallocate(ptr);
+		return nullptr;
+	}
+
+	size_t old_size = getHeader(ptr)->size;
+	void* mem = BaseProxyAllocator::reallocate((u8*)ptr - MIN_ALIGN, size + MIN_ALIGN);
+	if (!mem) return nullptr;
+	onDeallocated(old_size);
+	onAllocated(size);
+	return setHeader(mem, MIN_ALIGN, size);
+}
+
+
+void* TagAllocator::allocate_aligned(size_t size, size_t align)
+{
+	size_t offset = getHeaderSize(align);
+	void* mem = BaseProxyAllocator::allocate_aligned(size + offset, align);
+	if (!mem) return nullptr;
+	onAllocated(size);
+	return setHeader(mem, offset, size);
+}
+
+
+void TagAllocator::deallocate_aligned(void* ptr)
+{
+	if (!ptr) return;
+
+	Header* header = getHeader(ptr);
+	onDeallocated(header->size);
+	BaseProxyAllocator::deallocate_aligned((u8*)ptr - header->offset);
+}
+
+
+void* TagAllocator::reallocate_aligned(void* ptr, size_t size, size_t align)
+{
+	if (!ptr) return allocate_aligned(size, align);
+	if (size == 0)
+	{
+		deallocate_aligned(ptr);
+		return nullptr;
+	}
+
+	Header* header = getHeader(ptr);
+	size_t old_size = header->size;
+	size_t offset = getHeaderSize(align);
+	if (header->offset != offset)
+	{
+		void* new_ptr = allocate_aligned(size, align);
+		copyMemory(new_ptr, ptr, Math::minimum(old_size, size));
+		deallocate_aligned(ptr);
+		return new_ptr;
+	}
+
+	void* mem = BaseProxyAllocator::reallocate_aligned((u8*)ptr - offset, size + offset, align);
+	if (!mem) return nullptr;
+	onDeallocated(old_size);
+	onAllocated(size);
+	return setHeader(mem, offset, size);
+}
+
+
+TagAllocator::Stats TagAllocator::getStats()
+{
+	MT::SpinLock lock(m_mutex);
+	Stats stats;
+	stats.tag = m_tag;
+	stats.size = m_size;
+	stats.peak = m_peak;
+	stats.allocation_count = getAllocationCount();
+	stats.frame_allocation_count = m_last_frame_allocation_count;
+	stats.frame_allocated_size = m_last_frame_allocated_size;
+	return stats;
+}
+
+
+int TagAllocator::getStats(Stats* stats, int max_count)
+{
+	MT::SpinLock lock(g_registry.mutex);
+	int count = 0;
+	for (TagAllocator* allocator = g_registry.first; allocator; allocator = allocator->m_next)
+	{
+		if (count < max_count) stats[count] = allocator->getStats();
+		++count;
+	}
+	return count;
+}
+
+
+void TagAllocator::frame()
+{
+	PROFILE_BLOCK("memory KB");
+	MT::SpinLock lock(g_registry.mutex);
+	for (TagAllocator* allocator = g_registry.first; allocator; allocator = allocator->m_next)
+	{
+		size_t size;
+		{
+			MT::SpinLock allocator_lock(allocator->m_mutex);
+			allocator->m_last_frame_allocation_count = allocator->m_frame_allocation_count;
+			allocator->m_last_frame_allocated_size = allocator->m_frame_allocated_size;
+			allocator->m_frame_allocation_count = 0;
+			allocator->m_frame_allocated_size = 0;
+			size = allocator->m_size;
+		}
+		PROFILE_INT(allocator->m_tag, int(size >> 10));
+	}
+}
+
+
+} // namespace Lumix
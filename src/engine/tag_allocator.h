@@ -0,0 +1,76 @@
+#pragma once
+
+
+#include "engine/base_proxy_allocator.h"
+#include "engine/mt/sync.h"
+
+
+namespace Lumix
+{
+
+
+// Proxy allocator which accounts memory of one subsystem (renderer, physics, lua, ...). Live bytes,
+// peak and allocations in the last frame are tracked per instance and all instances are listed
+// in getStats, so the profiler can show where the memory goes and which subsystem churns.
+// Every allocation has a small header with its size, memory must be freed through the same allocator.
+class LUMIX_ENGINE_API TagAllocator LUMIX_FINAL : public BaseProxyAllocator
+{
+public:
+	struct Stats
+	{
+		const char* tag;
+		size_t size;
+		size_t peak;
+		int allocation_count;
+		// values of the last finished frame
+		int frame_allocation_count;
+		size_t frame_allocated_size;
+	};
+
+public:
+	// tag must outlive the allocator, use string literals
+	TagAllocator(IAllocator& source, const char* tag);
+	~TagAllocator();
+
+	void* allocate(size_t size) override;
+	void deallocate(void* ptr) override;
+	void* reallocate(void* ptr, size_t size) override;
+	void* allocate_aligned(size_t size, size_t align) override;
+	void deallocate_aligned(void* ptr) override;
+	void* reallocate_aligned(void* ptr, size_t size, size_t align) override;
+
+	const char* getTag() const { return m_tag; }
+	Stats getStats();
+
+	// fills at most max_count items, returns number of all tag allocators
+	static int getStats(Stats* stats, int max_count);
+	// called once per frame from the main thread, closes per-frame counters and records them in the profiler
+	static void frame();
+
+private:
+	struct Header
+	{
+		size_t size;
+		size_t offset;
+	};
+
+	void onAllocated(size_t size);
+	void onDeallocated(size_t size);
+	void* setHeader(void* mem, size_t offset, size_t size);
+	static Header* getHeader(void* ptr) { return (Header*)ptr - 1; }
+
+private:
+	const char* m_tag;
+	MT::SpinMutex m_mutex;
+	size_t m_size;
+	size_t m_peak;
+	int m_frame_allocation_count;
+	size_t m_frame_allocated_size;
+	int m_last_frame_allocation_count;
+	size_t m_last_frame_allocated_size;
+	TagAllocator* m_next;
+	TagAllocator* m_prev;
+};
+
+
+} // namespace Lumix
@@ -4,6 +4,7 @@
 #include "engine/hash_map.h"
 #include "engine/json_serializer.h"
 #include "engine/log.h"
+#include "engine/profiler.h"
 #include "engine/property_register.h"
 #include "engine/serializer.h"
 #include "universe.h"
@@ -16,11 +17,31 @@ namespace Lumix
 static const ComponentType HIERARCHY_TYPE_HANDLE = PropertyRegister::getComponentType("hierarchy");
 
 
+static bool isSameTransform(const Transform& a, const Transform& b)
+{
+	return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z && a.rot.x == b.rot.x &&
+		   a.rot.y == b.rot.y && a.rot.z == b.rot.z && a.rot.w == b.rot.w;
+}
+
+
 class HierarchyImpl LUMIX_FINAL : public Hierarchy
 {
 private:
 	typedef HashMap<Entity, Entity> Parents;
 
+	// every entity in a hierarchy has a node, nodes are in depth-first order,
+	// so parents are before their children and each subtree is a contiguous range
+	struct Node
+	{
+		Entity entity;
+		int parent;
+		int subtree_size;
+		Child* child;
+		Transform world;
+		bool is_local_dirty;
+		bool is_changed;
+	};
+
 public:
 	HierarchyImpl(IPlugin& system, Universe& universe, IAllocator& allocator)
 		: m_universe(universe)
@@ -28,6 +49,11 @@ public:
 		, m_children(allocator)
 		, m_allocator(allocator)
 		, m_system(system)
+		, m_nodes(allocator)
+		, m_node_indices(allocator)
+		, m_batch_entities(allocator)
+		, m_batch_transforms(allocator)
+		, m_is_nodes_valid(false)
 	{
 		universe.registerComponentType(HIERARCHY_TYPE_HANDLE, this, &HierarchyImpl::serializeComponent, &HierarchyImpl::deserializeComponent);
 		m_is_processing = false;
@@ -46,6 +72,7 @@ public:
 		}
 		m_children.clear();
 		m_parents.clear();
+		m_is_nodes_valid = false;
 	}
 
 
@@ -94,6 +121,7 @@ public:
 				}
 			}
 			m_parents.erase(parent_iter);
+			m_is_nodes_valid = false;
 			m_universe.destroyComponent(entity, type, this, component);
 		}
 	}
@@ -123,47 +151,160 @@ public:
 			}
 			LUMIX_DELETE(m_allocator, iter.value());
 			m_children.erase(iter);
+			m_is_nodes_valid = false;
+		}
+		else if (m_parents.find(entity).isValid())
+		{
+			m_is_nodes_valid = false;
 		}
 	}
 
 
-	void onEntityMoved(Entity entity)
+	void addNodes(Entity entity, int parent, Child* child)
 	{
-		bool was_processing = m_is_processing;
-		m_is_processing = true;
+		int index = m_nodes.size();
+		Node& node = m_nodes.emplace();
+		node.entity = entity;
+		node.parent = parent;
+		node.child = child;
+		node.world = m_universe.getTransform(entity);
+		node.is_local_dirty = false;
+		node.is_changed = false;
+		m_node_indices.insert(entity, index);
+
 		Children::iterator iter = m_children.find(entity);
 		if (iter.isValid())
 		{
-			Transform parent_transform = m_universe.getTransform(entity);
-			Array<Child>& children = *iter.value();
-			for (int i = 0, c = children.size(); i < c; ++i)
+			for (Child& c : *iter.value())
 			{
-				m_universe.setTransform(children[i].m_entity, parent_transform * children[i].m_local_transform);
+				// cycles are not supported
+				if (m_node_indices.find(c.m_entity).isValid()) continue;
+				addNodes(c.m_entity, index, &c);
 			}
 		}
-		m_is_processing = was_processing;
+		m_nodes[index].subtree_size = m_nodes.size() - index;
+	}
 
+
+	// structural changes only invalidate the nodes, they are rebuilt when needed
+	void updateNodes()
+	{
+		if (m_is_nodes_valid) return;
+
+		PROFILE_FUNCTION();
+		m_is_nodes_valid = true;
+		m_nodes.clear();
+		m_node_indices.clear();
+		for (Children::iterator iter = m_children.begin(), end = m_children.end(); iter != end; ++iter)
+		{
+			Parents::iterator parent_iter = m_parents.find(iter.key());
+			if (parent_iter.isValid() && isValid(parent_iter.value())) continue;
+
+			addNodes(iter.key(), -1, nullptr);
+		}
+	}
+
+
+	int getNodeIndex(Entity entity)
+	{
+		updateNodes();
+		auto iter = m_node_indices.find(entity);
+		return iter.isValid() ? iter.value() : -1;
+	}
+
+
+	// one linear pass over nodes [from, to), world transforms are computed from parents and
+	// written to the universe in one batch
+	void propagateTransforms(int from, int to)
+	{
+		m_batch_entities.clear();
+		m_batch_transforms.clear();
+		for (int i = from; i < to; ++i)
+		{
+			Node& node = m_nodes[i];
+			if (node.parent < 0 || (!node.is_local_dirty && !m_nodes[node.parent].is_changed)) continue;
+
+			node.is_changed = true;
+			Transform current = m_universe.getTransform(node.entity);
+			if (!node.is_local_dirty && !isSameTransform(current, node.world))
+			{
+				// moved by someone else and not processed yet (deferred notifications), it keeps its world transform
+				node.world = current;
+				node.child->m_local_transform = m_nodes[node.parent].world.inverted() * current;
+				continue;
+			}
+
+			node.is_local_dirty = false;
+			node.world = m_nodes[node.parent].world * node.child->m_local_transform;
+			m_batch_entities.push(node.entity);
+			m_batch_transforms.push(node.world);
+		}
+		for (int i = from; i < to; ++i)
+		{
+			m_nodes[i].is_changed = false;
+		}
+		if (m_batch_entities.empty()) return;
+
+		m_is_processing = true;
+		m_universe.setTransforms(&m_batch_entities[0], &m_batch_transforms[0], m_batch_entities.size());
+		m_is_processing = false;
+	}
+
+
+	void onEntityMoved(Entity entity)
+	{
 		if (m_is_processing) return;
+		// do not rebuild nodes because of entities outside of any hierarchy, e.g. while loading
+		if (!m_is_nodes_valid && !m_parents.find(entity).isValid() && !m_children.find(entity).isValid()) return;
 
-		Parents::iterator parent_iter = m_parents.find(entity);
-		if (parent_iter.isValid() && isValid(parent_iter.value()))
+		bool is_rebuilt = !m_is_nodes_valid;
+		int index = getNodeIndex(entity);
+		if (index < 0) return;
+
+		Node& node = m_nodes[index];
+		Transform transform = m_universe.getTransform(entity);
+		// our own write delivered later by deferred notifications
+		if (!is_rebuilt && isSameTransform(transform, node.world)) return;
+
+		node.world = transform;
+		if (node.child)
 		{
-			Entity parent(parent_iter.value());
-			Children::iterator child_iter = m_children.find(parent);
-			if (child_iter.isValid())
+			Entity parent = m_nodes[node.parent].entity;
+			node.child->m_local_transform = m_universe.getTransform(parent).inverted() * transform;
+		}
+		if (node.subtree_size > 1)
+		{
+			node.is_changed = true;
+			propagateTransforms(index, index + node.subtree_size);
+		}
+	}
+
+
+	void setLocalTransforms(const Entity* entities, const Transform* transforms, int count) override
+	{
+		PROFILE_FUNCTION();
+		updateNodes();
+		for (int i = 0; i < count; ++i)
+		{
+			int index = getNodeIndex(entities[i]);
+			Node* node = index < 0 ? nullptr : &m_nodes[index];
+			if (!node || !node->child)
 			{
-				Array<Child>& children = *child_iter.value();
-				for (int i = 0, c = children.size(); i < c; ++i)
-				{
-					if (children[i].m_entity == entity)
-					{
-						Transform parent_transform = m_universe.getTransform(parent);
-						children[i].m_local_transform = parent_transform.inverted() * m_universe.getTransform(entity);
-						break;
-					}
-				}
+				m_universe.setTransform(entities[i], transforms[i]);
+				continue;
 			}
+			node->child->m_local_transform = transforms[i];
+			node->is_local_dirty = true;
 		}
+		propagateTransforms(0, m_nodes.size());
+	}
+
+
+	Transform getLocalTransform(Entity entity) override
+	{
+		int index = getNodeIndex(entity);
+		if (index < 0 || !m_nodes[index].child) return m_universe.getTransform(entity);
+		return m_nodes[index].child->m_local_transform;
 	}
 
 
@@ -186,24 +327,7 @@ public:
 
 	Vec3 getLocalPosition(ComponentHandle cmp) override
 	{
-		Entity entity = {cmp.index};
-		Parents::iterator parent_iter = m_parents.find(entity);
-
-		if (parent_iter.isValid() && isValid(parent_iter.value()))
-		{
-			auto child_iter = m_children.find(parent_iter.value());
-			ASSERT(child_iter.isValid());
-
-			for (auto& child : *child_iter.value())
-			{
-				if (child.m_entity == entity)
-				{
-					return child.m_local_transform.pos;
-				}
-			}
-		}
-
-		return m_universe.getPosition(entity);
+		return getLocalTransform({cmp.index}).pos;
 	}
 
 
@@ -239,25 +363,7 @@ public:
 
 	Quat getLocalRotation(ComponentHandle cmp) override
 	{
-		Entity entity = {cmp.index};
-		Parents::iterator parent_iter = m_parents.find(entity);
-
-		if (parent_iter.isValid() && isValid(parent_iter.value()))
-		{
-			auto child_iter = m_children.find(parent_iter.value());
-			ASSERT(child_iter.isValid());
-
-			for (auto& child : *child_iter.value())
-			{
-				if (child.m_entity == entity)
-				{
-					Quat rot = child.m_local_transform.rot;
-					return rot;
-				}
-			}
-		}
-
-		return m_universe.getRotation(entity);
+		return getLocalTransform({cmp.index}).rot;
 	}
 
 	const Children& getAllChildren() const override { return m_children; }
@@ -292,6 +398,7 @@ public:
 		}
 
 		m_parents.insert(child_entity, parent);
+		m_is_nodes_valid = false;
 		if (isValid(parent))
 		{
 			Children::iterator child_iter = m_children.find(parent);
@@ -344,6 +451,7 @@ public:
 		Entity parent;
 		serializer.read(&parent);
 		m_parents.insert(entity, parent);
+		m_is_nodes_valid = false;
 		if (isValid(parent))
 		{
 			Children::iterator child_iter = m_children.find(parent);
@@ -407,6 +515,11 @@ private:
 	Parents m_parents;
 	Children m_children;
 	IPlugin& m_system;
+	Array<Node> m_nodes;
+	HashMap<Entity, int> m_node_indices;
+	Array<Entity> m_batch_entities;
+	Array<Transform> m_batch_transforms;
+	bool m_is_nodes_valid;
 	bool m_is_processing;
 };
 
@@ -54,6 +54,10 @@ namespace Lumix
 			virtual void setLocalRotation(ComponentHandle cmp, const Quat& rotation) = 0;
 			virtual Quat getLocalRotation(ComponentHandle cmp) = 0;
 			virtual void setLocalRotationEuler(ComponentHandle cmp, const Vec3& rotation) = 0;
+			// sets local transforms of many entities, world transforms are updated in one pass
+			// and written to the universe in one batch
+			virtual void setLocalTransforms(const Entity* entities, const Transform* transforms, int count) = 0;
+			virtual Transform getLocalTransform(Entity entity) = 0;
 			virtual Vec3 getLocalRotationEuler(ComponentHandle cmp) = 0;
 			virtual void setParent(ComponentHandle cmp, Entity parent) = 0;
 			virtual Entity getParent(ComponentHandle cmp) = 0;
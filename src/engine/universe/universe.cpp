@@ -5,6 +5,7 @@
 #include "engine/json_serializer.h"
 #include "engine/matrix.h"
 #include "engine/prefab.h"
+#include "engine/profiler.h"
 #include "engine/property_register.h"
 #include "engine/serializer.h"
 #include <cstdint>
@@ -32,6 +33,8 @@ Universe::Universe(IAllocator& allocator)
 	, m_entity_created(m_allocator)
 	, m_entity_destroyed(m_allocator)
 	, m_entity_moved(m_allocator)
+	, m_transformed_entities(m_allocator)
+	, m_defer_transform_notifications(false)
 	, m_first_free_slot(-1)
 	, m_scenes(m_allocator)
 {
@@ -85,14 +88,14 @@ const Quat& Universe::getRotation(Entity entity) const
 void Universe::setRotation(Entity entity, const Quat& rot)
 {
 	m_entities[entity.index].rotation = rot;
-	entityTransformed().invoke(entity);
+	transformEntity(entity);
 }
 
 
 void Universe::setRotation(Entity entity, float x, float y, float z, float w)
 {
 	m_entities[entity.index].rotation.set(x, y, z, w);
-	entityTransformed().invoke(entity);
+	transformEntity(entity);
 }
 
 
@@ -106,7 +109,7 @@ void Universe::setMatrix(Entity entity, const Matrix& mtx)
 {
 	EntityData& out = m_entities[entity.index];
 	mtx.decompose(out.position, out.rotation, out.scale);
-	entityTransformed().invoke(entity);
+	transformEntity(entity);
 }
 
 
@@ -124,7 +127,62 @@ void Universe::setTransform(Entity entity, const Transform& transform)
 	auto& tmp = m_entities[entity.index];
 	tmp.position = transform.pos;
 	tmp.rotation = transform.rot;
-	entityTransformed().invoke(entity);
+	transformEntity(entity);
+}
+
+
+void Universe::setTransforms(const Entity* entities, const Transform* transforms, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		auto& tmp = m_entities[entities[i].index];
+		tmp.position = transforms[i].pos;
+		tmp.rotation = transforms[i].rot;
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		transformEntity(entities[i]);
+	}
+}
+
+
+void Universe::transformEntity(Entity entity)
+{
+	if (!m_defer_transform_notifications)
+	{
+		m_entity_moved.invoke(entity);
+		return;
+	}
+
+	EntityData& data = m_entities[entity.index];
+	if (data.transformed) return;
+	data.transformed = true;
+	m_transformed_entities.push(entity);
+}
+
+
+void Universe::deferTransformNotifications(bool defer)
+{
+	if (!defer) flushTransforms();
+	m_defer_transform_notifications = defer;
+}
+
+
+void Universe::flushTransforms()
+{
+	if (m_transformed_entities.empty()) return;
+
+	PROFILE_FUNCTION();
+	PROFILE_INT("entities", m_transformed_entities.size());
+	// listeners can move other entities (e.g. children in hierarchy), those are appended and handled here too
+	for (int i = 0; i < m_transformed_entities.size(); ++i)
+	{
+		Entity entity = m_transformed_entities[i];
+		EntityData& data = m_entities[entity.index];
+		data.transformed = false;
+		if (data.valid) m_entity_moved.invoke(entity);
+	}
+	m_transformed_entities.clear();
 }
 
 
@@ -149,7 +207,7 @@ void Universe::setPosition(Entity entity, float x, float y, float z)
 {
 	auto& transform = m_entities[entity.index];
 	transform.position.set(x, y, z);
-	entityTransformed().invoke(entity);
+	transformEntity(entity);
 }
 
 
@@ -157,7 +215,7 @@ void Universe::setPosition(Entity entity, const Vec3& pos)
 {
 	auto& transform = m_entities[entity.index];
 	transform.position = pos;
-	entityTransformed().invoke(entity);
+	transformEntity(entity);
 }
 
 
@@ -219,6 +277,7 @@ void Universe::createEntity(Entity entity)
 	data.scale = 1;
 	data.components = 0;
 	data.valid = true;
+	data.transformed = false;
 	m_entity_created.invoke(entity);
 }
 
@@ -244,6 +303,7 @@ Entity Universe::createEntity(const Vec3& position, const Quat& rotation)
 	data->scale = 1;
 	data->components = 0;
 	data->valid = true;
+	data->transformed = false;
 	m_entity_created.invoke(entity);
 
 	return entity;
@@ -348,6 +408,8 @@ void Universe::deserialize(InputBlob& serializer)
 
 	if (count > 0)
 		serializer.read(&m_entities[0], sizeof(m_entities[0]) * m_entities.size());
+	for (auto& i : m_entities) i.transformed = false;
+	m_transformed_entities.clear();
 
 	serializer.read(count);
 	m_id_to_name_map.clear();
@@ -366,6 +428,41 @@ void Universe::deserialize(InputBlob& serializer)
 }
 
 
+void Universe::serializeSnapshot(OutputBlob& serializer)
+{
+	serialize(serializer);
+	for (auto* scene : m_scenes)
+	{
+		scene->serialize(serializer);
+	}
+}
+
+
+void Universe::deserializeSnapshot(InputBlob& serializer)
+{
+	ASSERT(m_entities.empty());
+	deserialize(serializer);
+	for (auto* scene : m_scenes)
+	{
+		scene->deserialize(serializer);
+	}
+}
+
+
+void Universe::clear()
+{
+	for (int i = m_scenes.size() - 1; i >= 0; --i)
+	{
+		m_scenes[i]->clear();
+	}
+	m_entities.clear();
+	m_id_to_name_map.clear();
+	m_name_to_id_map.clear();
+	m_transformed_entities.clear();
+	m_first_free_slot = -1;
+}
+
+
 struct PrefabEntityGUIDMap : public IEntityGUIDMap
 {
 	Entity get(EntityGUID guid) override { return{ (int)guid.value }; }
@@ -381,22 +478,102 @@ struct PrefabEntityGUIDMap : public IEntityGUIDMap
 };
 
 
-void Universe::instantiatePrefab(const PrefabResource& prefab,
-	const Vec3& pos,
-	const Quat& rot,
-	float scale,
-	Array<Entity>& entities)
+// Replays the text prefab and records every value read by scenes in binary form,
+// so the next instances do not have to parse text nor look up component types.
+struct PrefabCompiler LUMIX_FINAL : public IDeserializer
+{
+	PrefabCompiler(TextDeserializer& _text, OutputBlob& _image)
+		: text(_text)
+		, image(_image)
+	{
+	}
+
+	void read(Entity* entity) override
+	{
+		EntityGUID guid;
+		text.read(&guid.value);
+		image.write(guid);
+		*entity = text.entity_map.get(guid);
+	}
+
+	void read(ComponentHandle* value) override { text.read(value); image.write(*value); }
+	void read(Transform* value) override { text.read(value); image.write(*value); }
+	void read(Vec4* value) override { text.read(value); image.write(*value); }
+	void read(Vec3* value) override { text.read(value); image.write(*value); }
+	void read(Quat* value) override { text.read(value); image.write(*value); }
+	void read(float* value) override { text.read(value); image.write(*value); }
+	void read(bool* value) override { text.read(value); image.write(*value); }
+	void read(u64* value) override { text.read(value); image.write(*value); }
+	void read(i64* value) override { text.read(value); image.write(*value); }
+	void read(u32* value) override { text.read(value); image.write(*value); }
+	void read(i32* value) override { text.read(value); image.write(*value); }
+	void read(u8* value) override { text.read(value); image.write(*value); }
+	void read(i8* value) override { text.read(value); image.write(*value); }
+	void read(char* value, int max_size) override { text.read(value, max_size); image.writeString(value); }
+	Entity getEntity(EntityGUID guid) override { return text.getEntity(guid); }
+
+	TextDeserializer& text;
+	OutputBlob& image;
+};
+
+
+struct PrefabImageDeserializer LUMIX_FINAL : public IDeserializer
+{
+	PrefabImageDeserializer(InputBlob& _blob, IEntityGUIDMap& _entity_map)
+		: blob(_blob)
+		, entity_map(_entity_map)
+	{
+	}
+
+	void read(Entity* entity) override
+	{
+		EntityGUID guid;
+		blob.read(guid);
+		*entity = entity_map.get(guid);
+	}
+
+	void read(ComponentHandle* value) override { blob.read(*value); }
+	void read(Transform* value) override { blob.read(*value); }
+	void read(Vec4* value) override { blob.read(*value); }
+	void read(Vec3* value) override { blob.read(*value); }
+	void read(Quat* value) override { blob.read(*value); }
+	void read(float* value) override { blob.read(*value); }
+	void read(bool* value) override { blob.read(*value); }
+	void read(u64* value) override { blob.read(*value); }
+	void read(i64* value) override { blob.read(*value); }
+	void read(u32* value) override { blob.read(*value); }
+	void read(i32* value) override { blob.read(*value); }
+	void read(u8* value) override { blob.read(*value); }
+	void read(i8* value) override { blob.read(*value); }
+	void read(char* value, int max_size) override { blob.readString(value, max_size); }
+	Entity getEntity(EntityGUID guid) override { return entity_map.get(guid); }
+
+	InputBlob& blob;
+	IEntityGUIDMap& entity_map;
+};
+
+
+void Universe::compilePrefab(PrefabResource& prefab, const Transform& transform, float scale, Array<Entity>& entities)
 {
+	// image layout: per entity i32 component count, per component i32 type, i32 version and the recorded values
+	prefab.image.clear();
+	prefab.entities_count = 0;
 	InputBlob blob(prefab.blob.getData(), prefab.blob.getPos());
 	PrefabEntityGUIDMap entity_map;
 	TextDeserializer deserializer(blob, entity_map);
+	PrefabCompiler compiler(deserializer, prefab.image);
 	while (blob.getPosition() < blob.getSize())
 	{
-		u64 prefab;
-		deserializer.read(&prefab);
-		Entity entity = createEntity(pos, rot);
+		u64 prefab_hash;
+		deserializer.read(&prefab_hash);
+		Entity entity = createEntity(transform.pos, transform.rot);
+		m_entities[entity.index].scale = scale;
 		entities.push(entity);
-		setScale(entity, scale);
+		++prefab.entities_count;
+
+		int count_pos = prefab.image.getPos();
+		i32 cmp_count = 0;
+		prefab.image.write(cmp_count);
 		u32 cmp_type_hash;
 		deserializer.read(&cmp_type_hash);
 		while (cmp_type_hash != 0)
@@ -404,9 +581,73 @@ void Universe::instantiatePrefab(const PrefabResource& prefab,
 			ComponentType cmp_type = PropertyRegister::getComponentTypeFromHash(cmp_type_hash);
 			int scene_version;
 			deserializer.read(&scene_version);
-			deserializeComponent(deserializer, entity, cmp_type, scene_version);
+			prefab.image.write((i32)cmp_type.index);
+			prefab.image.write((i32)scene_version);
+			deserializeComponent(compiler, entity, cmp_type, scene_version);
+			++cmp_count;
 			deserializer.read(&cmp_type_hash);
 		}
+		copyMemory((u8*)prefab.image.getMutableData() + count_pos, &cmp_count, sizeof(cmp_count));
+	}
+	prefab.is_compiled = true;
+}
+
+
+void Universe::instantiatePrefab(PrefabResource& prefab,
+	const Vec3& pos,
+	const Quat& rot,
+	float scale,
+	Array<Entity>& entities)
+{
+	Transform transform = {pos, rot};
+	instantiatePrefab(prefab, &transform, 1, scale, entities);
+}
+
+
+void Universe::instantiatePrefab(PrefabResource& prefab,
+	const Transform* transforms,
+	int count,
+	float scale,
+	Array<Entity>& entities)
+{
+	PROFILE_FUNCTION();
+	if (count <= 0) return;
+
+	int first = 0;
+	if (!prefab.is_compiled)
+	{
+		compilePrefab(prefab, transforms[0], scale, entities);
+		first = 1;
+	}
+
+	int new_entities_count = (count - first) * prefab.entities_count;
+	entities.reserve(entities.size() + new_entities_count);
+	m_entities.reserve(m_entities.size() + new_entities_count);
+
+	InputBlob blob(prefab.image);
+	PrefabEntityGUIDMap entity_map;
+	PrefabImageDeserializer deserializer(blob, entity_map);
+	for (int i = first; i < count; ++i)
+	{
+		blob.rewind();
+		for (int j = 0; j < prefab.entities_count; ++j)
+		{
+			Entity entity = createEntity(transforms[i].pos, transforms[i].rot);
+			// nobody listens to the entity yet, so there is no need to notify about the scale
+			m_entities[entity.index].scale = scale;
+			entities.push(entity);
+
+			i32 cmp_count;
+			blob.read(cmp_count);
+			for (int k = 0; k < cmp_count; ++k)
+			{
+				i32 type_index;
+				i32 scene_version;
+				blob.read(type_index);
+				blob.read(scene_version);
+				deserializeComponent(deserializer, entity, {type_index}, scene_version);
+			}
+		}
 	}
 }
 
@@ -415,7 +656,7 @@ void Universe::setScale(Entity entity, float scale)
 {
 	auto& transform = m_entities[entity.index];
 	transform.scale = scale;
-	entityTransformed().invoke(entity);
+	transformEntity(entity);
 }
 
 
@@ -79,17 +79,24 @@ public:
 	Matrix getPositionAndRotation(Entity entity) const;
 	Matrix getMatrix(Entity entity) const;
 	void setTransform(Entity entity, const Transform& transform);
+	void setTransforms(const Entity* entities, const Transform* transforms, int count);
 	Transform getTransform(Entity entity) const;
 	void setRotation(Entity entity, float x, float y, float z, float w);
 	void setRotation(Entity entity, const Quat& rot);
 	void setPosition(Entity entity, float x, float y, float z);
 	void setPosition(Entity entity, const Vec3& pos);
 	void setScale(Entity entity, float scale);
-	void instantiatePrefab(const PrefabResource& prefab,
+	void instantiatePrefab(PrefabResource& prefab,
 		const Vec3& pos,
 		const Quat& rot,
 		float scale,
 		Array<Entity>& entities);
+	// creates count instances of the prefab, entities of all instances are pushed to entities
+	void instantiatePrefab(PrefabResource& prefab,
+		const Transform* transforms,
+		int count,
+		float scale,
+		Array<Entity>& entities);
 	float getScale(Entity entity);
 	const Vec3& getPosition(Entity entity) const;
 	const Quat& getRotation(Entity entity) const;
@@ -99,6 +106,12 @@ public:
 		m_name = name; 
 	}
 
+	// while deferred, moved entities are collected and entityTransformed is invoked once
+	// per entity in flushTransforms, no matter how many times each one was moved
+	void deferTransformNotifications(bool defer);
+	bool areTransformNotificationsDeferred() const { return m_defer_transform_notifications; }
+	void flushTransforms();
+
 	DelegateList<void(Entity)>& entityTransformed() { return m_entity_moved; }
 	DelegateList<void(Entity)>& entityCreated() { return m_entity_created; }
 	DelegateList<void(Entity)>& entityDestroyed() { return m_entity_destroyed; }
@@ -109,6 +122,13 @@ public:
 	void deserializeComponent(IDeserializer& serializer, Entity entity, ComponentType type, int scene_version);
 	void serialize(OutputBlob& serializer);
 	void deserialize(InputBlob& serializer);
+	// entities and all scenes in creation order, restored in the same process into the same universe;
+	// the entity table is copied as one block, scenes still go through their binary (de)serialize
+	void serializeSnapshot(OutputBlob& serializer);
+	void deserializeSnapshot(InputBlob& serializer);
+	// removes all entities and components, scenes stay attached and must be left
+	// in the same state as freshly created ones
+	void clear();
 
 	IScene* getScene(ComponentType type) const;
 	IScene* getScene(u32 hash) const;
@@ -136,8 +156,13 @@ private:
 			};
 		};
 		bool valid;
+		bool transformed;
 	};
 
+private:
+	void transformEntity(Entity entity);
+	void compilePrefab(PrefabResource& prefab, const Transform& transform, float scale, Array<Entity>& entities);
+
 private:
 	IAllocator& m_allocator;
 	ComponentTypeEntry m_component_type_map[MAX_COMPONENTS_TYPES_COUNT];
@@ -150,6 +175,8 @@ private:
 	DelegateList<void(Entity)> m_entity_destroyed;
 	DelegateList<void(const ComponentUID&)> m_component_destroyed;
 	DelegateList<void(const ComponentUID&)> m_component_added;
+	Array<Entity> m_transformed_entities;
+	bool m_defer_transform_notifications;
 	int m_first_free_slot;
 	StaticString<64> m_name;
 };
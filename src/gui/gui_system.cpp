@@ -9,6 +9,7 @@
 #include "engine/path.h"
 #include "engine/plugin_manager.h"
 #include "engine/resource_manager.h"
+#include "engine/tag_allocator.h"
 #include "renderer/material.h"
 #include "renderer/material_manager.h"
 #include "renderer/pipeline.h"
@@ -33,7 +34,8 @@ static const ResourceType TEXTURE_TYPE("texture");
 struct GUISystemImpl LUMIX_FINAL : public GUISystem
 {
 	GUISystemImpl(Engine& engine)
-		: m_engine(engine)
+		: m_allocator(engine.getAllocator(), "gui")
+		, m_engine(engine)
 		, m_interface(nullptr)
 	{
 		m_context = ImGui::CreateContext();
@@ -49,17 +51,12 @@ struct GUISystemImpl LUMIX_FINAL : public GUISystem
 		auto* resource = material_manager->load(Path("pipelines/imgui/imgui.mat"));
 		m_material = static_cast<Material*>(resource);
 
-		auto* old_texture = m_material->getTexture(0);
-		Texture* texture = LUMIX_NEW(m_engine.getAllocator(), Texture)(
-			Path("font"), *m_engine.getResourceManager().get(TEXTURE_TYPE), m_engine.getAllocator());
+		Texture* texture = LUMIX_NEW(m_allocator, Texture)(
+			Path("font"), *m_engine.getResourceManager().get(TEXTURE_TYPE), m_allocator);
 
 		texture->create(w, h, pixels);
+		// the previous texture is owned by the texture manager, setTexture releases it
 		m_material->setTexture(0, texture);
-		if (old_texture)
-		{
-			old_texture->destroy();
-			LUMIX_DELETE(m_engine.getAllocator(), old_texture);
-		}
 
 		io.DisplaySize.x = 640;
 		io.DisplaySize.y = 480;
@@ -77,7 +74,7 @@ struct GUISystemImpl LUMIX_FINAL : public GUISystem
 		{
 			m_material->setTexture(0, nullptr);
 			texture->destroy();
-			LUMIX_DELETE(m_engine.getAllocator(), texture);
+			LUMIX_DELETE(m_allocator, texture);
 		}
 
 		m_material->getResourceManager().unload(*m_material);
@@ -276,6 +273,7 @@ struct GUISystemImpl LUMIX_FINAL : public GUISystem
 	const char* getName() const override { return "gui"; }
 
 
+	TagAllocator m_allocator;
 	Engine& m_engine;
 	Interface* m_interface;
 	ImGuiContext* m_context;
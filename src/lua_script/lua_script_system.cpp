@@ -4,7 +4,6 @@
 #include "engine/binary_array.h"
 #include "engine/blob.h"
 #include "engine/crc32.h"
-#include "engine/debug/debug.h"
 #include "engine/engine.h"
 #include "engine/fs/file_system.h"
 #include "engine/iallocator.h"
@@ -20,6 +19,7 @@
 #include "engine/resource_manager.h"
 #include "engine/serializer.h"
 #include "engine/string.h"
+#include "engine/tag_allocator.h"
 #include "engine/universe/universe.h"
 #include "lua_script/lua_script_manager.h"
 
@@ -52,7 +52,7 @@ namespace Lumix
 		LuaScriptManager& getScriptManager() { return m_script_manager; }
 
 		Engine& m_engine;
-		Debug::Allocator m_allocator;
+		TagAllocator m_allocator;
 		LuaScriptManager m_script_manager;
 	};
 
@@ -122,7 +122,7 @@ namespace Lumix
 				ASSERT(is_env_valid);
 				lua_pushnil(L);
 				auto& allocator = m_scene.m_system.m_allocator;
-				BinaryArray valid_properties(m_scene.m_system.m_engine.getLIFOAllocator());
+				BinaryArray valid_properties(m_scene.m_system.m_engine.getFrameAllocator());
 				valid_properties.resize(inst.m_properties.size());
 				setMemory(valid_properties.getRaw(), 0, valid_properties.size() >> 3);
 
@@ -465,6 +465,8 @@ namespace Lumix
 				LUMIX_DELETE(m_system.m_allocator, script_cmp);
 			}
 			m_scripts.clear();
+			m_updates.clear();
+			m_timers.clear();
 		}
 
 
@@ -1645,7 +1647,7 @@ namespace Lumix
 
 	LuaScriptSystemImpl::LuaScriptSystemImpl(Engine& engine)
 		: m_engine(engine)
-		, m_allocator(engine.getAllocator())
+		, m_allocator(engine.getAllocator(), "lua_script")
 		, m_script_manager(m_allocator)
 	{
 		m_script_manager.create(LUA_SCRIPT_RESOURCE_TYPE, engine.getResourceManager());
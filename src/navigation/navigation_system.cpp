@@ -1,6 +1,5 @@
 #include "navigation_system.h"
 #include "engine/array.h"
-#include "engine/base_proxy_allocator.h"
 #include "engine/blob.h"
 #include "engine/crc32.h"
 #include "engine/engine.h"
@@ -13,6 +12,7 @@
 #include "engine/property_descriptor.h"
 #include "engine/property_register.h"
 #include "engine/serializer.h"
+#include "engine/tag_allocator.h"
 #include "engine/universe/universe.h"
 #include "engine/vec.h"
 #include "lua_script/lua_script_system.h"
@@ -45,6 +45,8 @@ enum class AnimationSceneVersion : int
 static const ComponentType NAVMESH_AGENT_TYPE = PropertyRegister::getComponentType("navmesh_agent");
 static const int CELLS_PER_TILE_SIDE = 256;
 static const float CELL_SIZE = 0.3f;
+static const u32 RENDERER_HASH = constCrc32("renderer");
+static const u32 LUA_SCRIPT_HASH = constCrc32("lua_script");
 static void registerLuaAPI(lua_State* L);
 
 
@@ -70,7 +72,7 @@ struct NavigationSystem LUMIX_FINAL : public IPlugin
 {
 	NavigationSystem(Engine& engine)
 		: m_engine(engine)
-		, m_allocator(engine.getAllocator())
+		, m_allocator(engine.getAllocator(), "navigation")
 	{
 		ASSERT(s_instance == nullptr);
 		s_instance = this;
@@ -122,7 +124,7 @@ struct NavigationSystem LUMIX_FINAL : public IPlugin
 	void createScenes(Universe& universe) override;
 	void destroyScene(IScene* scene) override;
 
-	BaseProxyAllocator m_allocator;
+	TagAllocator m_allocator;
 	Engine& m_engine;
 };
 
@@ -165,6 +167,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 	void clear() override
 	{
 		m_agents.clear();
+		clearNavmesh();
 	}
 
 
@@ -234,7 +237,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 		PROFILE_FUNCTION();
 		const float walkable_threshold = cosf(Math::degreesToRadians(60));
 
-		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		if (!render_scene) return;
 
 		ComponentHandle cmp = render_scene->getFirstTerrain();
@@ -294,7 +297,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 		PROFILE_FUNCTION();
 		const float walkable_threshold = cosf(Math::degreesToRadians(45));
 
-		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		if (!render_scene) return;
 
 		u32 no_navigation_flag = Material::getCustomFlag("no_navigation");
@@ -521,7 +524,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 
 	void debugDrawPath(Entity entity) override
 	{
-		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		if (!render_scene) return;
 		if (!m_crowd) return;
 
@@ -562,7 +565,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 
 	void debugDrawContours() override
 	{
-		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		if (!render_scene) return;
 		if (!m_debug_contours) return;
 
@@ -674,7 +677,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 
 	void debugDrawHeightfield() override
 	{
-		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		if (!render_scene) return;
 		if (!m_debug_heightfield) return;
 
@@ -706,7 +709,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 	{
 		static const int MAX_CUBES = 0xffFF;
 
-		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		if (!render_scene) return;
 		if (!m_debug_compact_heightfield) return;
 
@@ -875,7 +878,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 		int x = int((pos.x - m_aabb.min.x + (1 + m_config.borderSize) * m_config.cs) / (CELLS_PER_TILE_SIDE * CELL_SIZE));
 		int z = int((pos.z - m_aabb.min.z + (1 + m_config.borderSize) * m_config.cs) / (CELLS_PER_TILE_SIDE * CELL_SIZE));
 		const dtMeshTile* tile = m_navmesh->getTileAt(x, z, 0);
-		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto render_scene = static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		if (!render_scene) return;
 
 		dtPolyRef base = m_navmesh->getPolyRefBase(tile);
@@ -913,7 +916,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 
 	void startGame() override
 	{
-		auto* scene = m_universe.getScene(crc32("lua_script"));
+		auto* scene = m_universe.getScene(LUA_SCRIPT_HASH);
 		m_script_scene = static_cast<LuaScriptScene*>(scene);
 		
 		if (m_navmesh && !m_crowd) initCrowd();
@@ -1197,7 +1200,7 @@ struct NavigationSceneImpl LUMIX_FINAL : public NavigationScene
 	void computeAABB()
 	{
 		m_aabb.set(Vec3(0, 0, 0), Vec3(0, 0, 0));
-		auto* render_scene = static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto* render_scene = static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		if (!render_scene) return;
 
 		for (auto model_instance = render_scene->getFirstModelInstance(); model_instance != INVALID_COMPONENT;
@@ -14,6 +14,7 @@
 #include "engine/resource_manager.h"
 #include "engine/resource_manager_base.h"
 #include "engine/serializer.h"
+#include "engine/sparse_set.h"
 #include "engine/universe/universe.h"
 #include "lua_script/lua_script_system.h"
 #include "physics/physics_geometry_manager.h"
@@ -45,7 +46,8 @@ static const ComponentType SPHERICAL_JOINT_TYPE = PropertyRegister::getComponent
 static const ComponentType D6_JOINT_TYPE = PropertyRegister::getComponentType("d6_joint");
 static const ResourceType TEXTURE_TYPE("texture");
 static const ResourceType PHYSICS_TYPE("physics");
-static const u32 RENDERER_HASH = crc32("renderer");
+static const u32 RENDERER_HASH = constCrc32("renderer");
+static const u32 LUA_SCRIPT_HASH = constCrc32("lua_script");
 
 
 struct RagdollBone
@@ -266,6 +268,8 @@ struct PhysicsSceneImpl LUMIX_FINAL : public PhysicsScene
 		, m_ragdolls(m_allocator)
 		, m_terrains(m_allocator)
 		, m_dynamic_actors(m_allocator)
+		, m_dynamic_entities(m_allocator)
+		, m_dynamic_transforms(m_allocator)
 		, m_universe(context)
 		, m_is_game_running(false)
 		, m_contact_callback(*this)
@@ -345,6 +349,7 @@ struct PhysicsSceneImpl LUMIX_FINAL : public PhysicsScene
 		}
 		m_actors.clear();
 		m_dynamic_actors.clear();
+		m_queued_forces.clear();
 
 		m_terrains.clear();
 	}
@@ -1513,7 +1518,7 @@ struct PhysicsSceneImpl LUMIX_FINAL : public PhysicsScene
 
 	void render() override
 	{
-		auto& render_scene = *static_cast<RenderScene*>(m_universe.getScene(crc32("renderer")));
+		auto& render_scene = *static_cast<RenderScene*>(m_universe.getScene(RENDERER_HASH));
 		const PxRenderBuffer& rb = m_scene->getRenderBuffer();
 		const PxU32 num_lines = Math::minimum(100000U, rb.getNbLines());
 		if (num_lines)
@@ -1543,12 +1548,15 @@ struct PhysicsSceneImpl LUMIX_FINAL : public PhysicsScene
 	void updateDynamicActors()
 	{
 		PROFILE_FUNCTION();
+		m_dynamic_entities.clear();
+		m_dynamic_transforms.clear();
 		for (auto* actor : m_dynamic_actors)
 		{
-			PxTransform trans = actor->physx_actor->getGlobalPose();
-			m_universe.setPosition(actor->entity, trans.p.x, trans.p.y, trans.p.z);
-			m_universe.setRotation(actor->entity, trans.q.x, trans.q.y, trans.q.z, trans.q.w);
+			m_dynamic_entities.push(actor->entity);
+			m_dynamic_transforms.push(fromPhysx(actor->physx_actor->getGlobalPose()));
 		}
+		if (m_dynamic_entities.empty()) return;
+		m_universe.setTransforms(&m_dynamic_entities[0], &m_dynamic_transforms[0], m_dynamic_entities.size());
 	}
 
 
@@ -2203,7 +2211,7 @@ struct PhysicsSceneImpl LUMIX_FINAL : public PhysicsScene
 
 	void startGame() override
 	{
-		auto* scene = m_universe.getScene(crc32("lua_script"));
+		auto* scene = m_universe.getScene(LUA_SCRIPT_HASH);
 		m_script_scene = static_cast<LuaScriptScene*>(scene);
 		m_is_game_running = true;
 
@@ -4311,13 +4319,15 @@ struct PhysicsSceneImpl LUMIX_FINAL : public PhysicsScene
 	PxControllerManager* m_controller_manager;
 	PxMaterial* m_default_material;
 
-	AssociativeArray<Entity, RigidActor*> m_actors;
-	AssociativeArray<Entity, Ragdoll> m_ragdolls;
-	AssociativeArray<Entity, Joint> m_joints;
-	AssociativeArray<Entity, Controller> m_controllers;
-	AssociativeArray<Entity, Heightfield> m_terrains;
+	SparseSet<Entity, RigidActor*> m_actors;
+	SparseSet<Entity, Ragdoll> m_ragdolls;
+	SparseSet<Entity, Joint> m_joints;
+	SparseSet<Entity, Controller> m_controllers;
+	SparseSet<Entity, Heightfield> m_terrains;
 
 	Array<RigidActor*> m_dynamic_actors;
+	Array<Entity> m_dynamic_entities;
+	Array<Transform> m_dynamic_transforms;
 	bool m_is_game_running;
 	bool m_is_updating_ragdoll;
 	u32 m_debug_visualization_flags;
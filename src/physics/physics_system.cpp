@@ -3,7 +3,7 @@
 #include <PxPhysicsAPI.h>
 
 #include "cooking/PxCooking.h"
-#include "engine/base_proxy_allocator.h"
+#include "engine/tag_allocator.h"
 #include "engine/log.h"
 #include "engine/resource_manager.h"
 #include "engine/engine.h"
@@ -435,7 +435,7 @@ namespace Lumix
 	struct PhysicsSystemImpl LUMIX_FINAL : public PhysicsSystem
 	{
 		explicit PhysicsSystemImpl(Engine& engine)
-			: m_allocator(engine.getAllocator())
+			: m_allocator(engine.getAllocator(), "physics")
 			, m_engine(engine)
 			, m_manager(*this, engine.getAllocator())
 		{
@@ -504,7 +504,7 @@ namespace Lumix
 		physx::PxCooking* m_cooking;
 		PhysicsGeometryManager m_manager;
 		Engine& m_engine;
-		BaseProxyAllocator m_allocator;
+		TagAllocator m_allocator;
 	};
 
 
@@ -2,13 +2,22 @@
 #include "engine/lumix.h"
 
 #include "engine/binary_array.h"
-#include "engine/free_list.h"
 #include "engine/geometry.h"
+#include "engine/math_utils.h"
 #include "engine/profiler.h"
 
-#include "engine/mtjd/group.h"
 #include "engine/mtjd/manager.h"
-#include "engine/mtjd/job.h"
+
+#ifdef _WIN32
+	#include <immintrin.h>
+	#include <intrin.h>
+	#define CULLING_AVX
+	#define CULLING_AVX_TARGET
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define CULLING_AVX
+	#define CULLING_AVX_TARGET __attribute__((target("avx")))
+#endif
 
 namespace Lumix
 {
@@ -17,125 +26,664 @@ typedef Array<int> ModelInstancetoSphereMap;
 typedef Array<ComponentHandle> SphereToModelInstanceMap;
 
 static const int MIN_ENTITIES_PER_THREAD = 50;
+// below this the flat arrays are culled directly, the hierarchy would not pay off
+static const int OCTREE_MIN_OBJECTS = 4096;
+static const int OCTREE_NODE_CAPACITY = 32;
+static const int OCTREE_MAX_DEPTH = 10;
+static const int OCTREE_JOB_DEPTH = 2;
+
+static const int PLANES_COUNT = (int)Frustum::Planes::COUNT;
+
+
+// spheres in SoA layout, so the culling kernels can load several spheres per register
+struct SphereArrays
+{
+	explicit SphereArrays(IAllocator& allocator)
+		: xs(allocator)
+		, ys(allocator)
+		, zs(allocator)
+		, radiuses(allocator)
+	{
+	}
+
+	int size() const { return xs.size(); }
+	bool empty() const { return xs.empty(); }
+	Sphere get(int index) const { return Sphere(xs[index], ys[index], zs[index], radiuses[index]); }
+
+	void set(int index, const Sphere& sphere)
+	{
+		xs[index] = sphere.position.x;
+		ys[index] = sphere.position.y;
+		zs[index] = sphere.position.z;
+		radiuses[index] = sphere.radius;
+	}
+
+	void push(const Sphere& sphere)
+	{
+		xs.push(sphere.position.x);
+		ys.push(sphere.position.y);
+		zs.push(sphere.position.z);
+		radiuses.push(sphere.radius);
+	}
 
-static void doCulling(int start_index,
-	const Sphere* LUMIX_RESTRICT start,
-	const Sphere* LUMIX_RESTRICT end,
-	const Frustum* LUMIX_RESTRICT frustum,
-	const u64* LUMIX_RESTRICT layer_masks,
-	const ComponentHandle* LUMIX_RESTRICT sphere_to_model_instance_map,
-	u64 layer_mask,
+	void pop()
+	{
+		xs.pop();
+		ys.pop();
+		zs.pop();
+		radiuses.pop();
+	}
+
+	void reserve(int capacity)
+	{
+		xs.reserve(capacity);
+		ys.reserve(capacity);
+		zs.reserve(capacity);
+		radiuses.reserve(capacity);
+	}
+
+	void clear()
+	{
+		xs.clear();
+		ys.clear();
+		zs.clear();
+		radiuses.clear();
+	}
+
+	Array<float> xs;
+	Array<float> ys;
+	Array<float> zs;
+	Array<float> radiuses;
+};
+
+
+struct CullingContext
+{
+	const Frustum* frustum;
+	const float* xs;
+	const float* ys;
+	const float* zs;
+	const float* radiuses;
+	// maps kernel indices to sphere indices when culling copies of the spheres, null otherwise
+	const int* indices;
+	const u64* layer_masks;
+	const ComponentHandle* sphere_to_model_instance_map;
+	u64 layer_mask;
+};
+
+
+static LUMIX_FORCE_INLINE u32 countTrailingZeros(u32 value)
+{
+#ifdef _WIN32
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return index;
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
+
+// visible has one bit per sphere starting at base
+static LUMIX_FORCE_INLINE void pushVisible(u32 visible,
+	int base,
+	const CullingContext& ctx,
 	CullingSystem::Subresults& results)
 {
-	PROFILE_FUNCTION();
-	int i = start_index;
-	ASSERT(results.empty());
-	PROFILE_INT("objects", int(end - start));
-	float4 px = f4Load(frustum->xs);
-	float4 py = f4Load(frustum->ys);
-	float4 pz = f4Load(frustum->zs);
-	float4 pd = f4Load(frustum->ds);
-	float4 px2 = f4Load(&frustum->xs[4]);
-	float4 py2 = f4Load(&frustum->ys[4]);
-	float4 pz2 = f4Load(&frustum->zs[4]);
-	float4 pd2 = f4Load(&frustum->ds[4]);
-	
-	for (const Sphere *sphere = start; sphere <= end; sphere++, ++i)
-	{
-		float4 cx = f4Splat(sphere->position.x);
-		float4 cy = f4Splat(sphere->position.y);
-		float4 cz = f4Splat(sphere->position.z);
-		float4 r = f4Splat(-sphere->radius);
-
-		float4 t = f4Mul(cx, px);
-		t = f4Add(t, f4Mul(cy, py));
-		t = f4Add(t, f4Mul(cz, pz));
-		t = f4Add(t, pd);
-		t = f4Sub(t, r);
-		if (f4MoveMask(t)) continue;
+	for (; visible; visible &= visible - 1)
+	{
+		int idx = base + countTrailingZeros(visible);
+		if (ctx.indices) idx = ctx.indices[idx];
+		if (ctx.layer_masks[idx] & ctx.layer_mask) results.push(ctx.sphere_to_model_instance_map[idx]);
+	}
+}
+
+
+static void cullTail(const CullingContext& ctx, int start, int end, CullingSystem::Subresults& results)
+{
+	for (int i = start; i < end; ++i)
+	{
+		if (!ctx.frustum->isSphereInside(Vec3(ctx.xs[i], ctx.ys[i], ctx.zs[i]), ctx.radiuses[i])) continue;
+		int idx = ctx.indices ? ctx.indices[i] : i;
+		if (ctx.layer_masks[idx] & ctx.layer_mask) results.push(ctx.sphere_to_model_instance_map[idx]);
+	}
+}
+
 
-		t = f4Mul(cx, px2);
-		t = f4Add(t, f4Mul(cy, py2));
-		t = f4Add(t, f4Mul(cz, pz2));
-		t = f4Add(t, pd2);
+// returns 4 bits, set for spheres behind any of the planes
+static LUMIX_FORCE_INLINE int cullGroup4(const CullingContext& ctx,
+	int i,
+	const float4* px,
+	const float4* py,
+	const float4* pz,
+	const float4* pd)
+{
+	float4 cx = f4LoadUnaligned(ctx.xs + i);
+	float4 cy = f4LoadUnaligned(ctx.ys + i);
+	float4 cz = f4LoadUnaligned(ctx.zs + i);
+	float4 r = f4Sub(f4Splat(0), f4LoadUnaligned(ctx.radiuses + i));
+
+	int culled = 0;
+	for (int p = 0; p < PLANES_COUNT; ++p)
+	{
+		float4 t = f4Mul(cx, px[p]);
+		t = f4Add(t, f4Mul(cy, py[p]));
+		t = f4Add(t, f4Mul(cz, pz[p]));
+		t = f4Add(t, pd[p]);
 		t = f4Sub(t, r);
-		if (f4MoveMask(t)) continue;
+		culled |= f4MoveMask(t);
+	}
+	return culled;
+}
 
-		if(layer_masks[i] & layer_mask) results.push(sphere_to_model_instance_map[i]);
+
+// culls spheres [start, end), 8 spheres per iteration as two groups of 4
+static void doCulling(const CullingContext& ctx, int start, int end, CullingSystem::Subresults& results)
+{
+	const Frustum& frustum = *ctx.frustum;
+	float4 px[PLANES_COUNT];
+	float4 py[PLANES_COUNT];
+	float4 pz[PLANES_COUNT];
+	float4 pd[PLANES_COUNT];
+	for (int p = 0; p < PLANES_COUNT; ++p)
+	{
+		px[p] = f4Splat(frustum.xs[p]);
+		py[p] = f4Splat(frustum.ys[p]);
+		pz[p] = f4Splat(frustum.zs[p]);
+		pd[p] = f4Splat(frustum.ds[p]);
 	}
+
+	int i = start;
+	for (; i + 8 <= end; i += 8)
+	{
+		int culled = cullGroup4(ctx, i, px, py, pz, pd) | (cullGroup4(ctx, i + 4, px, py, pz, pd) << 4);
+		pushVisible(~culled & 0xff, i, ctx, results);
+	}
+	cullTail(ctx, i, end, results);
 }
 
-class CullingJob LUMIX_FINAL : public MTJD::Job
+
+#ifdef CULLING_AVX
+
+
+static bool hasAVX()
+{
+#ifdef _WIN32
+	int info[4];
+	__cpuid(info, 1);
+	bool has_avx = (info[2] & (1 << 28)) != 0;
+	bool has_xsave = (info[2] & (1 << 27)) != 0;
+	return has_avx && has_xsave && (_xgetbv(0) & 6) == 6;
+#else
+	return __builtin_cpu_supports("avx");
+#endif
+}
+
+
+static const bool s_has_avx = hasAVX();
+
+
+// same as doCulling, but 8 spheres in one register
+CULLING_AVX_TARGET static void doCullingAVX(const CullingContext& ctx,
+	int start,
+	int end,
+	CullingSystem::Subresults& results)
+{
+	const Frustum& frustum = *ctx.frustum;
+	__m256 px[PLANES_COUNT];
+	__m256 py[PLANES_COUNT];
+	__m256 pz[PLANES_COUNT];
+	__m256 pd[PLANES_COUNT];
+	for (int p = 0; p < PLANES_COUNT; ++p)
+	{
+		px[p] = _mm256_set1_ps(frustum.xs[p]);
+		py[p] = _mm256_set1_ps(frustum.ys[p]);
+		pz[p] = _mm256_set1_ps(frustum.zs[p]);
+		pd[p] = _mm256_set1_ps(frustum.ds[p]);
+	}
+	__m256 sign_mask = _mm256_set1_ps(-0.0f);
+
+	int i = start;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(ctx.xs + i);
+		__m256 cy = _mm256_loadu_ps(ctx.ys + i);
+		__m256 cz = _mm256_loadu_ps(ctx.zs + i);
+		__m256 r = _mm256_xor_ps(_mm256_loadu_ps(ctx.radiuses + i), sign_mask);
+
+		// sign bits of all planes are or-ed, a set bit means the sphere is behind some plane
+		__m256 culled = _mm256_setzero_ps();
+		for (int p = 0; p < PLANES_COUNT; ++p)
+		{
+			__m256 t = _mm256_mul_ps(cx, px[p]);
+			t = _mm256_add_ps(t, _mm256_mul_ps(cy, py[p]));
+			t = _mm256_add_ps(t, _mm256_mul_ps(cz, pz[p]));
+			t = _mm256_add_ps(t, pd[p]);
+			t = _mm256_sub_ps(t, r);
+			culled = _mm256_or_ps(culled, t);
+		}
+		pushVisible(~_mm256_movemask_ps(culled) & 0xff, i, ctx, results);
+	}
+	cullTail(ctx, i, end, results);
+}
+
+
+#endif
+
+
+static void cullRange(const CullingContext& ctx, int start, int end, CullingSystem::Subresults& results)
+{
+	#ifdef CULLING_AVX
+		if (s_has_avx)
+		{
+			doCullingAVX(ctx, start, end, results);
+			return;
+		}
+	#endif
+	doCulling(ctx, start, end, results);
+}
+
+
+// Loose octree node. A sphere is stored in the deepest node whose cell contains its center
+// and whose half size is at least its radius, so the node's bounds are its cell scaled by two.
+struct OctreeNode
+{
+	OctreeNode(IAllocator& allocator, OctreeNode* _parent, const Vec3& _center, float _half_size)
+		: objects(allocator)
+		, spheres(allocator)
+		, parent(_parent)
+		, center(_center)
+		, half_size(_half_size)
+		, subtree_count(0)
+		, depth(_parent ? _parent->depth + 1 : 0)
+		, is_split(false)
+	{
+		for (OctreeNode*& child : children) child = nullptr;
+	}
+
+	Array<int> objects;
+	// copies of the objects' spheres, so partially visible nodes can use the SoA kernels
+	SphereArrays spheres;
+	OctreeNode* parent;
+	OctreeNode* children[8];
+	Vec3 center;
+	float half_size;
+	int subtree_count;
+	int depth;
+	bool is_split;
+};
+
+
+enum class Containment
+{
+	OUTSIDE,
+	INTERSECT,
+	INSIDE
+};
+
+
+static Containment classify(const Frustum& frustum, const Vec3& center, float extent)
+{
+	Containment ret = Containment::INSIDE;
+	for (int i = 0; i < (int)Frustum::Planes::COUNT; ++i)
+	{
+		float distance = frustum.xs[i] * center.x + frustum.ys[i] * center.y + frustum.zs[i] * center.z + frustum.ds[i];
+		float radius = extent * (Math::abs(frustum.xs[i]) + Math::abs(frustum.ys[i]) + Math::abs(frustum.zs[i]));
+		if (distance < -radius) return Containment::OUTSIDE;
+		if (distance < radius) ret = Containment::INTERSECT;
+	}
+	return ret;
+}
+
+
+static void acceptSubtree(const OctreeNode& node, const CullingContext& ctx, CullingSystem::Subresults& results)
+{
+	for (int idx : node.objects)
+	{
+		if (ctx.layer_masks[idx] & ctx.layer_mask) results.push(ctx.sphere_to_model_instance_map[idx]);
+	}
+	for (const OctreeNode* child : node.children)
+	{
+		if (child && child->subtree_count > 0) acceptSubtree(*child, ctx, results);
+	}
+}
+
+
+static void cullNode(const OctreeNode& node, const CullingContext& ctx, bool recurse, CullingSystem::Subresults& results)
+{
+	if (node.subtree_count == 0) return;
+
+	// root holds also the spheres outside of its cell, so it has no bounds
+	Containment containment =
+		node.parent ? classify(*ctx.frustum, node.center, node.half_size * 2) : Containment::INTERSECT;
+	if (containment == Containment::OUTSIDE) return;
+	if (containment == Containment::INSIDE && recurse)
+	{
+		acceptSubtree(node, ctx, results);
+		return;
+	}
+
+	if (containment == Containment::INSIDE)
+	{
+		for (int idx : node.objects)
+		{
+			if (ctx.layer_masks[idx] & ctx.layer_mask) results.push(ctx.sphere_to_model_instance_map[idx]);
+		}
+	}
+	else if (!node.objects.empty())
+	{
+		CullingContext node_ctx = ctx;
+		node_ctx.xs = &node.spheres.xs[0];
+		node_ctx.ys = &node.spheres.ys[0];
+		node_ctx.zs = &node.spheres.zs[0];
+		node_ctx.radiuses = &node.spheres.radiuses[0];
+		node_ctx.indices = &node.objects[0];
+		cullRange(node_ctx, 0, node.objects.size(), results);
+	}
+
+	if (!recurse) return;
+	for (const OctreeNode* child : node.children)
+	{
+		if (child) cullNode(*child, ctx, true, results);
+	}
+}
+
+
+// Secondary index over the sphere arrays of CullingSystemImpl, nodes store indices into those arrays.
+class LooseOctree
 {
 public:
-	CullingJob(const CullingSystem::InputSpheres& spheres,
-		const LayerMasks& layer_masks,
-		const SphereToModelInstanceMap& sphere_to_model_instance_map,
-		u64 layer_mask,
-		CullingSystem::Subresults& results,
-		int start,
-		int end,
-		const Frustum& frustum,
-		MTJD::Manager& manager,
-		IAllocator& allocator,
-		IAllocator& job_allocator)
-		: Job(Job::AUTO_DESTROY, MTJD::Priority::Default, manager, allocator, job_allocator)
-		, m_spheres(spheres)
-		, m_results(results)
-		, m_start(start)
-		, m_end(end)
-		, m_frustum(frustum)
-		, m_layer_masks(layer_masks)
-		, m_layer_mask(layer_mask)
-		, m_sphere_to_model_instance_map(sphere_to_model_instance_map)
-	{
-		setJobName("CullingJob");
-		m_results.reserve(end - start);
-		ASSERT(m_results.empty());
-		m_is_executed = false;
-	}
-
-	~CullingJob() {}
-
-	void execute() override
-	{
-		ASSERT(m_results.empty() && !m_is_executed);
-		doCulling(m_start,
-			&m_spheres[m_start],
-			&m_spheres[m_end],
-			&m_frustum,
-			&m_layer_masks[0],
-			&m_sphere_to_model_instance_map[0],
-			m_layer_mask,
-			m_results);
-		m_is_executed = true;
+	struct JobNode
+	{
+		const OctreeNode* node;
+		bool recurse;
+	};
+
+
+	explicit LooseOctree(IAllocator& allocator)
+		: m_allocator(allocator)
+		, m_root(nullptr)
+		, m_locations(allocator)
+	{
+	}
+
+
+	~LooseOctree() { clear(); }
+
+
+	bool isBuilt() const { return m_root != nullptr; }
+	const OctreeNode* getRoot() const { return m_root; }
+
+
+	void clear()
+	{
+		if (m_root) destroyNode(m_root);
+		m_root = nullptr;
+		m_locations.clear();
+	}
+
+
+	void build(const SphereArrays& spheres)
+	{
+		PROFILE_FUNCTION();
+		clear();
+		int count = spheres.size();
+		if (count == 0) return;
+
+		Vec3 min(spheres.xs[0], spheres.ys[0], spheres.zs[0]);
+		Vec3 max = min;
+		for (int i = 1; i < count; ++i)
+		{
+			Vec3 pos(spheres.xs[i], spheres.ys[i], spheres.zs[i]);
+			min.set(Math::minimum(min.x, pos.x), Math::minimum(min.y, pos.y), Math::minimum(min.z, pos.z));
+			max.set(Math::maximum(max.x, pos.x), Math::maximum(max.y, pos.y), Math::maximum(max.z, pos.z));
+		}
+		Vec3 size = max - min;
+		float half_size = Math::maximum(1.0f, Math::maximum(size.x, size.y, size.z) * 0.5f);
+		m_root = LUMIX_NEW(m_allocator, OctreeNode)(m_allocator, nullptr, (min + max) * 0.5f, half_size);
+
+		m_locations.resize(count);
+		for (int i = 0; i < count; ++i)
+		{
+			insert(m_root, spheres, i);
+		}
+	}
+
+
+	// sphere at index was pushed to the end of the arrays
+	void add(const SphereArrays& spheres, int index)
+	{
+		ASSERT(index == m_locations.size());
+		m_locations.emplace();
+		insert(m_root, spheres, index);
+	}
+
+
+	// sphere at index is removed and the last sphere is moved in its place
+	void removeSwap(int index)
+	{
+		removeFromNode(index);
+		int last = m_locations.size() - 1;
+		if (index != last)
+		{
+			Location loc = m_locations[last];
+			loc.node->objects[loc.slot] = index;
+			m_locations[index] = loc;
+		}
+		m_locations.pop();
+	}
+
+
+	void update(const SphereArrays& spheres, int index)
+	{
+		Sphere sphere = spheres.get(index);
+		Location loc = m_locations[index];
+		OctreeNode* node = loc.node;
+		bool stays = node == m_root ? !(m_root->is_split && fitsChild(*m_root, sphere)) : fitsCell(*node, sphere);
+		if (stays)
+		{
+			node->spheres.set(loc.slot, sphere);
+			return;
+		}
+
+		removeFromNode(index);
+		insert(m_root, spheres, index);
+	}
+
+
+	// a rebuild is needed when too many spheres left the root cell and ended up untested in the root
+	bool needsRebuild() const
+	{
+		int root_count = m_root->objects.size();
+		return root_count > OCTREE_NODE_CAPACITY && root_count > m_locations.size() / 4;
+	}
+
+
+	void getJobNodes(Array<JobNode>& nodes) const
+	{
+		nodes.clear();
+		if (m_root) getJobNodes(*m_root, nodes);
 	}
 
+
 private:
-	const CullingSystem::InputSpheres& m_spheres;
-	CullingSystem::Subresults& m_results;
-	const LayerMasks& m_layer_masks;
-	const SphereToModelInstanceMap& m_sphere_to_model_instance_map;
-	u64 m_layer_mask;
-	int m_start;
-	int m_end;
-	const Frustum& m_frustum;
-	bool m_is_executed;
+	struct Location
+	{
+		OctreeNode* node;
+		int slot;
+	};
+
+
+	void getJobNodes(const OctreeNode& node, Array<JobNode>& nodes) const
+	{
+		if (node.subtree_count == 0) return;
+		if (node.depth == OCTREE_JOB_DEPTH || !node.is_split)
+		{
+			nodes.push({&node, true});
+			return;
+		}
+		if (!node.objects.empty()) nodes.push({&node, false});
+		for (const OctreeNode* child : node.children)
+		{
+			if (child) getJobNodes(*child, nodes);
+		}
+	}
+
+
+	static bool fitsCell(const OctreeNode& node, const Sphere& sphere)
+	{
+		Vec3 d = sphere.position - node.center;
+		return sphere.radius <= node.half_size && Math::abs(d.x) <= node.half_size &&
+			   Math::abs(d.y) <= node.half_size && Math::abs(d.z) <= node.half_size;
+	}
+
+
+	bool fitsChild(const OctreeNode& node, const Sphere& sphere) const
+	{
+		if (sphere.radius > node.half_size * 0.5f) return false;
+		return &node != m_root || fitsCell(node, sphere);
+	}
+
+
+	OctreeNode* getChild(OctreeNode* node, const Vec3& pos)
+	{
+		int octant = (pos.x > node->center.x ? 1 : 0) | (pos.y > node->center.y ? 2 : 0) |
+					 (pos.z > node->center.z ? 4 : 0);
+		OctreeNode*& child = node->children[octant];
+		if (!child)
+		{
+			float half_size = node->half_size * 0.5f;
+			Vec3 center(node->center.x + ((octant & 1) ? half_size : -half_size),
+				node->center.y + ((octant & 2) ? half_size : -half_size),
+				node->center.z + ((octant & 4) ? half_size : -half_size));
+			child = LUMIX_NEW(m_allocator, OctreeNode)(m_allocator, node, center, half_size);
+		}
+		return child;
+	}
+
+
+	void insert(OctreeNode* node, const SphereArrays& spheres, int index)
+	{
+		Sphere sphere = spheres.get(index);
+		while (node->is_split && fitsChild(*node, sphere))
+		{
+			node = getChild(node, sphere.position);
+		}
+
+		m_locations[index] = {node, node->objects.size()};
+		node->objects.push(index);
+		node->spheres.push(sphere);
+		for (OctreeNode* n = node; n; n = n->parent) ++n->subtree_count;
+
+		if (!node->is_split && node->objects.size() > OCTREE_NODE_CAPACITY && node->depth < OCTREE_MAX_DEPTH)
+		{
+			split(node, spheres);
+		}
+	}
+
+
+	void split(OctreeNode* node, const SphereArrays& spheres)
+	{
+		node->is_split = true;
+		// backwards, so objects swapped into the hole by removeFromNode are already processed
+		for (int i = node->objects.size() - 1; i >= 0; --i)
+		{
+			int index = node->objects[i];
+			if (!fitsChild(*node, spheres.get(index))) continue;
+
+			removeFromNode(index);
+			insert(node, spheres, index);
+		}
+	}
+
+
+	void removeFromNode(int index)
+	{
+		Location loc = m_locations[index];
+		int last = loc.node->objects.back();
+		loc.node->objects[loc.slot] = last;
+		loc.node->spheres.set(loc.slot, loc.node->spheres.get(loc.node->objects.size() - 1));
+		m_locations[last].slot = loc.slot;
+		loc.node->objects.pop();
+		loc.node->spheres.pop();
+		for (OctreeNode* n = loc.node; n; n = n->parent) --n->subtree_count;
+	}
+
+
+	void destroyNode(OctreeNode* node)
+	{
+		for (OctreeNode* child : node->children)
+		{
+			if (child) destroyNode(child);
+		}
+		LUMIX_DELETE(m_allocator, node);
+	}
+
+
+	IAllocator& m_allocator;
+	OctreeNode* m_root;
+	Array<Location> m_locations;
+};
+
+
+struct OctreeCullingJobData
+{
+	CullingContext ctx;
+	const LooseOctree::JobNode* nodes;
+	int nodes_count;
+	int first;
+	int step;
+	CullingSystem::Subresults* results;
 };
 
+
+static void octreeCullingJob(void* data)
+{
+	PROFILE_FUNCTION();
+	OctreeCullingJobData* job = (OctreeCullingJobData*)data;
+	for (int i = job->first; i < job->nodes_count; i += job->step)
+	{
+		const LooseOctree::JobNode& node = job->nodes[i];
+		cullNode(*node.node, job->ctx, node.recurse, *job->results);
+	}
+}
+
+
+struct CullingJobData
+{
+	CullingContext ctx;
+	int start;
+	int end;
+	CullingSystem::Subresults* results;
+};
+
+static void cullingJob(void* data)
+{
+	PROFILE_FUNCTION();
+	CullingJobData* job = (CullingJobData*)data;
+	PROFILE_INT("objects", job->end - job->start);
+	cullRange(job->ctx, job->start, job->end, *job->results);
+}
+
 class CullingSystemImpl LUMIX_FINAL : public CullingSystem
 {
 public:
 	CullingSystemImpl(MTJD::Manager& mtjd_manager, IAllocator& allocator)
 		: m_allocator(allocator)
-		, m_job_allocator(allocator)
 		, m_spheres(allocator)
 		, m_result(allocator)
-		, m_sync_point(true, allocator)
-		, m_mtjd_manager(mtjd_manager)
 		, m_layer_masks(m_allocator)
-		, m_sphere_to_model_instance_map(m_allocator)
 		, m_model_instance_to_sphere_map(m_allocator)
+		, m_sphere_to_model_instance_map(m_allocator)
+		, m_octree(m_allocator)
+		, m_is_octree_enabled(true)
+		, m_mtjd_manager(mtjd_manager)
+		, m_jobs(allocator)
+		, m_octree_jobs(allocator)
+		, m_octree_job_nodes(allocator)
+		, m_job_decls(allocator)
+		, m_job_counter(0)
+		, m_is_async_result(false)
 	{
 		m_result.emplace(m_allocator);
 		m_model_instance_to_sphere_map.reserve(5000);
@@ -146,6 +694,9 @@ public:
 		{
 			m_result.emplace(m_allocator);
 		}
+		m_jobs.resize(m_result.size());
+		m_octree_jobs.resize(m_result.size());
+		m_job_decls.resize(m_result.size());
 	}
 
 
@@ -155,6 +706,7 @@ public:
 		m_layer_masks.clear();
 		m_model_instance_to_sphere_map.clear();
 		m_sphere_to_model_instance_map.clear();
+		m_octree.clear();
 	}
 
 
@@ -165,28 +717,58 @@ public:
 	{
 		if (m_is_async_result)
 		{
-			m_sync_point.sync();
+			m_mtjd_manager.wait(&m_job_counter);
+			m_is_async_result = false;
 		}
 		return m_result;
 	}
 
 
+	// builds the octree once the flat arrays get big and drops it when they shrink
+	bool prepareOctree()
+	{
+		if (!m_is_octree_enabled || m_spheres.size() < OCTREE_MIN_OBJECTS)
+		{
+			if (m_octree.isBuilt()) m_octree.clear();
+			return false;
+		}
+		if (!m_octree.isBuilt() || m_octree.needsRebuild()) m_octree.build(m_spheres);
+		return true;
+	}
+
+
+	CullingContext getContext(const Frustum& frustum, u64 layer_mask) const
+	{
+		CullingContext ctx;
+		ctx.frustum = &frustum;
+		ctx.xs = &m_spheres.xs[0];
+		ctx.ys = &m_spheres.ys[0];
+		ctx.zs = &m_spheres.zs[0];
+		ctx.radiuses = &m_spheres.radiuses[0];
+		ctx.indices = nullptr;
+		ctx.layer_masks = &m_layer_masks[0];
+		ctx.sphere_to_model_instance_map = &m_sphere_to_model_instance_map[0];
+		ctx.layer_mask = layer_mask;
+		return ctx;
+	}
+
+
 	void cullToFrustum(const Frustum& frustum, u64 layer_mask) override
 	{
 		for (int i = 0; i < m_result.size(); ++i)
 		{
 			m_result[i].clear();
 		}
-		if (!m_spheres.empty())
+		if (prepareOctree())
 		{
-			doCulling(0,
-				&m_spheres[0],
-				&m_spheres.back(),
-				&frustum,
-				&m_layer_masks[0],
-				&m_sphere_to_model_instance_map[0],
-				layer_mask,
-				m_result[0]);
+			PROFILE_BLOCK("octree culling");
+			cullNode(*m_octree.getRoot(), getContext(frustum, layer_mask), true, m_result[0]);
+		}
+		else if (!m_spheres.empty())
+		{
+			PROFILE_BLOCK("flat culling");
+			PROFILE_INT("objects", m_spheres.size());
+			cullRange(getContext(frustum, layer_mask), 0, m_spheres.size(), m_result[0]);
 		}
 		m_is_async_result = false;
 	}
@@ -213,48 +795,44 @@ public:
 		}
 		m_is_async_result = true;
 
-		int cpu_count = m_mtjd_manager.getCpuThreadsCount();
-		int step = count / cpu_count;
-		int i = 0;
-		CullingJob* jobs[16];
-		ASSERT(lengthOf(jobs) >= cpu_count);
-		for (; i < cpu_count - 1; i++)
+		if (prepareOctree())
 		{
-			m_result[i].clear();
-			CullingJob* cj = LUMIX_NEW(m_job_allocator, CullingJob)(m_spheres,
-				m_layer_masks,
-				m_sphere_to_model_instance_map,
-				layer_mask,
-				m_result[i],
-				i * step,
-				(i + 1) * step - 1,
-				frustum,
-				m_mtjd_manager,
-				m_allocator,
-				m_job_allocator);
-			cj->addDependency(&m_sync_point);
-			jobs[i] = cj;
+			m_octree.getJobNodes(m_octree_job_nodes);
+			int jobs_count = Math::minimum(m_octree_jobs.size(), m_octree_job_nodes.size());
+			for (int i = 0; i < jobs_count; ++i)
+			{
+				OctreeCullingJobData& job = m_octree_jobs[i];
+				job.ctx = getContext(frustum, layer_mask);
+				job.nodes = &m_octree_job_nodes[0];
+				job.nodes_count = m_octree_job_nodes.size();
+				job.first = i;
+				job.step = jobs_count;
+				job.results = &m_result[i];
+
+				m_job_decls[i].task = &octreeCullingJob;
+				m_job_decls[i].data = &job;
+			}
+			m_mtjd_manager.runJobs(&m_job_decls[0], jobs_count, &m_job_counter);
+			return;
 		}
 
-		m_result[i].clear();
-		CullingJob* cj = LUMIX_NEW(m_job_allocator, CullingJob)(m_spheres,
-			m_layer_masks,
-			m_sphere_to_model_instance_map,
-			layer_mask,
-			m_result[i],
-			i * step,
-			count - 1,
-			frustum,
-			m_mtjd_manager,
-			m_allocator,
-			m_job_allocator);
-		cj->addDependency(&m_sync_point);
-		jobs[i] = cj;
-
-		for (i = 0; i < cpu_count; ++i)
+		int cpu_count = m_jobs.size();
+		// multiple of 8, so only the last job has a tail which the kernels process one by one
+		int step = (count / cpu_count + 7) & ~7;
+		for (int i = 0; i < cpu_count; i++)
 		{
-			m_mtjd_manager.schedule(jobs[i]);
+			CullingJobData& job = m_jobs[i];
+			job.ctx = getContext(frustum, layer_mask);
+			job.results = &m_result[i];
+			job.start = Math::minimum(i * step, count);
+			job.end = i < cpu_count - 1 ? Math::minimum((i + 1) * step, count) : count;
+			m_result[i].reserve(job.end - job.start);
+
+			m_job_decls[i].task = &cullingJob;
+			m_job_decls[i].data = &job;
 		}
+
+		m_mtjd_manager.runJobs(&m_job_decls[0], cpu_count, &m_job_counter);
 	}
 
 
@@ -293,6 +871,7 @@ public:
 		}
 		m_model_instance_to_sphere_map[model_instance.index] = m_spheres.size() - 1;
 		m_layer_masks.push(layer_mask);
+		if (m_octree.isBuilt()) m_octree.add(m_spheres, m_spheres.size() - 1);
 	}
 
 
@@ -302,8 +881,9 @@ public:
 		if (index < 0) return;
 		ASSERT(index < m_spheres.size());
 
+		if (m_octree.isBuilt()) m_octree.removeSwap(index);
 		m_model_instance_to_sphere_map[m_sphere_to_model_instance_map.back().index] = index;
-		m_spheres[index] = m_spheres.back();
+		m_spheres.set(index, m_spheres.get(m_spheres.size() - 1));
 		m_sphere_to_model_instance_map[index] = m_sphere_to_model_instance_map.back();
 		m_layer_masks[index] = m_layer_masks.back();
 
@@ -317,7 +897,10 @@ public:
 	void updateBoundingSphere(const Sphere& sphere, ComponentHandle model_instance) override
 	{
 		int idx = m_model_instance_to_sphere_map[model_instance.index];
-		if (idx >= 0) m_spheres[idx] = sphere;
+		if (idx < 0) return;
+
+		m_spheres.set(idx, sphere);
+		if (m_octree.isBuilt()) m_octree.update(m_spheres, idx);
 	}
 
 
@@ -333,27 +916,40 @@ public:
 			m_model_instance_to_sphere_map[model_instances[i].index] = m_spheres.size() - 1;
 			m_sphere_to_model_instance_map.push(model_instances[i]);
 			m_layer_masks.push(1);
+			if (m_octree.isBuilt()) m_octree.add(m_spheres, m_spheres.size() - 1);
 		}
 	}
 
 
-	const Sphere& getSphere(ComponentHandle model_instance) override
+	Sphere getSphere(ComponentHandle model_instance) override
+	{
+		return m_spheres.get(m_model_instance_to_sphere_map[model_instance.index]);
+	}
+
+
+	void enableOctree(bool enable) override
 	{
-		return m_spheres[m_model_instance_to_sphere_map[model_instance.index]];
+		m_is_octree_enabled = enable;
+		if (!enable) m_octree.clear();
 	}
 
 
 private:
 	IAllocator& m_allocator;
-	FreeList<CullingJob, 16> m_job_allocator;
-	InputSpheres m_spheres;
+	SphereArrays m_spheres;
 	Results m_result;
 	LayerMasks m_layer_masks;
 	ModelInstancetoSphereMap m_model_instance_to_sphere_map;
 	SphereToModelInstanceMap m_sphere_to_model_instance_map;
+	LooseOctree m_octree;
+	bool m_is_octree_enabled;
 
 	MTJD::Manager& m_mtjd_manager;
-	MTJD::Group m_sync_point;
+	Array<CullingJobData> m_jobs;
+	Array<OctreeCullingJobData> m_octree_jobs;
+	Array<LooseOctree::JobNode> m_octree_job_nodes;
+	Array<MTJD::JobDecl> m_job_decls;
+	volatile i32 m_job_counter;
 	bool m_is_async_result;
 };
 
@@ -47,6 +47,9 @@ namespace Lumix
 		virtual void updateBoundingSphere(const Sphere& sphere, ComponentHandle model_instance) = 0;
 
 		virtual void insert(const InputSpheres& spheres, const Array<ComponentHandle>& model_instances) = 0;
-		virtual const Sphere& getSphere(ComponentHandle model_instance) = 0;
+		virtual Sphere getSphere(ComponentHandle model_instance) = 0;
+
+		// big scenes are culled through a loose octree, disabled it culls the flat arrays only
+		virtual void enableOctree(bool enable) = 0;
 	};
 } // ~namespace Lux
\ No newline at end of file
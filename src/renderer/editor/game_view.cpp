@@ -219,6 +219,7 @@ void GameView::onStatsGUI(const ImVec2& view_pos)
 		const auto& stats = m_pipeline->getStats();
 		ImGui::LabelText("Draw calls", "%d", stats.draw_call_count);
 		ImGui::LabelText("Instances", "%d", stats.instance_count);
+		ImGui::LabelText("Draw calls saved", "%d", stats.draw_calls_saved);
 		char buf[30];
 		Lumix::toCStringPretty(stats.triangle_count, buf, Lumix::lengthOf(buf));
 		ImGui::LabelText("Triangles", "%s", buf);
@@ -0,0 +1,246 @@
+#include "light_grid.h"
+#include "engine/geometry.h"
+#include "engine/math_utils.h"
+#include <cmath>
+
+
+namespace Lumix
+{
+
+
+static u64 getCellKey(int x, int y, int z)
+{
+	return ((u64)(x & 0x1fffff) << 42) | ((u64)(y & 0x1fffff) << 21) | (u64)(z & 0x1fffff);
+}
+
+
+static bool intersects(const Vec3& min_a, const Vec3& max_a, const Vec3& min_b, const Vec3& max_b)
+{
+	return min_a.x <= max_b.x && max_a.x >= min_b.x && min_a.y <= max_b.y && max_a.y >= min_b.y &&
+		   min_a.z <= max_b.z && max_a.z >= min_b.z;
+}
+
+
+LightGrid::LightGrid(IAllocator& allocator, float cell_size)
+	: m_allocator(allocator)
+	, m_cell_size(cell_size)
+	, m_query_stamp(0)
+	, m_lights(allocator)
+	, m_light_map(allocator)
+	, m_big_lights(allocator)
+	, m_cell_map(allocator)
+	, m_cells(allocator)
+	, m_free_cells(allocator)
+{
+}
+
+
+void LightGrid::clear()
+{
+	m_lights.clear();
+	m_light_map.clear();
+	m_big_lights.clear();
+	m_cell_map.clear();
+	m_cells.clear();
+	m_free_cells.clear();
+}
+
+
+void LightGrid::toCell(const Vec3& pos, int* cell) const
+{
+	// keys have 21 bits per axis
+	static const float MAX_CELL = (float)(1 << 20) - 1;
+	cell[0] = (int)Math::clamp(floorf(pos.x / m_cell_size), -MAX_CELL, MAX_CELL);
+	cell[1] = (int)Math::clamp(floorf(pos.y / m_cell_size), -MAX_CELL, MAX_CELL);
+	cell[2] = (int)Math::clamp(floorf(pos.z / m_cell_size), -MAX_CELL, MAX_CELL);
+}
+
+
+int LightGrid::getCellCount(const int* cell_min, const int* cell_max) const
+{
+	i64 count = (i64)(cell_max[0] - cell_min[0] + 1) * (cell_max[1] - cell_min[1] + 1) *
+				(cell_max[2] - cell_min[2] + 1);
+	return count > MAX_CELLS_PER_LIGHT ? MAX_CELLS_PER_LIGHT + 1 : (int)count;
+}
+
+
+void LightGrid::link(int light_index)
+{
+	Light& light = m_lights[light_index];
+	if (light.is_big)
+	{
+		m_big_lights.push(light_index);
+		return;
+	}
+
+	for (int z = light.cell_min[2]; z <= light.cell_max[2]; ++z)
+	{
+		for (int y = light.cell_min[1]; y <= light.cell_max[1]; ++y)
+		{
+			for (int x = light.cell_min[0]; x <= light.cell_max[0]; ++x)
+			{
+				u64 key = getCellKey(x, y, z);
+				auto iter = m_cell_map.find(key);
+				int cell_index;
+				if (iter.isValid())
+				{
+					cell_index = iter.value();
+				}
+				else if (!m_free_cells.empty())
+				{
+					cell_index = m_free_cells.back();
+					m_free_cells.pop();
+					m_cell_map.insert(key, cell_index);
+				}
+				else
+				{
+					cell_index = m_cells.size();
+					m_cells.emplace(m_allocator);
+					m_cell_map.insert(key, cell_index);
+				}
+				m_cells[cell_index].push(light_index);
+			}
+		}
+	}
+}
+
+
+void LightGrid::unlink(int light_index)
+{
+	Light& light = m_lights[light_index];
+	if (light.is_big)
+	{
+		m_big_lights.eraseItemFast(light_index);
+		return;
+	}
+
+	for (int z = light.cell_min[2]; z <= light.cell_max[2]; ++z)
+	{
+		for (int y = light.cell_min[1]; y <= light.cell_max[1]; ++y)
+		{
+			for (int x = light.cell_min[0]; x <= light.cell_max[0]; ++x)
+			{
+				u64 key = getCellKey(x, y, z);
+				auto iter = m_cell_map.find(key);
+				ASSERT(iter.isValid());
+				int cell_index = iter.value();
+				Array<int>& cell = m_cells[cell_index];
+				cell.eraseItemFast(light_index);
+				if (cell.empty())
+				{
+					m_cell_map.erase(key);
+					m_free_cells.push(cell_index);
+				}
+			}
+		}
+	}
+}
+
+
+void LightGrid::setLight(ComponentHandle light, const Vec3& position, float range)
+{
+	auto iter = m_light_map.find(light);
+	int light_index;
+	if (iter.isValid())
+	{
+		light_index = iter.value();
+		unlink(light_index);
+	}
+	else
+	{
+		light_index = m_lights.size();
+		m_lights.emplace();
+		m_light_map.insert(light, light_index);
+	}
+
+	Light& tmp = m_lights[light_index];
+	tmp.component = light;
+	tmp.min = position - Vec3(range, range, range);
+	tmp.max = position + Vec3(range, range, range);
+	tmp.query_stamp = m_query_stamp;
+	toCell(tmp.min, tmp.cell_min);
+	toCell(tmp.max, tmp.cell_max);
+	tmp.is_big = getCellCount(tmp.cell_min, tmp.cell_max) > MAX_CELLS_PER_LIGHT;
+	link(light_index);
+}
+
+
+void LightGrid::removeLight(ComponentHandle light)
+{
+	auto iter = m_light_map.find(light);
+	if (!iter.isValid()) return;
+
+	int light_index = iter.value();
+	unlink(light_index);
+	m_light_map.erase(light);
+
+	int last = m_lights.size() - 1;
+	if (light_index != last)
+	{
+		// the last light takes the place of the removed one, relink it under the new index
+		unlink(last);
+		m_lights[light_index] = m_lights[last];
+		m_light_map[m_lights[light_index].component] = light_index;
+		m_lights.pop();
+		link(light_index);
+	}
+	else
+	{
+		m_lights.pop();
+	}
+}
+
+
+void LightGrid::pushLight(Light& light, const Vec3& min, const Vec3& max, Array<ComponentHandle>& lights)
+{
+	if (light.query_stamp == m_query_stamp) return;
+	light.query_stamp = m_query_stamp;
+	if (intersects(light.min, light.max, min, max)) lights.push(light.component);
+}
+
+
+void LightGrid::getLights(const Sphere& sphere, Array<ComponentHandle>& lights)
+{
+	++m_query_stamp;
+	Vec3 min = sphere.position - Vec3(sphere.radius, sphere.radius, sphere.radius);
+	Vec3 max = sphere.position + Vec3(sphere.radius, sphere.radius, sphere.radius);
+
+	for (int light_index : m_big_lights)
+	{
+		pushLight(m_lights[light_index], min, max, lights);
+	}
+
+	int cell_min[3];
+	int cell_max[3];
+	toCell(min, cell_min);
+	toCell(max, cell_max);
+	if (getCellCount(cell_min, cell_max) > MAX_CELLS_PER_LIGHT)
+	{
+		// big query, it's faster to check all the lights
+		for (Light& light : m_lights)
+		{
+			pushLight(light, min, max, lights);
+		}
+		return;
+	}
+
+	for (int z = cell_min[2]; z <= cell_max[2]; ++z)
+	{
+		for (int y = cell_min[1]; y <= cell_max[1]; ++y)
+		{
+			for (int x = cell_min[0]; x <= cell_max[0]; ++x)
+			{
+				auto iter = m_cell_map.find(getCellKey(x, y, z));
+				if (!iter.isValid()) continue;
+
+				for (int light_index : m_cells[iter.value()])
+				{
+					pushLight(m_lights[light_index], min, max, lights);
+				}
+			}
+		}
+	}
+}
+
+
+} // namespace Lumix
@@ -0,0 +1,67 @@
+#pragma once
+
+
+#include "engine/lumix.h"
+#include "engine/array.h"
+#include "engine/hash_map.h"
+#include "engine/vec.h"
+
+
+namespace Lumix
+{
+
+
+class IAllocator;
+struct Sphere;
+
+
+// Uniform grid of point light bounding boxes, cells are allocated only where there are lights.
+// Lights covering too many cells are kept in a separate list and always returned.
+class LUMIX_RENDERER_API LightGrid
+{
+public:
+	static const int MAX_CELLS_PER_LIGHT = 64;
+
+public:
+	LightGrid(IAllocator& allocator, float cell_size);
+
+	void clear();
+	// adds the light or updates its position and range
+	void setLight(ComponentHandle light, const Vec3& position, float range);
+	void removeLight(ComponentHandle light);
+	// pushes every light whose bounding box intersects the sphere's bounding box, each one once
+	void getLights(const Sphere& sphere, Array<ComponentHandle>& lights);
+	int getLightsCount() const { return m_lights.size(); }
+
+private:
+	struct Light
+	{
+		ComponentHandle component;
+		Vec3 min;
+		Vec3 max;
+		int cell_min[3];
+		int cell_max[3];
+		bool is_big;
+		u32 query_stamp;
+	};
+
+	void toCell(const Vec3& pos, int* cell) const;
+	int getCellCount(const int* cell_min, const int* cell_max) const;
+	void link(int light_index);
+	void unlink(int light_index);
+	void pushLight(Light& light, const Vec3& min, const Vec3& max, Array<ComponentHandle>& lights);
+
+private:
+	IAllocator& m_allocator;
+	float m_cell_size;
+	u32 m_query_stamp;
+	Array<Light> m_lights;
+	HashMap<ComponentHandle, int> m_light_map;
+	Array<int> m_big_lights;
+	HashMap<u64, int> m_cell_map;
+	Array<Array<int>> m_cells;
+	Array<int> m_free_cells;
+};
+
+
+} // namespace Lumix
@@ -18,7 +18,7 @@ namespace Lumix
 {
 
 
-static const u32 SHADOWMAP_HASH = crc32("shadowmap");
+static const u32 SHADOWMAP_HASH = constCrc32("shadowmap");
 static const ResourceType TEXTURE_TYPE("texture");
 static const ResourceType SHADER_TYPE("shader");
 static const ResourceType MATERIAL_TYPE("material");
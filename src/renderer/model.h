@@ -3,7 +3,7 @@
 
 #include "engine/array.h"
 #include "engine/geometry.h"
-#include "engine/hash_map.h"
+#include "engine/flat_hash_map.h"
 #include "engine/matrix.h"
 #include "engine/quat.h"
 #include "engine/string.h"
@@ -78,7 +78,7 @@ struct LODMeshIndices
 class LUMIX_RENDERER_API Model LUMIX_FINAL : public Resource
 {
 public:
-	typedef HashMap<u32, int> BoneMap;
+	typedef FlatHashMap<u32, int> BoneMap;
 
 #pragma pack(1)
 	struct FileHeader
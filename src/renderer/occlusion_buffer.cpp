@@ -0,0 +1,253 @@
+#include "occlusion_buffer.h"
+#include "engine/geometry.h"
+#include "engine/math_utils.h"
+#include "engine/profiler.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+
+namespace Lumix
+{
+
+
+// anything closer to the camera is treated as crossing the near plane
+static const float MIN_W = 0.001f;
+
+
+OcclusionBuffer::OcclusionBuffer(IAllocator& allocator)
+	: m_depth(allocator)
+	, m_tiles(allocator)
+	, m_triangles(allocator)
+{
+	m_view_projection.setIdentity();
+	m_depth.resize(WIDTH * HEIGHT);
+	m_tiles.resize(TILE_COLUMNS * TILE_ROWS);
+	clear(m_view_projection);
+}
+
+
+void OcclusionBuffer::clear(const Matrix& view_projection)
+{
+	m_view_projection = view_projection;
+	m_triangles.clear();
+	memset(&m_depth[0], 0, sizeof(m_depth[0]) * m_depth.size());
+	memset(&m_tiles[0], 0, sizeof(m_tiles[0]) * m_tiles.size());
+}
+
+
+bool OcclusionBuffer::toScreen(const Vec4& clip, Vertex* out) const
+{
+	if (clip.w < MIN_W) return false;
+
+	out->inv_w = 1 / clip.w;
+	out->x = (clip.x * out->inv_w * 0.5f + 0.5f) * WIDTH;
+	out->y = (0.5f - clip.y * out->inv_w * 0.5f) * HEIGHT;
+	return true;
+}
+
+
+void OcclusionBuffer::addOccluder(const Matrix& mtx,
+	const Vec3* vertices,
+	const u16* indices16,
+	const u32* indices32,
+	int indices_count)
+{
+	Matrix mvp = m_view_projection * mtx;
+	for (int i = 0; i + 2 < indices_count; i += 3)
+	{
+		Triangle triangle;
+		bool is_valid = true;
+		for (int j = 0; j < 3; ++j)
+		{
+			u32 index = indices16 ? indices16[i + j] : indices32[i + j];
+			Vec4 clip = mvp * Vec4(vertices[index], 1);
+			// occluders are optional, dropping triangles crossing the near plane keeps the test conservative
+			is_valid = is_valid && toScreen(clip, &triangle.v[j]);
+		}
+		if (!is_valid) continue;
+
+		const Vertex& v0 = triangle.v[0];
+		const Vertex& v1 = triangle.v[1];
+		const Vertex& v2 = triangle.v[2];
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		if (Math::abs(area) < 1e-6f) continue;
+		if (Math::maximum(v0.x, v1.x, v2.x) < 0 || Math::minimum(v0.x, v1.x, v2.x) > WIDTH) continue;
+		if (Math::maximum(v0.y, v1.y, v2.y) < 0 || Math::minimum(v0.y, v1.y, v2.y) > HEIGHT) continue;
+
+		m_triangles.push(triangle);
+	}
+}
+
+
+void OcclusionBuffer::rasterizeTriangle(const Triangle& triangle, int min_y, int max_y)
+{
+	const Vertex* v0 = &triangle.v[0];
+	const Vertex* v1 = &triangle.v[1];
+	const Vertex* v2 = &triangle.v[2];
+	float area = (v1->x - v0->x) * (v2->y - v0->y) - (v1->y - v0->y) * (v2->x - v0->x);
+	if (area < 0)
+	{
+		const Vertex* tmp = v1;
+		v1 = v2;
+		v2 = tmp;
+		area = -area;
+	}
+
+	int x0 = Math::maximum(0, (int)floorf(Math::minimum(v0->x, v1->x, v2->x)));
+	int x1 = Math::minimum(WIDTH - 1, (int)ceilf(Math::maximum(v0->x, v1->x, v2->x)));
+	int y0 = Math::maximum(min_y, (int)floorf(Math::minimum(v0->y, v1->y, v2->y)));
+	int y1 = Math::minimum(max_y, (int)ceilf(Math::maximum(v0->y, v1->y, v2->y)));
+	if (x0 > x1 || y0 > y1) return;
+
+	// edge functions, each one is zero on one edge and equals area on the opposite vertex
+	float a0 = v1->y - v2->y, b0 = v2->x - v1->x;
+	float a1 = v2->y - v0->y, b1 = v0->x - v2->x;
+	float a2 = v0->y - v1->y, b2 = v1->x - v0->x;
+	float inv_area = 1 / area;
+	float px = x0 + 0.5f;
+	for (int y = y0; y <= y1; ++y)
+	{
+		float py = y + 0.5f;
+		float w0 = (px - v1->x) * a0 + (py - v1->y) * b0;
+		float w1 = (px - v2->x) * a1 + (py - v2->y) * b1;
+		float w2 = (px - v0->x) * a2 + (py - v0->y) * b2;
+		float* LUMIX_RESTRICT row = &m_depth[y * WIDTH];
+		for (int x = x0; x <= x1; ++x)
+		{
+			if (w0 >= 0 && w1 >= 0 && w2 >= 0)
+			{
+				float inv_w = (w0 * v0->inv_w + w1 * v1->inv_w + w2 * v2->inv_w) * inv_area;
+				if (inv_w > row[x]) row[x] = inv_w;
+			}
+			w0 += a0;
+			w1 += a1;
+			w2 += a2;
+		}
+	}
+}
+
+
+void OcclusionBuffer::rasterize(int from_tile_row, int to_tile_row)
+{
+	PROFILE_FUNCTION();
+	int min_y = from_tile_row * TILE_SIZE;
+	int max_y = to_tile_row * TILE_SIZE - 1;
+	for (const Triangle& triangle : m_triangles)
+	{
+		rasterizeTriangle(triangle, min_y, max_y);
+	}
+
+	for (int tile_y = from_tile_row; tile_y < to_tile_row; ++tile_y)
+	{
+		for (int tile_x = 0; tile_x < TILE_COLUMNS; ++tile_x)
+		{
+			const float* tile = &m_depth[tile_y * TILE_SIZE * WIDTH + tile_x * TILE_SIZE];
+			float min_depth = tile[0];
+			for (int y = 0; y < TILE_SIZE; ++y)
+			{
+				for (int x = 0; x < TILE_SIZE; ++x)
+				{
+					min_depth = Math::minimum(min_depth, tile[x + y * WIDTH]);
+				}
+			}
+			m_tiles[tile_x + tile_y * TILE_COLUMNS] = min_depth;
+		}
+	}
+}
+
+
+bool OcclusionBuffer::isRectVisible(float ndc_min_x,
+	float ndc_min_y,
+	float ndc_max_x,
+	float ndc_max_y,
+	float inv_w) const
+{
+	// outside of the screen, leave it to frustum culling
+	if (ndc_min_x > 1 || ndc_max_x < -1 || ndc_min_y > 1 || ndc_max_y < -1) return true;
+
+	ndc_min_x = Math::maximum(ndc_min_x, -1.0f);
+	ndc_min_y = Math::maximum(ndc_min_y, -1.0f);
+	ndc_max_x = Math::minimum(ndc_max_x, 1.0f);
+	ndc_max_y = Math::minimum(ndc_max_y, 1.0f);
+
+	int x0 = Math::clamp((int)((ndc_min_x * 0.5f + 0.5f) * WIDTH), 0, WIDTH - 1);
+	int x1 = Math::clamp((int)((ndc_max_x * 0.5f + 0.5f) * WIDTH), 0, WIDTH - 1);
+	int y0 = Math::clamp((int)((0.5f - ndc_max_y * 0.5f) * HEIGHT), 0, HEIGHT - 1);
+	int y1 = Math::clamp((int)((0.5f - ndc_min_y * 0.5f) * HEIGHT), 0, HEIGHT - 1);
+
+	for (int tile_y = y0 / TILE_SIZE; tile_y <= y1 / TILE_SIZE; ++tile_y)
+	{
+		for (int tile_x = x0 / TILE_SIZE; tile_x <= x1 / TILE_SIZE; ++tile_x)
+		{
+			// all pixels of the tile are closer
+			if (m_tiles[tile_x + tile_y * TILE_COLUMNS] > inv_w) continue;
+
+			int from_x = Math::maximum(x0, tile_x * TILE_SIZE);
+			int to_x = Math::minimum(x1, tile_x * TILE_SIZE + TILE_SIZE - 1);
+			int from_y = Math::maximum(y0, tile_y * TILE_SIZE);
+			int to_y = Math::minimum(y1, tile_y * TILE_SIZE + TILE_SIZE - 1);
+			for (int y = from_y; y <= to_y; ++y)
+			{
+				for (int x = from_x; x <= to_x; ++x)
+				{
+					if (m_depth[x + y * WIDTH] <= inv_w) return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+
+bool OcclusionBuffer::isVisible(const Sphere& sphere) const
+{
+	const Matrix& m = m_view_projection;
+	Vec4 center = m * Vec4(sphere.position, 1);
+	// how much can clip x, y and w change inside the sphere
+	float rx = sphere.radius * Vec3(m.m11, m.m21, m.m31).length();
+	float ry = sphere.radius * Vec3(m.m12, m.m22, m.m32).length();
+	float rw = sphere.radius * Vec3(m.m14, m.m24, m.m34).length();
+
+	float near_w = center.w - rw;
+	float far_w = center.w + rw;
+	if (near_w < MIN_W) return true;
+
+	float min_x = center.x - rx;
+	float max_x = center.x + rx;
+	float min_y = center.y - ry;
+	float max_y = center.y + ry;
+	return isRectVisible(min_x / (min_x < 0 ? near_w : far_w),
+		min_y / (min_y < 0 ? near_w : far_w),
+		max_x / (max_x > 0 ? near_w : far_w),
+		max_y / (max_y > 0 ? near_w : far_w),
+		1 / near_w);
+}
+
+
+bool OcclusionBuffer::isVisible(const AABB& aabb, const Matrix& mtx) const
+{
+	Matrix mvp = m_view_projection * mtx;
+	float min_x = FLT_MAX, min_y = FLT_MAX;
+	float max_x = -FLT_MAX, max_y = -FLT_MAX;
+	float max_inv_w = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		Vec3 corner((i & 1) ? aabb.max.x : aabb.min.x,
+			(i & 2) ? aabb.max.y : aabb.min.y,
+			(i & 4) ? aabb.max.z : aabb.min.z);
+		Vec4 clip = mvp * Vec4(corner, 1);
+		if (clip.w < MIN_W) return true;
+
+		float inv_w = 1 / clip.w;
+		min_x = Math::minimum(min_x, clip.x * inv_w);
+		max_x = Math::maximum(max_x, clip.x * inv_w);
+		min_y = Math::minimum(min_y, clip.y * inv_w);
+		max_y = Math::maximum(max_y, clip.y * inv_w);
+		max_inv_w = Math::maximum(max_inv_w, inv_w);
+	}
+	return isRectVisible(min_x, min_y, max_x, max_y, max_inv_w);
+}
+
+
+} // namespace Lumix
@@ -0,0 +1,71 @@
+#pragma once
+
+
+#include "engine/lumix.h"
+#include "engine/array.h"
+#include "engine/matrix.h"
+
+
+namespace Lumix
+{
+
+
+struct AABB;
+class IAllocator;
+struct Sphere;
+
+
+// Small CPU depth buffer for occlusion culling. Occluder triangles are added first, then
+// rasterized by tile rows (can be split among jobs), and finally bounding volumes are tested.
+// Every pixel keeps 1 / w of the closest occluder, tiles keep the minimum of their pixels.
+class LUMIX_RENDERER_API OcclusionBuffer
+{
+public:
+	static const int WIDTH = 256;
+	static const int HEIGHT = 128;
+	static const int TILE_SIZE = 8;
+	static const int TILE_COLUMNS = WIDTH / TILE_SIZE;
+	static const int TILE_ROWS = HEIGHT / TILE_SIZE;
+
+public:
+	explicit OcclusionBuffer(IAllocator& allocator);
+
+	void clear(const Matrix& view_projection);
+	// indices are either 16 or 32 bit, the other pointer is null
+	void addOccluder(const Matrix& mtx,
+		const Vec3* vertices,
+		const u16* indices16,
+		const u32* indices32,
+		int indices_count);
+	int getTrianglesCount() const { return m_triangles.size(); }
+	void rasterize(int from_tile_row, int to_tile_row);
+
+	bool isVisible(const Sphere& sphere) const;
+	bool isVisible(const AABB& aabb, const Matrix& mtx) const;
+	float getDepth(int x, int y) const { return m_depth[x + y * WIDTH]; }
+
+private:
+	struct Vertex
+	{
+		float x, y;
+		float inv_w;
+	};
+
+	struct Triangle
+	{
+		Vertex v[3];
+	};
+
+	bool toScreen(const Vec4& clip, Vertex* out) const;
+	void rasterizeTriangle(const Triangle& triangle, int min_y, int max_y);
+	bool isRectVisible(float ndc_min_x, float ndc_min_y, float ndc_max_x, float ndc_max_y, float inv_w) const;
+
+private:
+	Matrix m_view_projection;
+	Array<float> m_depth;
+	Array<float> m_tiles;
+	Array<Triangle> m_triangles;
+};
+
+
+} // namespace Lumix
@@ -4,10 +4,11 @@
 #include "engine/fs/disk_file_device.h"
 #include "engine/fs/file_system.h"
 #include "engine/geometry.h"
-#include "engine/lifo_allocator.h"
 #include "engine/log.h"
 #include "engine/lua_wrapper.h"
+#include "engine/mtjd/manager.h"
 #include "engine/profiler.h"
+#include "engine/sparse_set.h"
 #include "engine/engine.h"
 #include "imgui/imgui.h"
 #include "lua_script/lua_script_system.h"
@@ -17,6 +18,7 @@
 #include "renderer/model.h"
 #include "renderer/particle_system.h"
 #include "renderer/pose.h"
+#include "renderer/render_queue.h"
 #include "renderer/render_scene.h"
 #include "renderer/renderer.h"
 #include "renderer/shader.h"
@@ -277,6 +279,7 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 		, m_default_cubemap(nullptr)
 		, m_debug_flags(BGFX_DEBUG_TEXT)
 		, m_point_light_shadowmaps(allocator)
+		, m_render_queue(allocator)
 		, m_is_rendering_in_shadowmap(false)
 		, m_is_ready(false)
 		, m_debug_index_buffer(BGFX_INVALID_HANDLE)
@@ -733,8 +736,19 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 		InstanceData& data = m_instances_data[idx];
 		if (!data.buffer) return;
 
-		Mesh& mesh = *data.mesh;
-		const Model& model = *data.model;
+		submitInstances(*data.mesh, *data.model, data.buffer, data.instance_count);
+
+		data.buffer = nullptr;
+		data.instance_count = 0;
+		data.mesh->instance_idx = -1;
+	}
+
+
+	void submitInstances(const Mesh& mesh,
+		const Model& model,
+		const bgfx::InstanceDataBuffer* instance_buffer,
+		int instance_count)
+	{
 		Material* material = mesh.material;
 		const u16 stride = model.getVertexDecl().getStride();
 
@@ -753,16 +767,12 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 							 mesh.indices_count);
 		bgfx::setStencil(view.stencil, BGFX_STENCIL_NONE);
 		bgfx::setState(view.render_state | material->getRenderStates());
-		bgfx::setInstanceDataBuffer(data.buffer, data.instance_count);
+		bgfx::setInstanceDataBuffer(instance_buffer, instance_count);
 		ShaderInstance& shader_instance = mesh.material->getShaderInstance();
 		++m_stats.draw_call_count;
-		m_stats.instance_count += data.instance_count;
-		m_stats.triangle_count += data.instance_count * mesh.indices_count / 3;
+		m_stats.instance_count += instance_count;
+		m_stats.triangle_count += instance_count * mesh.indices_count / 3;
 		bgfx::submit(view.bgfx_id, shader_instance.getProgramHandle(view.pass_idx));
-
-		data.buffer = nullptr;
-		data.instance_count = 0;
-		mesh.instance_idx = -1;
 	}
 
 
@@ -1025,7 +1035,7 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 		Material* material = static_cast<Material*>(res);
 		if (!material->isReady()) return;
 
-		IAllocator& frame_allocator = m_renderer.getEngine().getLIFOAllocator();
+		IAllocator& frame_allocator = m_renderer.getEngine().getFrameAllocator();
 		Array<ComponentHandle> local_lights(frame_allocator);
 		m_scene->getPointLights(m_camera_frustum, local_lights);
 
@@ -1118,7 +1128,7 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 		PROFILE_FUNCTION();
 		if (m_applied_camera == INVALID_COMPONENT) return;
 
-		IAllocator& frame_allocator = m_renderer.getEngine().getLIFOAllocator();
+		IAllocator& frame_allocator = m_renderer.getEngine().getFrameAllocator();
 		Array<DecalInfo> decals(frame_allocator);
 		m_scene->getDecals(m_camera_frustum, decals);
 
@@ -1212,7 +1222,7 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 		shadowmap_info.light = light;
 		//setPointLightUniforms(light);
 
-		IAllocator& frame_allocator = m_renderer.getEngine().getLIFOAllocator();
+		IAllocator& frame_allocator = m_renderer.getEngine().getFrameAllocator();
 		for (int i = 0; i < 4; ++i)
 		{
 			newView("omnilight", 0xff);
@@ -1739,7 +1749,7 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 	{
 		PROFILE_FUNCTION();
 
-		Array<ModelInstanceMesh> tmp_meshes(m_renderer.getEngine().getLIFOAllocator());
+		Array<ModelInstanceMesh> tmp_meshes(m_renderer.getEngine().getFrameAllocator());
 		m_scene->getPointLightInfluencedGeometry(light, tmp_meshes);
 		renderMeshes(tmp_meshes);
 	}
@@ -1751,7 +1761,7 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 
 		Array<ComponentHandle> lights(m_allocator);
 		m_scene->getPointLights(frustum, lights);
-		IAllocator& frame_allocator = m_renderer.getEngine().getLIFOAllocator();
+		IAllocator& frame_allocator = m_renderer.getEngine().getFrameAllocator();
 		m_is_current_light_global = false;
 		for (int i = 0; i < lights.size(); ++i)
 		{
@@ -1943,7 +1953,7 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 
 		if (!isValid(m_applied_camera)) return;
 
-		IAllocator& frame_allocator = m_renderer.getEngine().getLIFOAllocator();
+		IAllocator& frame_allocator = m_renderer.getEngine().getFrameAllocator();
 		m_is_current_light_global = true;
 
 		auto& meshes = m_scene->getModelInstanceInfos(frustum, lod_ref_point, layer_mask);
@@ -2255,42 +2265,6 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 	}
 
 
-	void renderRigidMesh(const ModelInstance& model_instance, const ModelInstanceMesh& info)
-	{
-		int instance_idx = info.mesh->instance_idx;
-		if (instance_idx == -1)
-		{
-			instance_idx = m_instance_data_idx;
-			m_instance_data_idx = (m_instance_data_idx + 1) % lengthOf(m_instances_data);
-			if (m_instances_data[instance_idx].buffer)
-			{
-				finishInstances(instance_idx);
-			}
-			InstanceData& data = m_instances_data[instance_idx];
-			if (!bgfx::checkAvailInstanceDataBuffer(InstanceData::MAX_INSTANCE_COUNT, sizeof(Matrix)))
-			{
-				g_log_warning.log("Renderer") << "Could not allocate instance data buffer";
-				return;
-			}
-			data.buffer =
-				bgfx::allocInstanceDataBuffer(InstanceData::MAX_INSTANCE_COUNT, sizeof(Matrix));
-			data.instance_count = 0;
-			data.mesh = info.mesh;
-			data.model = model_instance.model;
-			info.mesh->instance_idx = instance_idx;
-		}
-		InstanceData& data = m_instances_data[instance_idx];
-		float* mtcs = (float*)data.buffer->data;
-		copyMemory(&mtcs[data.instance_count * 16], &model_instance.matrix, sizeof(model_instance.matrix));
-		++data.instance_count;
-
-		if (data.instance_count == InstanceData::MAX_INSTANCE_COUNT)
-		{
-			finishInstances(instance_idx);
-		}
-	}
-
-
 	void executeCommandBuffer(const u8* data, Material* material) const
 	{
 		const u8* ip = data;
@@ -2502,32 +2476,122 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 	}
 
 
-	void renderMeshes(const Array<ModelInstanceMesh>& meshes)
+	u64 getSortKey(const ModelInstance& model_instance, const Mesh& mesh, const Vec3& camera_pos) const
 	{
-		PROFILE_FUNCTION();
-		if(meshes.empty()) return;
+		const Material* material = mesh.material;
+		int layer = material->getRenderLayer();
+		int view_idx = m_layer_to_view_map[layer];
+		const View& view = m_views[view_idx >= 0 ? view_idx : 0];
+		float depth = (model_instance.matrix.getTranslation() - camera_pos).squaredLength();
+		bool is_blended = ((view.render_state | material->getRenderStates()) & BGFX_STATE_BLEND_MASK) != 0;
+		return RenderQueue::makeKey(view_idx >= 0 ? view_idx : 0,
+			layer,
+			model_instance.type,
+			&material->getShaderInstance(),
+			material,
+			&mesh,
+			depth,
+			is_blended);
+	}
+
 
+	// merges consecutive instances of the same rigid mesh into one draw call, returns number of merged meshes
+	int renderRigidMeshes(const ModelInstanceMesh* meshes, int from)
+	{
 		ModelInstance* model_instances = m_scene->getModelInstances();
-		PROFILE_INT("mesh count", meshes.size());
-		for(auto& mesh : meshes)
+		const ModelInstanceMesh& first = meshes[m_render_queue.getValue(from)];
+		int to = from + 1;
+		int queue_size = m_render_queue.size();
+		while (to < queue_size && to - from < InstanceData::MAX_INSTANCE_COUNT)
+		{
+			const ModelInstanceMesh& info = meshes[m_render_queue.getValue(to)];
+			if (info.mesh != first.mesh || model_instances[info.model_instance.index].type != ModelInstance::RIGID)
+			{
+				break;
+			}
+			++to;
+		}
+
+		int count = to - from;
+		if (!bgfx::checkAvailInstanceDataBuffer(count, sizeof(Matrix)))
 		{
-			ModelInstance& model_instance = model_instances[mesh.model_instance.index];
+			g_log_warning.log("Renderer") << "Could not allocate instance data buffer";
+			return count;
+		}
+		const bgfx::InstanceDataBuffer* instance_buffer = bgfx::allocInstanceDataBuffer(count, sizeof(Matrix));
+		Matrix* mtcs = (Matrix*)instance_buffer->data;
+		for (int i = from; i < to; ++i)
+		{
+			const ModelInstanceMesh& info = meshes[m_render_queue.getValue(i)];
+			copyMemory(&mtcs[i - from], &model_instances[info.model_instance.index].matrix, sizeof(Matrix));
+		}
+		submitInstances(*first.mesh, *model_instances[first.model_instance.index].model, instance_buffer, count);
+		m_stats.draw_calls_saved += count - 1;
+		return count;
+	}
+
+
+	// meshes are submitted in sort key order, see RenderQueue
+	void renderSortedMeshes(const ModelInstanceMesh* meshes, int count)
+	{
+		ModelInstance* model_instances = m_scene->getModelInstances();
+		Vec3 camera_pos(0, 0, 0);
+		if (isValid(m_applied_camera))
+		{
+			camera_pos = m_scene->getUniverse().getPosition(m_scene->getCameraEntity(m_applied_camera));
+		}
+
+		{
+			PROFILE_BLOCK("sort keys");
+			m_render_queue.reset(count);
+			m_renderer.getEngine().getMTJDManager().parallelFor(count, 4096,
+				[this, meshes, model_instances, &camera_pos](int from, int to) {
+					for (int i = from; i < to; ++i)
+					{
+						const ModelInstanceMesh& info = meshes[i];
+						const ModelInstance& model_instance = model_instances[info.model_instance.index];
+						m_render_queue.setKey(i, getSortKey(model_instance, *info.mesh, camera_pos));
+					}
+				});
+		}
+		{
+			PROFILE_BLOCK("sort");
+			m_render_queue.sort();
+		}
+
+		int draw_calls_saved = m_stats.draw_calls_saved;
+		for (int i = 0; i < count;)
+		{
+			const ModelInstanceMesh& info = meshes[m_render_queue.getValue(i)];
+			ModelInstance& model_instance = model_instances[info.model_instance.index];
 			switch (model_instance.type)
 			{
 				case ModelInstance::RIGID:
-					renderRigidMesh(model_instance, mesh);
-					break;
+					i += renderRigidMeshes(meshes, i);
+					continue;
 				case ModelInstance::SKINNED:
-					renderSkinnedMesh(model_instance, mesh);
+					renderSkinnedMesh(model_instance, info);
 					break;
 				case ModelInstance::MULTILAYER_SKINNED:
-					renderMultilayerSkinnedMesh(model_instance, mesh);
+					renderMultilayerSkinnedMesh(model_instance, info);
 					break;
 				case ModelInstance::MULTILAYER_RIGID:
-					renderMultilayerRigidMesh(model_instance, mesh);
+					renderMultilayerRigidMesh(model_instance, info);
 					break;
 			}
+			++i;
 		}
+		PROFILE_INT("draw calls saved", m_stats.draw_calls_saved - draw_calls_saved);
+	}
+
+
+	void renderMeshes(const Array<ModelInstanceMesh>& meshes)
+	{
+		PROFILE_FUNCTION();
+		if(meshes.empty()) return;
+
+		PROFILE_INT("mesh count", meshes.size());
+		renderSortedMeshes(&meshes[0], meshes.size());
 		finishInstances();
 	}
 
@@ -2538,31 +2602,22 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 		int mesh_count = 0;
 		for (auto& submeshes : meshes)
 		{
-			if(submeshes.empty()) continue;
-			ModelInstance* model_instances = m_scene->getModelInstances();
 			mesh_count += submeshes.size();
-			for (auto& mesh : submeshes)
-			{
-				ModelInstance& model_instance = model_instances[mesh.model_instance.index];
-				switch (model_instance.type)
-				{
-					case ModelInstance::RIGID:
-						renderRigidMesh(model_instance, mesh);
-						break;
-					case ModelInstance::SKINNED:
-						renderSkinnedMesh(model_instance, mesh);
-						break;
-					case ModelInstance::MULTILAYER_SKINNED:
-						renderMultilayerSkinnedMesh(model_instance, mesh);
-						break;
-					case ModelInstance::MULTILAYER_RIGID:
-						renderMultilayerRigidMesh(model_instance, mesh);
-						break;
-				}
-			}
 		}
-		finishInstances();
 		PROFILE_INT("mesh count", mesh_count);
+		if (mesh_count == 0) return;
+
+		Array<ModelInstanceMesh> all_meshes(m_renderer.getEngine().getFrameAllocator());
+		all_meshes.resize(mesh_count);
+		int offset = 0;
+		for (auto& submeshes : meshes)
+		{
+			if (submeshes.empty()) continue;
+			copyMemory(&all_meshes[offset], &submeshes[0], submeshes.size() * sizeof(submeshes[0]));
+			offset += submeshes.size();
+		}
+		renderSortedMeshes(&all_meshes[0], mesh_count);
+		finishInstances();
 	}
 
 
@@ -2771,6 +2826,7 @@ struct PipelineImpl LUMIX_FINAL : public Pipeline
 	Array<FrameBuffer*> m_framebuffers;
 	Array<bgfx::UniformHandle> m_uniforms;
 	Array<PointLightShadowmap> m_point_light_shadowmaps;
+	RenderQueue m_render_queue;
 	FrameBuffer* m_global_light_shadowmap;
 	InstanceData m_instances_data[128];
 	int m_instance_data_idx;
@@ -64,6 +64,8 @@ class LUMIX_RENDERER_API Pipeline
 			int draw_call_count;
 			int instance_count;
 			int triangle_count;
+			// instances merged into draw calls of other instances
+			int draw_calls_saved;
 		};
 
 		struct CustomCommandHandler
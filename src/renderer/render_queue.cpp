@@ -0,0 +1,117 @@
+#include "render_queue.h"
+#include "engine/hash_map.h"
+#include "engine/string.h"
+
+
+namespace Lumix
+{
+
+
+static u64 hashBits(const void* ptr, int bits)
+{
+	return HashFunc<void*>::get(ptr) & ((1 << bits) - 1);
+}
+
+
+RenderQueue::RenderQueue(IAllocator& allocator)
+	: m_keys(allocator)
+	, m_values(allocator)
+	, m_tmp_keys(allocator)
+	, m_tmp_values(allocator)
+{
+}
+
+
+u64 RenderQueue::makeKey(int view, int layer, int type, const void* shader, const void* material, const void* mesh, float depth, bool back_to_front)
+{
+	ASSERT(view >= 0 && view < 64);
+	ASSERT(layer >= 0 && layer < 64);
+	ASSERT(type >= 0 && type < 4);
+
+	// bits of a non-negative float are ordered the same way as the floats themselves
+	u32 depth_bits;
+	float positive_depth = depth > 0 ? depth : 0;
+	copyMemory(&depth_bits, &positive_depth, sizeof(depth_bits));
+	// the sign bit is always zero, so only the low 12 of the 13 shifted bits are inverted
+	u64 depth_key = depth_bits >> 19;
+	if (back_to_front) depth_key ^= 0xfff;
+
+	return (u64(view) << 58) | (u64(layer) << 52) | (u64(type) << 50) | (hashBits(shader, 12) << 38) |
+		   (hashBits(material, 10) << 28) | (hashBits(mesh, 16) << 12) | depth_key;
+}
+
+
+void RenderQueue::radixSort(u64* keys, u32* values, u64* tmp_keys, u32* tmp_values, int count)
+{
+	// histograms of all 8 digits in one pass
+	u32 histograms[8][256] = {};
+	for (int i = 0; i < count; ++i)
+	{
+		u64 key = keys[i];
+		for (int digit = 0; digit < 8; ++digit)
+		{
+			++histograms[digit][(key >> (digit * 8)) & 0xff];
+		}
+	}
+
+	u64* src_keys = keys;
+	u32* src_values = values;
+	u64* dst_keys = tmp_keys;
+	u32* dst_values = tmp_values;
+	for (int digit = 0; digit < 8; ++digit)
+	{
+		u32* histogram = histograms[digit];
+		int shift = digit * 8;
+
+		// the pass would not change the order, e.g. the depth or view bits are the same in all keys
+		if (histogram[(src_keys[0] >> shift) & 0xff] == (u32)count) continue;
+
+		u32 offset = 0;
+		for (int i = 0; i < 256; ++i)
+		{
+			u32 tmp = histogram[i];
+			histogram[i] = offset;
+			offset += tmp;
+		}
+
+		for (int i = 0; i < count; ++i)
+		{
+			u64 key = src_keys[i];
+			u32 dst = histogram[(key >> shift) & 0xff]++;
+			dst_keys[dst] = key;
+			dst_values[dst] = src_values[i];
+		}
+
+		u64* tmp_k = src_keys;
+		src_keys = dst_keys;
+		dst_keys = tmp_k;
+		u32* tmp_v = src_values;
+		src_values = dst_values;
+		dst_values = tmp_v;
+	}
+
+	if (src_keys != keys)
+	{
+		copyMemory(keys, src_keys, sizeof(keys[0]) * count);
+		copyMemory(values, src_values, sizeof(values[0]) * count);
+	}
+}
+
+
+void RenderQueue::reset(int count)
+{
+	m_keys.resize(count);
+	m_values.resize(count);
+	m_tmp_keys.resize(count);
+	m_tmp_values.resize(count);
+}
+
+
+void RenderQueue::sort()
+{
+	if (m_keys.empty()) return;
+	radixSort(&m_keys[0], &m_values[0], &m_tmp_keys[0], &m_tmp_values[0], m_keys.size());
+}
+
+
+} // namespace Lumix
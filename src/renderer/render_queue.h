@@ -0,0 +1,50 @@
+#pragma once
+
+
+#include "engine/lumix.h"
+#include "engine/array.h"
+
+
+namespace Lumix
+{
+
+
+class IAllocator;
+
+
+// Sort keys of mesh draws. Draws are submitted in key order, so draws with the same view, layer,
+// shader and material are adjacent and instances of the same mesh can be merged into one draw call.
+// Key bits from the most significant: view 6, layer 6, type 2, shader 12, material 10, mesh 16, depth 12.
+// Shader, material and mesh are hashed pointers, a collision only breaks a batch, never the output.
+// Depth is front to back, or back to front for alpha blended draws so they are composited correctly.
+class LUMIX_RENDERER_API RenderQueue
+{
+public:
+	explicit RenderQueue(IAllocator& allocator);
+
+	static u64 makeKey(int view, int layer, int type, const void* shader, const void* material, const void* mesh, float depth, bool back_to_front);
+	// LSD radix sort, values are permuted the same way as keys, tmp arrays must have count items too
+	static void radixSort(u64* keys, u32* values, u64* tmp_keys, u32* tmp_values, int count);
+
+	// keys are not initialized, setKey can be called from multiple threads for different indices
+	void reset(int count);
+	void setKey(int index, u64 key)
+	{
+		m_keys[index] = key;
+		m_values[index] = index;
+	}
+	void sort();
+	int size() const { return m_keys.size(); }
+	u64 getKey(int index) const { return m_keys[index]; }
+	// index passed to setKey of the index-th smallest key
+	u32 getValue(int index) const { return m_values[index]; }
+
+private:
+	Array<u64> m_keys;
+	Array<u32> m_values;
+	Array<u64> m_tmp_keys;
+	Array<u32> m_tmp_values;
+};
+
+
+} // namespace Lumix
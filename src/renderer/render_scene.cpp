@@ -7,12 +7,9 @@
 #include "engine/fs/file_system.h"
 #include "engine/geometry.h"
 #include "engine/json_serializer.h"
-#include "engine/lifo_allocator.h"
 #include "engine/log.h"
 #include "engine/lua_wrapper.h"
 #include "engine/math_utils.h"
-#include "engine/mtjd/generic_job.h"
-#include "engine/mtjd/job.h"
 #include "engine/mtjd/manager.h"
 #include "engine/path_utils.h"
 #include "engine/plugin_manager.h"
@@ -21,14 +18,17 @@
 #include "engine/resource_manager.h"
 #include "engine/resource_manager_base.h"
 #include "engine/serializer.h"
+#include "engine/sparse_set.h"
 #include "engine/timer.h"
 #include "engine/universe/universe.h"
 #include "lua_script/lua_script_system.h"
 #include "renderer/culling_system.h"
 #include "renderer/frame_buffer.h"
 #include "renderer/material.h"
+#include "renderer/light_grid.h"
 #include "renderer/material_manager.h"
 #include "renderer/model.h"
+#include "renderer/occlusion_buffer.h"
 #include "renderer/particle_system.h"
 #include "renderer/pipeline.h"
 #include "renderer/pose.h"
@@ -221,6 +221,9 @@ public:
 		m_decals.clear();
 
 		m_cameras.clear();
+		m_global_lights.clear();
+		m_active_global_light_cmp = INVALID_COMPONENT;
+		m_bone_attachments.clear();
 
 		for (auto* terrain : m_terrains)
 		{
@@ -246,6 +249,8 @@ public:
 		m_model_instances.clear();
 		m_culling_system->clear();
 
+		clearPointLights();
+
 		for (auto& probe : m_environment_probes)
 		{
 			if (probe.texture) probe.texture->getResourceManager().unload(*probe.texture);
@@ -801,6 +806,7 @@ public:
 		serializer.read(&light.m_specular_color);
 		serializer.read(&light.m_specular_intensity);
 		m_point_lights_map.insert(light.m_component, m_point_lights.size() - 1);
+		updateLightGrid(light);
 
 		m_universe.addComponent(light.m_entity, POINT_LIGHT_TYPE, this, light.m_component);
 	}
@@ -1245,9 +1251,9 @@ public:
 	void serializeLights(OutputBlob& serializer)
 	{
 		serializer.write((i32)m_point_lights.size());
-		for (int i = 0, c = m_point_lights.size(); i < c; ++i)
+		if (!m_point_lights.empty())
 		{
-			serializer.write(m_point_lights[i]);
+			serializer.write(&m_point_lights[0], sizeof(m_point_lights[0]) * m_point_lights.size());
 		}
 		serializer.write(m_point_light_last_cmp);
 
@@ -1548,17 +1554,30 @@ public:
 		}
 	}
 
+	// the grid and the maps index m_point_lights, so they must be cleared together
+	void clearPointLights()
+	{
+		m_point_lights.clear();
+		m_point_lights_map.clear();
+		m_light_influenced_geometry.clear();
+		m_light_grid.clear();
+	}
+
+
 	void deserializeLights(InputBlob& serializer)
 	{
+		clearPointLights();
 		i32 size = 0;
 		serializer.read(size);
 		m_point_lights.resize(size);
+		if (size > 0) serializer.read(&m_point_lights[0], sizeof(m_point_lights[0]) * size);
+		m_light_influenced_geometry.reserve(size);
 		for (int i = 0; i < size; ++i)
 		{
 			m_light_influenced_geometry.emplace(m_allocator);
 			PointLight& light = m_point_lights[i];
-			serializer.read(light);
 			m_point_lights_map.insert(light.m_component, i);
+			updateLightGrid(light);
 
 			m_universe.addComponent(light.m_entity, POINT_LIGHT_TYPE, this, light.m_component);
 		}
@@ -1623,18 +1642,7 @@ public:
 	void destroyModelInstance(ComponentHandle component)
 	{
 		m_model_instance_destroyed.invoke(component);
-		for (int i = 0; i < m_light_influenced_geometry.size(); ++i)
-		{
-			Array<ComponentHandle>& influenced_geometry = m_light_influenced_geometry[i];
-			for (int j = 0; j < influenced_geometry.size(); ++j)
-			{
-				if (influenced_geometry[j] == component)
-				{
-					influenced_geometry.erase(j);
-					break;
-				}
-			}
-		}
+		removeFromInfluencedGeometry(component);
 
 		setModel(component, nullptr);
 		auto& model_instance = m_model_instances[component.index];
@@ -1674,6 +1682,7 @@ public:
 		Entity entity = m_point_lights[index].m_entity;
 		m_point_lights.eraseFast(index);
 		m_point_lights_map.erase(component);
+		m_light_grid.removeLight(component);
 		m_light_influenced_geometry.eraseFast(index);
 		if (index < m_point_lights.size())
 		{
@@ -2360,32 +2369,11 @@ public:
 		{
 			ModelInstance& r = m_model_instances[index];
 			r.matrix = m_universe.getMatrix(entity);
-			if (r.model && r.model->isReady())
-			{
-				float radius = m_universe.getScale(entity) * r.model->getBoundingRadius();
-				Vec3 position = m_universe.getPosition(entity);
-				m_culling_system->updateBoundingSphere({position, radius}, cmp);
-			}
-
-			float bounding_radius = r.model ? r.model->getBoundingRadius() : 1;
-			for (int light_idx = 0, c = m_point_lights.size(); light_idx < c; ++light_idx)
-			{
-				for (int j = 0, c2 = m_light_influenced_geometry[light_idx].size(); j < c2; ++j)
-				{
-					if(m_light_influenced_geometry[light_idx][j] == cmp)
-					{
-						m_light_influenced_geometry[light_idx].eraseFast(j);
-						break;
-					}
-				}
-
-				Vec3 pos = m_universe.getPosition(r.entity);
-				Frustum frustum = getPointLightFrustum({light_idx});
-				if(frustum.isSphereInside(pos, bounding_radius))
-				{
-					m_light_influenced_geometry[light_idx].push(cmp);
-				}
-			}
+			float radius = m_universe.getScale(entity) * r.model->getBoundingRadius();
+			Sphere sphere(m_universe.getPosition(entity), radius);
+			removeFromInfluencedGeometry(cmp);
+			m_culling_system->updateBoundingSphere(sphere, cmp);
+			addToInfluencedGeometry(cmp, sphere);
 		}
 
 		int decal_idx = m_decals.find(entity);
@@ -2394,13 +2382,11 @@ public:
 			updateDecalInfo(m_decals.at(decal_idx));
 		}
 
-		for (int i = 0, c = m_point_lights.size(); i < c; ++i)
+		if (!m_point_lights.empty() && m_universe.hasComponent(entity, POINT_LIGHT_TYPE))
 		{
-			if (m_point_lights[i].m_entity == entity)
-			{
-				detectLightInfluencedGeometry(m_point_lights[i].m_component);
-				break;
-			}
+			ComponentHandle light_cmp = getComponent(entity, POINT_LIGHT_TYPE);
+			updateLightGrid(m_point_lights[m_point_lights_map[light_cmp]]);
+			detectLightInfluencedGeometry(light_cmp);
 		}
 
 		bool was_updating = m_is_updating_attachments;
@@ -2931,6 +2917,8 @@ public:
 
 
 	void enableGrass(bool enabled) override { m_is_grass_enabled = enabled; }
+	void enableOcclusionCulling(bool enabled) override { m_is_occlusion_culling_enabled = enabled; }
+	bool isOcclusionCullingEnabled() const override { return m_is_occlusion_culling_enabled; }
 
 
 	void setGrassDensity(ComponentHandle cmp, int index, int density) override
@@ -3000,26 +2988,65 @@ public:
 		return &m_culling_system->getResult();
 	}
 
-	
-	void runJobs(Array<MTJD::Job*>& jobs, MTJD::Group& sync_point)
+
+
+	// rasterizes LOD0 of visible rigid meshes with "occluder" material into the occlusion buffer
+	bool renderOccluders(const CullingSystem::Results& results, const Frustum& frustum)
 	{
 		PROFILE_FUNCTION();
-		for (int i = 0; i < jobs.size(); ++i)
-		{
-			m_engine.getMTJDManager().schedule(jobs[i]);
-		}
-		if (!jobs.empty())
+		Matrix view, projection;
+		view.lookAt(frustum.position, frustum.position + frustum.direction, frustum.up);
+		projection.setPerspective(frustum.fov, frustum.ratio, frustum.near_distance, frustum.far_distance, true);
+		m_occlusion_buffer.clear(projection * view);
+
+		for (const auto& subresults : results)
 		{
-			sync_point.sync();
+			for (ComponentHandle cmp : subresults)
+			{
+				const ModelInstance& model_instance = m_model_instances[cmp.index];
+				if (model_instance.type != ModelInstance::RIGID && model_instance.type != ModelInstance::MULTILAYER_RIGID)
+				{
+					continue;
+				}
+
+				Model* model = model_instance.model;
+				const Model::LOD& lod = model->getLODs()[0];
+				const u16* indices16 = model->getIndices16();
+				const u32* indices32 = model->getIndices32();
+				int stride = model->getVertexDecl().getStride();
+				// indices are relative to the first vertex of their mesh, same as in Model::castRay
+				int vertex_offset = 0;
+				for (int i = lod.from_mesh; i <= lod.to_mesh; ++i)
+				{
+					const Mesh& mesh = model_instance.meshes[i];
+					const Vec3* vertices = &model->getVertices()[vertex_offset];
+					vertex_offset += mesh.attribute_array_size / stride;
+					if (!mesh.material->isCustomFlag(m_occluder_flag)) continue;
+
+					m_occlusion_buffer.addOccluder(model_instance.matrix,
+						vertices,
+						indices16 ? indices16 + mesh.indices_offset : nullptr,
+						indices32 ? indices32 + mesh.indices_offset : nullptr,
+						mesh.indices_count);
+				}
+			}
 		}
+		PROFILE_INT("occluder triangles", m_occlusion_buffer.getTrianglesCount());
+		if (m_occlusion_buffer.getTrianglesCount() == 0) return false;
+
+		m_engine.getMTJDManager().parallelFor(OcclusionBuffer::TILE_ROWS, 1, [this](int from, int to) {
+			m_occlusion_buffer.rasterize(from, to);
+		});
+		return true;
 	}
 
 
-	void fillTemporaryInfos(const CullingSystem::Results& results, const Frustum& frustum, const Vec3& lod_ref_point)
+	void fillTemporaryInfos(const CullingSystem::Results& results,
+		const Frustum& frustum,
+		const Vec3& lod_ref_point,
+		bool occlusion)
 	{
 		PROFILE_FUNCTION();
-		m_jobs.clear();
-
 		while (m_temporary_infos.size() < results.size())
 		{
 			m_temporary_infos.emplace(m_allocator);
@@ -3029,15 +3056,15 @@ public:
 			m_temporary_infos.pop();
 		}
 
-		for (int subresult_index = 0; subresult_index < results.size(); ++subresult_index)
-		{
-			Array<ModelInstanceMesh>& subinfos = m_temporary_infos[subresult_index];
-			subinfos.clear();
-			if (results[subresult_index].empty()) continue;
-
-			MTJD::Job* job = MTJD::makeJob(m_engine.getMTJDManager(),
-				[&subinfos, this, &results, subresult_index, &frustum, lod_ref_point]()
+		m_engine.getMTJDManager().parallelFor(results.size(), 1,
+			[this, &results, &frustum, lod_ref_point, occlusion](int from, int to)
+			{
+				for (int subresult_index = from; subresult_index < to; ++subresult_index)
 				{
+					Array<ModelInstanceMesh>& subinfos = m_temporary_infos[subresult_index];
+					subinfos.clear();
+					if (results[subresult_index].empty()) continue;
+
 					PROFILE_BLOCK("Temporary Info Job");
 					PROFILE_INT("ModelInstance count", results[subresult_index].size());
 					Vec3 ref_point = lod_ref_point;
@@ -3051,6 +3078,10 @@ public:
 					ModelInstance* LUMIX_RESTRICT model_instances = &m_model_instances[0];
 					for (int i = 0, c = results[subresult_index].size(); i < c; ++i)
 					{
+						if (occlusion && !m_occlusion_buffer.isVisible(m_culling_system->getSphere(raw_subresults[i])))
+						{
+							continue;
+						}
 						const ModelInstance* LUMIX_RESTRICT model_instance = &model_instances[raw_subresults[i].index];
 						float squared_distance = (model_instance->matrix.getTranslation() - ref_point).squaredLength();
 						squared_distance *= lod_multiplier;
@@ -3064,12 +3095,8 @@ public:
 							info.mesh = &model_instance->meshes[j];
 						}
 					}
-				},
-				m_allocator);
-			job->addDependency(&m_sync_point);
-			m_jobs.push(job);
-		}
-		runJobs(m_jobs, m_sync_point);
+				}
+			});
 	}
 
 
@@ -3238,7 +3265,9 @@ public:
 		const CullingSystem::Results* results = cull(frustum, layer_mask);
 		if (!results) return m_temporary_infos;
 
-		fillTemporaryInfos(*results, frustum, lod_ref_point);
+		// ortho frustums (shadows) are not worth it
+		bool occlusion = m_is_occlusion_culling_enabled && frustum.fov > 0 && renderOccluders(*results, frustum);
+		fillTemporaryInfos(*results, frustum, lod_ref_point, occlusion);
 		return m_temporary_infos;
 	}
 
@@ -4094,7 +4123,10 @@ public:
 
 	void setLightRange(ComponentHandle cmp, float value) override
 	{
-		m_point_lights[m_point_lights_map[cmp]].m_range = value;
+		PointLight& light = m_point_lights[m_point_lights_map[cmp]];
+		light.m_range = value;
+		updateLightGrid(light);
+		detectLightInfluencedGeometry(cmp);
 	}
 
 
@@ -4293,10 +4325,7 @@ public:
 		LUMIX_DELETE(m_allocator, r.pose);
 		r.pose = nullptr;
 
-		for (int i = 0; i < m_point_lights.size(); ++i)
-		{
-			m_light_influenced_geometry[i].eraseItemFast(component);
-		}
+		removeFromInfluencedGeometry(component);
 		m_culling_system->removeStatic(component);
 	}
 
@@ -4375,17 +4404,7 @@ public:
 			r.mesh_count = r.model->getMeshCount();
 		}
 
-		for (int i = 0; i < m_point_lights.size(); ++i)
-		{
-			PointLight& light = m_point_lights[i];
-			Vec3 t = r.matrix.getTranslation();
-			float radius = r.model->getBoundingRadius();
-			if ((t - m_universe.getPosition(light.m_entity)).squaredLength() <
-				(radius + light.m_range) * (radius + light.m_range))
-			{
-				m_light_influenced_geometry[i].push(component);
-			}
-		}
+		addToInfluencedGeometry(component, sphere);
 	}
 
 
@@ -4520,6 +4539,7 @@ public:
 
 			if (old_model->isReady())
 			{
+				removeFromInfluencedGeometry(component);
 				m_culling_system->removeStatic(component);
 			}
 			old_model->getResourceManager().unload(*old_model);
@@ -4544,6 +4564,41 @@ public:
 	IAllocator& getAllocator() override { return m_allocator; }
 
 
+	void updateLightGrid(const PointLight& light)
+	{
+		m_light_grid.setLight(light.m_component, m_universe.getPosition(light.m_entity), light.m_range);
+	}
+
+
+	// only lights returned by the grid can influence the model instance, so the rest are not touched
+	void removeFromInfluencedGeometry(ComponentHandle cmp)
+	{
+		if (!m_culling_system->isAdded(cmp)) return;
+
+		m_grid_lights.clear();
+		m_light_grid.getLights(m_culling_system->getSphere(cmp), m_grid_lights);
+		for (ComponentHandle light : m_grid_lights)
+		{
+			m_light_influenced_geometry[m_point_lights_map[light]].eraseItemFast(cmp);
+		}
+	}
+
+
+	void addToInfluencedGeometry(ComponentHandle cmp, const Sphere& sphere)
+	{
+		m_grid_lights.clear();
+		m_light_grid.getLights(sphere, m_grid_lights);
+		for (ComponentHandle light : m_grid_lights)
+		{
+			Frustum frustum = getPointLightFrustum(light);
+			if (frustum.isSphereInside(sphere.position, sphere.radius))
+			{
+				m_light_influenced_geometry[m_point_lights_map[light]].push(cmp);
+			}
+		}
+	}
+
+
 	void detectLightInfluencedGeometry(ComponentHandle cmp)
 	{
 		Frustum frustum = getPointLightFrustum(cmp);
@@ -4754,6 +4809,7 @@ public:
 		light.m_attenuation_param = 2;
 		light.m_range = 10;
 		m_point_lights_map.insert(light.m_component, m_point_lights.size() - 1);
+		updateLightGrid(light);
 
 		m_universe.addComponent(entity, POINT_LIGHT_TYPE, this, light.m_component);
 
@@ -4865,7 +4921,7 @@ public:
 	}
 
 
-	const AssociativeArray<Entity, ParticleEmitter*>& getParticleEmitters() const override
+	const SparseSet<Entity, ParticleEmitter*>& getParticleEmitters() const override
 	{
 		return m_particle_emitters;
 	}
@@ -4879,31 +4935,34 @@ private:
 
 	ComponentHandle m_point_light_last_cmp;
 	Array<Array<ComponentHandle>> m_light_influenced_geometry;
+	LightGrid m_light_grid;
+	Array<ComponentHandle> m_grid_lights;
 	ComponentHandle m_active_global_light_cmp;
 	HashMap<ComponentHandle, int> m_point_lights_map;
 
-	AssociativeArray<Entity, Decal> m_decals;
+	SparseSet<Entity, Decal> m_decals;
 	Array<ModelInstance> m_model_instances;
 	HashMap<Entity, GlobalLight> m_global_lights;
 	Array<PointLight> m_point_lights;
 	HashMap<Entity, Camera> m_cameras;
 	Array<BoneAttachment> m_bone_attachments;
-	AssociativeArray<Entity, EnvironmentProbe> m_environment_probes;
+	SparseSet<Entity, EnvironmentProbe> m_environment_probes;
 	HashMap<Entity, Terrain*> m_terrains;
-	AssociativeArray<Entity, ParticleEmitter*> m_particle_emitters;
+	SparseSet<Entity, ParticleEmitter*> m_particle_emitters;
 
 	Array<DebugTriangle> m_debug_triangles;
 	Array<DebugLine> m_debug_lines;
 	Array<DebugPoint> m_debug_points;
 
 	Array<Array<ModelInstanceMesh>> m_temporary_infos;
-	MTJD::Group m_sync_point;
-	Array<MTJD::Job*> m_jobs;
+	OcclusionBuffer m_occlusion_buffer;
+	u32 m_occluder_flag;
 
 	float m_time;
 	float m_lod_multiplier;
 	bool m_is_updating_attachments;
 	bool m_is_grass_enabled;
+	bool m_is_occlusion_culling_enabled;
 	bool m_is_game_running;
 
 	AssociativeArray<Model*, ModelLoadedCallback> m_model_loaded_callbacks;
@@ -4966,19 +5025,21 @@ RenderSceneImpl::RenderSceneImpl(Renderer& renderer,
 	, m_terrains(m_allocator)
 	, m_point_lights(m_allocator)
 	, m_light_influenced_geometry(m_allocator)
+	, m_light_grid(m_allocator, 16.0f)
+	, m_grid_lights(m_allocator)
 	, m_global_lights(m_allocator)
 	, m_decals(m_allocator)
 	, m_debug_triangles(m_allocator)
 	, m_debug_lines(m_allocator)
 	, m_debug_points(m_allocator)
 	, m_temporary_infos(m_allocator)
-	, m_sync_point(true, m_allocator)
-	, m_jobs(m_allocator)
+	, m_occlusion_buffer(m_allocator)
 	, m_active_global_light_cmp(INVALID_COMPONENT)
 	, m_point_light_last_cmp(INVALID_COMPONENT)
 	, m_model_instance_created(m_allocator)
 	, m_model_instance_destroyed(m_allocator)
 	, m_is_grass_enabled(true)
+	, m_is_occlusion_culling_enabled(true)
 	, m_is_game_running(false)
 	, m_particle_emitters(m_allocator)
 	, m_point_lights_map(m_allocator)
@@ -4993,6 +5054,7 @@ RenderSceneImpl::RenderSceneImpl(Renderer& renderer,
 	m_universe.entityDestroyed().bind<RenderSceneImpl, &RenderSceneImpl::onEntityDestroyed>(this);
 	m_culling_system = CullingSystem::create(m_engine.getMTJDManager(), m_allocator);
 	m_model_instances.reserve(5000);
+	m_occluder_flag = Material::getCustomFlag("occluder");
 
 	for (auto& i : COMPONENT_INFOS)
 	{
@@ -16,7 +16,6 @@ struct AABB;
 class Engine;
 struct Frustum;
 class IAllocator;
-class LIFOAllocator;
 class Material;
 struct Mesh;
 class Model;
@@ -29,7 +28,7 @@ class Terrain;
 class Texture;
 class Universe;
 template <typename T> class Array;
-template <typename T, typename T2> class AssociativeArray;
+template <typename T, typename T2> class SparseSet;
 template <typename T> class DelegateList;
 
 
@@ -245,7 +244,7 @@ public:
 	virtual class ParticleEmitter* getParticleEmitter(ComponentHandle cmp) = 0;
 	virtual void resetParticleEmitter(ComponentHandle cmp) = 0;
 	virtual void updateEmitter(ComponentHandle cmp, float time_delta) = 0;
-	virtual const AssociativeArray<Entity, class ParticleEmitter*>& getParticleEmitters() const = 0;
+	virtual const SparseSet<Entity, class ParticleEmitter*>& getParticleEmitters() const = 0;
 	virtual const Vec2* getParticleEmitterAlpha(ComponentHandle cmp) = 0;
 	virtual int getParticleEmitterAlphaCount(ComponentHandle cmp) = 0;
 	virtual const Vec2* getParticleEmitterSize(ComponentHandle cmp) = 0;
@@ -353,6 +352,8 @@ public:
 	virtual float getGrassDistance(ComponentHandle cmp, int index) = 0;
 	virtual void setGrassDistance(ComponentHandle cmp, int index, float value) = 0;
 	virtual void enableGrass(bool enabled) = 0;
+	virtual void enableOcclusionCulling(bool enabled) = 0;
+	virtual bool isOcclusionCullingEnabled() const = 0;
 	virtual void setGrassPath(ComponentHandle cmp, int index, const Path& path) = 0;
 	virtual Path getGrassPath(ComponentHandle cmp, int index) = 0;
 	virtual void setGrassDensity(ComponentHandle cmp, int index, int density) = 0;
@@ -6,7 +6,6 @@
 #include "engine/debug/debug.h"
 #include "engine/engine.h"
 #include "engine/fs/os_file.h"
-#include "engine/lifo_allocator.h"
 #include "engine/log.h"
 #include "engine/profiler.h"
 #include "engine/property_descriptor.h"
@@ -14,6 +13,7 @@
 #include "engine/resource_manager.h"
 #include "engine/string.h"
 #include "engine/system.h"
+#include "engine/tag_allocator.h"
 #include "engine/universe/universe.h"
 #include "renderer/material.h"
 #include "renderer/material_manager.h"
@@ -586,7 +586,7 @@ struct RendererImpl LUMIX_FINAL : public Renderer
 
 	explicit RendererImpl(Engine& engine)
 		: m_engine(engine)
-		, m_allocator(engine.getAllocator())
+		, m_allocator(engine.getAllocator(), "renderer")
 		, m_texture_manager(m_allocator)
 		, m_model_manager(m_allocator)
 		, m_material_manager(*this, m_allocator)
@@ -773,7 +773,7 @@ struct RendererImpl LUMIX_FINAL : public Renderer
 
 
 	Engine& m_engine;
-	IAllocator& m_allocator;
+	TagAllocator m_allocator;
 	Array<ShaderCombinations::Pass> m_passes;
 	Array<ShaderDefine> m_shader_defines;
 	Array<Layer> m_layers;
@@ -16,7 +16,6 @@ namespace Lumix
 
 
 class Engine;
-class LIFOAllocator;
 class MaterialManager;
 class ModelManager;
 class Path;
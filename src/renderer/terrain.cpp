@@ -3,7 +3,6 @@
 #include "engine/crc32.h"
 #include "engine/geometry.h"
 #include "engine/json_serializer.h"
-#include "engine/lifo_allocator.h"
 #include "engine/log.h"
 #include "engine/math_utils.h"
 #include "engine/profiler.h"
@@ -30,14 +29,14 @@ static const float GRASS_QUAD_RADIUS = GRASS_QUAD_SIZE * 0.7072f;
 static const int GRID_SIZE = 16;
 static const int COPY_COUNT = 50;
 static const ComponentType TERRAIN_HASH = PropertyRegister::getComponentType("terrain");
-static const u32 MORPH_CONST_HASH = crc32("morph_const");
-static const u32 QUAD_SIZE_HASH = crc32("quad_size");
-static const u32 QUAD_MIN_HASH = crc32("quad_min");
-
-static const u32 BRUSH_POSITION_HASH = crc32("brush_position");
-static const u32 BRUSH_SIZE_HASH = crc32("brush_size");
-static const u32 MAP_SIZE_HASH = crc32("map_size");
-static const u32 CAMERA_POS_HASH = crc32("camera_pos");
+static const u32 MORPH_CONST_HASH = constCrc32("morph_const");
+static const u32 QUAD_SIZE_HASH = constCrc32("quad_size");
+static const u32 QUAD_MIN_HASH = constCrc32("quad_min");
+
+static const u32 BRUSH_POSITION_HASH = constCrc32("brush_position");
+static const u32 BRUSH_SIZE_HASH = constCrc32("brush_size");
+static const u32 MAP_SIZE_HASH = constCrc32("map_size");
+static const u32 CAMERA_POS_HASH = constCrc32("camera_pos");
 static const ResourceType MODEL_TYPE("model");
 static const ResourceType MATERIAL_TYPE("material");
 static const char* TEX_COLOR_UNIFORM = "u_texColor";
@@ -17,7 +17,6 @@ struct AABB;
 struct Frustum;
 struct GrassInfo;
 class IAllocator;
-class LIFOAllocator;
 class Material;
 struct Mesh;
 class Model;
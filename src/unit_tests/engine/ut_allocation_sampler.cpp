@@ -0,0 +1,98 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/debug/debug.h"
+#include "engine/default_allocator.h"
+#include "engine/fs/os_file.h"
+
+
+namespace
+{
+
+
+static const int COUNT = 100;
+
+
+void allocateA(Lumix::IAllocator& allocator, void** ptrs)
+{
+	for (int i = 0; i < COUNT; ++i) ptrs[i] = allocator.allocate(64);
+}
+
+
+void allocateB(Lumix::IAllocator& allocator, void** ptrs)
+{
+	for (int i = 0; i < COUNT; ++i) ptrs[i] = allocator.allocate(256);
+}
+
+
+void UT_allocation_sampler(const char* params)
+{
+	Lumix::DefaultAllocator main_allocator;
+	Lumix::Debug::Allocator allocator(main_allocator);
+	auto& sampler = allocator.getSampler();
+	Lumix::Debug::AllocationSampler::Site sites[8];
+	LUMIX_EXPECT(sampler.getSites(sites, Lumix::lengthOf(sites)) == 0);
+
+	// every allocation is sampled
+	sampler.setInterval(1);
+	void* a[COUNT];
+	void* b[COUNT];
+	allocateA(allocator, a);
+	allocateB(allocator, b);
+	sampler.setInterval(0);
+	LUMIX_EXPECT(sampler.getSites(sites, Lumix::lengthOf(sites)) == 2);
+	LUMIX_EXPECT(sites[0].count == COUNT);
+	LUMIX_EXPECT(sites[0].size == COUNT * 256);
+	LUMIX_EXPECT(sites[1].size == COUNT * 64);
+
+	// samples are tracked until freed even with sampling disabled
+	for (int i = 0; i < COUNT / 2; ++i) allocator.deallocate(b[i]);
+	sampler.getSites(sites, Lumix::lengthOf(sites));
+	LUMIX_EXPECT(sites[0].live_count == COUNT / 2);
+	LUMIX_EXPECT(sites[0].live_size == COUNT / 2 * 256);
+	LUMIX_EXPECT(sites[1].live_count == COUNT);
+
+	LUMIX_EXPECT(sampler.saveReport("allocation_samples.txt"));
+	LUMIX_EXPECT(Lumix::FS::OsFile::fileExists("allocation_samples.txt"));
+
+	for (int i = COUNT / 2; i < COUNT; ++i) allocator.deallocate(b[i]);
+	for (void* ptr : a) allocator.deallocate(ptr);
+	sampler.getSites(sites, Lumix::lengthOf(sites));
+	LUMIX_EXPECT(sites[0].live_count == 0);
+	LUMIX_EXPECT(sites[1].live_size == 0);
+
+	sampler.clear();
+	LUMIX_EXPECT(sampler.getSites(sites, Lumix::lengthOf(sites)) == 0);
+}
+
+
+void UT_allocation_sampler_estimate(const char* params)
+{
+	Lumix::DefaultAllocator main_allocator;
+	Lumix::Debug::Allocator allocator(main_allocator);
+	auto& sampler = allocator.getSampler();
+	static const int INTERVAL = 4096;
+	static const int ALLOCATIONS_COUNT = 20000;
+	static const int SIZE = 64;
+	sampler.setInterval(INTERVAL);
+
+	static void* ptrs[ALLOCATIONS_COUNT];
+	for (void*& ptr : ptrs) ptr = allocator.allocate(SIZE);
+	for (void* ptr : ptrs) allocator.deallocate(ptr);
+	sampler.setInterval(0);
+
+	Lumix::Debug::AllocationSampler::Site sites[8];
+	int count = sampler.getSites(sites, Lumix::lengthOf(sites));
+	LUMIX_EXPECT(count == 1);
+	// about 312 samples, the estimate is within a few percent of the real size
+	size_t real_size = ALLOCATIONS_COUNT * SIZE;
+	LUMIX_EXPECT(sites[0].size > real_size * 3 / 4);
+	LUMIX_EXPECT(sites[0].size < real_size * 5 / 4);
+	LUMIX_EXPECT(sites[0].live_count == 0);
+}
+
+
+} // anonymous namespace
+
+
+REGISTER_TEST("unit_tests/engine/allocation_sampler", UT_allocation_sampler, "")
+REGISTER_TEST("unit_tests/engine/allocation_sampler_estimate", UT_allocation_sampler_estimate, "")
@@ -1,5 +1,25 @@
 #include "unit_tests/suite/lumix_unit_tests.h"
 #include "engine/crc32.h"
+#include "engine/string.h"
+
+
+namespace
+{
+	// bitwise reference implementation, the table based one must give the same values
+	Lumix::u32 referenceCrc32(Lumix::u32 crc, const Lumix::u8* data, int length)
+	{
+		crc = ~crc;
+		for (int i = 0; i < length; ++i)
+		{
+			crc ^= data[i];
+			for (int j = 0; j < 8; ++j)
+			{
+				crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+			}
+		}
+		return ~crc;
+	}
+}
 
 
 void UT_crc32(const char* params)
@@ -19,4 +39,39 @@ void UT_crc32(const char* params)
 	LUMIX_EXPECT(Lumix::crc32("\xff\xff\x12") == 0x214461C5);
 }
 
+
+void UT_crc32_compatibility(const char* params)
+{
+	static_assert(Lumix::constCrc32("123456789") == 0xCBF43926, "constCrc32 does not match crc32");
+	static_assert(Lumix::constCrc32("") == 0, "constCrc32 does not match crc32");
+
+	Lumix::u8 data[256 + 8];
+	for (int i = 0; i < Lumix::lengthOf(data); ++i)
+	{
+		data[i] = Lumix::u8(i * 131 + 7);
+	}
+
+	// all lengths around the 8 byte blocks, unaligned too
+	for (int offset = 0; offset < 8; ++offset)
+	{
+		for (int length = 0; length <= 256; ++length)
+		{
+			Lumix::u32 expected = referenceCrc32(0, data + offset, length);
+			LUMIX_EXPECT(Lumix::crc32(data + offset, length) == expected);
+		}
+	}
+
+	const char* strings[] = {"", "a", "renderer", "set_input", "u_materialColor", "models/a_long_path/to/some.msh"};
+	for (const char* str : strings)
+	{
+		int length = Lumix::stringLength(str);
+		Lumix::u32 expected = referenceCrc32(0, (const Lumix::u8*)str, length);
+		LUMIX_EXPECT(Lumix::crc32(str) == expected);
+		LUMIX_EXPECT(Lumix::constCrc32(str) == expected);
+		LUMIX_EXPECT(Lumix::crc32(str, length) == expected);
+		LUMIX_EXPECT(Lumix::continueCrc32(Lumix::crc32("prefix/"), str) == Lumix::crc32(Lumix::StaticString<64>("prefix/", str).data));
+	}
+}
+
 REGISTER_TEST("unit_tests/engine/crc32", UT_crc32, "")
+REGISTER_TEST("unit_tests/engine/crc32/compatibility", UT_crc32_compatibility, "")
@@ -1,9 +1,20 @@
 #include "unit_tests/suite/lumix_unit_tests.h"
 
+#include "engine/array.h"
+#include "engine/crc32.h"
 #include "engine/fs/file_system.h"
 #include "engine/fs/disk_file_device.h"
 #include "engine/fs/file_events_device.h"
+#include "engine/fs/memory_file_device.h"
+#include "engine/fs/os_file.h"
+#include "engine/fs/pack_builder.h"
+#include "engine/fs/pack_file_device.h"
+#include "engine/math_utils.h"
+#include "engine/mt/atomic.h"
+#include "engine/mt/task.h"
+#include "engine/mt/thread.h"
 #include "engine/path.h"
+#include "engine/string.h"
 
 namespace
 {
@@ -129,6 +140,397 @@ void UT_file_events_device(const char* params)
 };
 
 
+
+// files with content equal to their path, opening fails for paths starting with "fail",
+// opening paths starting with "file_same" takes a while and records overlapping opens
+struct TestFileDevice LUMIX_FINAL : public Lumix::FS::IFileDevice
+{
+	struct File LUMIX_FINAL : public Lumix::FS::IFile
+	{
+		explicit File(TestFileDevice& _device) : device(_device) {}
+
+		bool open(const Lumix::Path& path, Lumix::FS::Mode mode) override
+		{
+			Lumix::copyString(content, path.c_str());
+			position = 0;
+			if (Lumix::startsWith(content, "file_same"))
+			{
+				if (Lumix::MT::atomicIncrement(&device.same_path_opens) > 1) device.same_path_overlaps = 1;
+				Lumix::MT::sleep(1);
+				Lumix::MT::atomicDecrement(&device.same_path_opens);
+			}
+			return !Lumix::startsWith(content, "fail");
+		}
+
+		void close() override {}
+
+		bool read(void* buffer, size_t size) override
+		{
+			if (position + size > length()) return false;
+			Lumix::copyMemory(buffer, content + position, (int)size);
+			position += size;
+			return true;
+		}
+
+		bool write(const void* buffer, size_t size) override { return false; }
+		const void* getBuffer() const override { return nullptr; }
+		size_t size() override { return length(); }
+		size_t length() const { return Lumix::stringLength(content); }
+		bool seek(Lumix::FS::SeekMode base, size_t pos) override { return false; }
+		size_t pos() override { return position; }
+		Lumix::FS::IFileDevice& getDevice() override { return device; }
+
+		TestFileDevice& device;
+		char content[Lumix::MAX_PATH_LENGTH];
+		size_t position;
+	};
+
+	explicit TestFileDevice(Lumix::IAllocator& _allocator) : allocator(_allocator) {}
+
+	Lumix::FS::IFile* createFile(Lumix::FS::IFile*) override
+	{
+		Lumix::MT::atomicIncrement(&files_count);
+		return LUMIX_NEW(allocator, File)(*this);
+	}
+
+	void destroyFile(Lumix::FS::IFile* file) override
+	{
+		Lumix::MT::atomicDecrement(&files_count);
+		LUMIX_DELETE(allocator, file);
+	}
+
+	const char* name() const override { return "test"; }
+
+	Lumix::IAllocator& allocator;
+	volatile Lumix::i32 files_count = 0;
+	volatile Lumix::i32 same_path_opens = 0;
+	volatile Lumix::i32 same_path_overlaps = 0;
+};
+
+
+struct AsyncLoader
+{
+	void onLoaded(Lumix::FS::IFile& file, bool success)
+	{
+		if (!success)
+		{
+			++failed;
+			return;
+		}
+		++loaded;
+		// the data are already in memory
+		const char* buffer = (const char*)file.getBuffer();
+		LUMIX_EXPECT(buffer != nullptr);
+		if (buffer) LUMIX_EXPECT(Lumix::startsWith(buffer, "file"));
+	}
+
+	int loaded = 0;
+	int failed = 0;
+};
+
+
+void UT_async(const char* params)
+{
+	static const int FILES_COUNT = 200;
+
+	Lumix::DefaultAllocator allocator;
+	Lumix::PathManager path_manager(allocator);
+	Lumix::FS::FileSystem* file_system = Lumix::FS::FileSystem::create(allocator);
+	TestFileDevice device(allocator);
+	file_system->mount(&device);
+	Lumix::FS::DeviceList device_list;
+	file_system->fillDeviceList("test", device_list);
+
+	AsyncLoader loader;
+	Lumix::FS::ReadCallback cb;
+	cb.bind<AsyncLoader, &AsyncLoader::onLoaded>(&loader);
+
+	// more than the old limit of 16 requests in flight
+	int canceled = 0;
+	for (int i = 0; i < FILES_COUNT; ++i)
+	{
+		Lumix::StaticString<Lumix::MAX_PATH_LENGTH> path("file", i, ".txt");
+		Lumix::u32 id = file_system->openAsync(device_list, Lumix::Path(path), Lumix::FS::Mode::OPEN_AND_READ, cb, i % 3);
+		LUMIX_EXPECT(id != Lumix::FS::FileSystem::INVALID_ASYNC);
+		if (i % 10 == 0)
+		{
+			file_system->cancelAsync(id);
+			++canceled;
+		}
+	}
+	file_system->openAsync(device_list, Lumix::Path("fail.txt"), Lumix::FS::Mode::OPEN_AND_READ, cb);
+
+	while (file_system->hasWork())
+	{
+		file_system->updateAsyncTransactions();
+		Lumix::MT::yield();
+	}
+
+	LUMIX_EXPECT(loader.loaded == FILES_COUNT - canceled);
+	LUMIX_EXPECT(loader.failed == 1);
+	LUMIX_EXPECT(device.files_count == 0);
+
+	// requests for the same path are never processed at the same time, whatever their priority
+	static const int SAME_PATH_COUNT = 16;
+	for (int i = 0; i < SAME_PATH_COUNT; ++i)
+	{
+		file_system->openAsync(device_list, Lumix::Path("file_same.txt"), Lumix::FS::Mode::OPEN_AND_READ, cb, i);
+	}
+	while (file_system->hasWork())
+	{
+		file_system->updateAsyncTransactions();
+		Lumix::MT::yield();
+	}
+	LUMIX_EXPECT(device.same_path_overlaps == 0);
+	LUMIX_EXPECT(loader.loaded == FILES_COUNT - canceled + SAME_PATH_COUNT);
+	LUMIX_EXPECT(device.files_count == 0);
+
+	// requests still in flight are released when the file system is destroyed
+	file_system->openAsync(device_list, Lumix::Path("file.txt"), Lumix::FS::Mode::OPEN_AND_READ, cb);
+	Lumix::FS::FileSystem::destroy(file_system);
+	LUMIX_EXPECT(device.files_count == 0);
+	LUMIX_EXPECT(loader.loaded == FILES_COUNT - canceled + SAME_PATH_COUNT);
+}
+
+
+
+static const char* PACK_PATH = "unit_tests/file_system/test.pak";
+static const char* PACKED_FILES[] = {"a.txt", "dir/b.txt", "empty.txt", "dir/c.bin"};
+static const char* PACKED_CONTENTS[] = {"first file", "second file", "", "third file, the longest one"};
+
+
+void writePack(Lumix::IAllocator& allocator)
+{
+	Lumix::FS::OsFile file;
+	LUMIX_EXPECT(file.open(PACK_PATH, Lumix::FS::Mode::CREATE_AND_WRITE, allocator));
+	Lumix::i32 count = Lumix::lengthOf(PACKED_FILES);
+	file.write(&count, sizeof(count));
+	Lumix::u64 offset = sizeof(count) + (sizeof(Lumix::u32) + sizeof(Lumix::u64) * 2) * count;
+	for (int i = 0; i < count; ++i)
+	{
+		Lumix::u32 hash = Lumix::crc32(PACKED_FILES[i]);
+		Lumix::u64 size = Lumix::stringLength(PACKED_CONTENTS[i]);
+		file.write(&hash, sizeof(hash));
+		file.write(&offset, sizeof(offset));
+		file.write(&size, sizeof(size));
+		offset += size;
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		file.write(PACKED_CONTENTS[i], Lumix::stringLength(PACKED_CONTENTS[i]));
+	}
+	file.close();
+}
+
+
+bool checkPackedFile(Lumix::FS::FileSystem& file_system, const Lumix::FS::DeviceList& device_list, int index)
+{
+	Lumix::FS::IFile* file = file_system.open(device_list, Lumix::Path(PACKED_FILES[index]), Lumix::FS::Mode::OPEN_AND_READ);
+	if (!file) return false;
+
+	const char* content = PACKED_CONTENTS[index];
+	size_t size = Lumix::stringLength(content);
+	char tmp[64];
+	bool is_valid = file->size() == size && file->read(tmp, size) && !file->read(tmp, 1);
+	is_valid = is_valid && Lumix::compareMemory(tmp, content, size) == 0;
+	is_valid = is_valid && Lumix::compareMemory(file->getBuffer(), content, size) == 0;
+	is_valid = is_valid && file->seek(Lumix::FS::SeekMode::END, 0) && file->pos() == size;
+	file_system.close(*file);
+	return is_valid;
+}
+
+
+class PackReadTask : public Lumix::MT::Task
+{
+public:
+	PackReadTask(Lumix::FS::FileSystem& file_system, const Lumix::FS::DeviceList& device_list, Lumix::IAllocator& allocator)
+		: Lumix::MT::Task(allocator)
+		, m_file_system(file_system)
+		, m_device_list(device_list)
+		, m_is_valid(true)
+	{
+	}
+
+	int task() override
+	{
+		for (int i = 0; i < 5000; ++i)
+		{
+			int index = i % Lumix::lengthOf(PACKED_FILES);
+			m_is_valid = m_is_valid && checkPackedFile(m_file_system, m_device_list, index);
+		}
+		return 0;
+	}
+
+	bool isValid() const { return m_is_valid; }
+
+private:
+	Lumix::FS::FileSystem& m_file_system;
+	const Lumix::FS::DeviceList& m_device_list;
+	bool m_is_valid;
+};
+
+
+void UT_pack_file_device(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::PathManager path_manager(allocator);
+	writePack(allocator);
+
+	Lumix::FS::FileSystem* file_system = Lumix::FS::FileSystem::create(allocator);
+	Lumix::FS::PackFileDevice pack_device(allocator);
+	Lumix::FS::MemoryFileDevice memory_device(allocator);
+	LUMIX_EXPECT(!pack_device.mount("unit_tests/file_system/does_not_exist.pak"));
+	LUMIX_EXPECT(pack_device.mount(PACK_PATH));
+	file_system->mount(&pack_device);
+	file_system->mount(&memory_device);
+
+	Lumix::FS::DeviceList device_list;
+	file_system->fillDeviceList("pack", device_list);
+	for (int i = 0; i < Lumix::lengthOf(PACKED_FILES); ++i)
+	{
+		LUMIX_EXPECT(checkPackedFile(*file_system, device_list, i));
+	}
+	LUMIX_EXPECT(!file_system->open(device_list, Lumix::Path("not_packed.txt"), Lumix::FS::Mode::OPEN_AND_READ));
+
+	// memory device uses the mapped data directly
+	Lumix::FS::DeviceList memory_list;
+	file_system->fillDeviceList("memory:pack", memory_list);
+	Lumix::FS::IFile* file = file_system->open(device_list, Lumix::Path(PACKED_FILES[1]), Lumix::FS::Mode::OPEN_AND_READ);
+	Lumix::FS::IFile* memory_file = file_system->open(memory_list, Lumix::Path(PACKED_FILES[1]), Lumix::FS::Mode::OPEN_AND_READ);
+	LUMIX_EXPECT(file != nullptr);
+	LUMIX_EXPECT(memory_file != nullptr);
+	if (file && memory_file) LUMIX_EXPECT(file->getBuffer() == memory_file->getBuffer());
+	if (file) file_system->close(*file);
+	if (memory_file) file_system->close(*memory_file);
+
+	static const int THREADS_COUNT = 4;
+	PackReadTask* tasks[THREADS_COUNT];
+	for (int i = 0; i < THREADS_COUNT; ++i)
+	{
+		tasks[i] = LUMIX_NEW(allocator, PackReadTask)(*file_system, i % 2 ? device_list : memory_list, allocator);
+		tasks[i]->create("pack_read");
+	}
+	for (PackReadTask* task : tasks)
+	{
+		while (!task->isFinished()) Lumix::MT::yield();
+		task->destroy();
+		LUMIX_EXPECT(task->isValid());
+		LUMIX_DELETE(allocator, task);
+	}
+
+	Lumix::FS::FileSystem::destroy(file_system);
+}
+
+
+static const char* BUILDER_FILES[] = {"unit_tests/file_system/pb_a.txt",
+	"unit_tests/file_system/pb_b.txt",
+	"unit_tests/file_system/pb_copy_of_a.txt",
+	"unit_tests/file_system/pb_empty.txt"};
+
+
+void writeFile(const char* path, const void* data, size_t size, Lumix::IAllocator& allocator)
+{
+	Lumix::FS::OsFile file;
+	LUMIX_EXPECT(file.open(path, Lumix::FS::Mode::CREATE_AND_WRITE, allocator));
+	if (size > 0) file.write(data, size);
+	file.close();
+}
+
+
+bool checkBuiltFile(Lumix::FS::FileSystem& file_system,
+	const Lumix::FS::DeviceList& device_list,
+	const char* path,
+	const Lumix::Array<char>& content)
+{
+	Lumix::FS::IFile* file = file_system.open(device_list, Lumix::Path(path), Lumix::FS::Mode::OPEN_AND_READ);
+	if (!file) return false;
+
+	bool is_valid = file->size() == (size_t)content.size();
+	is_valid = is_valid && (content.empty() || Lumix::compareMemory(file->getBuffer(), &content[0], content.size()) == 0);
+	file_system.close(*file);
+	return is_valid;
+}
+
+
+void UT_pack_builder(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::PathManager path_manager(allocator);
+
+	// a compresses well, b does not, copy_of_a is stored only once
+	Lumix::Array<char> a(allocator);
+	Lumix::Array<char> b(allocator);
+	Lumix::Array<char> copy_of_a(allocator);
+	Lumix::Array<char> empty(allocator);
+	for (int i = 0; i < 1000; ++i) a.push("abcdefgh"[i % 8] + (i % 100 == 0 ? 1 : 0));
+	Lumix::Math::seedRandom(5);
+	for (int i = 0; i < 333; ++i) b.push((char)Lumix::Math::rand(0, 255));
+	for (char c : a) copy_of_a.push(c);
+	const Lumix::Array<char>* contents[] = {&a, &b, &copy_of_a, &empty};
+	for (int i = 0; i < Lumix::lengthOf(BUILDER_FILES); ++i)
+	{
+		writeFile(BUILDER_FILES[i], contents[i]->empty() ? nullptr : &(*contents[i])[0], contents[i]->size(), allocator);
+	}
+	static const char LOAD_ORDER[] = "unit_tests/file_system/pb_b.txt\r\nnot_packed.txt\nunit_tests/file_system/pb_a.txt\n";
+	static const char* LOAD_ORDER_PATH = "unit_tests/file_system/pb_load_order.txt";
+	writeFile(LOAD_ORDER_PATH, LOAD_ORDER, Lumix::stringLength(LOAD_ORDER), allocator);
+	static const char* BUILT_PACK_PATH = "unit_tests/file_system/pb_test.pak";
+
+	Lumix::FS::PackBuilder builder(allocator);
+	for (const char* path : BUILDER_FILES) builder.addFile(path);
+	LUMIX_EXPECT(builder.setLoadOrder(LOAD_ORDER_PATH));
+	LUMIX_EXPECT(builder.build(BUILT_PACK_PATH, 16, true));
+
+	// check the header
+	Lumix::FS::OsFile file;
+	LUMIX_EXPECT(file.open(BUILT_PACK_PATH, Lumix::FS::Mode::OPEN_AND_READ, allocator));
+	Lumix::u32 header[3];
+	file.read(header, sizeof(header));
+	LUMIX_EXPECT(header[0] == Lumix::FS::PackFileDevice::MAGIC);
+	LUMIX_EXPECT(header[1] == Lumix::FS::PackFileDevice::VERSION);
+	LUMIX_EXPECT(header[2] == Lumix::lengthOf(BUILDER_FILES));
+	#pragma pack(1)
+	struct Entry
+	{
+		Lumix::u32 hash;
+		Lumix::u64 offset;
+		Lumix::u64 size;
+		Lumix::u64 compressed_size;
+	};
+	#pragma pack()
+	Entry entries[Lumix::lengthOf(BUILDER_FILES)];
+	file.read(entries, sizeof(entries));
+	file.close();
+
+	LUMIX_EXPECT(entries[0].hash == Lumix::crc32(BUILDER_FILES[1]));
+	LUMIX_EXPECT(entries[1].hash == Lumix::crc32(BUILDER_FILES[0]));
+	LUMIX_EXPECT(entries[0].compressed_size == 0);
+	LUMIX_EXPECT(entries[1].compressed_size > 0);
+	LUMIX_EXPECT(entries[1].compressed_size < entries[1].size);
+	LUMIX_EXPECT(entries[0].offset < entries[1].offset);
+	LUMIX_EXPECT(entries[2].offset == entries[1].offset);
+	for (const Entry& entry : entries)
+	{
+		LUMIX_EXPECT(entry.offset % 16 == 0);
+	}
+
+	Lumix::FS::FileSystem* file_system = Lumix::FS::FileSystem::create(allocator);
+	Lumix::FS::PackFileDevice pack_device(allocator);
+	LUMIX_EXPECT(pack_device.mount(BUILT_PACK_PATH));
+	file_system->mount(&pack_device);
+	Lumix::FS::DeviceList device_list;
+	file_system->fillDeviceList("pack", device_list);
+	for (int i = 0; i < Lumix::lengthOf(BUILDER_FILES); ++i)
+	{
+		LUMIX_EXPECT(checkBuiltFile(*file_system, device_list, BUILDER_FILES[i], *contents[i]));
+	}
+	Lumix::FS::FileSystem::destroy(file_system);
+}
+
+
 } // anonymous namespace
 
 REGISTER_TEST("unit_tests/engine/file_system/file_events_device", UT_file_events_device, "")
+REGISTER_TEST("unit_tests/engine/file_system/async", UT_async, "")
+REGISTER_TEST("unit_tests/engine/file_system/pack_file_device", UT_pack_file_device, "")
+REGISTER_TEST("unit_tests/engine/file_system/pack_builder", UT_pack_builder, "")
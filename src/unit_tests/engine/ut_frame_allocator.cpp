@@ -0,0 +1,153 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/array.h"
+#include "engine/debug/debug.h"
+#include "engine/default_allocator.h"
+#include "engine/frame_allocator.h"
+#include "engine/mt/task.h"
+#include "engine/mt/thread.h"
+
+
+namespace
+{
+
+
+static const size_t PAGE_SIZE = 1024;
+
+
+void UT_frame_allocator(const char* params)
+{
+	Lumix::DefaultAllocator main_allocator;
+	Lumix::Debug::Allocator source(main_allocator);
+	{
+		Lumix::FrameAllocator allocator(source, PAGE_SIZE);
+
+		// last allocation is given back
+		void* a = allocator.allocate(100);
+		void* b = allocator.allocate_aligned(10, 64);
+		LUMIX_EXPECT((Lumix::uintptr)b % 64 == 0);
+		allocator.deallocate_aligned(b);
+		void* c = allocator.allocate_aligned(10, 64);
+		LUMIX_EXPECT(b == c);
+
+		// the last allocation grows in place
+		void* d = allocator.reallocate(allocator.allocate(16), 32);
+		LUMIX_EXPECT(allocator.reallocate(d, 64) == d);
+
+		// not enough space in the page, a new page is chained
+		{
+			Lumix::Array<int> array(allocator);
+			for (int i = 0; i < 1000; ++i) array.push(i);
+			LUMIX_EXPECT(allocator.getPagesCount() > 1);
+			for (int i = 0; i < 1000; ++i) LUMIX_EXPECT(array[i] == i);
+			LUMIX_EXPECT(allocator.getPeak() >= 1000 * sizeof(int));
+
+			// deallocation in any order
+			allocator.deallocate(a);
+			allocator.deallocate(d);
+			allocator.deallocate_aligned(c);
+			LUMIX_EXPECT(allocator.getPagesCount() > 1);
+		}
+		// the last deallocation rewinds the allocator and merges its pages
+		LUMIX_EXPECT(allocator.getPagesCount() == 1);
+
+		Lumix::Array<int> array(allocator);
+		for (int i = 0; i < 1000; ++i) array.push(i);
+		LUMIX_EXPECT(allocator.getPagesCount() == 1);
+	}
+	LUMIX_EXPECT(source.getTotalSize() == 0);
+}
+
+
+void UT_frame_allocator_frame_end(const char* params)
+{
+	Lumix::DefaultAllocator main_allocator;
+	Lumix::Debug::Allocator source(main_allocator);
+	{
+		Lumix::FrameAllocator allocator(source, PAGE_SIZE);
+
+		// an allocation outliving its frame does not block the rewind
+		void* outlived = allocator.allocate(100);
+		{
+			Lumix::Array<int> array(allocator);
+			for (int i = 0; i < 1000; ++i) array.push(i);
+		}
+		LUMIX_EXPECT(allocator.getPagesCount() > 1);
+		Lumix::FrameAllocator::frame();
+		void* a = allocator.allocate(100);
+		LUMIX_EXPECT(allocator.getPagesCount() == 1);
+		LUMIX_EXPECT(allocator.getPeak() < PAGE_SIZE);
+		allocator.deallocate(outlived);
+		allocator.deallocate(a);
+
+		// a spike grows the page, frames using less memory shrink it back
+		void* spike[64];
+		for (void*& ptr : spike) ptr = allocator.allocate(PAGE_SIZE / 2);
+		for (void* ptr : spike) allocator.deallocate(ptr);
+		LUMIX_EXPECT(allocator.getPageSize() > 32 * PAGE_SIZE);
+		for (int i = 0; i < 10; ++i)
+		{
+			Lumix::FrameAllocator::frame();
+			allocator.deallocate(allocator.allocate(16));
+		}
+		LUMIX_EXPECT(allocator.getPageSize() == PAGE_SIZE);
+	}
+	LUMIX_EXPECT(source.getTotalSize() == 0);
+}
+
+
+class ArrayTask : public Lumix::MT::Task
+{
+public:
+	explicit ArrayTask(Lumix::IAllocator& allocator)
+		: Task(allocator)
+		, frame_allocator(nullptr)
+		, is_valid(true)
+	{
+	}
+
+	int task() override
+	{
+		frame_allocator = &Lumix::FrameAllocator::get();
+		for (int j = 0; j < 100; ++j)
+		{
+			Lumix::Array<int> array(*frame_allocator);
+			for (int i = 0; i < 10000; ++i) array.push(i + j);
+			for (int i = 0; i < 10000; ++i) is_valid = is_valid && array[i] == i + j;
+		}
+		return 0;
+	}
+
+	Lumix::FrameAllocator* frame_allocator;
+	bool is_valid;
+};
+
+
+void UT_frame_allocator_threads(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	static const int THREADS_COUNT = 4;
+	ArrayTask* tasks[THREADS_COUNT];
+	for (auto& task : tasks)
+	{
+		task = LUMIX_NEW(allocator, ArrayTask)(allocator);
+		task->create("frame_allocator");
+	}
+	for (auto* task : tasks)
+	{
+		while (!task->isFinished()) Lumix::MT::yield();
+		task->destroy();
+		LUMIX_EXPECT(task->is_valid);
+		LUMIX_EXPECT(task->frame_allocator != &Lumix::FrameAllocator::get());
+	}
+	LUMIX_EXPECT(tasks[0]->frame_allocator != tasks[1]->frame_allocator);
+	for (auto* task : tasks) LUMIX_DELETE(allocator, task);
+}
+
+
+} // anonymous namespace
+
+
+REGISTER_TEST("unit_tests/engine/frame_allocator", UT_frame_allocator, "")
+REGISTER_TEST("unit_tests/engine/frame_allocator_frame_end", UT_frame_allocator_frame_end, "")
+REGISTER_TEST("unit_tests/engine/frame_allocator_threads", UT_frame_allocator_threads, "")
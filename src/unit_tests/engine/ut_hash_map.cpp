@@ -1,8 +1,12 @@
 #include "unit_tests/suite/lumix_unit_tests.h"
 
 #include "engine/array.h"
+#include "engine/flat_hash_map.h"
 #include "engine/hash_map.h"
 #include "engine/debug/debug.h"
+#include "engine/log.h"
+#include "engine/math_utils.h"
+#include "engine/timer.h"
 
 namespace
 {
@@ -106,10 +110,246 @@ namespace
 		hash_table.insert(26, 26);// 15 and 26 collide
 		hash_table.rehash(64);
 	}
+
+	// random operations compared with an array of values indexed by key
+	void UT_flat(const char* params)
+	{
+		static const int KEYS_COUNT = 1000;
+
+		Lumix::DefaultAllocator main_allocator;
+		Lumix::Debug::Allocator allocator(main_allocator);
+		Lumix::FlatHashMap<i32, i32> hash_table(allocator);
+		Lumix::Array<i32> expected(allocator);
+		expected.resize(KEYS_COUNT);
+		for (i32& value : expected) value = -1;
+		Lumix::Math::seedRandom(3);
+
+		LUMIX_EXPECT(hash_table.empty());
+		LUMIX_EXPECT(!hash_table.find(0).isValid());
+
+		int count = 0;
+		for (int i = 0; i < 20000; ++i)
+		{
+			i32 key = Lumix::Math::rand(0, KEYS_COUNT - 1);
+			if (Lumix::Math::rand(0, 2) == 0)
+			{
+				LUMIX_EXPECT(hash_table.erase(key) == (expected[key] >= 0 ? 1u : 0u));
+				if (expected[key] >= 0) --count;
+				expected[key] = -1;
+			}
+			else
+			{
+				if (expected[key] < 0) ++count;
+				expected[key] = i;
+				hash_table.insert(key, i);
+			}
+		}
+
+		LUMIX_EXPECT(hash_table.size() == (Lumix::u32)count);
+		for (i32 key = 0; key < KEYS_COUNT; ++key)
+		{
+			auto iter = hash_table.find(key);
+			LUMIX_EXPECT(iter.isValid() == (expected[key] >= 0));
+			if (iter.isValid()) LUMIX_EXPECT(iter.value() == expected[key]);
+		}
+
+		int iterated = 0;
+		const Lumix::FlatHashMap<i32, i32>& const_hash_table = hash_table;
+		for (auto iter = const_hash_table.begin(); iter != const_hash_table.end(); ++iter)
+		{
+			LUMIX_EXPECT(iter.value() == expected[iter.key()]);
+			++iterated;
+		}
+		LUMIX_EXPECT(iterated == count);
+
+		Lumix::FlatHashMap<i32, i32> copy(hash_table);
+		LUMIX_EXPECT(copy.size() == hash_table.size());
+
+		// erase odd keys while iterating
+		for (auto iter = hash_table.begin(); iter != hash_table.end();)
+		{
+			if (iter.key() % 2 == 1)
+			{
+				expected[iter.key()] = -1;
+				iter = hash_table.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+		for (i32 key = 0; key < KEYS_COUNT; ++key)
+		{
+			LUMIX_EXPECT(hash_table.find(key).isValid() == (expected[key] >= 0));
+		}
+		for (auto iter = copy.begin(); iter != copy.end(); ++iter)
+		{
+			if (iter.key() % 2 == 0) LUMIX_EXPECT(iter.value() == expected[iter.key()]);
+		}
+
+		hash_table.clear();
+		LUMIX_EXPECT(hash_table.empty());
+		hash_table.rehash(1024);
+		LUMIX_EXPECT(hash_table.capacity() == 1024);
+
+		Lumix::FlatHashMap<i32, Lumix::Array<int>> arrays(allocator);
+		for (i32 i = 0; i < 100; ++i)
+		{
+			Lumix::Array<int> tmp(allocator);
+			tmp.push(i);
+			arrays.insert(i, tmp);
+		}
+		for (i32 i = 0; i < 100; i += 2) arrays.erase(i);
+		for (i32 i = 1; i < 100; i += 2) LUMIX_EXPECT(arrays[i][0] == i);
+	}
+
+	// the home slot of a key is the key itself, so the tests can place elements around the wrap
+	struct IdentityHash
+	{
+		static Lumix::u32 get(i32 key) { return (Lumix::u32)key; }
+	};
+
+	typedef Lumix::FlatHashMap<i32, i32, IdentityHash> IdentityMap;
+
+	// erases keys for which is_erased is true while iterating, every element must be visited once
+	template <typename F>
+	void eraseWhileIterating(IdentityMap& map, const i32* keys, int keys_count, F is_erased)
+	{
+		int visits[64] = {};
+		for (auto iter = map.begin(); iter != map.end();)
+		{
+			++visits[iter.key()];
+			if (is_erased(iter.key()))
+			{
+				iter = map.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+		for (int i = 0; i < keys_count; ++i)
+		{
+			LUMIX_EXPECT(visits[keys[i]] == 1);
+			LUMIX_EXPECT(map.find(keys[i]).isValid() == !is_erased(keys[i]));
+		}
+	}
+
+	void UT_flat_erase_wrap(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+
+		// 15 and 23 wrap to slots 0 and 1, erasing 7 from the last slot shifts 15 back into it
+		{
+			IdentityMap map(allocator);
+			LUMIX_EXPECT(map.capacity() == 8);
+			const i32 keys[] = {7, 15, 23, 2};
+			for (i32 key : keys) map.insert(key, key);
+			eraseWhileIterating(map, keys, Lumix::lengthOf(keys), [](i32 key) { return key == 7; });
+		}
+
+		// 22 wraps to slot 0, erasing 6 shifts 14 to slot 6 and 22 to the last slot
+		{
+			IdentityMap map(allocator);
+			const i32 keys[] = {6, 14, 22};
+			for (i32 key : keys) map.insert(key, key);
+			eraseWhileIterating(map, keys, Lumix::lengthOf(keys), [](i32 key) { return key == 6; });
+		}
+
+		// several erases shift more visited elements over the wrap
+		{
+			IdentityMap map(allocator);
+			const i32 keys[] = {6, 14, 22, 30};
+			for (i32 key : keys) map.insert(key, key);
+			eraseWhileIterating(map, keys, Lumix::lengthOf(keys), [](i32 key) { return key == 6 || key == 14; });
+			eraseWhileIterating(map, keys + 2, 2, [](i32 key) { return true; });
+			LUMIX_EXPECT(map.empty());
+		}
+	}
+
+	struct BenchmarkResult
+	{
+		float insert;
+		float find;
+		float erase;
+		Lumix::u32 checksum;
+	};
+
+	template <typename Map>
+	BenchmarkResult benchmark(Lumix::IAllocator& allocator, const Lumix::Array<Lumix::u32>& keys)
+	{
+		static const int LOOKUPS_COUNT = 10;
+
+		BenchmarkResult result;
+		Lumix::Timer* timer = Lumix::Timer::create(allocator);
+		Map map(allocator);
+		for (int i = 0; i < keys.size(); ++i)
+		{
+			map.insert(keys[i], i);
+		}
+		result.insert = timer->tick();
+
+		Lumix::u32 sum = 0;
+		for (int j = 0; j < LOOKUPS_COUNT; ++j)
+		{
+			for (Lumix::u32 key : keys)
+			{
+				auto iter = map.find(key ^ (j & 1));
+				if (iter.isValid()) sum += iter.value();
+			}
+		}
+		result.find = timer->tick();
+
+		for (int i = 0; i < keys.size(); i += 2)
+		{
+			map.erase(keys[i]);
+		}
+		result.erase = timer->tick();
+		result.checksum = sum + map.size();
+		Lumix::Timer::destroy(timer);
+		return result;
+	}
+
+	void logResult(const char* name, const BenchmarkResult& result)
+	{
+		Lumix::g_log_info.log("unit") << name << " insert: " << result.insert * 1000 << " ms, find: "
+									  << result.find * 1000 << " ms, erase: " << result.erase * 1000 << " ms";
+	}
+
+	// inserts, lookups (half of them misses) and erases
+	void UT_benchmark(const char* params)
+	{
+		static const int KEYS_COUNT = 200000;
+
+		Lumix::DefaultAllocator allocator;
+		Lumix::Array<Lumix::u32> keys(allocator);
+		Lumix::Math::seedRandom(7);
+		// even keys in random order, odd keys are misses
+		for (int i = 0; i < KEYS_COUNT; ++i)
+		{
+			keys.push(i * 2);
+		}
+		for (int i = KEYS_COUNT - 1; i > 0; --i)
+		{
+			int j = Lumix::Math::rand(0, i);
+			Lumix::u32 tmp = keys[i];
+			keys[i] = keys[j];
+			keys[j] = tmp;
+		}
+
+		BenchmarkResult chained = benchmark<Lumix::HashMap<Lumix::u32, int>>(allocator, keys);
+		BenchmarkResult flat = benchmark<Lumix::FlatHashMap<Lumix::u32, int>>(allocator, keys);
+		LUMIX_EXPECT(chained.checksum == flat.checksum);
+		logResult("HashMap", chained);
+		logResult("FlatHashMap", flat);
+	}
 }
 
 REGISTER_TEST("unit_tests/engine/hash_map/insert", UT_insert, "")
 REGISTER_TEST("unit_tests/engine/hash_map/array", UT_array, "")
 REGISTER_TEST("unit_tests/engine/hash_map/clear", UT_clear, "")
 REGISTER_TEST("unit_tests/engine/hash_map/constIterator", UT_constIterator, "")
+REGISTER_TEST("unit_tests/engine/hash_map/flat", UT_flat, "")
+REGISTER_TEST("unit_tests/engine/hash_map/flat_erase_wrap", UT_flat_erase_wrap, "")
+REGISTER_TEST("unit_tests/engine/hash_map/benchmark", UT_benchmark, "")
 
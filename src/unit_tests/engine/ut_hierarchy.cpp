@@ -0,0 +1,118 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "engine/property_register.h"
+#include "engine/universe/hierarchy.h"
+#include "engine/universe/universe.h"
+
+
+namespace
+{
+	const Lumix::ComponentType HIERARCHY_TYPE = Lumix::PropertyRegister::getComponentType("hierarchy");
+
+
+	struct MoveCounter
+	{
+		explicit MoveCounter(Lumix::Universe& _universe)
+			: universe(_universe)
+		{
+			universe.entityTransformed().bind<MoveCounter, &MoveCounter::onEntityMoved>(this);
+		}
+
+		~MoveCounter() { universe.entityTransformed().unbind<MoveCounter, &MoveCounter::onEntityMoved>(this); }
+
+		void onEntityMoved(Lumix::Entity entity) { ++count; }
+
+		Lumix::Universe& universe;
+		int count = 0;
+	};
+
+
+	void expectPosition(Lumix::Universe& universe, Lumix::Entity entity, float x, float y, float z)
+	{
+		Lumix::Vec3 pos = universe.getPosition(entity);
+		LUMIX_EXPECT_CLOSE_EQ(pos.x, x, 0.0001f);
+		LUMIX_EXPECT_CLOSE_EQ(pos.y, y, 0.0001f);
+		LUMIX_EXPECT_CLOSE_EQ(pos.z, z, 0.0001f);
+	}
+
+
+	void UT_hierarchy(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::PathManager path_manager(allocator);
+		Lumix::Universe universe(allocator);
+		Lumix::HierarchyPlugin plugin(allocator);
+		Lumix::Hierarchy* hierarchy = Lumix::Hierarchy::create(plugin, universe, allocator);
+		Lumix::Quat identity(0, 0, 0, 1);
+
+		// chain root <- a <- b <- c and a second child d of root
+		static const int CHAIN_LENGTH = 4;
+		Lumix::Entity chain[CHAIN_LENGTH];
+		for (int i = 0; i < CHAIN_LENGTH; ++i)
+		{
+			chain[i] = universe.createEntity({0, float(i), 0}, identity);
+			if (i > 0)
+			{
+				Lumix::ComponentHandle cmp = hierarchy->createComponent(HIERARCHY_TYPE, chain[i]);
+				hierarchy->setParent(cmp, chain[i - 1]);
+			}
+		}
+		Lumix::Entity d = universe.createEntity({5, 0, 0}, identity);
+		hierarchy->setParent(hierarchy->createComponent(HIERARCHY_TYPE, d), chain[0]);
+
+		// moving the root moves the whole tree, every entity is notified once
+		MoveCounter counter(universe);
+		universe.setPosition(chain[0], 10, 0, 0);
+		LUMIX_EXPECT(counter.count == CHAIN_LENGTH + 1);
+		expectPosition(universe, chain[3], 10, 3, 0);
+		expectPosition(universe, d, 15, 0, 0);
+
+		// moving a child changes its local transform and moves its subtree
+		universe.setPosition(chain[2], 10, 10, 0);
+		expectPosition(universe, chain[3], 10, 11, 0);
+		Lumix::Vec3 local = hierarchy->getLocalPosition({chain[2].index});
+		LUMIX_EXPECT_CLOSE_EQ(local.y, 9.0f, 0.0001f);
+
+		// batched local transforms
+		Lumix::Entity entities[] = {chain[3], chain[1], d};
+		Lumix::Transform locals[] = {
+			{{0, 0, 1}, identity},
+			{{0, 2, 0}, identity},
+			{{0, 0, 7}, identity}
+		};
+		counter.count = 0;
+		hierarchy->setLocalTransforms(entities, locals, Lumix::lengthOf(entities));
+		LUMIX_EXPECT(counter.count == 4);
+		expectPosition(universe, chain[1], 10, 2, 0);
+		expectPosition(universe, chain[2], 10, 11, 0);
+		expectPosition(universe, chain[3], 10, 11, 1);
+		expectPosition(universe, d, 10, 0, 7);
+
+		// deferred notifications give the same result as immediate ones
+		universe.deferTransformNotifications(true);
+		universe.setPosition(chain[3], 0, 0, 0);
+		universe.setPosition(chain[0], 20, 0, 0);
+		universe.flushTransforms();
+		expectPosition(universe, chain[3], 10, 0, 0);
+		expectPosition(universe, chain[2], 20, 11, 0);
+		expectPosition(universe, d, 20, 0, 7);
+
+		universe.setPosition(chain[0], 30, 0, 0);
+		universe.setPosition(chain[3], 0, 0, 0);
+		universe.flushTransforms();
+		expectPosition(universe, chain[3], 0, 0, 0);
+		expectPosition(universe, chain[2], 30, 11, 0);
+		universe.deferTransformNotifications(false);
+
+		// reparenting
+		hierarchy->setParent({d.index}, chain[3]);
+		LUMIX_EXPECT(hierarchy->getParent({d.index}) == chain[3]);
+		universe.setPosition(chain[3], 1, 1, 1);
+		expectPosition(universe, d, 31, 1, 8);
+		universe.setPosition(chain[0], 40, 0, 0);
+		expectPosition(universe, d, 41, 1, 8);
+
+		Lumix::Hierarchy::destroy(hierarchy);
+	}
+} // anonymous namespace
+
+REGISTER_TEST("unit_tests/engine/hierarchy", UT_hierarchy, "");
@@ -0,0 +1,67 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/array.h"
+#include "engine/lz4.h"
+#include "engine/math_utils.h"
+#include "engine/string.h"
+
+
+namespace
+{
+
+
+bool roundTrip(Lumix::IAllocator& allocator, const Lumix::u8* data, int size, int* compressed_size)
+{
+	Lumix::Array<Lumix::u8> compressed(allocator);
+	compressed.resize(Lumix::LZ4::compressBound(size));
+	*compressed_size = Lumix::LZ4::compress(data, size, &compressed[0], compressed.size());
+	if (*compressed_size <= 0) return false;
+
+	Lumix::Array<Lumix::u8> decompressed(allocator);
+	decompressed.resize(size + 1);
+	if (!Lumix::LZ4::decompress(&compressed[0], *compressed_size, &decompressed[0], size)) return false;
+	return size == 0 || Lumix::compareMemory(data, &decompressed[0], size) == 0;
+}
+
+
+void UT_lz4(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::Array<Lumix::u8> data(allocator);
+	int compressed_size;
+
+	// repeated text compresses well
+	static const char TEXT[] = "material { shader \"pipelines/common.shd\"; texture \"albedo.dds\"; }\n";
+	for (int i = 0; i < 500; ++i)
+	{
+		for (int j = 0; j < Lumix::lengthOf(TEXT) - 1; ++j) data.push(TEXT[j]);
+		data.push(Lumix::u8('0' + i % 10));
+	}
+	LUMIX_EXPECT(roundTrip(allocator, &data[0], data.size(), &compressed_size));
+	LUMIX_EXPECT(compressed_size < data.size() / 10);
+
+	// random data does not, but it still round trips
+	Lumix::Math::seedRandom(11);
+	for (Lumix::u8& c : data) c = (Lumix::u8)Lumix::Math::rand(0, 255);
+	LUMIX_EXPECT(roundTrip(allocator, &data[0], data.size(), &compressed_size));
+	LUMIX_EXPECT(compressed_size <= Lumix::LZ4::compressBound(data.size()));
+
+	// inputs shorter than the minimal match are just literals
+	for (int size = 1; size < 20; ++size)
+	{
+		LUMIX_EXPECT(roundTrip(allocator, &data[0], size, &compressed_size));
+	}
+
+	// corrupted input must not write out of bounds
+	Lumix::u8 out[16];
+	const Lumix::u8 too_long_literals[] = {0xf0, 0xff, 0x10, 'a', 'b'};
+	LUMIX_EXPECT(!Lumix::LZ4::decompress(too_long_literals, sizeof(too_long_literals), out, sizeof(out)));
+	const Lumix::u8 bad_offset[] = {0x14, 'a', 0x10, 0x00};
+	LUMIX_EXPECT(!Lumix::LZ4::decompress(bad_offset, sizeof(bad_offset), out, sizeof(out)));
+}
+
+
+} // anonymous namespace
+
+
+REGISTER_TEST("unit_tests/engine/lz4", UT_lz4, "")
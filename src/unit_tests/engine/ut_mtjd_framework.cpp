@@ -192,5 +192,88 @@ void UT_MTJDFrameworkDependencyTest(const char* params)
 	allocator.deallocate(jobs);
 }
 
+void UT_MTJDParallelForTest(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::MTJD::Manager* manager = Lumix::MTJD::Manager::create(allocator);
+
+	for (i32 i = 0; i < BUFFER_SIZE; i++)
+	{
+		IN1_BUFFER[0][i] = (float)i;
+		IN2_BUFFER[0][i] = (float)i;
+		OUT_BUFFER[0][i] = 0;
+	}
+
+	for (size_t x = 0; x < TEST_RUNS; x++)
+	{
+		volatile i32 processed = 0;
+		manager->parallelFor(BUFFER_SIZE, 97, [&processed](int from, int to) {
+			for (int i = from; i < to; ++i)
+			{
+				OUT_BUFFER[0][i] += IN1_BUFFER[0][i] + IN2_BUFFER[0][i];
+			}
+			Lumix::MT::atomicAdd(&processed, to - from);
+		});
+		LUMIX_EXPECT(processed == BUFFER_SIZE);
+	}
+
+	for (i32 i = 0; i < BUFFER_SIZE; i++)
+	{
+		LUMIX_EXPECT(OUT_BUFFER[0][i] == (float)i * 2 * TEST_RUNS);
+	}
+
+	Lumix::MTJD::Manager::destroy(*manager);
+}
+
+void UT_MTJDCounterTest(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::MTJD::Manager* manager = Lumix::MTJD::Manager::create(allocator);
+
+	struct JobData
+	{
+		float* in1;
+		float* in2;
+		float* out;
+	};
+	JobData data[TESTS_COUNT];
+	Lumix::MTJD::JobDecl jobs[TESTS_COUNT];
+	for (i32 i = 0; i < TESTS_COUNT; i++)
+	{
+		for (i32 j = 0; j < BUFFER_SIZE; j++)
+		{
+			IN1_BUFFER[i][j] = (float)j;
+			IN2_BUFFER[i][j] = (float)j;
+			OUT_BUFFER[i][j] = 0;
+		}
+		data[i] = {IN1_BUFFER[i], IN2_BUFFER[i], OUT_BUFFER[i]};
+		jobs[i].data = &data[i];
+		jobs[i].task = [](void* ptr) {
+			JobData* data = (JobData*)ptr;
+			for (i32 j = 0; j < BUFFER_SIZE; j++)
+			{
+				data->out[j] = data->in1[j] + data->in2[j];
+			}
+		};
+	}
+
+	volatile i32 counter = 0;
+	manager->runJobs(jobs, TESTS_COUNT, &counter);
+	manager->wait(&counter);
+	LUMIX_EXPECT(counter == 0);
+
+	for (i32 i = 0; i < TESTS_COUNT; i++)
+	{
+		for (i32 j = 0; j < BUFFER_SIZE; j++)
+		{
+			LUMIX_EXPECT(OUT_BUFFER[i][j] == (float)j + (float)j);
+		}
+	}
+
+	Lumix::MTJD::Manager::destroy(*manager);
+}
+
 REGISTER_TEST("unit_tests/engine/mtjd/frameworkTest", UT_MTJDFrameworkTest, "")
 REGISTER_TEST("unit_tests/engine/mtjd/frameworkDependencyTest", UT_MTJDFrameworkDependencyTest, "")
+REGISTER_TEST("unit_tests/engine/mtjd/parallelForTest", UT_MTJDParallelForTest, "")
+REGISTER_TEST("unit_tests/engine/mtjd/counterTest", UT_MTJDCounterTest, "")
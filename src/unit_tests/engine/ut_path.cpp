@@ -1,7 +1,10 @@
 #include "unit_tests/suite/lumix_unit_tests.h"
 
 #include "engine/path.h"
+#include "engine/blob.h"
 #include "engine/crc32.h"
+#include "engine/mt/task.h"
+#include "engine/mt/thread.h"
 #include "engine/string.h"
 
 const char src_path[] = "Unit\\Test\\PATH_1231231.EXT";
@@ -18,4 +21,80 @@ void UT_path(const char* params)
 	LUMIX_EXPECT(path.getHash() == Lumix::crc32(res_path));
 }
 
+
+class PathTask : public Lumix::MT::Task
+{
+public:
+	PathTask(int seed, Lumix::IAllocator& allocator)
+		: Lumix::MT::Task(allocator)
+		, m_seed(seed)
+		, m_is_valid(true)
+	{
+	}
+
+	int task() override
+	{
+		// threads share most of the paths, so they create, copy and free the same entries
+		for (int i = 0; i < 20000; ++i)
+		{
+			char tmp[Lumix::MAX_PATH_LENGTH];
+			Lumix::copyString(tmp, "dir/file_");
+			char num[10];
+			Lumix::toCString((i * 7 + m_seed) % 64, num, Lumix::lengthOf(num));
+			Lumix::catString(tmp, num);
+			Lumix::Path path(tmp);
+			Lumix::Path copy(path);
+			Lumix::Path other;
+			other = copy;
+			m_is_valid = m_is_valid && Lumix::equalStrings(other.c_str(), tmp) && other.getHash() == Lumix::crc32(tmp);
+		}
+		return 0;
+	}
+
+	bool isValid() const { return m_is_valid; }
+
+private:
+	int m_seed;
+	bool m_is_valid;
+};
+
+
+void UT_path_threads(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::PathManager path_manager(allocator);
+	Lumix::Path kept("dir/file_0");
+
+	PathTask task0(0, allocator);
+	PathTask task1(1, allocator);
+	PathTask task2(2, allocator);
+	PathTask task3(3, allocator);
+	task0.create("path0");
+	task1.create("path1");
+	task2.create("path2");
+	task3.create("path3");
+	while (!task0.isFinished() || !task1.isFinished() || !task2.isFinished() || !task3.isFinished())
+	{
+		Lumix::MT::yield();
+	}
+	task0.destroy();
+	task1.destroy();
+	task2.destroy();
+	task3.destroy();
+
+	LUMIX_EXPECT(task0.isValid());
+	LUMIX_EXPECT(task1.isValid());
+	LUMIX_EXPECT(task2.isValid());
+	LUMIX_EXPECT(task3.isValid());
+	LUMIX_EXPECT(Lumix::equalStrings(kept.c_str(), "dir/file_0"));
+	LUMIX_EXPECT(Lumix::Path(kept.getHash()) == kept);
+
+	// only the empty path and the kept one are referenced
+	Lumix::OutputBlob blob(allocator);
+	path_manager.serialize(blob);
+	Lumix::InputBlob input(blob);
+	LUMIX_EXPECT(input.read<Lumix::i32>() == 2);
+}
+
 REGISTER_TEST("unit_tests/engine/path/path", UT_path, "")
+REGISTER_TEST("unit_tests/engine/path/threads", UT_path_threads, "")
@@ -0,0 +1,227 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/array.h"
+#include "engine/debug/debug.h"
+#include "engine/default_allocator.h"
+#include "engine/hash_map.h"
+#include "engine/math_utils.h"
+#include "engine/mt/task.h"
+#include "engine/mt/thread.h"
+#include "engine/pool_allocator.h"
+#include "engine/timer.h"
+
+
+namespace
+{
+
+
+void UT_pool_allocator(const char* params)
+{
+	Lumix::DefaultAllocator main_allocator;
+	Lumix::Debug::Allocator source(main_allocator);
+	{
+		// pool slabs are 64KB aligned, more than the debug allocator's bookkeeping used to hold
+		static const size_t SLAB_SIZE = 64 * 1024;
+		void* slab = source.allocate_aligned(SLAB_SIZE, SLAB_SIZE);
+		LUMIX_EXPECT((Lumix::uintptr)slab % SLAB_SIZE == 0);
+		source.deallocate_aligned(slab);
+	}
+	{
+		Lumix::PoolAllocator allocator(source);
+
+		// small allocations of all sizes, filled with a pattern
+		static const int COUNT = 1000;
+		void* ptrs[COUNT];
+		Lumix::Math::seedRandom(13);
+		for (int i = 0; i < COUNT; ++i)
+		{
+			size_t size = Lumix::Math::rand(1, (int)Lumix::PoolAllocator::MAX_SMALL_SIZE);
+			ptrs[i] = i % 2 ? allocator.allocate(size) : allocator.allocate_aligned(size, 16);
+			LUMIX_EXPECT((Lumix::uintptr)ptrs[i] % 16 == 0);
+			Lumix::setMemory(ptrs[i], i & 0xff, Lumix::Math::minimum(size, (size_t)16));
+		}
+		LUMIX_EXPECT(allocator.getLargeAllocationsCount() == 0);
+		for (int i = 0; i < COUNT; ++i)
+		{
+			LUMIX_EXPECT(*(Lumix::u8*)ptrs[i] == (i & 0xff));
+			if (i % 2) allocator.deallocate(ptrs[i]);
+			else allocator.deallocate_aligned(ptrs[i]);
+		}
+
+		// growing through small size classes to a large allocation keeps the content
+		int* data = nullptr;
+		for (int size = 1; size < 1000; ++size)
+		{
+			data = (int*)allocator.reallocate(data, size * sizeof(int));
+			data[size - 1] = size;
+		}
+		LUMIX_EXPECT(allocator.getLargeAllocationsCount() == 1);
+		for (int size = 1; size < 1000; ++size) LUMIX_EXPECT(data[size - 1] == size);
+		data = (int*)allocator.reallocate(data, 10 * sizeof(int));
+		LUMIX_EXPECT(data[9] == 10);
+		LUMIX_EXPECT(allocator.getLargeAllocationsCount() == 0);
+		allocator.deallocate(data);
+
+		void* aligned = allocator.allocate_aligned(64, 64);
+		LUMIX_EXPECT((Lumix::uintptr)aligned % 64 == 0);
+		LUMIX_EXPECT(allocator.getLargeAllocationsCount() == 1);
+		allocator.deallocate_aligned(aligned);
+
+		// small block which is large only because of its alignment grows in the source allocator
+		aligned = allocator.allocate_aligned(16, 64);
+		Lumix::setMemory(aligned, 7, 16);
+		aligned = allocator.reallocate_aligned(aligned, 200, 16);
+		for (int i = 0; i < 16; ++i) LUMIX_EXPECT(((Lumix::u8*)aligned)[i] == 7);
+		LUMIX_EXPECT(allocator.getLargeAllocationsCount() == 1);
+		allocator.deallocate_aligned(aligned);
+		LUMIX_EXPECT(allocator.getLargeAllocationsCount() == 0);
+
+		Lumix::PoolAllocator::SizeClassStats stats[Lumix::PoolAllocator::SIZE_CLASSES_COUNT];
+		allocator.getStats(stats);
+		LUMIX_EXPECT(stats[0].size == 16);
+		LUMIX_EXPECT(stats[Lumix::PoolAllocator::SIZE_CLASSES_COUNT - 1].size == Lumix::PoolAllocator::MAX_SMALL_SIZE);
+		Lumix::u32 slabs_count = 0;
+		for (const auto& size_class : stats) slabs_count += size_class.slabs_count;
+		LUMIX_EXPECT(slabs_count > 0);
+	}
+	LUMIX_EXPECT(source.getTotalSize() == 0);
+}
+
+
+// allocates on one thread, frees the other half of objects allocated by the previous task
+class AllocTask : public Lumix::MT::Task
+{
+public:
+	AllocTask(Lumix::PoolAllocator& pool, Lumix::IAllocator& allocator)
+		: Task(allocator)
+		, pool(pool)
+		, is_valid(true)
+	{
+	}
+
+	int task() override
+	{
+		for (int j = 0; j < 100; ++j)
+		{
+			Lumix::Array<int> array(pool);
+			Lumix::HashMap<int, int> map(pool);
+			for (int i = 0; i < 1000; ++i)
+			{
+				array.push(i);
+				map.insert(i, i + j);
+			}
+			for (int i = 0; i < 1000; ++i)
+			{
+				is_valid = is_valid && array[i] == i;
+				is_valid = is_valid && map[i] == i + j;
+			}
+		}
+		return 0;
+	}
+
+	Lumix::PoolAllocator& pool;
+	bool is_valid;
+};
+
+
+void UT_pool_allocator_threads(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::PoolAllocator pool(allocator);
+	static const int THREADS_COUNT = 4;
+	AllocTask* tasks[THREADS_COUNT];
+	for (auto& task : tasks)
+	{
+		task = LUMIX_NEW(allocator, AllocTask)(pool, allocator);
+		task->create("pool_allocator");
+	}
+	for (auto* task : tasks)
+	{
+		while (!task->isFinished()) Lumix::MT::yield();
+		task->destroy();
+		LUMIX_EXPECT(task->is_valid);
+		LUMIX_DELETE(allocator, task);
+	}
+
+	// caches of exited threads are given back to the shared pool
+	Lumix::PoolAllocator::SizeClassStats stats[Lumix::PoolAllocator::SIZE_CLASSES_COUNT];
+	pool.getStats(stats);
+	for (const auto& size_class : stats)
+	{
+		LUMIX_EXPECT(size_class.free_count + size_class.taken_count <= size_class.slabs_count * 0x10000 / size_class.size);
+		LUMIX_EXPECT(size_class.taken_count == 0);
+	}
+}
+
+
+// one thread using more allocators than it has thread caches
+void UT_pool_allocator_many(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	static const int ALLOCATORS_COUNT = 20;
+	Lumix::PoolAllocator* pools[ALLOCATORS_COUNT];
+	for (auto& pool : pools) pool = LUMIX_NEW(allocator, Lumix::PoolAllocator)(allocator);
+
+	// switching between allocators does not strand cached objects
+	for (int j = 0; j < 1000; ++j)
+	{
+		for (auto* pool : pools) pool->deallocate(pool->allocate(16));
+	}
+	for (auto* pool : pools)
+	{
+		Lumix::PoolAllocator::SizeClassStats stats[Lumix::PoolAllocator::SIZE_CLASSES_COUNT];
+		pool->getStats(stats);
+		LUMIX_EXPECT(stats[0].slabs_count == 1);
+		LUMIX_EXPECT(stats[0].taken_count <= 64);
+	}
+
+	// a destroyed allocator frees its place for a new one
+	LUMIX_DELETE(allocator, pools[0]);
+	pools[0] = LUMIX_NEW(allocator, Lumix::PoolAllocator)(allocator);
+	void* ptr = pools[0]->allocate(16);
+	Lumix::PoolAllocator::SizeClassStats stats[Lumix::PoolAllocator::SIZE_CLASSES_COUNT];
+	pools[0]->getStats(stats);
+	LUMIX_EXPECT(stats[0].taken_count > 1);
+	pools[0]->deallocate(ptr);
+
+	for (auto* pool : pools) LUMIX_DELETE(allocator, pool);
+}
+
+
+template <typename Allocator> float benchmark(Allocator& allocator)
+{
+	Lumix::Timer* timer = Lumix::Timer::create(allocator);
+	static const int COUNT = 100000;
+	static void* ptrs[COUNT];
+	Lumix::Math::seedRandom(17);
+	for (int j = 0; j < 10; ++j)
+	{
+		for (int i = 0; i < COUNT; ++i) ptrs[i] = allocator.allocate(Lumix::Math::rand(8, 256));
+		for (int i = 0; i < COUNT; i += 2) allocator.deallocate(ptrs[i]);
+		for (int i = 0; i < COUNT; i += 2) ptrs[i] = allocator.allocate(Lumix::Math::rand(8, 256));
+		for (int i = 0; i < COUNT; ++i) allocator.deallocate(ptrs[i]);
+	}
+	float time = timer->tick();
+	Lumix::Timer::destroy(timer);
+	return time;
+}
+
+
+void UT_pool_allocator_benchmark(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::PoolAllocator pool(allocator);
+	float default_time = benchmark(allocator);
+	float pool_time = benchmark(pool);
+	Lumix::g_log_info.log("unit") << "DefaultAllocator: " << default_time * 1000 << " ms, PoolAllocator: "
+								  << pool_time * 1000 << " ms";
+}
+
+
+} // anonymous namespace
+
+
+REGISTER_TEST("unit_tests/engine/pool_allocator", UT_pool_allocator, "")
+REGISTER_TEST("unit_tests/engine/pool_allocator_threads", UT_pool_allocator_threads, "")
+REGISTER_TEST("unit_tests/engine/pool_allocator_many", UT_pool_allocator_many, "")
+REGISTER_TEST("unit_tests/engine/pool_allocator_benchmark", UT_pool_allocator_benchmark, "")
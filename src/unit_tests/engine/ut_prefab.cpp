@@ -0,0 +1,96 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "engine/blob.h"
+#include "engine/path.h"
+#include "engine/prefab.h"
+#include "engine/property_register.h"
+#include "engine/serializer.h"
+#include "engine/universe/hierarchy.h"
+#include "engine/universe/universe.h"
+
+
+namespace
+{
+	const Lumix::ComponentType HIERARCHY_TYPE = Lumix::PropertyRegister::getComponentType("hierarchy");
+
+
+	struct GUIDMap : public Lumix::IEntityGUIDMap
+	{
+		Lumix::Entity get(Lumix::EntityGUID guid) override { return{ (int)guid.value }; }
+		Lumix::EntityGUID get(Lumix::Entity entity) override { return{ (Lumix::u64)entity.index }; }
+	};
+
+
+	// two entities, the first one has a hierarchy component without parent
+	void writePrefab(Lumix::OutputBlob& blob)
+	{
+		GUIDMap map;
+		Lumix::TextSerializer serializer(blob, map);
+		serializer.write("prefab", (Lumix::u64)0);
+		serializer.write("hierarchy", Lumix::PropertyRegister::getComponentTypeHash(HIERARCHY_TYPE));
+		serializer.write("scene_version", (Lumix::i32)0);
+		serializer.write("parent", Lumix::INVALID_ENTITY);
+		serializer.write("cmp_end", 0);
+		serializer.write("prefab", (Lumix::u64)1 << 32);
+		serializer.write("cmp_end", 0);
+	}
+
+
+	void expectInstances(Lumix::Universe& universe,
+		const Lumix::Array<Lumix::Entity>& entities,
+		const Lumix::Transform* transforms,
+		int count)
+	{
+		LUMIX_EXPECT(entities.size() == count * 2);
+		for (int i = 0; i < count; ++i)
+		{
+			Lumix::Entity first = entities[i * 2];
+			Lumix::Entity second = entities[i * 2 + 1];
+			LUMIX_EXPECT(universe.getComponent(first, HIERARCHY_TYPE).isValid());
+			LUMIX_EXPECT(!universe.getComponent(second, HIERARCHY_TYPE).isValid());
+			LUMIX_EXPECT(universe.getPosition(first).x == transforms[i].pos.x);
+			LUMIX_EXPECT(universe.getPosition(second).x == transforms[i].pos.x);
+			LUMIX_EXPECT(universe.getScale(second) == 2);
+		}
+	}
+
+
+	void UT_prefab(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::PathManager path_manager(allocator);
+		Lumix::Universe universe(allocator);
+		Lumix::HierarchyPlugin plugin(allocator);
+		Lumix::Hierarchy* hierarchy = Lumix::Hierarchy::create(plugin, universe, allocator);
+		Lumix::PrefabResourceManager manager(allocator);
+		Lumix::PrefabResource prefab(Lumix::Path("test.fab"), manager, allocator);
+		writePrefab(prefab.blob);
+
+		static const int COUNT = 5;
+		Lumix::Transform transforms[COUNT];
+		for (int i = 0; i < COUNT; ++i)
+		{
+			transforms[i].pos.set((float)i, 0, 0);
+			transforms[i].rot.set(0, 0, 0, 1);
+		}
+
+		// the first instance compiles the prefab
+		Lumix::Array<Lumix::Entity> entities(allocator);
+		LUMIX_EXPECT(!prefab.is_compiled);
+		universe.instantiatePrefab(prefab, transforms, COUNT, 2, entities);
+		LUMIX_EXPECT(prefab.is_compiled);
+		LUMIX_EXPECT(prefab.entities_count == 2);
+		expectInstances(universe, entities, transforms, COUNT);
+
+		// all instances from the compiled image
+		entities.clear();
+		universe.instantiatePrefab(prefab, transforms, COUNT, 2, entities);
+		expectInstances(universe, entities, transforms, COUNT);
+
+		prefab.unload();
+		LUMIX_EXPECT(!prefab.is_compiled);
+
+		Lumix::Hierarchy::destroy(hierarchy);
+	}
+} // anonymous namespace
+
+REGISTER_TEST("unit_tests/engine/prefab", UT_prefab, "");
@@ -0,0 +1,129 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "engine/profiler.h"
+#include "engine/default_allocator.h"
+#include "engine/fs/os_file.h"
+#include "engine/string.h"
+
+
+namespace
+{
+const char* OUTER_NAME = "ut_outer";
+const char* INNER_NAME = "ut_inner";
+const char* INT_NAME = "ut_int";
+
+
+Lumix::Profiler::Block* findChild(Lumix::Profiler::Block* block, const char* name)
+{
+	while (block && Lumix::Profiler::getBlockName(block) != name)
+	{
+		block = Lumix::Profiler::getBlockNext(block);
+	}
+	return block;
+}
+
+
+struct FrameChecker
+{
+	void onFrame()
+	{
+		auto* root = Lumix::Profiler::getRootBlock(Lumix::MT::getCurrentThreadID());
+		auto* outer = findChild(root, OUTER_NAME);
+		LUMIX_EXPECT(outer != nullptr);
+		if (!outer) return;
+		outer_hits = Lumix::Profiler::getBlockHitCount(outer);
+
+		auto* inner = findChild(Lumix::Profiler::getBlockFirstChild(outer), INNER_NAME);
+		LUMIX_EXPECT(inner != nullptr);
+		if (inner) inner_hits = Lumix::Profiler::getBlockHitCount(inner);
+
+		auto* int_block = findChild(Lumix::Profiler::getBlockFirstChild(outer), INT_NAME);
+		LUMIX_EXPECT(int_block != nullptr);
+		if (int_block) int_value = Lumix::Profiler::getBlockInt(int_block);
+	}
+
+	int outer_hits = 0;
+	int inner_hits = 0;
+	int int_value = 0;
+};
+}
+
+
+void UT_profiler(const char* params)
+{
+	FrameChecker checker;
+	Lumix::Profiler::getFrameListeners().bind<FrameChecker, &FrameChecker::onFrame>(&checker);
+
+	Lumix::Profiler::beginBlock(OUTER_NAME);
+	for (int i = 0; i < 3; ++i)
+	{
+		Lumix::Profiler::beginBlock(INNER_NAME);
+		Lumix::Profiler::endBlock();
+		Lumix::Profiler::record(INT_NAME, 5);
+	}
+	Lumix::Profiler::endBlock();
+	Lumix::Profiler::frame();
+
+	LUMIX_EXPECT(checker.outer_hits == 1);
+	LUMIX_EXPECT(checker.inner_hits == 3);
+	LUMIX_EXPECT(checker.int_value == 15);
+
+	// more events than fit in the per-thread buffer, excess is dropped but nesting stays intact
+	Lumix::Profiler::beginBlock(OUTER_NAME);
+	for (int i = 0; i < 100000; ++i)
+	{
+		Lumix::Profiler::beginBlock(INNER_NAME);
+		Lumix::Profiler::endBlock();
+	}
+	Lumix::Profiler::record(INT_NAME, 1);
+	Lumix::Profiler::endBlock();
+	Lumix::Profiler::frame();
+
+	LUMIX_EXPECT(checker.outer_hits == 1);
+	LUMIX_EXPECT(checker.inner_hits > 0);
+	LUMIX_EXPECT(checker.inner_hits < 100000);
+
+	Lumix::Profiler::getFrameListeners().unbind<FrameChecker, &FrameChecker::onFrame>(&checker);
+}
+
+
+
+void UT_profiler_capture(const char* params)
+{
+	Lumix::Profiler::beginBlock(OUTER_NAME);
+	Lumix::Profiler::startCapture(2);
+	LUMIX_EXPECT(Lumix::Profiler::isCapturing());
+	LUMIX_EXPECT(!Lumix::Profiler::saveCapture("profiler_capture.bin"));
+	for (int i = 0; i < 2; ++i)
+	{
+		Lumix::Profiler::beginBlock(INNER_NAME);
+		Lumix::Profiler::record(INT_NAME, 5);
+		Lumix::Profiler::endBlock();
+		Lumix::Profiler::frame();
+	}
+	Lumix::Profiler::endBlock();
+	LUMIX_EXPECT(!Lumix::Profiler::isCapturing());
+
+	LUMIX_EXPECT(Lumix::Profiler::saveCapture("profiler_capture.bin"));
+	LUMIX_EXPECT(Lumix::Profiler::convertCaptureToChromeTrace(
+		"profiler_capture.bin", "profiler_capture.json"));
+
+	Lumix::DefaultAllocator allocator;
+	Lumix::FS::OsFile file;
+	LUMIX_EXPECT(file.open("profiler_capture.json", Lumix::FS::Mode::OPEN_AND_READ, allocator));
+	char json[4096];
+	int size = Lumix::Math::minimum((int)file.size(), Lumix::lengthOf(json) - 1);
+	LUMIX_EXPECT(file.read(json, size));
+	json[size] = '\0';
+	file.close();
+
+	// outer block ends after the capture, the converter closes it
+	LUMIX_EXPECT(Lumix::findSubstring(json, "\"traceEvents\"") != nullptr);
+	LUMIX_EXPECT(Lumix::findSubstring(json, "\"name\":\"ut_inner\",\"ph\":\"B\"") != nullptr);
+	LUMIX_EXPECT(Lumix::findSubstring(json, "\"name\":\"ut_int\",\"ph\":\"C\",\"args\":{\"value\":5}") != nullptr);
+	LUMIX_EXPECT(Lumix::findSubstring(json, "\"name\":\"Frame\",\"ph\":\"i\"") != nullptr);
+	LUMIX_EXPECT(Lumix::findSubstring(json, "\"name\":\"ut_outer\",\"ph\":\"B\"") != nullptr);
+}
+
+
+REGISTER_TEST("unit_tests/engine/profiler", UT_profiler, "")
+REGISTER_TEST("unit_tests/engine/profiler_capture", UT_profiler_capture, "")
@@ -0,0 +1,150 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/fs/disk_file_device.h"
+#include "engine/fs/file_system.h"
+#include "engine/fs/os_file.h"
+#include "engine/mt/thread.h"
+#include "engine/path.h"
+#include "engine/resource.h"
+#include "engine/resource_manager.h"
+#include "engine/resource_manager_base.h"
+
+
+namespace
+{
+
+
+static const char* RESOURCE_PATHS[] = {"unit_tests/file_system/resource0.dat",
+	"unit_tests/file_system/resource1.dat",
+	"unit_tests/file_system/resource2.dat",
+	"unit_tests/file_system/resource3.dat"};
+static const int RESOURCE_SIZE = 100;
+
+
+class TestResource : public Lumix::Resource
+{
+public:
+	TestResource(const Lumix::Path& path, Lumix::ResourceManagerBase& manager, Lumix::IAllocator& allocator)
+		: Resource(path, manager, allocator)
+	{
+	}
+
+	void unload() override {}
+	bool load(Lumix::FS::IFile& file) override { return true; }
+};
+
+
+class TestManager : public Lumix::ResourceManagerBase
+{
+public:
+	explicit TestManager(Lumix::IAllocator& allocator)
+		: ResourceManagerBase(allocator)
+		, m_allocator(allocator)
+	{
+	}
+
+protected:
+	Lumix::Resource* createResource(const Lumix::Path& path) override
+	{
+		return LUMIX_NEW(m_allocator, TestResource)(path, *this, m_allocator);
+	}
+
+	void destroyResource(Lumix::Resource& resource) override
+	{
+		LUMIX_DELETE(m_allocator, static_cast<TestResource*>(&resource));
+	}
+
+private:
+	Lumix::IAllocator& m_allocator;
+};
+
+
+void waitForLoads(Lumix::FS::FileSystem& file_system)
+{
+	while (file_system.hasWork())
+	{
+		Lumix::MT::yield();
+		file_system.updateAsyncTransactions();
+	}
+}
+
+
+void UT_memory_budget(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+	Lumix::PathManager path_manager(allocator);
+	char data[RESOURCE_SIZE] = {};
+	for (const char* path : RESOURCE_PATHS)
+	{
+		Lumix::FS::OsFile file;
+		LUMIX_EXPECT(file.open(path, Lumix::FS::Mode::CREATE_AND_WRITE, allocator));
+		file.write(data, sizeof(data));
+		file.close();
+	}
+
+	Lumix::FS::FileSystem* file_system = Lumix::FS::FileSystem::create(allocator);
+	Lumix::FS::DiskFileDevice disk_device("disk", "", allocator);
+	file_system->mount(&disk_device);
+	file_system->setDefaultDevice("disk");
+	Lumix::ResourceManager owner(allocator);
+	owner.create(*file_system);
+	TestManager manager(allocator);
+	manager.create(Lumix::ResourceType("test"), owner);
+	manager.setMemoryBudget(RESOURCE_SIZE * 5 / 2);
+
+	Lumix::Resource* resources[Lumix::lengthOf(RESOURCE_PATHS)];
+	resources[0] = manager.load(Lumix::Path(RESOURCE_PATHS[0]));
+	resources[1] = manager.load(Lumix::Path(RESOURCE_PATHS[1]));
+	waitForLoads(*file_system);
+	LUMIX_EXPECT(resources[0]->isReady());
+	LUMIX_EXPECT(resources[1]->isReady());
+	LUMIX_EXPECT(manager.getMemoryStats().used == RESOURCE_SIZE * 2);
+
+	// unreferenced resources stay loaded while they fit in the budget
+	manager.unload(*resources[0]);
+	manager.unload(*resources[1]);
+	LUMIX_EXPECT(resources[0]->isReady());
+	LUMIX_EXPECT(resources[1]->isReady());
+	LUMIX_EXPECT(manager.getMemoryStats().cached == RESOURCE_SIZE * 2);
+
+	// the least recently used one is evicted
+	resources[2] = manager.load(Lumix::Path(RESOURCE_PATHS[2]));
+	waitForLoads(*file_system);
+	LUMIX_EXPECT(resources[0]->isEmpty());
+	LUMIX_EXPECT(resources[1]->isReady());
+	LUMIX_EXPECT(manager.getMemoryStats().used == RESOURCE_SIZE * 2);
+	LUMIX_EXPECT(manager.getMemoryStats().evicted_count == 1);
+
+	// cached resource is reused without loading
+	LUMIX_EXPECT(manager.load(Lumix::Path(RESOURCE_PATHS[1])) == resources[1]);
+	LUMIX_EXPECT(!file_system->hasWork());
+	LUMIX_EXPECT(manager.getMemoryStats().cached == 0);
+
+	// referenced resources are never evicted, even over budget
+	resources[3] = manager.load(Lumix::Path(RESOURCE_PATHS[3]));
+	waitForLoads(*file_system);
+	LUMIX_EXPECT(manager.getMemoryStats().used == RESOURCE_SIZE * 3);
+	LUMIX_EXPECT(resources[1]->isReady());
+	manager.unload(*resources[2]);
+	LUMIX_EXPECT(resources[2]->isEmpty());
+	LUMIX_EXPECT(manager.getMemoryStats().used == RESOURCE_SIZE * 2);
+
+	// without budget resources are unloaded immediately
+	manager.setMemoryBudget(0);
+	manager.unload(*resources[1]);
+	manager.unload(*resources[3]);
+	LUMIX_EXPECT(resources[1]->isEmpty());
+	LUMIX_EXPECT(resources[3]->isEmpty());
+	LUMIX_EXPECT(manager.getMemoryStats().used == 0);
+
+	manager.removeUnreferenced();
+	LUMIX_EXPECT(manager.getResourceTable().empty());
+	manager.destroy();
+	Lumix::FS::FileSystem::destroy(file_system);
+}
+
+
+} // anonymous namespace
+
+
+REGISTER_TEST("unit_tests/engine/resource_manager/memory_budget", UT_memory_budget, "")
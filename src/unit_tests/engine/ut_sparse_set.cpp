@@ -0,0 +1,61 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "engine/sparse_set.h"
+
+
+void UT_sparse_set(const char* params)
+{
+	Lumix::DefaultAllocator allocator;
+
+	Lumix::SparseSet<Lumix::Entity, int> set(allocator);
+	LUMIX_EXPECT(set.size() == 0);
+	set.reserve(128);
+	LUMIX_EXPECT(set.size() == 0);
+	int x;
+	LUMIX_EXPECT(!set.find({0}, x));
+	LUMIX_EXPECT(!set.find({1000}, x));
+
+	for (int i = 0; i < 10; ++i)
+	{
+		set.insert({i * 3}, i * 5);
+	}
+	LUMIX_EXPECT(set.size() == 10);
+	LUMIX_EXPECT(set.insert({6}, 10) == -1);
+	LUMIX_EXPECT(set.size() == 10);
+	LUMIX_EXPECT(set.get({3}) == 5);
+	LUMIX_EXPECT(set.get({9}) == 15);
+	LUMIX_EXPECT(set.get({21}) == 35);
+	LUMIX_EXPECT(!set.find({1}, x));
+	LUMIX_EXPECT(!set.find({-1}, x));
+
+	// the last value is moved into the hole
+	set.erase({15});
+	LUMIX_EXPECT(!set.find({15}, x));
+	LUMIX_EXPECT(set.size() == 9);
+	LUMIX_EXPECT(set.getKey(5).index == 27);
+	for (int i = 0; i < set.size(); ++i)
+	{
+		LUMIX_EXPECT(set.find(set.getKey(i)) == i);
+		LUMIX_EXPECT(set.get(set.getKey(i)) == set.at(i));
+		LUMIX_EXPECT(set.at(i) == set.getKey(i).index / 3 * 5);
+	}
+
+	set[{100}] = 7;
+	LUMIX_EXPECT(set.size() == 10);
+	LUMIX_EXPECT(set.get({100}) == 7);
+	set.emplace({15}, 1);
+	LUMIX_EXPECT(set.get({15}) == 1);
+
+	int sum = 0;
+	for (int value : set) sum += value;
+	LUMIX_EXPECT(sum == 0 + 5 + 10 + 15 + 20 + 30 + 35 + 40 + 45 + 7 + 1);
+
+	set.eraseAt(set.size() - 1);
+	LUMIX_EXPECT(!set.find({15}, x));
+	set.clear();
+	LUMIX_EXPECT(set.size() == 0);
+	LUMIX_EXPECT(!set.find({3}, x));
+	set.insert({3}, 1);
+	LUMIX_EXPECT(set.get({3}) == 1);
+}
+
+REGISTER_TEST("unit_tests/engine/sparse_set", UT_sparse_set, "")
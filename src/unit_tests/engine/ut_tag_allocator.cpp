@@ -0,0 +1,73 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/debug/debug.h"
+#include "engine/default_allocator.h"
+#include "engine/string.h"
+#include "engine/tag_allocator.h"
+
+
+namespace
+{
+
+
+Lumix::TagAllocator::Stats findStats(const char* tag)
+{
+	Lumix::TagAllocator::Stats stats[16];
+	int count = Lumix::TagAllocator::getStats(stats, Lumix::lengthOf(stats));
+	for (int i = 0; i < count && i < Lumix::lengthOf(stats); ++i)
+	{
+		if (Lumix::equalStrings(stats[i].tag, tag)) return stats[i];
+	}
+	Lumix::TagAllocator::Stats empty = {};
+	return empty;
+}
+
+
+void UT_tag_allocator(const char* params)
+{
+	Lumix::DefaultAllocator main_allocator;
+	Lumix::Debug::Allocator source(main_allocator);
+	{
+		Lumix::TagAllocator allocator(source, "test_a");
+		Lumix::TagAllocator other(source, "test_b");
+
+		void* a = allocator.allocate(100);
+		void* b = allocator.allocate_aligned(200, 64);
+		void* c = other.allocate(1000);
+		LUMIX_EXPECT((Lumix::uintptr)b % 64 == 0);
+		LUMIX_EXPECT(allocator.getStats().size == 300);
+		LUMIX_EXPECT(allocator.getStats().allocation_count == 2);
+		LUMIX_EXPECT(findStats("test_b").size == 1000);
+
+		Lumix::setMemory(a, 1, 100);
+		a = allocator.reallocate(a, 1000);
+		LUMIX_EXPECT(*((Lumix::u8*)a + 99) == 1);
+		b = allocator.reallocate_aligned(b, 20, 64);
+		LUMIX_EXPECT((Lumix::uintptr)b % 64 == 0);
+		LUMIX_EXPECT(allocator.getStats().size == 1020);
+		LUMIX_EXPECT(allocator.getStats().peak == 1200);
+
+		// per-frame counters are closed by frame()
+		Lumix::TagAllocator::frame();
+		Lumix::TagAllocator::Stats stats = allocator.getStats();
+		LUMIX_EXPECT(stats.frame_allocation_count == 4);
+		LUMIX_EXPECT(stats.frame_allocated_size == 1320);
+		Lumix::TagAllocator::frame();
+		LUMIX_EXPECT(allocator.getStats().frame_allocation_count == 0);
+
+		allocator.deallocate(a);
+		allocator.deallocate_aligned(b);
+		other.deallocate(c);
+		LUMIX_EXPECT(allocator.getStats().size == 0);
+		LUMIX_EXPECT(allocator.getStats().allocation_count == 0);
+		LUMIX_EXPECT(allocator.getStats().peak == 1200);
+	}
+	LUMIX_EXPECT(findStats("test_a").tag == nullptr);
+	LUMIX_EXPECT(source.getTotalSize() == 0);
+}
+
+
+} // anonymous namespace
+
+
+REGISTER_TEST("unit_tests/engine/tag_allocator", UT_tag_allocator, "")
@@ -1,4 +1,8 @@
 #include "unit_tests/suite/lumix_unit_tests.h"
+#include "engine/blob.h"
+#include "engine/matrix.h"
+#include "engine/property_register.h"
+#include "engine/universe/hierarchy.h"
 #include "engine/universe/universe.h"
 
 
@@ -71,6 +75,172 @@ namespace
 			LUMIX_EXPECT_CLOSE_EQ(pos.z, float(i), 0.00001f);
 		}
 	}
+
+	struct MoveCounter
+	{
+		explicit MoveCounter(Lumix::Universe& _universe)
+			: universe(_universe)
+		{
+			universe.entityTransformed().bind<MoveCounter, &MoveCounter::onEntityMoved>(this);
+		}
+
+		~MoveCounter() { universe.entityTransformed().unbind<MoveCounter, &MoveCounter::onEntityMoved>(this); }
+
+		void onEntityMoved(Lumix::Entity entity)
+		{
+			++count;
+			// moves a follower like hierarchy does with children
+			if (entity == leader) universe.setPosition(follower, universe.getPosition(leader));
+		}
+
+		Lumix::Universe& universe;
+		Lumix::Entity leader = Lumix::INVALID_ENTITY;
+		Lumix::Entity follower = Lumix::INVALID_ENTITY;
+		int count = 0;
+	};
+
+
+	void UT_universe_transforms(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::PathManager path_manager(allocator);
+		Lumix::Universe universe(allocator);
+		MoveCounter counter(universe);
+
+		static const int ENTITY_COUNT = 4;
+		Lumix::Entity entities[ENTITY_COUNT];
+		Lumix::Transform transforms[ENTITY_COUNT];
+		for (int i = 0; i < ENTITY_COUNT; ++i)
+		{
+			entities[i] = universe.createEntity({0, 0, 0}, {0, 0, 0, 1});
+			transforms[i] = Lumix::Transform({float(i), 0, 0}, {0, 0, 0, 1});
+		}
+
+		universe.setTransforms(entities, transforms, ENTITY_COUNT);
+		LUMIX_EXPECT(counter.count == ENTITY_COUNT);
+		LUMIX_EXPECT_CLOSE_EQ(universe.getPosition(entities[3]).x, 3.0f, 0.00001f);
+
+		counter.count = 0;
+		universe.deferTransformNotifications(true);
+		LUMIX_EXPECT(universe.areTransformNotificationsDeferred());
+		for (int i = 0; i < 3; ++i)
+		{
+			universe.setPosition(entities[0], float(i), 1, 1);
+			universe.setScale(entities[0], 2);
+			universe.setTransforms(entities, transforms, 2);
+		}
+		LUMIX_EXPECT(counter.count == 0);
+		universe.flushTransforms();
+		LUMIX_EXPECT(counter.count == 2);
+		universe.flushTransforms();
+		LUMIX_EXPECT(counter.count == 2);
+
+		// entities moved by listeners during the flush are notified in the same flush
+		counter.count = 0;
+		counter.leader = entities[0];
+		counter.follower = entities[1];
+		universe.setPosition(entities[0], 5, 5, 5);
+		universe.setPosition(entities[2], 1, 1, 1);
+		universe.destroyEntity(entities[2]);
+		universe.flushTransforms();
+		LUMIX_EXPECT(counter.count == 2);
+		LUMIX_EXPECT_CLOSE_EQ(universe.getPosition(entities[1]).x, 5.0f, 0.00001f);
+
+		counter.count = 0;
+		universe.setPosition(entities[3], 1, 1, 1);
+		universe.deferTransformNotifications(false);
+		LUMIX_EXPECT(counter.count == 1);
+		universe.setPosition(entities[3], 2, 2, 2);
+		LUMIX_EXPECT(counter.count == 2);
+	}
+
+	void expectTransform(Lumix::Universe& universe, Lumix::Entity entity, const Lumix::Transform& tr, float scale)
+	{
+		Lumix::Transform actual = universe.getTransform(entity);
+		LUMIX_EXPECT_CLOSE_EQ(actual.pos.x, tr.pos.x, 0.00001f);
+		LUMIX_EXPECT_CLOSE_EQ(actual.pos.y, tr.pos.y, 0.00001f);
+		LUMIX_EXPECT_CLOSE_EQ(actual.pos.z, tr.pos.z, 0.00001f);
+		LUMIX_EXPECT_CLOSE_EQ(actual.rot.x, tr.rot.x, 0.00001f);
+		LUMIX_EXPECT_CLOSE_EQ(actual.rot.y, tr.rot.y, 0.00001f);
+		LUMIX_EXPECT_CLOSE_EQ(actual.rot.z, tr.rot.z, 0.00001f);
+		LUMIX_EXPECT_CLOSE_EQ(actual.rot.w, tr.rot.w, 0.00001f);
+		LUMIX_EXPECT_CLOSE_EQ(universe.getScale(entity), scale, 0.00001f);
+	}
+
+
+	void UT_universe_snapshot(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::PathManager path_manager(allocator);
+		Lumix::Universe universe(allocator);
+		Lumix::HierarchyPlugin plugin(allocator);
+		Lumix::Hierarchy* hierarchy = Lumix::Hierarchy::create(plugin, universe, allocator);
+		universe.addScene(hierarchy);
+		const Lumix::ComponentType HIERARCHY_TYPE = Lumix::PropertyRegister::getComponentType("hierarchy");
+
+		static const int ENTITY_COUNT = 5;
+		Lumix::Entity entities[ENTITY_COUNT];
+		Lumix::Transform transforms[ENTITY_COUNT];
+		Lumix::Quat rot(Lumix::Vec3(0, 1, 0), 0.5f);
+		for (int i = 0; i < ENTITY_COUNT; ++i)
+		{
+			transforms[i] = Lumix::Transform({float(i), float(i * 2), 1}, rot);
+			entities[i] = universe.createEntity(transforms[i].pos, transforms[i].rot);
+			universe.setScale(entities[i], float(i + 1));
+		}
+		universe.setEntityName(entities[0], "root");
+		hierarchy->setParent(hierarchy->createComponent(HIERARCHY_TYPE, entities[1]), entities[0]);
+		hierarchy->setParent(hierarchy->createComponent(HIERARCHY_TYPE, entities[2]), entities[0]);
+		universe.destroyEntity(entities[4]);
+
+		Lumix::OutputBlob snapshot(allocator);
+		universe.serializeSnapshot(snapshot);
+
+		// game mode changes
+		universe.setPosition(entities[0], 100, 0, 0);
+		hierarchy->destroyComponent({entities[2].index}, HIERARCHY_TYPE);
+		universe.destroyEntity(entities[3]);
+		universe.setEntityName(entities[0], "moved");
+		Lumix::Entity spawned = universe.createEntity({7, 7, 7}, rot);
+		hierarchy->setParent(hierarchy->createComponent(HIERARCHY_TYPE, spawned), entities[1]);
+
+		universe.clear();
+		LUMIX_EXPECT(!universe.hasEntity(entities[0]));
+		LUMIX_EXPECT(hierarchy->getAllChildren().size() == 0);
+
+		Lumix::InputBlob blob(snapshot);
+		universe.deserializeSnapshot(blob);
+		LUMIX_EXPECT(blob.getPosition() == blob.getSize());
+
+		for (int i = 0; i < ENTITY_COUNT - 1; ++i)
+		{
+			LUMIX_EXPECT(universe.hasEntity(entities[i]));
+			expectTransform(universe, entities[i], transforms[i], float(i + 1));
+		}
+		LUMIX_EXPECT(!universe.hasEntity(entities[4]));
+		LUMIX_EXPECT(Lumix::equalStrings(universe.getEntityName(entities[0]), "root"));
+		LUMIX_EXPECT(!universe.nameExists("moved"));
+
+		LUMIX_EXPECT(universe.hasComponent(entities[1], HIERARCHY_TYPE));
+		LUMIX_EXPECT(universe.hasComponent(entities[2], HIERARCHY_TYPE));
+		LUMIX_EXPECT(!universe.hasComponent(entities[3], HIERARCHY_TYPE));
+		LUMIX_EXPECT(hierarchy->getParent({entities[1].index}) == entities[0]);
+		LUMIX_EXPECT(hierarchy->getParent({entities[2].index}) == entities[0]);
+		Lumix::Array<Lumix::Hierarchy::Child>* children = hierarchy->getChildren(entities[0]);
+		LUMIX_EXPECT(children != nullptr);
+		if (children) LUMIX_EXPECT(children->size() == 2);
+		LUMIX_EXPECT(!hierarchy->getChildren(entities[1]));
+
+		// restored hierarchy is live and free slots are reused
+		universe.setPosition(entities[0], 10, 0, 1);
+		LUMIX_EXPECT_CLOSE_EQ(universe.getPosition(entities[2]).x, 12.0f, 0.00001f);
+		LUMIX_EXPECT(universe.createEntity({0, 0, 0}, rot) == entities[4]);
+
+		universe.clear();
+		Lumix::Hierarchy::destroy(hierarchy);
+	}
 } // anonymous namespace
 
 REGISTER_TEST("unit_tests/engine/universe", UT_universe, "");
+REGISTER_TEST("unit_tests/engine/universe_transforms", UT_universe_transforms, "");
+REGISTER_TEST("unit_tests/engine/universe_snapshot", UT_universe_snapshot, "");
@@ -1,6 +1,7 @@
 #include "unit_tests/suite/lumix_unit_tests.h"
 
 #include "engine/geometry.h"
+#include "engine/math_utils.h"
 #include "engine/timer.h"
 #include "engine/log.h"
 
@@ -133,7 +134,191 @@ namespace
 
 		Lumix::CullingSystem::destroy(*culling_system);
 	}
+
+	void checkCullingResult(Lumix::CullingSystem& culling_system,
+		const Lumix::Frustum& frustum,
+		const Lumix::Array<Lumix::Sphere>& spheres,
+		const Lumix::Array<Lumix::u64>& layers,
+		const Lumix::Array<bool>& is_alive,
+		Lumix::u64 layer_mask)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Array<int> visible_count(allocator);
+		visible_count.resize(spheres.size());
+		for (int& count : visible_count) count = 0;
+
+		for (const auto& subresult : culling_system.getResult())
+		{
+			for (Lumix::ComponentHandle cmp : subresult) ++visible_count[cmp.index];
+		}
+
+		for (int i = 0; i < spheres.size(); ++i)
+		{
+			bool expected = is_alive[i] && (layers[i] & layer_mask) &&
+							frustum.isSphereInside(spheres[i].position, spheres[i].radius);
+			LUMIX_EXPECT(visible_count[i] == (expected ? 1 : 0));
+		}
+	}
+
+	// enough spheres for the octree path, results must match brute force culling after edits
+	void UT_culling_system_octree(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Array<Lumix::Sphere> spheres(allocator);
+		Lumix::Array<Lumix::u64> layers(allocator);
+		Lumix::Array<bool> is_alive(allocator);
+		Lumix::Math::seedRandom(7);
+
+		Lumix::Frustum frustum;
+		frustum.computePerspective(test_frustum.pos,
+			test_frustum.dir,
+			test_frustum.up,
+			Lumix::Math::degreesToRadians(test_frustum.fov),
+			test_frustum.ratio,
+			test_frustum.near,
+			1000.0f);
+
+		Lumix::MTJD::Manager* mtjd_manager = Lumix::MTJD::Manager::create(allocator);
+		Lumix::CullingSystem* culling_system = Lumix::CullingSystem::create(*mtjd_manager, allocator);
+
+		auto randomSphere = []() {
+			return Lumix::Sphere(Lumix::Math::randFloat(-1000, 1000),
+				Lumix::Math::randFloat(-1000, 1000),
+				Lumix::Math::randFloat(-1000, 1000),
+				Lumix::Math::randFloat(0.1f, Lumix::Math::randFloat() < 0.01f ? 300.0f : 10.0f));
+		};
+
+		for (int i = 0; i < 30000; ++i)
+		{
+			spheres.push(randomSphere());
+			layers.push(Lumix::Math::rand(1, 2));
+			is_alive.push(true);
+			culling_system->addStatic({i}, spheres[i], layers[i]);
+		}
+
+		for (int iter = 0; iter < 3; ++iter)
+		{
+			culling_system->cullToFrustum(frustum, 1);
+			checkCullingResult(*culling_system, frustum, spheres, layers, is_alive, 1);
+			culling_system->cullToFrustumAsync(frustum, 3);
+			checkCullingResult(*culling_system, frustum, spheres, layers, is_alive, 3);
+
+			for (int i = 0; i < 5000; ++i)
+			{
+				int idx = Lumix::Math::rand(0, spheres.size() - 1);
+				if (is_alive[idx])
+				{
+					culling_system->removeStatic({idx});
+					is_alive[idx] = false;
+				}
+				else
+				{
+					culling_system->addStatic({idx}, spheres[idx], layers[idx]);
+					is_alive[idx] = true;
+				}
+
+				idx = Lumix::Math::rand(0, spheres.size() - 1);
+				spheres[idx] = randomSphere();
+				culling_system->updateBoundingSphere(spheres[idx], {idx});
+			}
+		}
+
+		Lumix::CullingSystem::destroy(*culling_system);
+		Lumix::MTJD::Manager::destroy(*mtjd_manager);
+	}
+
+	void logThroughput(const char* name, float time, int spheres_count, int iterations)
+	{
+		float spheres_per_second = spheres_count * (float)iterations / time;
+		Lumix::g_log_info.log("unit") << name << ": " << time * 1000 / iterations << " ms per cull, "
+									  << spheres_per_second / 1000000 << " M spheres/s";
+	}
+
+	// compares the SoA kernels with per sphere testing of an AoS array, which is how the culling used to work
+	void UT_culling_system_benchmark(const char* params)
+	{
+		static const int SPHERES_COUNT = 1000000;
+		static const int ITERATIONS = 10;
+
+		Lumix::DefaultAllocator allocator;
+		Lumix::Array<Lumix::Sphere> spheres(allocator);
+		Lumix::Array<Lumix::ComponentHandle> model_instances(allocator);
+		Lumix::Math::seedRandom(11);
+		for (int i = 0; i < SPHERES_COUNT; ++i)
+		{
+			spheres.emplace(Lumix::Math::randFloat(-1000, 1000),
+				Lumix::Math::randFloat(-1000, 1000),
+				Lumix::Math::randFloat(-1000, 1000),
+				Lumix::Math::randFloat(0.1f, 10.0f));
+			model_instances.push({i});
+		}
+
+		Lumix::Frustum frustum;
+		frustum.computePerspective(test_frustum.pos,
+			test_frustum.dir,
+			test_frustum.up,
+			Lumix::Math::degreesToRadians(test_frustum.fov),
+			test_frustum.ratio,
+			test_frustum.near,
+			1000.0f);
+
+		Lumix::MTJD::Manager* mtjd_manager = Lumix::MTJD::Manager::create(allocator);
+		Lumix::CullingSystem* culling_system = Lumix::CullingSystem::create(*mtjd_manager, allocator);
+		culling_system->insert(spheres, model_instances);
+		culling_system->enableOctree(false);
+
+		int expected_count = 0;
+		{
+			Lumix::ScopedTimer timer("AoS", allocator);
+			Lumix::Array<Lumix::ComponentHandle> result(allocator);
+			for (int iter = 0; iter < ITERATIONS; ++iter)
+			{
+				result.clear();
+				for (int i = 0; i < spheres.size(); ++i)
+				{
+					if (frustum.isSphereInside(spheres[i].position, spheres[i].radius)) result.push(model_instances[i]);
+				}
+			}
+			expected_count = result.size();
+			logThroughput(timer.getName(), timer.getTimeSinceStart(), SPHERES_COUNT, ITERATIONS);
+		}
+
+		auto measure = [&](const char* name, bool use_octree, bool async) {
+			culling_system->enableOctree(use_octree);
+			// warm up, the first cull builds the octree
+			culling_system->cullToFrustum(frustum, 1);
+			culling_system->getResult();
+
+			Lumix::ScopedTimer timer(name, allocator);
+			int count = 0;
+			for (int iter = 0; iter < ITERATIONS; ++iter)
+			{
+				if (async)
+				{
+					culling_system->cullToFrustumAsync(frustum, 1);
+				}
+				else
+				{
+					culling_system->cullToFrustum(frustum, 1);
+				}
+				count = 0;
+				for (const auto& subresult : culling_system->getResult()) count += subresult.size();
+			}
+			logThroughput(timer.getName(), timer.getTimeSinceStart(), SPHERES_COUNT, ITERATIONS);
+			LUMIX_EXPECT(count == expected_count);
+		};
+
+		measure("SoA", false, false);
+		measure("SoA async", false, true);
+		measure("Octree", true, false);
+		measure("Octree async", true, true);
+
+		Lumix::CullingSystem::destroy(*culling_system);
+		Lumix::MTJD::Manager::destroy(*mtjd_manager);
+	}
 }
 
 REGISTER_TEST("unit_tests/graphics/culling_system", UT_culling_system, "");
 REGISTER_TEST("unit_tests/graphics/culling_system_async", UT_culling_system_async, "");
+REGISTER_TEST("unit_tests/graphics/culling_system_octree", UT_culling_system_octree, "");
+REGISTER_TEST("unit_tests/graphics/culling_system_benchmark", UT_culling_system_benchmark, "");
@@ -0,0 +1,103 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/default_allocator.h"
+#include "engine/geometry.h"
+#include "engine/math_utils.h"
+
+#include "renderer/light_grid.h"
+
+namespace
+{
+
+	struct TestLight
+	{
+		Lumix::Vec3 position;
+		float range;
+		bool is_valid;
+	};
+
+
+	bool overlaps(const TestLight& light, const Lumix::Sphere& sphere)
+	{
+		Lumix::Vec3 d = light.position - sphere.position;
+		float r = light.range + sphere.radius;
+		return Lumix::Math::abs(d.x) <= r && Lumix::Math::abs(d.y) <= r && Lumix::Math::abs(d.z) <= r;
+	}
+
+
+	Lumix::Vec3 randomPosition()
+	{
+		return Lumix::Vec3(Lumix::Math::randFloat(-200, 200),
+			Lumix::Math::randFloat(-50, 50),
+			Lumix::Math::randFloat(-200, 200));
+	}
+
+
+	// compares the grid with a brute force overlap test
+	void checkQueries(Lumix::LightGrid& grid, const Lumix::Array<TestLight>& lights, Lumix::IAllocator& allocator)
+	{
+		Lumix::Array<Lumix::ComponentHandle> result(allocator);
+		for (int i = 0; i < 200; ++i)
+		{
+			float radius = i % 10 == 0 ? Lumix::Math::randFloat(50, 300) : Lumix::Math::randFloat(0.1f, 10);
+			Lumix::Sphere sphere(randomPosition(), radius);
+			result.clear();
+			grid.getLights(sphere, result);
+
+			int expected_count = 0;
+			for (int j = 0; j < lights.size(); ++j)
+			{
+				if (!lights[j].is_valid || !overlaps(lights[j], sphere)) continue;
+				++expected_count;
+				bool found = false;
+				for (Lumix::ComponentHandle cmp : result) found = found || cmp.index == j;
+				LUMIX_EXPECT(found);
+			}
+			LUMIX_EXPECT(result.size() == expected_count);
+		}
+	}
+
+
+	void UT_light_grid(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::LightGrid grid(allocator, 16);
+		Lumix::Array<TestLight> lights(allocator);
+		Lumix::Math::seedRandom(0);
+
+		for (int i = 0; i < 500; ++i)
+		{
+			TestLight& light = lights.emplace();
+			light.position = randomPosition();
+			// a few lights are too big for the grid
+			light.range = i % 50 == 0 ? 100.0f : Lumix::Math::randFloat(1, 20);
+			light.is_valid = true;
+			grid.setLight({i}, light.position, light.range);
+		}
+		LUMIX_EXPECT(grid.getLightsCount() == lights.size());
+		checkQueries(grid, lights, allocator);
+
+		for (int i = 0; i < lights.size(); i += 3)
+		{
+			lights[i].position = randomPosition();
+			grid.setLight({i}, lights[i].position, lights[i].range);
+		}
+		checkQueries(grid, lights, allocator);
+
+		int removed = 0;
+		for (int i = 0; i < lights.size(); i += 4)
+		{
+			lights[i].is_valid = false;
+			grid.removeLight({i});
+			++removed;
+		}
+		LUMIX_EXPECT(grid.getLightsCount() == lights.size() - removed);
+		checkQueries(grid, lights, allocator);
+
+		grid.clear();
+		LUMIX_EXPECT(grid.getLightsCount() == 0);
+	}
+
+} // anonymous namespace
+
+REGISTER_TEST("unit_tests/graphics/light_grid", UT_light_grid, "");
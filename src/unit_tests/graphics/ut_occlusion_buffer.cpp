@@ -0,0 +1,137 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/default_allocator.h"
+#include "engine/geometry.h"
+#include "engine/math_utils.h"
+
+#include "renderer/occlusion_buffer.h"
+
+namespace
+{
+
+	// 20x20 quad at z = 10 in front of a camera at origin looking down +z
+	const Lumix::Vec3 quad_vertices[] = {
+		{ -10.f, -10.f, 10.f },
+		{ 10.f, -10.f, 10.f },
+		{ 10.f, 10.f, 10.f },
+		{ -10.f, 10.f, 10.f }
+	};
+	const Lumix::u16 quad_indices[] = { 0, 1, 2, 0, 2, 3 };
+
+
+	Lumix::Matrix getViewProjection()
+	{
+		Lumix::Matrix view, projection;
+		view.lookAt({ 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 });
+		projection.setPerspective(Lumix::Math::degreesToRadians(60.f), 2.f, 0.1f, 1000.f, true);
+		return projection * view;
+	}
+
+
+	void UT_occlusion_buffer(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::OcclusionBuffer buffer(allocator);
+		Lumix::Matrix identity = Lumix::Matrix::IDENTITY;
+
+		buffer.clear(getViewProjection());
+		LUMIX_EXPECT(buffer.isVisible(Lumix::Sphere(0, 0, 50, 1)));
+
+		buffer.addOccluder(identity, quad_vertices, quad_indices, nullptr, Lumix::lengthOf(quad_indices));
+		LUMIX_EXPECT(buffer.getTrianglesCount() == 2);
+		buffer.rasterize(0, Lumix::OcclusionBuffer::TILE_ROWS / 2);
+		buffer.rasterize(Lumix::OcclusionBuffer::TILE_ROWS / 2, Lumix::OcclusionBuffer::TILE_ROWS);
+
+		int center_x = Lumix::OcclusionBuffer::WIDTH / 2;
+		int center_y = Lumix::OcclusionBuffer::HEIGHT / 2;
+		LUMIX_EXPECT_CLOSE_EQ(buffer.getDepth(center_x, center_y), 0.1f, 0.001f);
+		LUMIX_EXPECT(buffer.getDepth(0, 0) == 0);
+
+		// behind the quad
+		LUMIX_EXPECT(!buffer.isVisible(Lumix::Sphere(0, 0, 50, 1)));
+		LUMIX_EXPECT(!buffer.isVisible(Lumix::Sphere(30, 0, 50, 5)));
+		LUMIX_EXPECT(!buffer.isVisible(Lumix::AABB({ -1, -1, 20 }, { 1, 1, 22 }), identity));
+		// in front of the quad
+		LUMIX_EXPECT(buffer.isVisible(Lumix::Sphere(0, 0, 5, 1)));
+		LUMIX_EXPECT(buffer.isVisible(Lumix::AABB({ -1, -1, 5 }, { 1, 1, 7 }), identity));
+		// intersecting the quad
+		LUMIX_EXPECT(buffer.isVisible(Lumix::Sphere(0, 0, 10, 1)));
+		// behind the quad but sticking out of it
+		LUMIX_EXPECT(buffer.isVisible(Lumix::Sphere(60, 0, 50, 5)));
+		Lumix::Matrix above = Lumix::Matrix::IDENTITY;
+		above.setTranslation({ 0, 20, 0 });
+		LUMIX_EXPECT(buffer.isVisible(Lumix::AABB({ -1, -1, 20 }, { 1, 1, 22 }), above));
+		// behind the camera or crossing the near plane
+		LUMIX_EXPECT(buffer.isVisible(Lumix::Sphere(0, 0, -50, 1)));
+		LUMIX_EXPECT(buffer.isVisible(Lumix::Sphere(0, 0, 0, 1)));
+
+		// occluder crossing the near plane is dropped
+		buffer.clear(getViewProjection());
+		Lumix::Matrix behind = Lumix::Matrix::IDENTITY;
+		behind.setTranslation({ 0, 0, -10 });
+		buffer.addOccluder(behind, quad_vertices, quad_indices, nullptr, Lumix::lengthOf(quad_indices));
+		LUMIX_EXPECT(buffer.getTrianglesCount() == 0);
+		buffer.rasterize(0, Lumix::OcclusionBuffer::TILE_ROWS);
+		LUMIX_EXPECT(buffer.isVisible(Lumix::Sphere(0, 0, 50, 1)));
+	}
+
+
+	// model with two meshes in shared vertex and index arrays, the left and the right half of the screen;
+	// indices of each mesh are relative to its first vertex, like in Model
+	const Lumix::Vec3 two_mesh_vertices[] = {
+		{ -20.f, -10.f, 10.f },
+		{ 0.f, -10.f, 10.f },
+		{ 0.f, 10.f, 10.f },
+		{ -20.f, 10.f, 10.f },
+
+		{ 0.f, -10.f, 10.f },
+		{ 20.f, -10.f, 10.f },
+		{ 20.f, 10.f, 10.f },
+		{ 0.f, 10.f, 10.f }
+	};
+	const Lumix::u16 two_mesh_indices[] = { 0, 1, 2, 0, 2, 3, 0, 1, 2, 0, 2, 3 };
+	const int two_mesh_vertices_count[] = { 4, 4 };
+
+
+	// same as RenderScene::renderOccluders, skipped meshes still advance the vertex offset
+	void addTwoMeshOccluder(Lumix::OcclusionBuffer& buffer, const bool* is_occluder)
+	{
+		int vertex_offset = 0;
+		for (int i = 0; i < 2; ++i)
+		{
+			const Lumix::Vec3* vertices = &two_mesh_vertices[vertex_offset];
+			vertex_offset += two_mesh_vertices_count[i];
+			if (!is_occluder[i]) continue;
+
+			buffer.addOccluder(Lumix::Matrix::IDENTITY, vertices, two_mesh_indices + i * 6, nullptr, 6);
+		}
+		buffer.rasterize(0, Lumix::OcclusionBuffer::TILE_ROWS);
+	}
+
+
+	void UT_occlusion_buffer_multi_mesh(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::OcclusionBuffer buffer(allocator);
+		Lumix::Sphere left(-30, 0, 50, 5);
+		Lumix::Sphere right(30, 0, 50, 5);
+
+		buffer.clear(getViewProjection());
+		const bool both[] = { true, true };
+		addTwoMeshOccluder(buffer, both);
+		LUMIX_EXPECT(buffer.getTrianglesCount() == 4);
+		LUMIX_EXPECT(!buffer.isVisible(left));
+		LUMIX_EXPECT(!buffer.isVisible(right));
+
+		buffer.clear(getViewProjection());
+		const bool only_second[] = { false, true };
+		addTwoMeshOccluder(buffer, only_second);
+		LUMIX_EXPECT(buffer.getTrianglesCount() == 2);
+		LUMIX_EXPECT(buffer.isVisible(left));
+		LUMIX_EXPECT(!buffer.isVisible(right));
+	}
+
+} // anonymous namespace
+
+REGISTER_TEST("unit_tests/graphics/occlusion_buffer", UT_occlusion_buffer, "");
+REGISTER_TEST("unit_tests/graphics/occlusion_buffer_multi_mesh", UT_occlusion_buffer_multi_mesh, "");
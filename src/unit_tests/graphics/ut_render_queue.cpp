@@ -0,0 +1,93 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+
+#include "engine/default_allocator.h"
+#include "engine/math_utils.h"
+
+#include "renderer/render_queue.h"
+
+namespace
+{
+
+
+	void UT_render_queue_sort(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::RenderQueue queue(allocator);
+		Lumix::Math::seedRandom(7);
+
+		static const int COUNT = 10000;
+		Lumix::u64 keys[COUNT];
+		for (int j = 0; j < 3; ++j)
+		{
+			queue.reset(COUNT);
+			for (int i = 0; i < COUNT; ++i)
+			{
+				// only some digits differ in the first iterations, their passes are skipped
+				Lumix::u64 key = Lumix::u64(Lumix::Math::rand()) << 32 | Lumix::u64(Lumix::Math::rand());
+				if (j == 0) key &= 0xff000000000000ffULL;
+				if (j == 1) key &= 0x0000ffff00000000ULL;
+				keys[i] = key;
+				queue.setKey(i, key);
+			}
+			queue.sort();
+
+			for (int i = 0; i < COUNT; ++i)
+			{
+				LUMIX_EXPECT(queue.getKey(i) == keys[queue.getValue(i)]);
+				if (i > 0) LUMIX_EXPECT(queue.getKey(i - 1) <= queue.getKey(i));
+			}
+		}
+
+		// radix sort is stable
+		queue.reset(COUNT);
+		for (int i = 0; i < COUNT; ++i) queue.setKey(i, i % 10);
+		queue.sort();
+		for (int i = 1; i < COUNT; ++i)
+		{
+			if (queue.getKey(i - 1) == queue.getKey(i)) LUMIX_EXPECT(queue.getValue(i - 1) < queue.getValue(i));
+		}
+
+		queue.reset(0);
+		queue.sort();
+		LUMIX_EXPECT(queue.size() == 0);
+	}
+
+
+	void UT_render_queue_key(const char* params)
+	{
+		int material_a, material_b, mesh_a, mesh_b, shader_a, shader_b;
+
+		// view and layer have priority over everything else
+		LUMIX_EXPECT(Lumix::RenderQueue::makeKey(0, 5, 0, &shader_a, &material_a, &mesh_a, 1000, false)
+			< Lumix::RenderQueue::makeKey(1, 0, 0, &shader_b, &material_b, &mesh_b, 0, false));
+		LUMIX_EXPECT(Lumix::RenderQueue::makeKey(1, 0, 3, &shader_a, &material_a, &mesh_a, 1000, false)
+			< Lumix::RenderQueue::makeKey(1, 1, 0, &shader_b, &material_b, &mesh_b, 0, false));
+
+		// instances of the same mesh are sorted front to back
+		Lumix::u64 near = Lumix::RenderQueue::makeKey(2, 3, 0, &shader_a, &material_a, &mesh_a, 10, false);
+		Lumix::u64 far = Lumix::RenderQueue::makeKey(2, 3, 0, &shader_a, &material_a, &mesh_a, 1000, false);
+		LUMIX_EXPECT(near < far);
+		LUMIX_EXPECT((near >> 12) == (far >> 12));
+
+		// same state does not depend on depth
+		Lumix::u64 other_mesh = Lumix::RenderQueue::makeKey(2, 3, 0, &shader_a, &material_a, &mesh_b, 10, false);
+		LUMIX_EXPECT((near >> 28) == (other_mesh >> 28));
+		LUMIX_EXPECT(Lumix::RenderQueue::makeKey(0, 0, 0, &shader_a, &material_a, &mesh_a, -1, false)
+			== Lumix::RenderQueue::makeKey(0, 0, 0, &shader_a, &material_a, &mesh_a, 0, false));
+
+		// alpha blended instances are sorted back to front, without touching the other bits
+		Lumix::u64 blended_near = Lumix::RenderQueue::makeKey(2, 3, 0, &shader_a, &material_a, &mesh_a, 10, true);
+		Lumix::u64 blended_far = Lumix::RenderQueue::makeKey(2, 3, 0, &shader_a, &material_a, &mesh_a, 1000, true);
+		LUMIX_EXPECT(blended_far < blended_near);
+		LUMIX_EXPECT((blended_near >> 12) == (near >> 12));
+		LUMIX_EXPECT((blended_far >> 12) == (far >> 12));
+		LUMIX_EXPECT(Lumix::RenderQueue::makeKey(2, 3, 0, &shader_a, &material_a, &mesh_a, 1e30f, true)
+			< Lumix::RenderQueue::makeKey(2, 3, 0, &shader_a, &material_a, &mesh_a, 0, true));
+	}
+
+
+} // anonymous namespace
+
+
+REGISTER_TEST("unit_tests/graphics/render_queue_sort", UT_render_queue_sort, "")
+REGISTER_TEST("unit_tests/graphics/render_queue_key", UT_render_queue_key, "")